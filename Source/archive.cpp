@@ -0,0 +1,206 @@
+#include "archive.h"
+
+// Returns true if the path is an archive that can be extracted in place of an input folder (e.g. a Bandcamp .zip download)
+bool isArchiveFile(QString inputPath) {
+    QFileInfo inputInfo(inputPath);
+    return inputInfo.isFile() && QStringList({"zip", "7z", "tar"}).contains(inputInfo.suffix().toLower());
+}
+
+// Reads the list of files and folders inside an archive through 7-Zip's technical listing (-slt)
+// isSolid is set for archives that compress everything as one stream (usually .7z), where single entries can't be read independently
+bool listArchiveEntries(QString inputArchive, QList<archiveEntry_t> *entries, bool *isSolid) {
+    QString programLocation = checkInstalledProgram("sDefaultSevenZipLocation", "7z");
+    if(programLocation == "") {
+        return false;
+    }
+
+    // 7-Zip arguments
+    // l: list
+    // -slt: technical listing, one "Key = Value" line per property
+    // -sccUTF-8: print names as UTF-8 regardless of the console's code page
+    // --: stop parsing switches, in case the archive's name starts with a dash
+    QStringList arguments;
+    arguments << "l" << "-slt" << "-sccUTF-8" << "--" << QDir::toNativeSeparators(inputArchive);
+
+    // Start, and read the listing until 7-Zip exits
+    SupervisedProcess SevenZipProcess({programLocation, arguments, ""});
+    QByteArray SevenZipOutput;
+    if(!SevenZipProcess.start()) {
+        return false;
+    }
+    while(SevenZipProcess.readOutput(&SevenZipOutput)) {
+    }
+    if(!SevenZipProcess.finish()) {
+        return false;
+    }
+
+    // The archive's own properties come first, then a line of dashes, then one block of properties per entry separated by blank lines
+    QStringList listing = QString::fromUtf8(SevenZipOutput).split('\n');
+    bool inEntries = false;
+    archiveEntry_t currentEntry{"", 0, false};
+    *isSolid = false;
+
+    // An extra blank line at the end makes sure the last entry gets added
+    listing += "";
+    foreach(QString line, listing) {
+        line = line.trimmed();
+
+        if(!inEntries) {
+            if(line == "Solid = +") {
+                *isSolid = true;
+            }
+            else if(line.startsWith("----------")) {
+                inEntries = true;
+            }
+            continue;
+        }
+
+        // End of an entry's block
+        if(line.isEmpty()) {
+            if(!currentEntry.path.isEmpty()) {
+                entries->append(currentEntry);
+            }
+            currentEntry = archiveEntry_t{"", 0, false};
+            continue;
+        }
+
+        QString key = line.section(" = ", 0, 0);
+        QString value = line.section(" = ", 1);
+        if(key == "Path") {
+            currentEntry.path = QDir::fromNativeSeparators(value);
+        }
+        else if(key == "Size") {
+            currentEntry.size = value.toLongLong();
+        }
+        // Some formats mark folders with "Folder = +", others only through a "D" in their attributes
+        else if((key == "Folder" && value == "+") || (key == "Attributes" && value.startsWith('D'))) {
+            currentEntry.isFolder = true;
+        }
+    }
+
+    return true;
+}
+
+// Streams a single entry out of an archive into outputFile without any intermediate copy
+// With convertWav, the entry is piped straight into FLAC instead, so the WAV is never written anywhere
+bool extractArchiveEntry(QString inputArchive, QString entryPath, QString outputFile, bool convertWav) {
+    QString programLocation = checkInstalledProgram("sDefaultSevenZipLocation", "7z");
+    if(programLocation == "") {
+        return false;
+    }
+
+    // 7-Zip arguments
+    // x: extract with full paths
+    // -so: write the extracted data to stdout
+    // -spd: treat the entry name literally instead of as a wildcard
+    // --: stop parsing switches
+    QStringList arguments;
+    arguments << "x" << "-so" << "-spd" << "--" << QDir::toNativeSeparators(inputArchive) << QDir::toNativeSeparators(entryPath);
+
+    if(!convertWav) {
+        // The OS writes 7-Zip's output straight into the file
+        return runProcess({{programLocation, arguments, outputFile}}).succeeded();
+    }
+    processJob_t SevenZipJob{programLocation, arguments, ""};
+
+    programLocation = checkInstalledProgram("sDefaultFLACLocation", "flac");
+    if(programLocation == "") {
+        return false;
+    }
+
+    // FLAC arguments
+    // -f: force
+    // -V: verify
+    // -8: level 8 compression (highest)
+    // -: read the WAV from stdin
+    // -o: output location
+    arguments.clear();
+    arguments << "-f" << "-V" << "-8" << "-" << "-o" << QDir::toNativeSeparators(outputFile);
+
+    // Run 7-Zip with its stdout connected to FLAC's stdin, and wait. FLAC finishes once 7-Zip closes the pipe
+    // FLAC also succeeds on a WAV that 7-Zip cut short, so both have to have succeeded
+    if(!runProcess({SevenZipJob, {programLocation, arguments, ""}}).succeeded()) {
+        QFile::remove(outputFile);
+        return false;
+    }
+    return true;
+}
+
+// Extracts an archive into outputDir, reading independent entries in parallel
+// With convertWavs, WAV entries are encoded to FLAC on the way out. Returns the list of files that were written
+QStringList extractArchive(QString inputArchive, QDir outputDir, bool convertWavs) {
+    QList<archiveEntry_t> entries;
+    bool isSolid = false;
+    if(!listArchiveEntries(inputArchive, &entries, &isSolid)) {
+        return QStringList{};
+    }
+
+    // Initialize a pool for parallel threads. Default number of parallel threads is equal to processor's logical core count
+    QThreadPool extractPool;
+
+    // Reading entries of a solid archive one at a time would decompress everything before each one again, so extract it all in one go
+    if(isSolid) {
+        // 7-Zip arguments
+        // x: extract with full paths
+        // -y: answer yes to any prompts (e.g. overwriting)
+        // -o: output folder (no space between switch and path)
+        // --: stop parsing switches
+        QStringList arguments;
+        arguments << "x" << "-y" << "-o" + QDir::toNativeSeparators(outputDir.path()) << "--" << QDir::toNativeSeparators(inputArchive);
+
+        // Whatever a failed extraction left behind may be truncated, so none of it is reported
+        if(!runProcess({{checkInstalledProgram("sDefaultSevenZipLocation", "7z"), arguments, ""}}).succeeded()) {
+            return QStringList{};
+        }
+
+        // The WAVs had to be written here, so convert them in place
+        if(convertWavs) {
+            foreach(QString currentWAV, findFiles(outputDir, {"*.wav"})) {
+                QtConcurrent::run(&extractPool, convertWAV, currentWAV, QString(""));
+            }
+            extractPool.waitForDone();
+        }
+
+        return findFiles(outputDir);
+    }
+
+    QStringList outputFiles;
+    // QList that will hold the QFuture of every thread we launch, allowing us to launch many threads and check their results later
+    QList<QFuture<bool>> futureList;
+
+    foreach(archiveEntry_t currentEntry, entries) {
+        // Never let an entry write outside of outputDir (e.g. "../../file" or an absolute path)
+        QString cleanPath = QDir::cleanPath(currentEntry.path);
+        if(cleanPath.startsWith("../") || cleanPath == ".." || QDir::isAbsolutePath(cleanPath)) {
+            continue;
+        }
+
+        QString outputPath = outputDir.path() + "/" + cleanPath;
+        if(currentEntry.isFolder) {
+            QDir().mkpath(outputPath);
+            continue;
+        }
+
+        // Make sure the path for this new file exists
+        QDir().mkpath(QFileInfo(outputPath).path());
+
+        bool convertWav = convertWavs && QFileInfo(outputPath).suffix().toLower() == "wav";
+        if(convertWav) {
+            outputPath = outputPath.left(outputPath.length() - 3) + "flac";
+        }
+
+        outputFiles += outputPath;
+        futureList.append(QtConcurrent::run(&extractPool, extractArchiveEntry, inputArchive, currentEntry.path, outputPath, convertWav));
+    }
+    extractPool.waitForDone();
+
+    // Only report the files that were actually extracted
+    QStringList extractedFiles;
+    for(int i = 0; i < futureList.count(); i++) {
+        if(futureList[i].result()) {
+            extractedFiles += outputFiles[i];
+        }
+    }
+
+    return extractedFiles;
+}
@@ -0,0 +1,22 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <helper.h>
+#include <processsupervisor.h>
+
+#include <QFileInfo>
+
+// One file or folder inside an archive, as listed by 7-Zip
+struct archiveEntry_t {
+    // Path inside the archive, with forward slashes
+    QString path;
+    qint64 size;
+    bool isFolder;
+};
+
+bool isArchiveFile(QString inputPath);
+bool listArchiveEntries(QString inputArchive, QList<archiveEntry_t> *entries, bool *isSolid);
+bool extractArchiveEntry(QString inputArchive, QString entryPath, QString outputFile, bool convertWav);
+QStringList extractArchive(QString inputArchive, QDir outputDir, bool convertWavs);
+
+#endif // ARCHIVE_H
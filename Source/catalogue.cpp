@@ -0,0 +1,248 @@
+#include "catalogue.h"
+
+// Opens (creating it on first use) the catalogue of imported albums
+// SQLite connections can't be shared between threads, so every call gets a connection of its own, named by a counter rather than the thread
+// (thread ids are reused), which is handed back with closeCatalogue once nothing uses it anymore
+QSqlDatabase openCatalogue() {
+    static QAtomicInteger<quint64> connectionCount;
+    QString connectionName = "catalogue-" + QString::number(connectionCount.fetchAndAddRelaxed(1));
+
+    QString catalogueDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(catalogueDir);
+
+    QSqlDatabase catalogue = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    catalogue.setDatabaseName(catalogueDir + "/" + CATALOGUE_FILE_NAME);
+    // Several albums can finish at once, so wait for the other writers instead of failing
+    catalogue.setConnectOptions("QSQLITE_BUSY_TIMEOUT=10000");
+    if(!catalogue.open()) {
+        return catalogue;
+    }
+
+    // Create the tables once per run
+    static QMutex schemaMutex;
+    static bool schemaCreated = false;
+    QMutexLocker schemaLocker(&schemaMutex);
+    if(!schemaCreated) {
+        QSqlQuery query(catalogue);
+        // WAL lets the history window read while an album is being written
+        query.exec("PRAGMA journal_mode=WAL");
+        query.exec("CREATE TABLE IF NOT EXISTS albums ("
+                   "id INTEGER PRIMARY KEY, artist TEXT, album TEXT, input_path TEXT, output_path TEXT, "
+                   "codec TEXT, preset TEXT, tool_versions TEXT, imported_at INTEGER)");
+        query.exec("CREATE TABLE IF NOT EXISTS tracks ("
+                   "id INTEGER PRIMARY KEY, album_id INTEGER REFERENCES albums(id), input_name TEXT, audio_md5 TEXT, "
+                   "sample_rate INTEGER, bits_per_sample INTEGER, output_file TEXT, output_sha256 TEXT, output_size INTEGER, track_gain TEXT)");
+        query.exec("CREATE TABLE IF NOT EXISTS stages ("
+                   "album_id INTEGER REFERENCES albums(id), stage TEXT, milliseconds INTEGER)");
+        // Loudness scans by audio MD5 (see readLoudnessCache), so audio that comes back doesn't have to be decoded again
+        query.exec("CREATE TABLE IF NOT EXISTS loudness ("
+                   "audio_md5 TEXT PRIMARY KEY, integrated_loudness REAL, true_peak REAL, track_gain REAL, track_range REAL, "
+                   "gating_histogram BLOB, short_term_histogram BLOB)");
+        // Lookups before converting go by audio MD5, so they stay instant no matter how big the catalogue gets
+        query.exec("CREATE INDEX IF NOT EXISTS tracks_audio_md5 ON tracks(audio_md5)");
+        query.exec("CREATE INDEX IF NOT EXISTS stages_album_id ON stages(album_id)");
+        schemaCreated = true;
+    }
+
+    return catalogue;
+}
+
+// Closes a connection from openCatalogue and removes it. Every QSqlQuery (and model) that used it must be gone by then
+void closeCatalogue(QSqlDatabase *catalogue) {
+    QString connectionName = catalogue->connectionName();
+    catalogue->close();
+    *catalogue = QSqlDatabase();
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+// Writes an album and everything that belongs to it in one transaction
+static bool writeCatalogueAlbum(QSqlDatabase catalogue, catalogueAlbum_t *album) {
+    if(!catalogue.isOpen() || !catalogue.transaction()) {
+        return false;
+    }
+
+    QSqlQuery query(catalogue);
+    query.prepare("INSERT INTO albums (artist, album, input_path, output_path, codec, preset, tool_versions, imported_at) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+    query.addBindValue(album->artist);
+    query.addBindValue(album->album);
+    query.addBindValue(QDir::toNativeSeparators(album->inputPath));
+    query.addBindValue(QDir::toNativeSeparators(album->outputPath));
+    query.addBindValue(album->codec);
+    query.addBindValue(album->preset);
+    query.addBindValue(album->toolVersions);
+    query.addBindValue(QDateTime::currentSecsSinceEpoch());
+    if(!query.exec()) {
+        catalogue.rollback();
+        return false;
+    }
+    qint64 albumID = query.lastInsertId().toLongLong();
+
+    query.prepare("INSERT INTO tracks (album_id, input_name, audio_md5, sample_rate, bits_per_sample, output_file, output_sha256, output_size, track_gain) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    foreach(catalogueTrack_t currentTrack, album->tracks) {
+        query.addBindValue(albumID);
+        query.addBindValue(QFileInfo(currentTrack.inputFLAC).fileName());
+        query.addBindValue(currentTrack.audioMD5);
+        query.addBindValue(currentTrack.sampleRate);
+        query.addBindValue(currentTrack.bitsPerSample);
+        query.addBindValue(QDir::toNativeSeparators(currentTrack.outputFile));
+        query.addBindValue(currentTrack.outputSHA256);
+        query.addBindValue(currentTrack.outputSize);
+        query.addBindValue(currentTrack.trackGain);
+        if(!query.exec()) {
+            catalogue.rollback();
+            return false;
+        }
+    }
+
+    query.prepare("INSERT INTO stages (album_id, stage, milliseconds) VALUES (?, ?, ?)");
+    foreach(QString stage, album->stageTimings.keys()) {
+        query.addBindValue(albumID);
+        query.addBindValue(stage);
+        query.addBindValue(album->stageTimings.value(stage));
+        if(!query.exec()) {
+            catalogue.rollback();
+            return false;
+        }
+    }
+
+    return catalogue.commit();
+}
+
+// Stores an album that finished converting, along with its tracks and stage timings
+bool recordCatalogueAlbum(catalogueAlbum_t *album) {
+    QSqlDatabase catalogue = openCatalogue();
+    bool recorded = writeCatalogueAlbum(catalogue, album);
+    closeCatalogue(&catalogue);
+    return recorded;
+}
+
+// Finds the previous import that shares the most of audioMD5s, the most recent one if several share as many
+static bool queryCatalogueMatch(QSqlDatabase catalogue, QStringList audioMD5s, QString codec, QString preset, catalogueMatch_t *match) {
+    if(!catalogue.isOpen()) {
+        return false;
+    }
+
+    // One placeholder per MD5
+    QStringList placeholders;
+    for(int i = 0; i < audioMD5s.count(); i++) {
+        placeholders += "?";
+    }
+
+    QSqlQuery query(catalogue);
+    query.prepare("SELECT COUNT(DISTINCT tracks.audio_md5), albums.artist, albums.album, albums.output_path, albums.imported_at "
+                  "FROM tracks JOIN albums ON albums.id = tracks.album_id "
+                  "WHERE albums.codec = ? AND albums.preset = ? AND tracks.audio_md5 IN (" + placeholders.join(", ") + ") "
+                  "GROUP BY albums.id ORDER BY COUNT(DISTINCT tracks.audio_md5) DESC, albums.imported_at DESC LIMIT 1");
+    query.addBindValue(codec);
+    query.addBindValue(preset);
+    foreach(QString audioMD5, audioMD5s) {
+        query.addBindValue(audioMD5);
+    }
+
+    if(!query.exec() || !query.next()) {
+        return false;
+    }
+
+    match->matchedTracks = query.value(0).toInt();
+    match->artist = query.value(1).toString();
+    match->album = query.value(2).toString();
+    match->outputPath = query.value(3).toString();
+    match->importedAt = QDateTime::fromSecsSinceEpoch(query.value(4).toLongLong());
+    return true;
+}
+
+// Looks up whether any of this audio was already imported with the same codec and preset
+// Fills match with the import that has the most of it (the most recent one on a tie) and returns true if there was one
+bool findCatalogueMatch(QStringList audioMD5s, QString codec, QString preset, catalogueMatch_t *match) {
+    audioMD5s.removeAll(QString(""));
+    if(audioMD5s.isEmpty()) {
+        return false;
+    }
+
+    QSqlDatabase catalogue = openCatalogue();
+    bool found = queryCatalogueMatch(catalogue, audioMD5s, codec, preset, match);
+    closeCatalogue(&catalogue);
+    return found;
+}
+
+// Describes a previous import for the user, e.g. "All 12 tracks were already imported on 2020-01-01 (Artist - Album, into /music/...)"
+QString describeCatalogueMatch(catalogueMatch_t match, int totalTracks) {
+    QString description = match.matchedTracks >= totalTracks ? "All " + QString::number(totalTracks) + " tracks were" : QString::number(match.matchedTracks) + " of " + QString::number(totalTracks) + " tracks were";
+    return description + " already imported on " + match.importedAt.toString("yyyy-MM-dd hh:mm") + " (" + match.artist + " - " + match.album + ", into " + match.outputPath + ")";
+}
+
+// Reads the version line of a program, e.g. "flac 1.3.3"
+static QString getProgramVersion(QString location, QString programName) {
+    QString programLocation = checkInstalledProgram(location, programName);
+    if(programLocation == "") {
+        return "";
+    }
+
+    SupervisedProcess versionProcess({programLocation, {"--version"}, ""});
+    QByteArray versionOutput;
+    if(!versionProcess.start()) {
+        return "";
+    }
+    while(versionProcess.readOutput(&versionOutput)) {
+    }
+    versionProcess.finish();
+
+    return QString::fromUtf8(versionOutput).section('\n', 0, 0).trimmed();
+}
+
+// Versions of the encoders used for codec, separated by "; "
+// Encoders don't change while the program is running, so each codec is only asked once
+QString getToolVersions(QString codec) {
+    static QMutex versionMutex;
+    static QMap<QString, QString> versionCache;
+    QMutexLocker versionLocker(&versionMutex);
+
+    if(!versionCache.contains(codec)) {
+        // FLAC decodes the input for every codec
+        QStringList versions;
+        versions += getProgramVersion("sDefaultFLACLocation", "flac");
+        if(codec == "MP3") {
+            versions += getProgramVersion("sDefaultLAMELocation", "lame");
+        }
+        else if(codec == "Opus") {
+            versions += getProgramVersion("sDefaultOpusLocation", "opusenc");
+        }
+        versions.removeAll(QString(""));
+        versionCache.insert(codec, versions.join("; "));
+    }
+
+    return versionCache.value(codec);
+}
+
+// SHA-256 of a file's contents, as a hex string
+QString getFileSHA256(QString inputFile) {
+    QFile hashFile(inputFile);
+    if(!hashFile.open(QIODevice::ReadOnly)) {
+        return "";
+    }
+
+    QCryptographicHash fileHash(QCryptographicHash::Sha256);
+    fileHash.addData(&hashFile);
+    return QString(fileHash.result().toHex());
+}
+
+// Reads the track gain that ReplayGain wrote to a FLAC, MP3 or Opus (R128 for Opus)
+QString readTrackGain(QString inputFile) {
+#if defined(Q_OS_LINUX)
+    TagLib::FileRef inputTagFile(inputFile.toStdString().data());
+#elif defined(Q_OS_WIN)
+    TagLib::FileRef inputTagFile(inputFile.toStdWString().data());
+#endif
+    if(inputTagFile.isNull()) {
+        return "";
+    }
+
+    TagLib::PropertyMap inputTagMap = inputTagFile.file()->properties();
+    if(inputTagMap.contains("REPLAYGAIN_TRACK_GAIN")) {
+        return TStringToQString(inputTagMap["REPLAYGAIN_TRACK_GAIN"].front());
+    }
+    if(inputTagMap.contains("R128_TRACK_GAIN")) {
+        return "R128 " + TStringToQString(inputTagMap["R128_TRACK_GAIN"].front());
+    }
+    return "";
+}
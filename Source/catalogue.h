@@ -0,0 +1,69 @@
+#ifndef CATALOGUE_H
+#define CATALOGUE_H
+
+#include <helper.h>
+#include <processsupervisor.h>
+
+#include <QAtomicInteger>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QThread>
+
+#include <fileref.h>
+
+// File name of the catalogue database, kept in the application's data folder
+#define CATALOGUE_FILE_NAME "catalogue.sqlite"
+
+// One converted track, as stored in the catalogue
+struct catalogueTrack_t {
+    QString inputFLAC;
+    // STREAMINFO MD5 of the decoded audio, which identifies the audio regardless of tags or compression level
+    QString audioMD5;
+    int sampleRate;
+    int bitsPerSample;
+    QString outputFile;
+    QString outputSHA256;
+    qint64 outputSize;
+    // ReplayGain/R128 track gain as written to the output, if any
+    QString trackGain;
+};
+
+// One conversion of an album, as stored in the catalogue
+struct catalogueAlbum_t {
+    QString artist;
+    QString album;
+    QString inputPath;
+    QString outputPath;
+    QString codec;
+    QString preset;
+    // Version lines of the encoders that were used
+    QString toolVersions;
+    QList<catalogueTrack_t> tracks;
+    // Milliseconds spent in each stage of the conversion, by stage name
+    QMap<QString, qint64> stageTimings;
+};
+
+// A previous import that matched some of the audio being converted
+struct catalogueMatch_t {
+    int matchedTracks;
+    QString artist;
+    QString album;
+    QString outputPath;
+    QDateTime importedAt;
+};
+
+QSqlDatabase openCatalogue();
+void closeCatalogue(QSqlDatabase *catalogue);
+bool recordCatalogueAlbum(catalogueAlbum_t *album);
+bool findCatalogueMatch(QStringList audioMD5s, QString codec, QString preset, catalogueMatch_t *match);
+QString describeCatalogueMatch(catalogueMatch_t match, int totalTracks);
+QString getToolVersions(QString codec);
+QString getFileSHA256(QString inputFile);
+QString readTrackGain(QString inputFile);
+
+#endif // CATALOGUE_H
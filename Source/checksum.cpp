@@ -0,0 +1,141 @@
+#include "checksum.h"
+
+// SHA-256 of a file as read from disk, skipping the page cache where the OS allows it
+static QString readBackSHA256(QString path) {
+    // Dropping the file first makes the read come from the disk rather than from the pages that were just written
+    pageCacheStats_t readBackStats{};
+    dropFileCache(path, &readBackStats);
+    return getFileSHA256(path);
+}
+
+// Copies a file block by block, hashing each block as it goes by. Like QFile::copy, an existing file is never overwritten
+// The hash is recorded for toPath. If checksumSet asks for it, the copy is also read back and compared
+bool copyWithChecksum(QString fromPath, QString toPath, checksumSet_t *checksumSet) {
+    QFile inputFile(fromPath);
+    if(QFile::exists(toPath) || !inputFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QSaveFile outputFile(toPath);
+    if(!outputFile.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QCryptographicHash copyHash(QCryptographicHash::Sha256);
+    QByteArray copyBuffer(CHECKSUM_COPY_BLOCK_SIZE, Qt::Uninitialized);
+    forever {
+        qint64 readBytes = inputFile.read(copyBuffer.data(), CHECKSUM_COPY_BLOCK_SIZE);
+        if(readBytes == 0) {
+            break;
+        }
+        if(readBytes < 0 || outputFile.write(copyBuffer.constData(), readBytes) != readBytes) {
+            outputFile.cancelWriting();
+            break;
+        }
+        copyHash.addData(copyBuffer.constData(), static_cast<int>(readBytes));
+    }
+    inputFile.close();
+
+    if(!outputFile.commit()) {
+        return false;
+    }
+    QFile::setPermissions(toPath, QFile::permissions(fromPath));
+
+    QString sha256 = QString(copyHash.result().toHex());
+    recordChecksum(checksumSet, toPath, sha256);
+
+    if(checksumSet->verify && readBackSHA256(toPath) != sha256) {
+        QMutexLocker checksumLocker(&checksumSet->checksumMutex);
+        checksumSet->mismatchedFiles += toPath;
+        return false;
+    }
+    return true;
+}
+
+// Remembers a hash that was just taken of path, along with the file's current size and modification time
+void recordChecksum(checksumSet_t *checksumSet, QString path, QString sha256) {
+    if(sha256 == "") {
+        return;
+    }
+
+    QFileInfo fileInfo(path);
+    QMutexLocker checksumLocker(&checksumSet->checksumMutex);
+    checksumSet->checksums.insert(path, fileChecksum_t{sha256, fileInfo.size(), fileInfo.lastModified().toMSecsSinceEpoch()});
+}
+
+// Keeps a file's hash when it's renamed or moved (which changes neither its size nor its modification time)
+void moveChecksum(checksumSet_t *checksumSet, QString fromPath, QString toPath) {
+    QMutexLocker checksumLocker(&checksumSet->checksumMutex);
+    if(checksumSet->checksums.contains(fromPath)) {
+        checksumSet->checksums.insert(toPath, checksumSet->checksums.take(fromPath));
+    }
+}
+
+// The hash of path, from the set if the file hasn't changed since, or else hashed now (the file was usually just written, so it's read from cache)
+QString lookUpChecksum(checksumSet_t *checksumSet, QString path) {
+    QFileInfo fileInfo(path);
+    {
+        QMutexLocker checksumLocker(&checksumSet->checksumMutex);
+        fileChecksum_t checksum = checksumSet->checksums.value(path, fileChecksum_t{"", -1, -1});
+        if(checksum.sha256 != "" && checksum.size == fileInfo.size() && checksum.modifiedAt == fileInfo.lastModified().toMSecsSinceEpoch()) {
+            return checksum.sha256;
+        }
+    }
+
+    QString sha256 = getFileSHA256(path);
+    recordChecksum(checksumSet, path, sha256);
+    return sha256;
+}
+
+// Writes baseName.sha256 (every file in albumDir, in sha256sum's format) and baseName.ffp (every FLAC's STREAMINFO MD5) into albumDir
+// Paths are relative to albumDir. Returns the manifests that were written
+QStringList writeChecksumManifests(QDir albumDir, QString baseName, checksumSet_t *checksumSet) {
+    QString sha256Path = albumDir.filePath(baseName + ".sha256");
+    QString ffpPath = albumDir.filePath(baseName + ".ffp");
+
+    QStringList albumFiles = findFiles(albumDir, {"*"});
+    albumFiles.removeAll(sha256Path);
+    albumFiles.removeAll(ffpPath);
+    albumFiles.sort();
+
+    QStringList sha256Lines;
+    QStringList ffpLines;
+    foreach(QString albumFile, albumFiles) {
+        QString relativePath = albumDir.relativeFilePath(albumFile);
+        // Folders still being cleaned up by the conversion (e.g. the extras folder) aren't part of the album
+        if(relativePath.startsWith(".qMusicImportKit ") || relativePath.contains("/.qMusicImportKit ")) {
+            continue;
+        }
+
+        QString sha256 = lookUpChecksum(checksumSet, albumFile);
+        if(sha256 != "") {
+            sha256Lines += sha256 + "  " + relativePath;
+        }
+
+        // The audio MD5 only needs the FLAC's header, so this doesn't read the file again
+        if(QFileInfo(albumFile).suffix().toLower() == "flac") {
+            FLACMetadataReader albumFileMetadata(albumFile);
+            QByteArray audioMD5 = albumFileMetadata.audioMD5();
+            if(!audioMD5.isEmpty()) {
+                ffpLines += relativePath + ":" + QString(audioMD5.toHex());
+            }
+        }
+    }
+
+    QStringList manifestFiles;
+    QList<QPair<QString, QStringList>> manifests = {{sha256Path, sha256Lines}, {ffpPath, ffpLines}};
+    foreach(auto manifest, manifests) {
+        if(manifest.second.isEmpty()) {
+            continue;
+        }
+        QSaveFile manifestFile(manifest.first);
+        if(manifestFile.open(QIODevice::WriteOnly)) {
+            manifestFile.write((manifest.second.join("\n") + "\n").toUtf8());
+            if(manifestFile.commit()) {
+                manifestFiles += manifest.first;
+            }
+        }
+    }
+
+    return manifestFiles;
+}
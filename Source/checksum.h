@@ -0,0 +1,39 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <catalogue.h>
+#include <flacmetadata.h>
+#include <helper.h>
+#include <pagecache.h>
+
+#include <QCryptographicHash>
+#include <QHash>
+#include <QMutex>
+
+// Size of each block copied (and hashed) at once
+#define CHECKSUM_COPY_BLOCK_SIZE (4 * 1024 * 1024)
+
+// A file's SHA-256, and the size and modification time it had when it was hashed
+struct fileChecksum_t {
+    QString sha256;
+    qint64 size;
+    qint64 modifiedAt;
+};
+
+// SHA-256s of files, taken while they were copied or right after they were written, so manifests never need a pass of their own
+// A hash is only used while its file's size and modification time haven't changed (e.g. images compressed after being copied are hashed again)
+struct checksumSet_t {
+    QMutex checksumMutex;
+    QHash<QString, fileChecksum_t> checksums;
+    // With verify set, every copy is read back from disk and compared to its source's hash; copies that didn't match are listed here
+    bool verify;
+    QStringList mismatchedFiles;
+};
+
+bool copyWithChecksum(QString fromPath, QString toPath, checksumSet_t *checksumSet);
+void recordChecksum(checksumSet_t *checksumSet, QString path, QString sha256);
+void moveChecksum(checksumSet_t *checksumSet, QString fromPath, QString toPath);
+QString lookUpChecksum(checksumSet_t *checksumSet, QString path);
+QStringList writeChecksumManifests(QDir albumDir, QString baseName, checksumSet_t *checksumSet);
+
+#endif // CHECKSUM_H
@@ -0,0 +1,53 @@
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+// Runtime CPU feature checks for the hand-vectorized kernels
+// Kernels are compiled for their instruction set with target attributes and only called when the running CPU reports support,
+// so a single binary runs everywhere and still uses the fastest path available
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MIK_X86_KERNELS
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || (defined(__ARM_NEON) && defined(__arm__))
+#define MIK_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+// Returns true if the CPU can run the AVX2+FMA kernels
+inline bool cpuSupportsAVX2() {
+#if defined(MIK_X86_KERNELS)
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// Returns true if the CPU has the SHA extensions (SHA-NI), along with the SSE4.1 their kernels shuffle with
+inline bool cpuSupportsSHA() {
+#if defined(MIK_X86_KERNELS)
+    static const bool supported = []() {
+        unsigned int eax, ebx, ecx, edx;
+        // Leaf 7 EBX bit 29 is SHA; older compilers don't know it as a __builtin_cpu_supports name
+        return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 29)) && __builtin_cpu_supports("sse4.1");
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// Returns true if the CPU has carry-less multiplication (PCLMULQDQ), along with the SSE4.1 the CRC kernel extracts its result with
+inline bool cpuSupportsPCLMUL() {
+#if defined(MIK_X86_KERNELS)
+    static const bool supported = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+#endif // CPUFEATURES_H
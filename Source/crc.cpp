@@ -0,0 +1,184 @@
+#include "crc.h"
+#include "cpufeatures.h"
+
+// CRC-32 as used by zip, PNG, EAC's Copy CRCs and XLD's CRC32 hashes (reflected polynomial 0xEDB88320)
+// Rip logs are checked against every sample of an album, so the bulk of it is folded 64 bytes at a time with carry-less multiplication
+// ("Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction", Intel, 2009). Other CPUs and the odd bytes go through slicing-by-8 tables
+
+#define CRC32_POLYNOMIAL 0xEDB88320u
+
+// crcTables[0] is the usual byte-at-a-time table; crcTables[k] advances a byte that is followed by k more
+static const quint32 (*crcTables())[256] {
+    static quint32 tables[8][256];
+    static const bool built = []() {
+        for(quint32 i = 0; i < 256; i++) {
+            quint32 crc = i;
+            for(int bit = 0; bit < 8; bit++) {
+                crc = (crc & 1) ? (crc >> 1) ^ CRC32_POLYNOMIAL : crc >> 1;
+            }
+            tables[0][i] = crc;
+        }
+        for(quint32 i = 0; i < 256; i++) {
+            for(int k = 1; k < 8; k++) {
+                tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+            }
+        }
+        return true;
+    }();
+    Q_UNUSED(built);
+    return tables;
+}
+
+// Table CRC over the pre-inverted state
+static quint32 crc32Tables(quint32 crc, const unsigned char *data, qint64 length) {
+    const quint32 (*tables)[256] = crcTables();
+
+    while(length >= 8) {
+        quint32 low = crc ^ (static_cast<quint32>(data[0]) | (static_cast<quint32>(data[1]) << 8) | (static_cast<quint32>(data[2]) << 16) | (static_cast<quint32>(data[3]) << 24));
+        quint32 high = static_cast<quint32>(data[4]) | (static_cast<quint32>(data[5]) << 8) | (static_cast<quint32>(data[6]) << 16) | (static_cast<quint32>(data[7]) << 24);
+        crc = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF] ^ tables[5][(low >> 16) & 0xFF] ^ tables[4][low >> 24]
+              ^ tables[3][high & 0xFF] ^ tables[2][(high >> 8) & 0xFF] ^ tables[1][(high >> 16) & 0xFF] ^ tables[0][high >> 24];
+        data += 8;
+        length -= 8;
+    }
+    while(length-- > 0) {
+        crc = (crc >> 8) ^ tables[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+#if defined(MIK_X86_KERNELS)
+// Folds one 128-bit lane forward over the next 128 bits and adds those in
+__attribute__((target("pclmul,sse4.1")))
+static inline __m128i foldLane(__m128i lane, __m128i constants, __m128i next) {
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(lane, constants, 0x11), _mm_clmulepi64_si128(lane, constants, 0x00)), next);
+}
+
+// Folds length bytes (at least 64, a multiple of 16) into the pre-inverted state with PCLMULQDQ
+// Four lanes of 128 bits are folded forward in parallel, then folded into one, then Barrett-reduced back to 32 bits
+__attribute__((target("pclmul,sse4.1")))
+static quint32 crc32PCLMUL(quint32 crc, const unsigned char *data, qint64 length) {
+    // Bit-reflected x^(n) mod P constants for folding by 512 and 128 bits, then 64 bits, and the Barrett constants (P and floor(x^64 / P))
+    alignas(16) static const quint64 fold512[2] = {0x0154442BD4ULL, 0x01C6E41596ULL};
+    alignas(16) static const quint64 fold128[2] = {0x01751997D0ULL, 0x00CCAA009EULL};
+    alignas(16) static const quint64 fold64[2] = {0x0163CD6124ULL, 0x0000000000ULL};
+    alignas(16) static const quint64 barrett[2] = {0x01DB710641ULL, 0x01F7011641ULL};
+
+    __m128i lane1 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), _mm_cvtsi32_si128(static_cast<int>(crc)));
+    __m128i lane2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16));
+    __m128i lane3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 32));
+    __m128i lane4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 48));
+    data += 64;
+    length -= 64;
+
+    // Fold 512 bits at a time
+    __m128i constants = _mm_load_si128(reinterpret_cast<const __m128i *>(fold512));
+    while(length >= 64) {
+        lane1 = foldLane(lane1, constants, _mm_loadu_si128(reinterpret_cast<const __m128i *>(data)));
+        lane2 = foldLane(lane2, constants, _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16)));
+        lane3 = foldLane(lane3, constants, _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 32)));
+        lane4 = foldLane(lane4, constants, _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 48)));
+        data += 64;
+        length -= 64;
+    }
+
+    // Fold the four lanes into one, then any remaining 128-bit blocks into it
+    constants = _mm_load_si128(reinterpret_cast<const __m128i *>(fold128));
+    lane1 = foldLane(lane1, constants, lane2);
+    lane1 = foldLane(lane1, constants, lane3);
+    lane1 = foldLane(lane1, constants, lane4);
+    while(length >= 16) {
+        lane1 = foldLane(lane1, constants, _mm_loadu_si128(reinterpret_cast<const __m128i *>(data)));
+        data += 16;
+        length -= 16;
+    }
+
+    // 128 bits down to 64
+    __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    lane1 = _mm_xor_si128(_mm_srli_si128(lane1, 8), _mm_clmulepi64_si128(lane1, constants, 0x10));
+    constants = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(fold64));
+    lane1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(lane1, mask32), constants, 0x00), _mm_srli_si128(lane1, 4));
+
+    // Barrett reduction to 32 bits
+    constants = _mm_load_si128(reinterpret_cast<const __m128i *>(barrett));
+    __m128i quotient = _mm_clmulepi64_si128(_mm_and_si128(lane1, mask32), constants, 0x10);
+    quotient = _mm_clmulepi64_si128(_mm_and_si128(quotient, mask32), constants, 0x00);
+    return static_cast<quint32>(_mm_extract_epi32(_mm_xor_si128(lane1, quotient), 1));
+}
+#endif
+
+// Continues a CRC-32 over length more bytes of data. Start with 0; the result of one call can be passed into the next
+quint32 crc32Update(quint32 crc, const char *data, qint64 length) {
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+    crc = ~crc;
+
+#if defined(MIK_X86_KERNELS)
+    if(length >= 64 && cpuSupportsPCLMUL()) {
+        qint64 foldedLength = length & ~static_cast<qint64>(15);
+        crc = crc32PCLMUL(crc, bytes, foldedLength);
+        bytes += foldedLength;
+        length -= foldedLength;
+    }
+#endif
+
+    return ~crc32Tables(crc, bytes, length);
+}
+
+// Multiplies a 32x32 GF(2) matrix by a vector
+static quint32 gf2MatrixTimes(const quint32 *matrix, quint32 vector) {
+    quint32 sum = 0;
+    while(vector != 0) {
+        if(vector & 1) {
+            sum ^= *matrix;
+        }
+        vector >>= 1;
+        matrix++;
+    }
+    return sum;
+}
+
+static void gf2MatrixSquare(quint32 *square, const quint32 *matrix) {
+    for(int n = 0; n < 32; n++) {
+        square[n] = gf2MatrixTimes(matrix, matrix[n]);
+    }
+}
+
+// CRC-32 of two pieces of data back to back, from the CRC of each and the second one's length (as zlib's crc32_combine)
+// Lets tracks be checked in parallel and still be compared to the CRC of the whole image they were ripped as
+quint32 crc32Combine(quint32 firstCRC, quint32 secondCRC, qint64 secondLength) {
+    if(secondLength <= 0) {
+        return firstCRC;
+    }
+
+    // The operator for one zero bit, then squared into two and four; every later square doubles the zeros it appends
+    quint32 evenOperator[32];
+    quint32 oddOperator[32];
+    oddOperator[0] = CRC32_POLYNOMIAL;
+    quint32 row = 1;
+    for(int n = 1; n < 32; n++) {
+        oddOperator[n] = row;
+        row <<= 1;
+    }
+    gf2MatrixSquare(evenOperator, oddOperator);
+    gf2MatrixSquare(oddOperator, evenOperator);
+
+    // Append secondLength zero bytes to the first CRC, one bit of the length at a time
+    do {
+        gf2MatrixSquare(evenOperator, oddOperator);
+        if(secondLength & 1) {
+            firstCRC = gf2MatrixTimes(evenOperator, firstCRC);
+        }
+        secondLength >>= 1;
+        if(secondLength == 0) {
+            break;
+        }
+
+        gf2MatrixSquare(oddOperator, evenOperator);
+        if(secondLength & 1) {
+            firstCRC = gf2MatrixTimes(oddOperator, firstCRC);
+        }
+        secondLength >>= 1;
+    } while(secondLength != 0);
+
+    return firstCRC ^ secondCRC;
+}
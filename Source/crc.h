@@ -0,0 +1,9 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include <helper.h>
+
+quint32 crc32Update(quint32 crc, const char *data, qint64 length);
+quint32 crc32Combine(quint32 firstCRC, quint32 secondCRC, qint64 secondLength);
+
+#endif // CRC_H
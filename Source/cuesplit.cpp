@@ -0,0 +1,505 @@
+#include "cuesplit.h"
+
+// Reads a CUE sheet's text. Rippers write them in whatever the system's encoding was, so UTF-8 is only trusted when it has a BOM or decodes cleanly, and anything else is read as Windows-1252
+static QString readCueText(QString cuePath) {
+    QFile cueFile(cuePath);
+    if(!cueFile.open(QIODevice::ReadOnly)) {
+        return "";
+    }
+    QByteArray cueData = cueFile.readAll();
+
+    // UTF-8/16/32 with a BOM
+    QTextCodec *cueCodec = QTextCodec::codecForUtfText(cueData, nullptr);
+    if(cueCodec != nullptr) {
+        return cueCodec->toUnicode(cueData);
+    }
+
+    QTextCodec::ConverterState cueState;
+    QString cueText = QTextCodec::codecForName("UTF-8")->toUnicode(cueData.constData(), cueData.size(), &cueState);
+    if(cueState.invalidChars == 0) {
+        return cueText;
+    }
+    return QTextCodec::codecForName("Windows-1252")->toUnicode(cueData);
+}
+
+// Strips the quotes around a CUE value. Only the outermost ones are removed, since badly written sheets leave quotes inside titles unescaped
+static QString unquoteCueValue(QString value) {
+    value = value.trimmed();
+    if(value.length() >= 2 && value.startsWith('"') && value.endsWith('"')) {
+        value = value.mid(1, value.length() - 2);
+    }
+    return value;
+}
+
+// Converts an mm:ss:ff CUE time into CD frames, or -1 if it isn't one
+static qint64 parseCueTime(QString cueTime) {
+    QStringList timeParts = cueTime.trimmed().split(':');
+    if(timeParts.count() != 3) {
+        return -1;
+    }
+
+    bool minutesValid, secondsValid, framesValid;
+    qint64 minutes = timeParts[0].toLongLong(&minutesValid);
+    qint64 seconds = timeParts[1].toLongLong(&secondsValid);
+    qint64 frames = timeParts[2].toLongLong(&framesValid);
+    if(!minutesValid || !secondsValid || !framesValid || seconds >= 60 || frames >= CUESPLIT_FRAMES_PER_SECOND) {
+        return -1;
+    }
+    return (minutes * 60 + seconds) * CUESPLIT_FRAMES_PER_SECOND + frames;
+}
+
+// Parses the parts of a CUE sheet needed to split its image: album and track titles and performers, REM DATE/GENRE, FILE, ISRC and the INDEX 00/01 points
+// Returns false if the sheet can't be used, e.g. it has data tracks or a track without an INDEX 01
+bool parseCueSheet(QString cuePath, cueSheet_t *cueSheet) {
+    *cueSheet = cueSheet_t();
+    cueSheet->cuePath = cuePath;
+    QDir cueDir = QFileInfo(cuePath).dir();
+
+    QString cueText = readCueText(cuePath);
+    if(cueText.isEmpty()) {
+        return false;
+    }
+
+    foreach(QString cueLine, cueText.split(QRegExp("[\r\n]+"), QString::SkipEmptyParts)) {
+        cueLine = cueLine.trimmed().replace('\t', ' ');
+        QString keyword = cueLine.section(' ', 0, 0).toUpper();
+        QString value = cueLine.section(' ', 1).trimmed();
+        cueTrack_t *currentTrack = cueSheet->tracks.isEmpty() ? nullptr : &cueSheet->tracks.last();
+
+        if(keyword == "REM") {
+            QString remKeyword = value.section(' ', 0, 0).toUpper();
+            QString remValue = unquoteCueValue(value.section(' ', 1));
+            if(remKeyword == "DATE") {
+                cueSheet->date = remValue;
+            }
+            else if(remKeyword == "GENRE") {
+                cueSheet->genre = remValue;
+            }
+        }
+
+        // Before the first TRACK these describe the album, after it the track
+        else if(keyword == "TITLE") {
+            (currentTrack != nullptr ? currentTrack->title : cueSheet->title) = unquoteCueValue(value);
+        }
+        else if(keyword == "PERFORMER") {
+            (currentTrack != nullptr ? currentTrack->performer : cueSheet->performer) = unquoteCueValue(value);
+        }
+        else if(keyword == "ISRC" && currentTrack != nullptr) {
+            currentTrack->isrc = unquoteCueValue(value);
+        }
+
+        // FILE "name" TYPE, where the name may or may not be quoted
+        else if(keyword == "FILE") {
+            QString fileName = value.startsWith('"') ? value.mid(1, value.lastIndexOf('"') - 1) : value.section(' ', 0, -2);
+            cueSheet->files += cueDir.filePath(fileName.isEmpty() ? value : fileName);
+        }
+
+        else if(keyword == "TRACK") {
+            // Data tracks have no audio in the image to cut out
+            if(value.section(' ', 1, 1, QString::SectionSkipEmpty).toUpper() != "AUDIO") {
+                return false;
+            }
+            cueSheet->tracks.append(cueTrack_t{value.section(' ', 0, 0).toInt(), "", "", "", -1, -1});
+        }
+
+        else if(keyword == "INDEX" && currentTrack != nullptr) {
+            int indexNumber = value.section(' ', 0, 0).toInt();
+            qint64 indexFrame = parseCueTime(value.section(' ', 1, 1, QString::SectionSkipEmpty));
+            if(indexFrame < 0) {
+                return false;
+            }
+            if(indexNumber == 0) {
+                currentTrack->pregapFrame = indexFrame;
+            }
+            else if(indexNumber == 1) {
+                currentTrack->startFrame = indexFrame;
+            }
+        }
+    }
+
+    if(cueSheet->tracks.isEmpty()) {
+        return false;
+    }
+    foreach(cueTrack_t currentTrack, cueSheet->tracks) {
+        if(currentTrack.startFrame < 0 || currentTrack.pregapFrame > currentTrack.startFrame) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Finds the image a CUE sheet describes. Only single-file sheets with more than one track describe an image; sheets written for already split tracks are left alone
+// The image may have been renamed, or already encoded from a WAV while copying, so files named like the sheet's FILE or like the sheet itself are tried too
+QString findCueImage(cueSheet_t *cueSheet) {
+    if(cueSheet->files.count() != 1 || cueSheet->tracks.count() < 2) {
+        return "";
+    }
+
+    QFileInfo fileInfo(cueSheet->files.first());
+    QFileInfo cueInfo(cueSheet->cuePath);
+    QStringList candidates = {fileInfo.filePath(),
+                              fileInfo.path() + "/" + fileInfo.completeBaseName() + ".flac",
+                              fileInfo.path() + "/" + fileInfo.completeBaseName() + ".wav",
+                              cueInfo.path() + "/" + cueInfo.completeBaseName() + ".flac",
+                              cueInfo.path() + "/" + cueInfo.completeBaseName() + ".wav"};
+
+    foreach(QString candidate, candidates) {
+        QString suffix = QFileInfo(candidate).suffix().toLower();
+        if((suffix == "flac" || suffix == "wav") && QFileInfo(candidate).isFile()) {
+            return candidate;
+        }
+    }
+    return "";
+}
+
+// Reads the format of an integer PCM WAV, and where its audio starts and how long it is
+static bool readWAVHeader(QFile *WAVFile, audioFormat_t *audioFormat, qint64 *dataOffset, qint64 *dataSize) {
+    QByteArray RIFFHeader = WAVFile->read(12);
+    if(RIFFHeader.size() != 12 || !RIFFHeader.startsWith("RIFF") || RIFFHeader.mid(8, 4) != "WAVE") {
+        return false;
+    }
+
+    bool formatFound = false;
+    int blockAlign = 0;
+    forever {
+        QByteArray chunkHeader = WAVFile->read(8);
+        if(chunkHeader.size() != 8) {
+            return false;
+        }
+        const uchar *chunkBytes = reinterpret_cast<const uchar *>(chunkHeader.constData());
+        qint64 chunkSize = static_cast<qint64>(chunkBytes[4] | (chunkBytes[5] << 8) | (chunkBytes[6] << 16) | (static_cast<quint32>(chunkBytes[7]) << 24));
+
+        if(chunkHeader.startsWith("fmt ")) {
+            QByteArray formatChunk = WAVFile->read(chunkSize);
+            if(formatChunk.size() < 16) {
+                return false;
+            }
+            const uchar *formatBytes = reinterpret_cast<const uchar *>(formatChunk.constData());
+            int formatTag = formatBytes[0] | (formatBytes[1] << 8);
+            // WAVE_FORMAT_EXTENSIBLE keeps the actual format in the first two bytes of its sub-format GUID
+            if(formatTag == 0xFFFE && formatChunk.size() >= 26) {
+                formatTag = formatBytes[24] | (formatBytes[25] << 8);
+            }
+            audioFormat->channels = formatBytes[2] | (formatBytes[3] << 8);
+            audioFormat->sampleRate = static_cast<int>(formatBytes[4] | (formatBytes[5] << 8) | (formatBytes[6] << 16) | (static_cast<quint32>(formatBytes[7]) << 24));
+            blockAlign = formatBytes[12] | (formatBytes[13] << 8);
+            audioFormat->bitsPerSample = formatBytes[14] | (formatBytes[15] << 8);
+            // 8-bit WAVs are unsigned and floating point can't go through flac, so only signed integer PCM is read
+            if(formatTag != 1 || audioFormat->channels <= 0 || audioFormat->bitsPerSample <= 8 || blockAlign != audioFormat->channels * ((audioFormat->bitsPerSample + 7) / 8)) {
+                return false;
+            }
+            formatFound = true;
+            // Chunks are padded to an even size
+            WAVFile->seek(WAVFile->pos() + (chunkSize & 1));
+        }
+
+        else if(chunkHeader.startsWith("data")) {
+            if(!formatFound) {
+                return false;
+            }
+            *dataOffset = WAVFile->pos();
+            // Streamed WAVs leave the size unset, in which case the audio runs to the end of the file
+            qint64 availableBytes = WAVFile->size() - *dataOffset;
+            *dataSize = (chunkSize == 0 || chunkSize == 0xFFFFFFFFLL || chunkSize > availableBytes) ? availableBytes : chunkSize;
+            *dataSize -= *dataSize % blockAlign;
+            audioFormat->totalFrames = *dataSize / blockAlign;
+            return true;
+        }
+
+        else if(!WAVFile->seek(WAVFile->pos() + chunkSize + (chunkSize & 1))) {
+            return false;
+        }
+    }
+}
+
+// Streams a WAV's raw PCM into chunkCallback, in the same form decodeFLACStream() does (little-endian signed integers, whole frames)
+static bool decodeWAVStream(QString inputWAV, audioFormat_t *audioFormat, std::function<bool(const QByteArray &)> chunkCallback) {
+    QFile WAVFile(inputWAV);
+    qint64 dataOffset = 0;
+    qint64 dataSize = 0;
+    if(!WAVFile.open(QIODevice::ReadOnly) || !readWAVHeader(&WAVFile, audioFormat, &dataOffset, &dataSize) || !WAVFile.seek(dataOffset)) {
+        return false;
+    }
+
+    // About 4 MB at a time, in whole frames
+    int bytesPerFrame = audioFormat->channels * ((audioFormat->bitsPerSample + 7) / 8);
+    qint64 chunkBytes = (4 * 1024 * 1024 / bytesPerFrame) * bytesPerFrame;
+
+    while(dataSize > 0) {
+        QByteArray rawPCM = WAVFile.read(qMin(chunkBytes, dataSize));
+        if(rawPCM.isEmpty() || rawPCM.size() % bytesPerFrame != 0) {
+            return false;
+        }
+        dataSize -= rawPCM.size();
+        if(!chunkCallback(rawPCM)) {
+            return true;
+        }
+    }
+    return true;
+}
+
+// Reads an image's format without decoding it
+static bool readImageFormat(QString imagePath, audioFormat_t *audioFormat) {
+    if(QFileInfo(imagePath).suffix().toLower() == "flac") {
+        return readAudioFormat(imagePath, audioFormat);
+    }
+
+    QFile WAVFile(imagePath);
+    qint64 dataOffset = 0;
+    qint64 dataSize = 0;
+    return WAVFile.open(QIODevice::ReadOnly) && readWAVHeader(&WAVFile, audioFormat, &dataOffset, &dataSize);
+}
+
+// Starts encoding one track's raw PCM file with FLAC -8 into outputFLAC, through the process supervisor so it counts against its limit and can be cancelled with cancelGroup
+// The raw file is removed as soon as FLAC is done with it, whether it succeeded or not
+static QFuture<processResult_t> encodeTrackPCM(QString rawPCM, audioFormat_t audioFormat, QString outputFLAC, quintptr cancelGroup) {
+    QString programLocation = checkInstalledProgram("sDefaultFLACLocation", "flac");
+    if(programLocation == "") {
+        QFile::remove(rawPCM);
+        return QFuture<processResult_t>();
+    }
+
+    // FLAC arguments
+    // -f: force
+    // -V: verify
+    // -8: level 8 compression (highest)
+    // --force-raw-format: input is headerless audio
+    // --endian/--sign/--channels/--bps/--sample-rate: describe the raw input
+    // -o: output location
+    QStringList arguments;
+    arguments << "-f" << "-V" << "-8" << "--force-raw-format" << "--endian=little" << "--sign=signed"
+              << "--channels=" + QString::number(audioFormat.channels) << "--bps=" + QString::number(audioFormat.bitsPerSample) << "--sample-rate=" + QString::number(audioFormat.sampleRate)
+              << QDir::toNativeSeparators(rawPCM) << "-o" << QDir::toNativeSeparators(outputFLAC);
+
+    return ProcessSupervisor::instance()->submit({{programLocation, arguments, ""}}, [rawPCM](const processResult_t &) {
+        QFile::remove(rawPCM);
+    }, cancelGroup);
+}
+
+// Tags a split track: everything the image carried (FLAC images only), minus what only describes the image as a whole, then what the CUE says about the album and this track
+static void tagSplitTrack(QString imagePath, cueSheet_t *cueSheet, cueSplitTrack_t *splitTrack) {
+    if(QFileInfo(imagePath).suffix().toLower() == "flac") {
+        copyFLACMetadata(imagePath, splitTrack->outputFLAC);
+    }
+
+    // Linux only wants StdStrings, while Windows prefers StdWStrings (char encoding errors possible if Windows uses StdStrings)
+#if defined(Q_OS_LINUX)
+    TagLib::FLAC::File trackTagFile(splitTrack->outputFLAC.toStdString().data());
+#elif defined(Q_OS_WIN)
+    TagLib::FLAC::File trackTagFile(splitTrack->outputFLAC.toStdWString().data());
+#endif
+    TagLib::Ogg::XiphComment *trackComment = trackTagFile.xiphComment(true);
+
+    // The image's embedded CUE sheet, its gain and checksums, and its own title/numbering belong to the image, not to any one track
+    // Album-wide fields (ALBUM, DATE, LABEL, ...) are kept
+    static const QStringList imageFields = {"CUESHEET", "TITLE", "TRACKNUMBER", "TRACKTOTAL", "TOTALTRACKS", "ISRC", "LENGTH", "LYRICS", "UNSYNCEDLYRICS",
+                                            "MUSICBRAINZ_TRACKID", "MUSICBRAINZ_RELEASETRACKID", "ACOUSTID_ID", "ACOUSTID_FINGERPRINT"};
+    static const QStringList imageFieldPrefixes = {"REPLAYGAIN_", "R128_", "ACCURATERIP", "CTDB", "CUE_TRACK"};
+    QStringList removedFields;
+    const TagLib::Ogg::FieldListMap &imageFieldMap = trackComment->fieldListMap();
+    for(TagLib::Ogg::FieldListMap::ConstIterator field = imageFieldMap.begin(); field != imageFieldMap.end(); ++field) {
+        QString fieldName = TStringToQString(field->first).toUpper();
+        bool imageField = imageFields.contains(fieldName);
+        foreach(QString prefix, imageFieldPrefixes) {
+            imageField = imageField || fieldName.startsWith(prefix);
+        }
+        if(imageField) {
+            removedFields += TStringToQString(field->first);
+        }
+    }
+    foreach(QString fieldName, removedFields) {
+        trackComment->removeFields(QStringToTString(fieldName));
+    }
+
+    // Blank CUE values leave whatever the image had
+    QList<QPair<QString, QString>> trackFields = {{"TITLE", splitTrack->track.title},
+                                                  {"ARTIST", splitTrack->track.performer.isEmpty() ? cueSheet->performer : splitTrack->track.performer},
+                                                  {"ALBUM", cueSheet->title},
+                                                  {"ALBUMARTIST", cueSheet->performer},
+                                                  {"DATE", cueSheet->date},
+                                                  {"GENRE", cueSheet->genre},
+                                                  {"TRACKNUMBER", QString::number(splitTrack->track.number)},
+                                                  {"TRACKTOTAL", QString::number(cueSheet->tracks.count())},
+                                                  {"ISRC", splitTrack->track.isrc}};
+    for(int i = 0; i < trackFields.count(); i++) {
+        if(!trackFields[i].second.isEmpty()) {
+            trackComment->addField(QStringToTString(trackFields[i].first), QStringToTString(trackFields[i].second), true);
+        }
+    }
+
+    trackTagFile.save();
+}
+
+// Splits an image into one FLAC per CUE track, next to the image, and removes the image once every track checks out
+// The image is decoded once, front to back, into one headerless PCM file per track. Each track is handed to its own encoder as soon as the decoder has passed its end,
+// so the tracks are encoded in parallel while the rest is still being decoded, and no more than a chunk of audio is ever held in memory
+// Encoders run under the process supervisor with cancelGroup, so they count against its limit and are stopped along with everything else in the group
+// Gaps are kept with the track before them (INDEX 01 to the next INDEX 01), and any hidden track before track 1 stays at the start of track 1, so every sample of the image ends up in exactly one track
+bool splitCueImage(cueSheet_t *cueSheet, QString imagePath, quintptr cancelGroup) {
+    audioFormat_t imageFormat = {0, 0, 0, 0};
+    if(!readImageFormat(imagePath, &imageFormat) || imageFormat.sampleRate <= 0 || imageFormat.channels <= 0) {
+        return false;
+    }
+    int bytesPerFrame = imageFormat.channels * ((imageFormat.bitsPerSample + 7) / 8);
+
+    // Work out every track's sample range from its INDEX 01, which has to move forward through the image
+    QList<cueSplitTrack_t> splitTracks;
+    QString imageFolder = QFileInfo(imagePath).path();
+    for(int i = 0; i < cueSheet->tracks.count(); i++) {
+        cueTrack_t currentTrack = cueSheet->tracks[i];
+        qint64 firstSample = (i == 0) ? 0 : currentTrack.startFrame * imageFormat.sampleRate / CUESPLIT_FRAMES_PER_SECOND;
+        if(i > 0) {
+            if(firstSample <= splitTracks.last().firstSample) {
+                return false;
+            }
+            splitTracks.last().lastSample = firstSample;
+        }
+
+        QString trackName = QString("%1").arg(currentTrack.number, 2, 10, QChar('0'));
+        if(!currentTrack.title.isEmpty()) {
+            trackName += " - " + cleanString(currentTrack.title);
+        }
+        QString outputFLAC = imageFolder + "/" + trackName + ".flac";
+        QString rawPCM = outputFLAC + ".pcm";
+
+        // Never overwrite anything, including the image itself
+        if(QFileInfo::exists(outputFLAC) || QFileInfo::exists(rawPCM)) {
+            return false;
+        }
+        splitTracks.append(cueSplitTrack_t{currentTrack, outputFLAC, firstSample, -1, rawPCM, QFuture<processResult_t>()});
+    }
+
+    // The last track has to start inside the image (the length is only known beforehand for WAVs and most FLACs)
+    if(imageFormat.totalFrames > 0 && splitTracks.last().firstSample >= imageFormat.totalFrames) {
+        return false;
+    }
+
+    int currentTrack = 0;
+    // Raw PCM file of the track being decoded, open from its first sample until it's handed to its encoder
+    QFile trackPCMFile;
+    qint64 decodedSamples = 0;
+    bool overrun = false;
+    bool writeFailed = false;
+
+    // Hands the track being decoded over to an encoder
+    auto startEncoder = [&]() {
+        trackPCMFile.close();
+        splitTracks[currentTrack].encoder = encodeTrackPCM(splitTracks[currentTrack].rawPCM, imageFormat, splitTracks[currentTrack].outputFLAC, cancelGroup);
+        currentTrack++;
+    };
+
+    auto chunkCallback = [&](const QByteArray &rawPCM) {
+        qint64 chunkSamples = rawPCM.size() / bytesPerFrame;
+        qint64 chunkPosition = 0;
+
+        while(chunkPosition < chunkSamples) {
+            // Every track has been handed over already, which only a broken decoder could cause
+            if(currentTrack >= splitTracks.count()) {
+                overrun = true;
+                return false;
+            }
+
+            cueSplitTrack_t *splitTrack = &splitTracks[currentTrack];
+            if(!trackPCMFile.isOpen()) {
+                trackPCMFile.setFileName(splitTrack->rawPCM);
+                if(!trackPCMFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                    writeFailed = true;
+                    return false;
+                }
+            }
+
+            qint64 takenSamples = chunkSamples - chunkPosition;
+            if(splitTrack->lastSample >= 0) {
+                takenSamples = qMin(takenSamples, splitTrack->lastSample - decodedSamples);
+            }
+            qint64 takenBytes = takenSamples * bytesPerFrame;
+            if(trackPCMFile.write(rawPCM.constData() + chunkPosition * bytesPerFrame, takenBytes) != takenBytes) {
+                writeFailed = true;
+                return false;
+            }
+            chunkPosition += takenSamples;
+            decodedSamples += takenSamples;
+
+            if(decodedSamples == splitTrack->lastSample) {
+                startEncoder();
+            }
+        }
+        return true;
+    };
+
+    bool decoded = false;
+    if(QFileInfo(imagePath).suffix().toLower() == "flac") {
+        decoded = decodeFLACStream(imagePath, &imageFormat, chunkCallback, cancelGroup);
+    }
+    else {
+        decoded = decodeWAVStream(imagePath, &imageFormat, chunkCallback);
+    }
+
+    // The last track runs to wherever the image ends. If the decoder stopped before that, the image is shorter than its CUE sheet
+    if(decoded && !overrun && !writeFailed && currentTrack == splitTracks.count() - 1 && trackPCMFile.isOpen()) {
+        splitTracks[currentTrack].lastSample = decodedSamples;
+        startEncoder();
+    }
+    else if(trackPCMFile.isOpen()) {
+        trackPCMFile.close();
+        trackPCMFile.remove();
+    }
+    bool success = decoded && !overrun && !writeFailed && currentTrack == splitTracks.count();
+
+    // Every encoder that was started has to finish (and remove its raw file) before anything is checked or cleaned up
+    for(int i = 0; i < currentTrack; i++) {
+        splitTracks[i].encoder.waitForFinished();
+    }
+
+    // Sample-accurate check: every track holds exactly its range, and together they hold exactly the image
+    qint64 splitSamples = 0;
+    for(int i = 0; i < splitTracks.count() && success; i++) {
+        audioFormat_t trackFormat = {0, 0, 0, 0};
+        success = !splitTracks[i].encoder.isCanceled() && splitTracks[i].encoder.resultCount() > 0 && splitTracks[i].encoder.result().succeeded()
+                  && readAudioFormat(splitTracks[i].outputFLAC, &trackFormat) && trackFormat.totalFrames == splitTracks[i].lastSample - splitTracks[i].firstSample;
+        splitSamples += trackFormat.totalFrames;
+    }
+    if(success) {
+        success = splitSamples == decodedSamples && (imageFormat.totalFrames <= 0 || splitSamples == imageFormat.totalFrames);
+    }
+
+    // Anything that went wrong leaves the image as it was, without half a set of tracks next to it
+    if(!success) {
+        foreach(cueSplitTrack_t splitTrack, splitTracks) {
+            QFile(splitTrack.outputFLAC).remove();
+            QFile(splitTrack.rawPCM).remove();
+        }
+        return false;
+    }
+
+    for(int i = 0; i < splitTracks.count(); i++) {
+        tagSplitTrack(imagePath, cueSheet, &splitTracks[i]);
+    }
+    QFile(imagePath).remove();
+    return true;
+}
+
+// Splits every CUE+image rip under rootDir into tracks. The CUE sheets themselves are kept
+// Returns the CUE sheets whose images couldn't be split, which are left whole. Their encoders run under cancelGroup
+QStringList splitCueImages(QDir rootDir, quintptr cancelGroup) {
+    QStringList unsplitCues;
+
+    foreach(QString cuePath, findFiles(rootDir, {"*.cue"})) {
+        cueSheet_t cueSheet;
+        if(!parseCueSheet(cuePath, &cueSheet)) {
+            continue;
+        }
+
+        // Also skips a second sheet for an image that has been split already (e.g. the same CUE in two encodings)
+        QString imagePath = findCueImage(&cueSheet);
+        if(imagePath.isEmpty()) {
+            continue;
+        }
+
+        if(!splitCueImage(&cueSheet, imagePath, cancelGroup)) {
+            unsplitCues += cuePath;
+        }
+    }
+
+    return unsplitCues;
+}
@@ -0,0 +1,53 @@
+#ifndef CUESPLIT_H
+#define CUESPLIT_H
+
+#include <helper.h>
+#include <processsupervisor.h>
+
+#include <QTextCodec>
+
+// CD frames (sectors) per second, the unit of every CUE time
+#define CUESPLIT_FRAMES_PER_SECOND 75
+
+// One TRACK of a CUE sheet
+struct cueTrack_t {
+    int number;
+    QString title;
+    QString performer;
+    QString isrc;
+    // INDEX 00 (start of the pregap, or -1 if there isn't one) and INDEX 01, in CD frames from the start of the image
+    qint64 pregapFrame;
+    qint64 startFrame;
+};
+
+// What's needed from a CUE sheet to split its image into tracks
+struct cueSheet_t {
+    QString cuePath;
+    // Every FILE of the sheet, resolved against the CUE's folder. Only single-file sheets describe an image
+    QStringList files;
+    QString performer;
+    QString title;
+    QString date;
+    QString genre;
+    QList<cueTrack_t> tracks;
+};
+
+// One track being cut out of the image, in samples (frames of every channel) from the start of the image
+struct cueSplitTrack_t {
+    cueTrack_t track;
+    QString outputFLAC;
+    qint64 firstSample;
+    // -1 for the last track, which runs to the end of the image
+    qint64 lastSample;
+    // Headerless PCM the track is decoded into, removed as soon as its encoder is done with it
+    QString rawPCM;
+    // Set once its encoder has been handed the track's audio
+    QFuture<processResult_t> encoder;
+};
+
+bool parseCueSheet(QString cuePath, cueSheet_t *cueSheet);
+QString findCueImage(cueSheet_t *cueSheet);
+bool splitCueImage(cueSheet_t *cueSheet, QString imagePath, quintptr cancelGroup = 0);
+QStringList splitCueImages(QDir rootDir, quintptr cancelGroup = 0);
+
+#endif // CUESPLIT_H
@@ -0,0 +1,187 @@
+#include "dropfolder.h"
+
+DropFolderWatcher::DropFolderWatcher(QObject *parent) :
+    QObject(parent)
+{
+    connect(&folderWatcher, &QFileSystemWatcher::directoryChanged, this, &DropFolderWatcher::watchedDirChanged);
+
+    settleTimer.setInterval(DROPFOLDER_POLL_INTERVAL);
+    connect(&settleTimer, &QTimer::timeout, this, &DropFolderWatcher::checkPendingAlbums);
+}
+
+// Starts watching dropDir. Anything already inside it is left alone; only albums that arrive afterwards are reported
+bool DropFolderWatcher::start(QDir dropDir) {
+    stop();
+
+    if(dropDir.path() == "." || !dropDir.exists()) {
+        return false;
+    }
+
+    watchedDir = dropDir;
+    knownEntries = listAlbumEntries().toSet();
+
+    return folderWatcher.addPath(watchedDir.path());
+}
+
+void DropFolderWatcher::stop() {
+    if(!folderWatcher.directories().isEmpty()) {
+        folderWatcher.removePaths(folderWatcher.directories());
+    }
+    settleTimer.stop();
+    knownEntries.clear();
+    pendingAlbums.clear();
+}
+
+bool DropFolderWatcher::isWatching() {
+    return !folderWatcher.directories().isEmpty();
+}
+
+// Lists the folders and archives directly inside the watched folder
+QStringList DropFolderWatcher::listAlbumEntries() {
+    QStringList albumEntries;
+
+    // Hidden entries are usually partial downloads or file manager leftovers
+    foreach(QFileInfo entryInfo, watchedDir.entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks)) {
+        if(entryInfo.isDir() || isArchiveFile(entryInfo.filePath())) {
+            albumEntries += entryInfo.filePath();
+        }
+    }
+
+    return albumEntries;
+}
+
+// Summarizes an album's current state, so it can be compared later to see whether anything is still being written
+QString DropFolderWatcher::albumSignature(QString albumPath) {
+    QFileInfo albumInfo(albumPath);
+    if(albumInfo.isFile()) {
+        return QString::number(albumInfo.size()) + "/" + QString::number(albumInfo.lastModified().toMSecsSinceEpoch());
+    }
+
+    qint64 totalSize = 0;
+    qint64 newestModification = 0;
+    QStringList albumFiles = findFiles(QDir(albumPath));
+    foreach(QString currentFile, albumFiles) {
+        QFileInfo fileInfo(currentFile);
+        totalSize += fileInfo.size();
+        newestModification = qMax(newestModification, fileInfo.lastModified().toMSecsSinceEpoch());
+    }
+
+    return QString::number(albumFiles.count()) + "/" + QString::number(totalSize) + "/" + QString::number(newestModification);
+}
+
+// Runs when something is added to or removed from the watched folder
+void DropFolderWatcher::watchedDirChanged() {
+    QStringList currentEntries = listAlbumEntries();
+
+    // Forget entries that are gone, so an album dropped again under the same name gets processed again
+    foreach(QString knownEntry, knownEntries.toList()) {
+        if(!currentEntries.contains(knownEntry)) {
+            knownEntries.remove(knownEntry);
+        }
+    }
+    foreach(QString pendingAlbum, pendingAlbums.keys()) {
+        if(!currentEntries.contains(pendingAlbum)) {
+            pendingAlbums.remove(pendingAlbum);
+        }
+    }
+
+    // New arrivals start out pending, until they've stopped changing
+    foreach(QString currentEntry, currentEntries) {
+        if(!knownEntries.contains(currentEntry) && !pendingAlbums.contains(currentEntry)) {
+            pendingAlbums.insert(currentEntry, dropFolderCandidate_t{"", QDateTime::currentDateTime()});
+        }
+    }
+
+    // Only poll while something is arriving
+    if(!pendingAlbums.isEmpty() && !settleTimer.isActive()) {
+        settleTimer.start();
+    }
+}
+
+// Re-checks every pending album and reports the ones that have settled
+void DropFolderWatcher::checkPendingAlbums() {
+    QDateTime now = QDateTime::currentDateTime();
+
+    foreach(QString pendingAlbum, pendingAlbums.keys()) {
+        QString signature = albumSignature(pendingAlbum);
+        dropFolderCandidate_t &candidate = pendingAlbums[pendingAlbum];
+
+        // Still changing, so start waiting over
+        if(signature != candidate.signature) {
+            candidate.signature = signature;
+            candidate.stableSince = now;
+        }
+        else if(candidate.stableSince.secsTo(now) >= DROPFOLDER_SETTLE_SECONDS) {
+            pendingAlbums.remove(pendingAlbum);
+            knownEntries.insert(pendingAlbum);
+            emit albumReady(pendingAlbum);
+        }
+    }
+
+    if(pendingAlbums.isEmpty()) {
+        settleTimer.stop();
+    }
+}
+
+// Adds a timestamped line to the drop folder's results log ("qMusicImportKit drop folder.log" in logDir)
+// Albums can finish at the same time on different threads, so writes are serialized
+void appendDropFolderLog(QDir logDir, QString albumPath, QString result) {
+    static QMutex logMutex;
+    QMutexLocker logLocker(&logMutex);
+
+    QFile logFile(logDir.path() + "/qMusicImportKit drop folder.log");
+    if(logFile.open(QIODevice::Append | QIODevice::Text)) {
+        QTextStream logStream(&logFile);
+        logStream << "[" << QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss") << "] " << QDir::toNativeSeparators(albumPath) << ": " << result << "\n";
+    }
+}
+
+// Total size of an album folder's files, or of an archive
+qint64 getAlbumSize(QString albumPath) {
+    if(QFileInfo(albumPath).isFile()) {
+        return QFileInfo(albumPath).size();
+    }
+
+    qint64 totalSize = 0;
+    foreach(QString currentFile, findFiles(QDir(albumPath), {"*"})) {
+        totalSize += QFileInfo(currentFile).size();
+    }
+    return totalSize;
+}
+
+// Space promised to albums that are currently running, which they may not have written yet
+static QMutex tempSpaceMutex;
+static QWaitCondition tempSpaceFreed;
+static qint64 reservedTempBytes = 0;
+
+// Blocks until the temp drive has room for bytes more (on top of what running albums have reserved), then reserves it
+// Returns false right away if the album can't fit even with nothing else running
+bool reserveTempSpace(QDir tempDir, qint64 bytes) {
+    QMutexLocker spaceLocker(&tempSpaceMutex);
+
+    forever {
+        QStorageInfo tempStorage(tempDir);
+        if(!tempStorage.isValid()) {
+            return false;
+        }
+
+        if(tempStorage.bytesAvailable() - reservedTempBytes - DROPFOLDER_FREE_SPACE_MARGIN >= bytes) {
+            reservedTempBytes += bytes;
+            return true;
+        }
+
+        // Nothing else is running, so waiting won't free anything up
+        if(reservedTempBytes == 0) {
+            return false;
+        }
+
+        tempSpaceFreed.wait(&tempSpaceMutex, DROPFOLDER_SPACE_RECHECK_INTERVAL);
+    }
+}
+
+// Gives back space reserved with reserveTempSpace once an album is done, and wakes up albums that are waiting for it
+void releaseTempSpace(qint64 bytes) {
+    QMutexLocker spaceLocker(&tempSpaceMutex);
+    reservedTempBytes = qMax(0LL, reservedTempBytes - bytes);
+    tempSpaceFreed.wakeAll();
+}
@@ -0,0 +1,68 @@
+#ifndef DROPFOLDER_H
+#define DROPFOLDER_H
+
+#include <archive.h>
+#include <helper.h>
+
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QMutex>
+#include <QObject>
+#include <QStorageInfo>
+#include <QSet>
+#include <QTextStream>
+#include <QTimer>
+#include <QWaitCondition>
+
+// How often (ms) albums that are still arriving are re-checked. Nothing is polled while no album is arriving
+#define DROPFOLDER_POLL_INTERVAL 1000
+// How long (seconds) an album has to stay unchanged before it's considered completely copied in
+#define DROPFOLDER_SETTLE_SECONDS 3
+// Space (bytes) always left free on the temp drive when admitting albums
+#define DROPFOLDER_FREE_SPACE_MARGIN (512LL * 1024 * 1024)
+// How long (ms) an album waiting for temp space sleeps before checking again, in case space was freed outside of the program
+#define DROPFOLDER_SPACE_RECHECK_INTERVAL 10000
+
+// An album that has shown up in the watched folder but may still be arriving
+struct dropFolderCandidate_t {
+    // File count, total size and newest modification time, which stop changing once the album is complete
+    QString signature;
+    QDateTime stableSince;
+};
+
+// Watches a folder for new album folders and archives, and reports each one once it has stopped changing
+// The folder itself is watched by the OS (inotify/ReadDirectoryChangesW), so nothing runs while it's idle
+class DropFolderWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DropFolderWatcher(QObject *parent = nullptr);
+    bool start(QDir dropDir);
+    void stop();
+    bool isWatching();
+
+signals:
+    void albumReady(QString albumPath);
+
+private:
+    QFileSystemWatcher folderWatcher;
+    QTimer settleTimer;
+    QDir watchedDir;
+    // Entries that have already been reported (or were there before watching started)
+    QSet<QString> knownEntries;
+    QMap<QString, dropFolderCandidate_t> pendingAlbums;
+    QStringList listAlbumEntries();
+    QString albumSignature(QString albumPath);
+
+private slots:
+    void watchedDirChanged();
+    void checkPendingAlbums();
+};
+
+void appendDropFolderLog(QDir logDir, QString albumPath, QString result);
+qint64 getAlbumSize(QString albumPath);
+bool reserveTempSpace(QDir tempDir, qint64 bytes);
+void releaseTempSpace(qint64 bytes);
+
+#endif // DROPFOLDER_H
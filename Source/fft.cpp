@@ -0,0 +1,202 @@
+#include "fft.h"
+#include "cpufeatures.h"
+
+#include <cmath>
+
+// Runs one group of radix-2 butterflies: (a, b) -> (a + w*b, a - w*b) for count consecutive points
+// Inputs are split into separate real/imaginary arrays so every lane of a vector does the same work
+static void butterflySpanScalar(float *realA, float *imagA, float *realB, float *imagB, const float *twiddleReal, const float *twiddleImag, int count) {
+    for(int k = 0; k < count; k++) {
+        float productReal = realB[k] * twiddleReal[k] - imagB[k] * twiddleImag[k];
+        float productImag = realB[k] * twiddleImag[k] + imagB[k] * twiddleReal[k];
+        realB[k] = realA[k] - productReal;
+        imagB[k] = imagA[k] - productImag;
+        realA[k] += productReal;
+        imagA[k] += productImag;
+    }
+}
+
+#if defined(MIK_X86_KERNELS)
+// AVX2 version of butterflySpanScalar, 8 butterflies at a time
+__attribute__((target("avx2,fma")))
+static void butterflySpanAVX2(float *realA, float *imagA, float *realB, float *imagB, const float *twiddleReal, const float *twiddleImag, int count) {
+    int k = 0;
+    for(; k + 8 <= count; k += 8) {
+        __m256 wr = _mm256_loadu_ps(twiddleReal + k);
+        __m256 wi = _mm256_loadu_ps(twiddleImag + k);
+        __m256 br = _mm256_loadu_ps(realB + k);
+        __m256 bi = _mm256_loadu_ps(imagB + k);
+        __m256 ar = _mm256_loadu_ps(realA + k);
+        __m256 ai = _mm256_loadu_ps(imagA + k);
+
+        __m256 productReal = _mm256_fmsub_ps(br, wr, _mm256_mul_ps(bi, wi));
+        __m256 productImag = _mm256_fmadd_ps(br, wi, _mm256_mul_ps(bi, wr));
+
+        _mm256_storeu_ps(realB + k, _mm256_sub_ps(ar, productReal));
+        _mm256_storeu_ps(imagB + k, _mm256_sub_ps(ai, productImag));
+        _mm256_storeu_ps(realA + k, _mm256_add_ps(ar, productReal));
+        _mm256_storeu_ps(imagA + k, _mm256_add_ps(ai, productImag));
+    }
+
+    // Leftover butterflies that don't fill a whole vector
+    butterflySpanScalar(realA + k, imagA + k, realB + k, imagB + k, twiddleReal + k, twiddleImag + k, count - k);
+}
+#endif
+
+#if defined(MIK_NEON_KERNELS)
+// NEON version of butterflySpanScalar, 4 butterflies at a time
+static void butterflySpanNEON(float *realA, float *imagA, float *realB, float *imagB, const float *twiddleReal, const float *twiddleImag, int count) {
+    int k = 0;
+    for(; k + 4 <= count; k += 4) {
+        float32x4_t wr = vld1q_f32(twiddleReal + k);
+        float32x4_t wi = vld1q_f32(twiddleImag + k);
+        float32x4_t br = vld1q_f32(realB + k);
+        float32x4_t bi = vld1q_f32(imagB + k);
+        float32x4_t ar = vld1q_f32(realA + k);
+        float32x4_t ai = vld1q_f32(imagA + k);
+
+        float32x4_t productReal = vmlsq_f32(vmulq_f32(br, wr), bi, wi);
+        float32x4_t productImag = vmlaq_f32(vmulq_f32(br, wi), bi, wr);
+
+        vst1q_f32(realB + k, vsubq_f32(ar, productReal));
+        vst1q_f32(imagB + k, vsubq_f32(ai, productImag));
+        vst1q_f32(realA + k, vaddq_f32(ar, productReal));
+        vst1q_f32(imagA + k, vaddq_f32(ai, productImag));
+    }
+
+    butterflySpanScalar(realA + k, imagA + k, realB + k, imagB + k, twiddleReal + k, twiddleImag + k, count - k);
+}
+#endif
+
+// Picks the fastest butterfly kernel the running CPU supports
+typedef void (*butterflySpanFunction)(float *, float *, float *, float *, const float *, const float *, int);
+static butterflySpanFunction selectButterflySpan() {
+#if defined(MIK_X86_KERNELS)
+    if(cpuSupportsAVX2()) {
+        return butterflySpanAVX2;
+    }
+#endif
+#if defined(MIK_NEON_KERNELS)
+    return butterflySpanNEON;
+#endif
+    return butterflySpanScalar;
+}
+
+// Builds every table needed to transform size real samples. size must be a power of two of at least 4
+void createFFTPlan(int size, fftPlan_t *plan) {
+    const double pi = 3.14159265358979323846;
+
+    plan->size = size;
+
+    // The real input is packed into a complex FFT of half the size
+    int halfSize = size / 2;
+
+    // Bit-reversal permutation for the half-size FFT
+    int bits = 0;
+    while((1 << bits) < halfSize) {
+        bits++;
+    }
+    plan->bitReversal.resize(halfSize);
+    for(int i = 0; i < halfSize; i++) {
+        int reversed = 0;
+        for(int bit = 0; bit < bits; bit++) {
+            if(i & (1 << bit)) {
+                reversed |= 1 << (bits - 1 - bit);
+            }
+        }
+        plan->bitReversal[i] = reversed;
+    }
+
+    // Stage twiddles. A stage that combines spans of length span uses exp(-2*pi*i*k / (2*span)) for k < span
+    // Stages are stored back to back, so the stage with span length span starts at index span - 1
+    plan->stageTwiddleReal.resize(halfSize > 1 ? halfSize - 1 : 1);
+    plan->stageTwiddleImag.resize(halfSize > 1 ? halfSize - 1 : 1);
+    for(int span = 1; span < halfSize; span *= 2) {
+        for(int k = 0; k < span; k++) {
+            double angle = -pi * k / span;
+            plan->stageTwiddleReal[span - 1 + k] = static_cast<float>(std::cos(angle));
+            plan->stageTwiddleImag[span - 1 + k] = static_cast<float>(std::sin(angle));
+        }
+    }
+
+    // Split twiddles, exp(-2*pi*i*k / size) for every output bin
+    plan->splitTwiddleReal.resize(halfSize + 1);
+    plan->splitTwiddleImag.resize(halfSize + 1);
+    for(int k = 0; k <= halfSize; k++) {
+        double angle = -2.0 * pi * k / size;
+        plan->splitTwiddleReal[k] = static_cast<float>(std::cos(angle));
+        plan->splitTwiddleImag[k] = static_cast<float>(std::sin(angle));
+    }
+
+    // Periodic Hann window
+    plan->window.resize(size);
+    for(int i = 0; i < size; i++) {
+        plan->window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * i / size));
+    }
+}
+
+// Allocates the scratch buffers a thread needs to run a plan
+void createFFTWorkspace(const fftPlan_t &plan, fftWorkspace_t *workspace) {
+    workspace->real.resize(plan.size / 2);
+    workspace->imag.resize(plan.size / 2);
+}
+
+// Windows size real samples and writes the power (squared magnitude) of bins 0 through size/2 into powerSpectrum
+void computePowerSpectrum(const fftPlan_t &plan, fftWorkspace_t *workspace, const float *input, float *powerSpectrum) {
+    static const butterflySpanFunction butterflySpan = selectButterflySpan();
+
+    int halfSize = plan.size / 2;
+    float *real = workspace->real.data();
+    float *imag = workspace->imag.data();
+    const float *window = plan.window.data();
+
+    // Pack even samples into the real part and odd samples into the imaginary part, windowing and bit-reversing on the way
+    for(int i = 0; i < halfSize; i++) {
+        int target = plan.bitReversal[i];
+        real[target] = input[2*i] * window[2*i];
+        imag[target] = input[2*i + 1] * window[2*i + 1];
+    }
+
+    // Iterative radix-2 stages
+    for(int span = 1; span < halfSize; span *= 2) {
+        const float *twiddleReal = plan.stageTwiddleReal.data() + span - 1;
+        const float *twiddleImag = plan.stageTwiddleImag.data() + span - 1;
+
+        for(int start = 0; start < halfSize; start += 2 * span) {
+            butterflySpan(real + start, imag + start, real + start + span, imag + start + span, twiddleReal, twiddleImag, span);
+        }
+    }
+
+    // Split the packed result into the spectrum of the real input
+    // X[k] = E[k] + W^k * O[k], where E and O are the even/odd sample spectra recovered from Z[k] and conj(Z[halfSize - k])
+    for(int k = 0; k <= halfSize; k++) {
+        int index = k % halfSize;
+        int mirrorIndex = (halfSize - k) % halfSize;
+
+        float zReal = real[index];
+        float zImag = imag[index];
+        float mirrorReal = real[mirrorIndex];
+        float mirrorImag = -imag[mirrorIndex];
+
+        float evenReal = 0.5f * (zReal + mirrorReal);
+        float evenImag = 0.5f * (zImag + mirrorImag);
+        float oddReal = 0.5f * (zImag - mirrorImag);
+        float oddImag = -0.5f * (zReal - mirrorReal);
+
+        float twiddleReal = plan.splitTwiddleReal[k];
+        float twiddleImag = plan.splitTwiddleImag[k];
+
+        float outputReal = evenReal + twiddleReal * oddReal - twiddleImag * oddImag;
+        float outputImag = evenImag + twiddleReal * oddImag + twiddleImag * oddReal;
+
+        powerSpectrum[k] = outputReal * outputReal + outputImag * outputImag;
+    }
+}
+
+// Adds one power spectrum into a running double-precision sum (used for long-term averages)
+void accumulateSpectrum(const float *powerSpectrum, double *accumulatedSpectrum, int bins) {
+    // Plain loop on purpose; compilers vectorize it on every target
+    for(int k = 0; k < bins; k++) {
+        accumulatedSpectrum[k] += powerSpectrum[k];
+    }
+}
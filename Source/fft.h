@@ -0,0 +1,34 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <vector>
+
+// Precomputed tables for a windowed real-input FFT of one size
+// A plan is read-only once created, so one plan can be shared by any number of threads
+struct fftPlan_t {
+    // Number of real input samples (a power of two)
+    int size;
+    // Bit-reversed index for every point of the half-size complex FFT
+    std::vector<int> bitReversal;
+    // Twiddle factors for every stage of the half-size complex FFT, stored stage after stage so each stage's are contiguous
+    std::vector<float> stageTwiddleReal;
+    std::vector<float> stageTwiddleImag;
+    // Twiddle factors used to split the half-size result into the real-input spectrum
+    std::vector<float> splitTwiddleReal;
+    std::vector<float> splitTwiddleImag;
+    // Hann window applied to the input
+    std::vector<float> window;
+};
+
+// Per-thread scratch space for running a plan
+struct fftWorkspace_t {
+    std::vector<float> real;
+    std::vector<float> imag;
+};
+
+void createFFTPlan(int size, fftPlan_t *plan);
+void createFFTWorkspace(const fftPlan_t &plan, fftWorkspace_t *workspace);
+void computePowerSpectrum(const fftPlan_t &plan, fftWorkspace_t *workspace, const float *input, float *powerSpectrum);
+void accumulateSpectrum(const float *powerSpectrum, double *accumulatedSpectrum, int bins);
+
+#endif // FFT_H
@@ -0,0 +1,221 @@
+#include "flacmetadata.h"
+
+// Big-endian integers, as used in FLAC's own structures
+static quint32 readBigEndian(const uchar *data, int bytes) {
+    quint32 value = 0;
+    for(int i = 0; i < bytes; i++) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+// Little-endian 32-bit integers, as used in Vorbis comments
+static quint32 readLittleEndian32(const uchar *data) {
+    return static_cast<quint32>(data[0]) | (static_cast<quint32>(data[1]) << 8) | (static_cast<quint32>(data[2]) << 16) | (static_cast<quint32>(data[3]) << 24);
+}
+
+FLACMetadataReader::FLACMetadataReader(QString inputFLAC) :
+    flacFile(inputFLAC),
+    fileSize(0),
+    valid(false),
+    window(nullptr),
+    windowStart(0),
+    windowLength(0),
+    streamFormat{0, 0, 0, 0}
+{
+    if(!flacFile.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    fileSize = flacFile.size();
+
+    valid = parseMetadata();
+}
+
+// Returns a pointer to length bytes at offset, mapping a new window of the file if they aren't in the current one
+// Returns nullptr if the range is past the end of the file
+const uchar *FLACMetadataReader::mapRange(qint64 offset, qint64 length) {
+    if(offset < 0 || length < 0 || offset + length > fileSize) {
+        return nullptr;
+    }
+
+    if(window == nullptr || offset < windowStart || offset + length > windowStart + windowLength) {
+        windowStart = offset;
+        windowLength = qMin(qMax(length, static_cast<qint64>(FLACMETADATA_WINDOW_SIZE)), fileSize - offset);
+        window = flacFile.map(windowStart, windowLength);
+        if(window == nullptr) {
+            return nullptr;
+        }
+    }
+
+    return window + (offset - windowStart);
+}
+
+// Walks the metadata blocks at the start of the file, stopping after the last one
+bool FLACMetadataReader::parseMetadata() {
+    qint64 position = 0;
+
+    // Some taggers put an ID3v2 tag in front of the FLAC stream. Skip it using its (syncsafe) size
+    const uchar *data = mapRange(0, 10);
+    if(data != nullptr && data[0] == 'I' && data[1] == 'D' && data[2] == '3') {
+        position = 10 + ((data[6] & 0x7f) << 21 | (data[7] & 0x7f) << 14 | (data[8] & 0x7f) << 7 | (data[9] & 0x7f));
+        // Footer present
+        if(data[5] & 0x10) {
+            position += 10;
+        }
+    }
+
+    data = mapRange(position, 4);
+    if(data == nullptr || data[0] != 'f' || data[1] != 'L' || data[2] != 'a' || data[3] != 'C') {
+        return false;
+    }
+    position += 4;
+
+    bool foundStreamInfo = false;
+    bool lastBlock = false;
+    while(!lastBlock) {
+        // Block header: last-block flag, 7-bit type, 24-bit length
+        const uchar *header = mapRange(position, 4);
+        if(header == nullptr) {
+            return false;
+        }
+        lastBlock = header[0] & 0x80;
+        int blockType = header[0] & 0x7f;
+        qint64 blockLength = readBigEndian(header + 1, 3);
+        position += 4;
+
+        if(blockType == FLACMETADATA_STREAMINFO) {
+            const uchar *streamInfo = mapRange(position, 34);
+            if(blockLength < 34 || streamInfo == nullptr) {
+                return false;
+            }
+
+            // After the block and frame sizes (10 bytes): 20 bits sample rate, 3 bits channels - 1, 5 bits bits per sample - 1, 36 bits total samples
+            streamFormat.sampleRate = static_cast<int>(readBigEndian(streamInfo + 10, 3) >> 4);
+            streamFormat.channels = ((streamInfo[12] >> 1) & 0x07) + 1;
+            streamFormat.bitsPerSample = (((streamInfo[12] & 0x01) << 4) | (streamInfo[13] >> 4)) + 1;
+            streamFormat.totalFrames = (static_cast<qint64>(streamInfo[13] & 0x0f) << 32) | readBigEndian(streamInfo + 14, 4);
+
+            // An all-zero MD5 means the encoder didn't compute one
+            QByteArray md5(reinterpret_cast<const char *>(streamInfo + 18), 16);
+            if(md5 != QByteArray(16, '\0')) {
+                streamMD5 = md5;
+            }
+            foundStreamInfo = true;
+        }
+        else if(blockType == FLACMETADATA_VORBIS_COMMENT) {
+            if(!parseVorbisComment(position, blockLength)) {
+                return false;
+            }
+        }
+        else if(blockType == FLACMETADATA_PICTURE) {
+            parsePicture(position, blockLength);
+        }
+
+        // Everything else (padding, seek tables, ...) is skipped without being mapped
+        position += blockLength;
+    }
+
+    return foundStreamInfo;
+}
+
+// Reads the vendor string and every "FIELD=value" entry of a VORBIS_COMMENT block
+bool FLACMetadataReader::parseVorbisComment(qint64 offset, qint64 length) {
+    const uchar *block = mapRange(offset, length);
+    if(block == nullptr || length < 8) {
+        return false;
+    }
+    const uchar *blockEnd = block + length;
+
+    quint32 vendorLength = readLittleEndian32(block);
+    if(vendorLength > static_cast<quint64>(length - 8)) {
+        return false;
+    }
+    vendorString = QByteArray(reinterpret_cast<const char *>(block + 4), static_cast<int>(vendorLength));
+
+    const uchar *entry = block + 4 + vendorLength;
+    quint32 entryCount = readLittleEndian32(entry);
+    entry += 4;
+
+    for(quint32 i = 0; i < entryCount; i++) {
+        if(blockEnd - entry < 4) {
+            return false;
+        }
+        quint32 entryLength = readLittleEndian32(entry);
+        entry += 4;
+        if(static_cast<quint64>(blockEnd - entry) < entryLength) {
+            return false;
+        }
+        commentList.append(QByteArray(reinterpret_cast<const char *>(entry), static_cast<int>(entryLength)));
+        entry += entryLength;
+    }
+
+    return true;
+}
+
+// Records where a PICTURE block's image data is. Only the short header in front of the image is mapped
+bool FLACMetadataReader::parsePicture(qint64 offset, qint64 length) {
+    // Picture type and MIME type length
+    const uchar *header = mapRange(offset, 8);
+    if(header == nullptr || length < 32) {
+        return false;
+    }
+    flacPicture_t picture;
+    picture.pictureType = static_cast<int>(readBigEndian(header, 4));
+    qint64 mimeLength = readBigEndian(header + 4, 4);
+
+    const uchar *mimeType = mapRange(offset + 8, mimeLength + 4);
+    if(mimeType == nullptr || 8 + mimeLength + 4 > length) {
+        return false;
+    }
+    picture.mimeType = QByteArray(reinterpret_cast<const char *>(mimeType), static_cast<int>(mimeLength));
+    qint64 descriptionLength = readBigEndian(mimeType + mimeLength, 4);
+
+    // Skip the description, then width, height, color depth and color count (4 bytes each)
+    qint64 dataLengthOffset = offset + 8 + mimeLength + 4 + descriptionLength + 16;
+    const uchar *dataLength = mapRange(dataLengthOffset, 4);
+    if(dataLength == nullptr || dataLengthOffset + 4 > offset + length) {
+        return false;
+    }
+    picture.dataLength = readBigEndian(dataLength, 4);
+    picture.dataOffset = dataLengthOffset + 4;
+
+    pictureList.append(picture);
+    return true;
+}
+
+bool FLACMetadataReader::isValid() {
+    return valid;
+}
+
+audioFormat_t FLACMetadataReader::audioFormat() {
+    return streamFormat;
+}
+
+// The 16-byte MD5 of the decoded audio, or an empty array if the encoder didn't store one
+QByteArray FLACMetadataReader::audioMD5() {
+    return streamMD5;
+}
+
+QByteArray FLACMetadataReader::vendor() {
+    return vendorString;
+}
+
+// Every Vorbis comment as "FIELD=value" (UTF-8), in file order
+QList<QByteArray> FLACMetadataReader::comments() {
+    return commentList;
+}
+
+// First value of a Vorbis comment field (field names are case-insensitive), or a blank string if it's not there
+QString FLACMetadataReader::tagValue(QString field) {
+    QByteArray fieldName = field.toLatin1().toUpper() + "=";
+    foreach(QByteArray comment, commentList) {
+        if(comment.size() >= fieldName.size() && comment.left(fieldName.size()).toUpper() == fieldName) {
+            return QString::fromUtf8(comment.constData() + fieldName.size(), comment.size() - fieldName.size());
+        }
+    }
+    return "";
+}
+
+QList<flacPicture_t> FLACMetadataReader::pictures() {
+    return pictureList;
+}
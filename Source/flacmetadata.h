@@ -0,0 +1,62 @@
+#ifndef FLACMETADATA_H
+#define FLACMETADATA_H
+
+#include <helper.h>
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+
+// How much of a FLAC is mapped at once. Almost every file's STREAMINFO and tags fit in the first window
+#define FLACMETADATA_WINDOW_SIZE (64 * 1024)
+
+// FLAC metadata block types (see https://xiph.org/flac/format.html#metadata_block_header)
+#define FLACMETADATA_STREAMINFO 0
+#define FLACMETADATA_VORBIS_COMMENT 4
+#define FLACMETADATA_PICTURE 6
+
+// Where an embedded picture is, without its image data ever being read
+struct flacPicture_t {
+    // ID3v2 APIC picture type (3 = front cover)
+    int pictureType;
+    QByteArray mimeType;
+    // Position and size of the image data in the file
+    qint64 dataOffset;
+    qint64 dataLength;
+};
+
+// Minimal FLAC metadata reader for scanning many files quickly
+// Only the metadata blocks that are needed get memory-mapped, and PICTURE blocks are skipped over (only their position is kept)
+// Unlike TagLib::FLAC::File, pictures are never read: only the few bytes of STREAMINFO and the tags are copied out, so everything returned stays valid after the reader is gone
+class FLACMetadataReader
+{
+public:
+    explicit FLACMetadataReader(QString inputFLAC);
+    bool isValid();
+    audioFormat_t audioFormat();
+    QByteArray audioMD5();
+    QByteArray vendor();
+    QList<QByteArray> comments();
+    QString tagValue(QString field);
+    QList<flacPicture_t> pictures();
+
+private:
+    QFile flacFile;
+    qint64 fileSize;
+    bool valid;
+    // The most recently mapped part of the file. Earlier windows stay mapped until the file is closed
+    const uchar *window;
+    qint64 windowStart;
+    qint64 windowLength;
+    audioFormat_t streamFormat;
+    QByteArray streamMD5;
+    QByteArray vendorString;
+    QList<QByteArray> commentList;
+    QList<flacPicture_t> pictureList;
+    const uchar *mapRange(qint64 offset, qint64 length);
+    bool parseMetadata();
+    bool parseVorbisComment(qint64 offset, qint64 length);
+    bool parsePicture(qint64 offset, qint64 length);
+};
+
+#endif // FLACMETADATA_H
@@ -1,4 +1,8 @@
 #include "helper.h"
+#include "flacmetadata.h"
+#include "pagecache.h"
+#include "processsupervisor.h"
+#include "resampler.h"
 
 #if defined(Q_OS_LINUX)
 // Get user's shell-manipulated PATH environment variable (including .bashrc, .zshrc, .profile, etc)
@@ -111,6 +115,125 @@ bool removeDir(const QString &dirName)
     return result;
 }
 
+// Moves a finished file from the local staging folder to its place in the (possibly network) output folder
+// The data is streamed into a temporary file next to outputFile, which is only renamed into place once it's complete, so nothing ever sees a half-written file
+// With drop-behind, the transferred file is taken out of the page cache once it's on disk (the staged copy's cache goes with it when it's deleted)
+bool transferStagedFile(QString stagedFile, QString outputFile, pageCacheStats_t *pageCacheStats) {
+    QFile inputFile(stagedFile);
+    if(!inputFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // Make sure the path for this file exists
+    QDir().mkpath(QFileInfo(outputFile).path());
+
+    QSaveFile transferFile(outputFile);
+    if(!transferFile.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    // Copy in large chunks, so network writes aren't split into many small requests
+    while(!inputFile.atEnd()) {
+        QByteArray chunk = inputFile.read(4 * 1024 * 1024);
+        if(chunk.isEmpty() || transferFile.write(chunk) != chunk.size()) {
+            transferFile.cancelWriting();
+            break;
+        }
+    }
+    inputFile.close();
+
+    // Renames the temporary file over outputFile, replacing any previous version
+    if(!transferFile.commit()) {
+        return false;
+    }
+
+    // The staged copy isn't needed anymore, so free up scratch space as soon as possible
+    QFile::remove(stagedFile);
+    dropFileCache(outputFile, pageCacheStats);
+    return true;
+}
+
+// Deleting trash should never slow down conversions, so it runs on threads that only get otherwise idle CPU/disk time
+// The pools are never destroyed, so quitting doesn't wait for them. Whatever is left gets deleted on the next start
+static QThreadPool *trashPool() {
+    static QThreadPool *pool = new QThreadPool();
+    return pool;
+}
+
+// Walks the trashed folders one at a time, handing their files out to trashPool()
+static QThreadPool *trashCoordinatorPool() {
+    static QThreadPool *pool = [] {
+        QThreadPool *coordinatorPool = new QThreadPool();
+        coordinatorPool->setMaxThreadCount(1);
+        return coordinatorPool;
+    }();
+    return pool;
+}
+
+static void deleteTrashFiles(QStringList trashFiles) {
+    QThread::currentThread()->setPriority(QThread::IdlePriority);
+    foreach(QString trashFile, trashFiles) {
+        QFile::remove(trashFile);
+    }
+}
+
+// Deletes a trashed folder's files in parallel, then the (now empty) folders themselves
+static void emptyTrashedFolder(QString trashedDirName) {
+    QThread::currentThread()->setPriority(QThread::IdlePriority);
+
+    QList<QFuture<void>> futureList;
+    QStringList trashFiles;
+    QDirIterator trashIterator(trashedDirName, QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+    while(trashIterator.hasNext()) {
+        trashFiles += trashIterator.next();
+        if(trashFiles.count() == TRASH_BATCH_SIZE) {
+            futureList.append(QtConcurrent::run(trashPool(), deleteTrashFiles, trashFiles));
+            trashFiles.clear();
+        }
+    }
+    futureList.append(QtConcurrent::run(trashPool(), deleteTrashFiles, trashFiles));
+
+    foreach(QFuture<void> currentFuture, futureList) {
+        currentFuture.waitForFinished();
+    }
+
+    removeDir(trashedDirName);
+}
+
+// Moves a finished temp folder out of the way so the job can finish right away, and queues it for background deletion
+// A rename within the same drive is instant no matter how many files there are. Returns false if it couldn't be moved
+bool moveToTrash(QString dirName) {
+    QDir parentDir = getNearestParent(QDir(dirName));
+    if(parentDir.path() == ".") {
+        return false;
+    }
+
+    // The trash lives next to the temp folder, so it's on the same drive
+    QDir trashDir(parentDir.path() + "/" + TRASH_FOLDER_NAME);
+    QDir().mkpath(trashDir.path());
+
+    // Albums with the same name can be trashed more than once, so make each name unique
+    QString trashedDirName = trashDir.path() + "/" + QDir(dirName).dirName() + " " + QString::number(QDateTime::currentMSecsSinceEpoch());
+    if(!QDir().rename(dirName, trashedDirName)) {
+        return false;
+    }
+
+    QtConcurrent::run(trashCoordinatorPool(), emptyTrashedFolder, trashedDirName);
+    return true;
+}
+
+// Queues everything in a trash folder for background deletion, e.g. leftovers from when the program was last closed
+void emptyTrash(QString trashDirName) {
+    QDir trashDir(trashDirName);
+    if(trashDirName == "" || !trashDir.exists()) {
+        return;
+    }
+
+    foreach(QFileInfo trashedInfo, trashDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden)) {
+        QtConcurrent::run(trashCoordinatorPool(), emptyTrashedFolder, trashedInfo.filePath());
+    }
+}
+
 // Get the parent folder of a path
 QDir getNearestParent(QDir pathDir)
 {
@@ -251,6 +374,136 @@ void openSpekWorker(QStringList inputFLACs) {
     }
 }
 
+// Reads the STREAMINFO properties (sample rate, bit-depth, channels, length) of a FLAC without decoding any audio
+bool readAudioFormat(QString inputFLAC, audioFormat_t *audioFormat) {
+    // Only STREAMINFO is needed, so skip TagLib (which would also load every embedded picture)
+    FLACMetadataReader inputFLACMetadata(inputFLAC);
+
+    // Return if the file couldn't be parsed
+    if(!inputFLACMetadata.isValid()) {
+        return false;
+    }
+
+    *audioFormat = inputFLACMetadata.audioFormat();
+
+    return true;
+}
+
+// Returns the MD5 of a FLAC's decoded audio as stored in its STREAMINFO block (lowercase hex)
+// Tags and pictures do not affect this value, so it identifies the audio itself. Returns a blank string if the encoder didn't store one
+QString getAudioMD5(QString inputFLAC) {
+    FLACMetadataReader inputFLACMetadata(inputFLAC);
+
+    // An all-zero signature means the MD5 was never computed, so it can't be used to identify anything (audioMD5() is empty then)
+    if(!inputFLACMetadata.isValid() || inputFLACMetadata.audioMD5().isEmpty()) {
+        return "";
+    }
+
+    return QString(inputFLACMetadata.audioMD5().toHex());
+}
+
+// Decodes a FLAC through the flac binary and streams its raw PCM into chunkCallback, so memory use stays constant regardless of track length
+// Chunks are interleaved little-endian signed integers at the FLAC's own bit-depth and always contain whole frames
+// chunkCallback can return false to stop decoding early. Returns false if the FLAC couldn't be decoded or cancelGroup was cancelled
+bool decodeFLACStream(QString inputFLAC, audioFormat_t *audioFormat, std::function<bool(const QByteArray &)> chunkCallback, quintptr cancelGroup) {
+    // The raw output carries no header, so the format has to be known beforehand to interpret it
+    if(!readAudioFormat(inputFLAC, audioFormat) || audioFormat->channels <= 0 || audioFormat->bitsPerSample <= 0) {
+        return false;
+    }
+
+    QString programLocation = checkInstalledProgram("sDefaultFLACLocation", "flac");
+    if(programLocation == "") {
+        return false;
+    }
+
+    // deFLAC arguments
+    // -d: decode
+    // -c: write the decoded output to stdout
+    // -s: silent (no progress output)
+    // --force-raw-format: output headerless PCM instead of a WAV
+    // --endian=little: little-endian samples
+    // --sign=signed: signed samples
+    QStringList arguments;
+    arguments << "-d" << "-c" << "-s" << "--force-raw-format" << "--endian=little" << "--sign=signed" << QDir::toNativeSeparators(inputFLAC);
+
+    // Counts towards the supervisor's limit like any other program, but its output is read right here
+    SupervisedProcess deFLACProcess({programLocation, arguments, ""}, cancelGroup);
+    if(!deFLACProcess.start()) {
+        return false;
+    }
+
+    // Raw FLAC output pads every sample to whole bytes (e.g. 24-bit = 3 bytes)
+    int bytesPerFrame = audioFormat->channels * ((audioFormat->bitsPerSample + 7) / 8);
+
+    // Holds output that hasn't been passed on yet, including any partial frame at the end of a read
+    QByteArray pendingBytes;
+    bool keepDecoding = true;
+
+    while(keepDecoding) {
+        // Wait for more output. Returns false once the process has exited and everything has been read
+        bool moreData = deFLACProcess.readOutput(&pendingBytes);
+
+        // Only pass whole frames on, keeping any partial frame for the next read
+        int wholeFrameBytes = pendingBytes.size() - (pendingBytes.size() % bytesPerFrame);
+        if(wholeFrameBytes > 0 && !deFLACProcess.isCancelled()) {
+            keepDecoding = chunkCallback(pendingBytes.left(wholeFrameBytes));
+            pendingBytes.remove(0, wholeFrameBytes);
+        }
+
+        if(!moreData) {
+            break;
+        }
+    }
+
+    // If the callback asked to stop early, there is no reason to let flac keep decoding
+    if(!keepDecoding) {
+        deFLACProcess.stop();
+        return true;
+    }
+
+    return deFLACProcess.finish();
+}
+
+// Converts a chunk of raw PCM from decodeFLACStream into interleaved floats in the range of -1.0 to 1.0
+void convertPCMToFloat(const QByteArray &rawPCM, int bitsPerSample, QVector<float> *outputSamples) {
+    int bytesPerSample = (bitsPerSample + 7) / 8;
+    int sampleCount = rawPCM.size() / bytesPerSample;
+    const unsigned char *rawBytes = reinterpret_cast<const unsigned char *>(rawPCM.constData());
+
+    outputSamples->resize(sampleCount);
+    float *outputData = outputSamples->data();
+
+    // flac writes raw samples right-justified in whole bytes (e.g. 20-bit audio arrives as 24-bit with the top bits sign-extended), so the scale follows the real bit-depth
+    const float scale = 1.0f / static_cast<float>(1LL << (bitsPerSample - 1));
+
+    // Each width gets its own loop so the compiler can vectorize the common cases
+    if(bytesPerSample == 2) {
+        for(int i = 0; i < sampleCount; i++) {
+            int16_t sample = static_cast<int16_t>(rawBytes[2*i] | (rawBytes[2*i + 1] << 8));
+            outputData[i] = sample * scale;
+        }
+    }
+    else if(bytesPerSample == 3) {
+        for(int i = 0; i < sampleCount; i++) {
+            // Shift the 24-bit value into the top of a 32-bit integer and back down to sign-extend it
+            int32_t sample = static_cast<int32_t>(static_cast<uint32_t>(rawBytes[3*i]) << 8 | static_cast<uint32_t>(rawBytes[3*i + 1]) << 16 | static_cast<uint32_t>(rawBytes[3*i + 2]) << 24) >> 8;
+            outputData[i] = sample * scale;
+        }
+    }
+    else if(bytesPerSample == 4) {
+        for(int i = 0; i < sampleCount; i++) {
+            int32_t sample = static_cast<int32_t>(static_cast<uint32_t>(rawBytes[4*i]) | static_cast<uint32_t>(rawBytes[4*i + 1]) << 8 | static_cast<uint32_t>(rawBytes[4*i + 2]) << 16 | static_cast<uint32_t>(rawBytes[4*i + 3]) << 24);
+            outputData[i] = sample * scale;
+        }
+    }
+    else {
+        for(int i = 0; i < sampleCount; i++) {
+            int8_t sample = static_cast<int8_t>(rawBytes[i]);
+            outputData[i] = sample * scale;
+        }
+    }
+}
+
 // Parses custom syntax (e.g. %tag% and &codec&) and returns a QString based on the metadata/tags of a file
 QString parseNamingSyntax(QString syntax, QString codec, QString preset, QString inputFLAC, int futureBPS, int futureSampleRate) {
     QString parsedString = "";
@@ -441,16 +694,15 @@ QString parseNamingSyntax(QString syntax, QString codec, QString preset, QString
 }
 
 // Losslessly compresses a GIF using Gifsicle. Multi-threaded but can only accept one file at a time, so initialization costs for every file
-void compressGIF(QString inputGIF) {
+// Returns right away; the future finishes once the GIF has been compressed (and replaced if that made it smaller)
+QFuture<processResult_t> compressGIF(QString inputGIF) {
     // The name of the eventual compressed GIF output; used for efficiency
     QString compressedGIF = QFileInfo(inputGIF).dir().path() + "/" + QFileInfo(inputGIF).baseName() + "compressed" + ".gif";
 
-    QProcess GifsicleProcess;
     QString programLocation = checkInstalledProgram("sDefaultGifsicleLocation", "gifsicle");
     if(programLocation == "") {
-        return;
+        return QFuture<processResult_t>();
     }
-    GifsicleProcess.setProgram(programLocation);
 
     // Gifsicle arguments
     // -O3: optimization level 3 (highest/slowest)
@@ -461,35 +713,32 @@ void compressGIF(QString inputGIF) {
     QStringList arguments;
     arguments << "-O3" << "-j" + QString::number(QThread::idealThreadCount()) << "--no-comments" << "--no-names"
               << QDir::toNativeSeparators(inputGIF) << "-o" << QDir::toNativeSeparators(compressedGIF);
-    GifsicleProcess.setArguments(arguments);
 
-    // Start and wait
-    GifsicleProcess.start();
-    GifsicleProcess.waitForFinished(-1);
-
-    // Gifsicle overwrites the original file even if the file it "compressed" ends up being larger, so we handle that here
-    // If the compressed GIF is smaller than the original file
-    if(QFileInfo(compressedGIF).size() < QFileInfo(inputGIF).size()) {
-        // Remove original file
-        QFile(inputGIF).remove();
-        // Rename compressed GIF to the original file's name
-        QFile(compressedGIF).rename(inputGIF);
-    }
-    // Else Gifsicle made a larger GIF
-    else {
-        // Remove the new GIF
-        QFile(compressedGIF).remove();
-    }
+    // Start it, and keep whichever GIF is smaller once it's done
+    return ProcessSupervisor::instance()->submit({{programLocation, arguments, ""}}, [inputGIF, compressedGIF](const processResult_t &) {
+        // Gifsicle overwrites the original file even if the file it "compressed" ends up being larger, so we handle that here
+        // If the compressed GIF is smaller than the original file
+        if(QFileInfo(compressedGIF).exists() && QFileInfo(compressedGIF).size() < QFileInfo(inputGIF).size()) {
+            // Remove original file
+            QFile(inputGIF).remove();
+            // Rename compressed GIF to the original file's name
+            QFile(compressedGIF).rename(inputGIF);
+        }
+        // Else Gifsicle made a larger GIF
+        else {
+            // Remove the new GIF
+            QFile(compressedGIF).remove();
+        }
+    });
 }
 
-// Losslessly compresses and strips a JPG using JPEGOptim. Not multi-threaded so needs to be called multiple times via threads.
-void compressJPG(QString inputJPG) {
-    QProcess JPEGOptimProcess;
+// Losslessly compresses and strips a JPG using JPEGOptim. Not multi-threaded so needs to be run for several files at once
+// Returns right away; the future finishes once the JPG has been compressed
+QFuture<processResult_t> compressJPG(QString inputJPG) {
     QString programLocation = checkInstalledProgram("sDefaultJPEGOptimLocation", "jpegoptim");
     if(programLocation == "") {
-        return;
+        return QFuture<processResult_t>();
     }
-    JPEGOptimProcess.setProgram(programLocation);
 
     // JPEGOptim arguments
     // -q: quiet
@@ -500,21 +749,17 @@ void compressJPG(QString inputJPG) {
     // --all-progressive: force progressive mode on all JPGs
     QStringList arguments;
     arguments << "-q" << "--strip-com" << "--strip-exif" << "--strip-iptc" << "--strip-xmp" << "--all-progressive" << QDir::toNativeSeparators(inputJPG);
-    JPEGOptimProcess.setArguments(arguments);
 
-    // Start and wait
-    JPEGOptimProcess.start();
-    JPEGOptimProcess.waitForFinished(-1);
+    return ProcessSupervisor::instance()->submit({{programLocation, arguments, ""}});
 }
 
 // Losslessly compresses a list of PNGs using OxiPNG. Multi-threaded and handles all files at once so only one initialization cost.
-void compressPNGs(QStringList inputPNGs) {
-    QProcess OxiPNGProcess;
+// Returns right away; the future finishes once every PNG has been compressed
+QFuture<processResult_t> compressPNGs(QStringList inputPNGs) {
     QString programLocation = checkInstalledProgram("sDefaultOxiPNGLocation", "oxipng");
     if(programLocation == "") {
-        return;
+        return QFuture<processResult_t>();
     }
-    OxiPNGProcess.setProgram(programLocation);
 
     // OxiPNG arguments
     // -o max: highest/slowest optimization level
@@ -527,11 +772,8 @@ void compressPNGs(QStringList inputPNGs) {
     foreach (QString currentPNG, inputPNGs) {
         arguments << QDir::toNativeSeparators(currentPNG);
     }
-    OxiPNGProcess.setArguments(arguments);
 
-    // Start and wait
-    OxiPNGProcess.start();
-    OxiPNGProcess.waitForFinished(-1);
+    return ProcessSupervisor::instance()->submit({{programLocation, arguments, ""}});
 }
 
 // Returns the real format of an image by reading the bytes from its magic header
@@ -680,48 +922,55 @@ void compressImages(QStringList inputFiles) {
         }
     }
 
+    // Every compressor is started through the process supervisor, so GIFs, JPGs and PNGs are all compressed at once without a thread per file
+    QList<QFuture<processResult_t>> compressionList;
+
     // GIF compression
     // If the GIF list isn't empty, the user wants to compress GIFs, and a GIF compression program exists
     if(!pendingGIF.isEmpty() && MIKSettings.value("bDefaultCompressGIF", false).toBool() && checkInstalledProgram("sDefaultGifsicleLocation", "gifsicle") != "") {
         // Compress each GIF in the pendingGIF list
         foreach (QString currentGIF, pendingGIF) {
-            compressGIF(currentGIF);
+            compressionList.append(compressGIF(currentGIF));
         }
     }
 
     // JPG compression
     // If the JPG list isn't empty, the user wants to compress JPGs, and a JPG compression program exists
     if(!pendingJPG.isEmpty() && MIKSettings.value("bDefaultCompressJPG", false).toBool() && checkInstalledProgram("sDefaultJPEGOptimLocation", "jpegoptim") != "") {
-        QThreadPool compressJPGsPool;
-        // Pass each JPG file into the compressJPG function in its own thread
+        // Compress each JPG in the pendingJPG list
         foreach (QString currentJPG, pendingJPG) {
-            QtConcurrent::run(&compressJPGsPool, compressJPG, currentJPG);
+            compressionList.append(compressJPG(currentJPG));
         }
-        // Wait for all JPGs to finish
-        compressJPGsPool.waitForDone();
     }
 
     // PNG compression
     // If the PNG list isn't empty, the user wants to compress PNGs, and a PNG compression program exists
     if(!pendingPNG.isEmpty() && MIKSettings.value("bDefaultCompressPNG", false).toBool() && checkInstalledProgram("sDefaultOxiPNGLocation", "oxipng") != "") {
         // Send all PNGs into the compression program
-        compressPNGs(pendingPNG);
+        compressionList.append(compressPNGs(pendingPNG));
+    }
+
+    // Wait for every image to finish
+    foreach (QFuture<processResult_t> currentCompression, compressionList) {
+        currentCompression.waitForFinished();
     }
 
     return;
 }
 
 // Converts a WAV into a FLAC
-void convertWAV(QString inputWAV) {
-    QString outputFLAC = inputWAV;
-    outputFLAC.replace(".wav", ".flac");
+// Without an outputFLAC, the FLAC is written next to the WAV and the WAV is removed afterwards
+// Returns false if FLAC failed, in which case the WAV is kept and nothing is left at outputFLAC
+bool convertWAV(QString inputWAV, QString outputFLAC) {
+    bool inPlace = outputFLAC.isEmpty();
+    if(inPlace) {
+        outputFLAC = inputWAV.left(inputWAV.length() - QFileInfo(inputWAV).suffix().length()) + "flac";
+    }
 
-    QProcess FLACProcess;
     QString programLocation = checkInstalledProgram("sDefaultFLACLocation", "flac");
     if(programLocation == "") {
-        return;
+        return false;
     }
-    FLACProcess.setProgram(programLocation);
 
     // FLAC arguments
     // -f: force
@@ -730,37 +979,91 @@ void convertWAV(QString inputWAV) {
     // -o: output location
     QStringList arguments;
     arguments << "-f" << "-V" << "-8" << QDir::toNativeSeparators(inputWAV) << "-o" << QDir::toNativeSeparators(outputFLAC);
-    FLACProcess.setArguments(arguments);
 
-    // Start and wait
-    FLACProcess.start();
-    FLACProcess.waitForFinished(-1);
+    // Run it through the process supervisor and wait
+    // A failed or crashed FLAC can leave a partial file behind, which must not pass for the converted WAV
+    if(!runProcess({{programLocation, arguments, ""}}).succeeded()) {
+        QFile::remove(outputFLAC);
+        return false;
+    }
 
-    // Remove the original WAV
-    QFile(inputWAV).remove();
+    // Remove the original WAV, unless it was read from somewhere else (e.g. the input folder)
+    if(inPlace) {
+        QFile(inputWAV).remove();
+    }
+
+    return true;
 }
 
-// Converts a FLAC to a FLAC (re-FLACing)
-QString convertToFLAC(QString inputFLAC, conversionParameters_t *conversionParameters, int futureBPS, int futureSampleRate) {
+// Copies every tag and picture from one FLAC to another, e.g. after encoding from raw audio which carries none
+void copyFLACMetadata(QString inputFLAC, QString outputFLAC) {
+    // Linux only wants StdStrings, while Windows prefers StdWStrings (char encoding errors possible if Windows uses StdStrings)
+#if defined(Q_OS_LINUX)
+    TagLib::FLAC::File inputFLACTagFile(inputFLAC.toStdString().data());
+    TagLib::FLAC::File outputFLACTagFile(outputFLAC.toStdString().data());
+#elif defined(Q_OS_WIN)
+    TagLib::FLAC::File inputFLACTagFile(inputFLAC.toStdWString().data());
+    TagLib::FLAC::File outputFLACTagFile(outputFLAC.toStdWString().data());
+#endif
+
+    // Vorbis comments are copied field by field rather than through a PropertyMap, so unusual and custom fields survive as-is
+    if(inputFLACTagFile.hasXiphComment()) {
+        const TagLib::Ogg::FieldListMap &inputFields = inputFLACTagFile.xiphComment()->fieldListMap();
+        TagLib::Ogg::XiphComment *outputComment = outputFLACTagFile.xiphComment(true);
+
+        for(TagLib::Ogg::FieldListMap::ConstIterator field = inputFields.begin(); field != inputFields.end(); ++field) {
+            for(unsigned int i = 0; i < field->second.size(); i++) {
+                outputComment->addField(field->first, field->second[i], false);
+            }
+        }
+    }
+
+    // For every picture in the original FLAC file
+    for(unsigned int i = 0; i < inputFLACTagFile.pictureList().size(); i++) {
+        // The output file takes ownership of the pictures it's given, so give it a copy
+        outputFLACTagFile.addPicture(new TagLib::FLAC::Picture(inputFLACTagFile.pictureList()[i]->render()));
+    }
+
+    outputFLACTagFile.save();
+}
+
+// One track's conversion, split around its encoder so no thread has to wait while the encoder runs
+struct trackConversion_t {
+    QString outputFile;
+    // Programs that write outputFile, or none if it was already written while preparing (the built-in resampler)
+    QList<processJob_t> jobs;
+    // Tagging to do once the programs have succeeded (if any). Returns false if the output can't be used
+    std::function<bool()> finish;
+};
+
+// Sets up converting a FLAC to a FLAC (re-FLACing)
+// The built-in resampler runs right here, as it's the conversion's own work rather than an external encoder's
+static bool prepareFLACConversion(QString inputFLAC, conversionParameters_t *conversionParameters, int futureBPS, int futureSampleRate, trackConversion_t *conversion) {
     QString outputFLAC = "";
     int inputFLACBPS = 0;
     int inputFLACBitrate = 0;
+    int inputFLACChannels = 0;
 
-    // Open the firstFLAC with TagLib, read some important data, then immediately destroy it
-    // Under Windows, TagLib cannot open the same file multiple times so must be completely destroyed before the next access
+    // Read the format straight from STREAMINFO, the file is closed again before anything else opens it
+    // Under Windows, a file cannot be opened multiple times so must be completely closed before the next access
     {
-#if defined(Q_OS_LINUX)
-        TagLib::FLAC::File inputFLACTagFile(inputFLAC.toStdString().data());
-#elif defined(Q_OS_WIN)
-        TagLib::FLAC::File inputFLACTagFile(inputFLAC.toStdWString().data());
-#endif
-        inputFLACBPS = inputFLACTagFile.audioProperties()->bitsPerSample();
-        inputFLACBitrate = inputFLACTagFile.audioProperties()->sampleRate();
+        audioFormat_t inputFLACFormat = {0, 0, 0, 0};
+        readAudioFormat(inputFLAC, &inputFLACFormat);
+        inputFLACBPS = inputFLACFormat.bitsPerSample;
+        inputFLACBitrate = inputFLACFormat.sampleRate;
+        inputFLACChannels = inputFLACFormat.channels;
     }
 
+    // Scan results for this file, only filled in for the "Remove fake hi-res" preset (all false otherwise)
+    effectiveFormat_t effectiveFormat = conversionParameters->effectiveFormats.value(inputFLAC);
+    // "Remove fake hi-res" only touches files where nothing real would be lost
+    bool removeFakeHiRes = conversionParameters->presetInput == "Remove fake hi-res" && (effectiveFormat.paddedBitDepth || effectiveFormat.upsampled);
+    // Padded files that weren't also upsampled just have their zero bits dropped, which is exact
+    bool truncateOnly = removeFakeHiRes && !effectiveFormat.upsampled;
+
     // If the user wants a SoX-specific feature and the file actually needs it
-    if((conversionParameters->presetInput == "Force 16-bit" || conversionParameters->presetInput == "Force 44.1kHz/48kHz" || conversionParameters->presetInput == "Force 16-bit and 44.1kHz/48kHz") &&
-        (inputFLACBPS >= 24 || (inputFLACBitrate != 44100 && inputFLACBitrate != 48000))) {
+    if(((conversionParameters->presetInput == "Force 16-bit" || conversionParameters->presetInput == "Force 44.1kHz/48kHz" || conversionParameters->presetInput == "Force 16-bit and 44.1kHz/48kHz") &&
+        (inputFLACBPS >= 24 || (inputFLACBitrate != 44100 && inputFLACBitrate != 48000))) || removeFakeHiRes) {
         // Variables to hold dynamic tag-based filenames as defined by the user
         QString parsedFileSyntax = parseNamingSyntax(conversionParameters->syntaxInput, conversionParameters->codecInput, conversionParameters->presetInput, inputFLAC, futureBPS, futureSampleRate);
         QString parsedFolderSyntax = "";
@@ -771,70 +1074,110 @@ QString convertToFLAC(QString inputFLAC, conversionParameters_t *conversionParam
             parsedFolderSyntax = parsedFileSyntax.mid(0, parsedFileSyntax.lastIndexOf('/'));
         }
 
-        // Eventual name of the SoX-manipulated output FLAC
-        outputFLAC = QFileInfo(inputFLAC).dir().path() + "/" + QFileInfo(inputFLAC).baseName() + "downsampled" + ".flac";
+        // Eventual name of the output FLAC
+        outputFLAC = conversionParameters->outputDir.path() + "/" + parsedFileSyntax + ".flac";
+        conversion->outputFile = outputFLAC;
+        // Make any necessary folders for the file to live in
+        QDir().mkpath(conversionParameters->outputDir.path() + "/" + parsedFolderSyntax);
+
+        // Raw audio carries no tags, so copy them (and pictures) over from the input once the output is written
+        conversion->finish = [inputFLAC, outputFLAC]() {
+            copyFLACMetadata(inputFLAC, outputFLAC);
+            return true;
+        };
 
-        QProcess SoXProcess;
-        QString programLocation = checkInstalledProgram("sDefaultSoXLocation", "sox");
-        if(programLocation == "") {
-            return "";
-        }
-        SoXProcess.setProgram(programLocation);
-
-        // SoX arguments
-        // -G: Guarding to protect against clipping
-        // -b: bit-depth
-        // rate: add the "rate" effect to the effect chain
-        // -v: volume adjustment
-        // -L: linear phase response
-        // 44100/48000/etc: sample rate that SoX should resample to
-        // dither: triangular dithering (default dithering method)
-        QStringList arguments;
-        arguments << QDir::toNativeSeparators(inputFLAC) << "-G";
+        // Format of the output
+        int outputBPS = inputFLACBPS;
+        int outputSampleRate = inputFLACBitrate;
 
         // If the user requests 16-bit
-        if(conversionParameters->presetInput == "Force 16-bit" || conversionParameters->presetInput == "Force 16-bit and 44.1kHz/48kHz") {
-            arguments << "-b" << "16";
+        if(conversionParameters->presetInput == "Force 16-bit" || conversionParameters->presetInput == "Force 16-bit and 44.1kHz/48kHz" || (removeFakeHiRes && effectiveFormat.paddedBitDepth)) {
+            outputBPS = 16;
         }
 
-        arguments << QDir::toNativeSeparators(outputFLAC) << "rate" << "-v" << "-L";
+        // Raw audio is written in whole bytes, so odd bit-depths (e.g. 20-bit) are carried as the next whole-byte size
+        // This widens e.g. 20-bit audio to 24-bit (with its low bits dithered rather than zero), which the preset's tooltip and the README point out
+        outputBPS = ((outputBPS + 7) / 8) * 8;
 
         // If the user requests downsampling
-        if(conversionParameters->presetInput == "Force 44.1kHz/48kHz" || conversionParameters->presetInput == "Force 16-bit and 44.1kHz/48kHz") {
+        if(conversionParameters->presetInput == "Force 44.1kHz/48kHz" || conversionParameters->presetInput == "Force 16-bit and 44.1kHz/48kHz" || (removeFakeHiRes && effectiveFormat.upsampled)) {
             if(inputFLACBitrate % 44100 == 0) {
-                arguments << "44100";
+                outputSampleRate = 44100;
             }
             else if(inputFLACBitrate % 48000 == 0) {
-                arguments << "48000";
+                outputSampleRate = 48000;
             }
         }
 
-        // If no downsampling should occur, use the file's original samplerate (required via SoX syntax)
-        else if(conversionParameters->presetInput == "Force 16-bit") {
-            arguments << QString::number(inputFLACBitrate);
+        // The built-in resampler is used unless SoX has been asked for through the hidden bDefaultUseSoXResampler setting
+        QSettings MIKSettings;
+        if(!MIKSettings.value("bDefaultUseSoXResampler", false).toBool() || checkInstalledProgram("sDefaultSoXLocation", "sox") == "") {
+            // Dropping zero bits doesn't change a single sample, so only dither when samples are actually being changed
+            bool ditherEnabled = !truncateOnly && (outputSampleRate != inputFLACBitrate || outputBPS < inputFLACBPS);
+            // A failed resample or encode leaves at most a partial file, which is removed by the caller
+            return resampleFLAC(inputFLAC, outputFLAC, outputSampleRate, outputBPS, ditherEnabled, conversionParameters->cancelGroup);
         }
 
-        arguments << "dither";
+        // SoX's output is piped straight into FLAC, so the result gets the same -8 -V treatment as any other FLAC with no temporary file in between
+        else {
+            processJob_t SoXJob{checkInstalledProgram("sDefaultSoXLocation", "sox"), {}, ""};
 
-        SoXProcess.setArguments(arguments);
+            QString programLocation = checkInstalledProgram("sDefaultFLACLocation", "flac");
+            if(programLocation == "") {
+                return false;
+            }
+            processJob_t FLACJob{programLocation, {}, ""};
+
+            // SoX arguments
+            // -G: Guarding to protect against clipping
+            // -D: no dithering (only used for exact truncation of padding bits)
+            // -t raw: headerless output
+            // -e signed-integer: signed samples
+            // -L: little-endian samples (before the output file)
+            // -b: bit-depth
+            // -: write the output to stdout
+            // rate: add the "rate" effect to the effect chain
+            // -v: volume adjustment
+            // -L: linear phase response (after "rate")
+            // 44100/48000/etc: sample rate that SoX should resample to (the original samplerate if no downsampling should occur, as required by SoX syntax)
+            // dither: triangular dithering (default dithering method)
+            QStringList arguments;
+            arguments << QDir::toNativeSeparators(inputFLAC);
+
+            // Dropping zero bits doesn't change a single sample, so there's nothing to guard or dither
+            if(truncateOnly) {
+                arguments << "-D";
+            }
+            else {
+                arguments << "-G";
+            }
 
-        // Start and wait
-        SoXProcess.start();
-        SoXProcess.waitForFinished(-1);
+            arguments << "-t" << "raw" << "-e" << "signed-integer" << "-L" << "-b" << QString::number(outputBPS) << "-";
 
-        // Make any necessary folders for the file to live in
-        QDir().mkpath(conversionParameters->outputDir.path() + "/" + parsedFolderSyntax);
+            if(!truncateOnly) {
+                arguments << "rate" << "-v" << "-L" << QString::number(outputSampleRate) << "dither";
+            }
 
-        // If the conversion was successful
-        if(QFile(outputFLAC).exists()) {
-            // Remove the original
-            QFile(conversionParameters->outputDir.path() + "/" + parsedFileSyntax + ".flac").remove();
-            // Renamed the converted file to the original
-            QFile(outputFLAC).rename(conversionParameters->outputDir.path() + "/" + parsedFileSyntax + ".flac");
+            SoXJob.arguments = arguments;
+
+            // FLAC arguments
+            // -f: force
+            // -V: verify
+            // -8: level 8 compression (highest)
+            // --force-raw-format: input is headerless audio
+            // --endian/--sign/--channels/--bps/--sample-rate: describe the raw input
+            // -: read the input from stdin
+            // -o: output location
+            arguments.clear();
+            arguments << "-f" << "-V" << "-8" << "--force-raw-format" << "--endian=little" << "--sign=signed"
+                      << "--channels=" + QString::number(inputFLACChannels) << "--bps=" + QString::number(outputBPS) << "--sample-rate=" + QString::number(outputSampleRate)
+                      << "-" << "-o" << QDir::toNativeSeparators(outputFLAC);
+            FLACJob.arguments = arguments;
+
+            // Run SoX with its stdout connected to FLAC's stdin. FLAC finishes once SoX closes the pipe
+            // Both exit codes count: a SoX that fails midway still closes the pipe, which FLAC would otherwise encode as a shorter but valid file
+            conversion->jobs = {SoXJob, FLACJob};
         }
-
-        // Set the eventual return value to this FLAC
-        outputFLAC = conversionParameters->outputDir.path() + "/" + parsedFileSyntax + ".flac";
     }
     else {
         // Variables to hold dynamic tag-based filenames as defined by the user
@@ -852,12 +1195,10 @@ QString convertToFLAC(QString inputFLAC, conversionParameters_t *conversionParam
         // Make any necessary folders for the file to live in
         QDir().mkpath(conversionParameters->outputDir.path() + "/" + parsedFolderSyntax);
 
-        QProcess FLACProcess;
         QString programLocation = checkInstalledProgram("sDefaultFLACLocation", "flac");
         if(programLocation == "") {
-            return "";
+            return false;
         }
-        FLACProcess.setProgram(programLocation);
 
         // FLAC arguments
         // -f: force
@@ -866,20 +1207,30 @@ QString convertToFLAC(QString inputFLAC, conversionParameters_t *conversionParam
         // -o: output location
         QStringList arguments;
         arguments << "-f" << "-V" << "-8" << QDir::toNativeSeparators(inputFLAC) << "-o" << QDir::toNativeSeparators(outputFLAC);
-        FLACProcess.setArguments(arguments);
-        // Start and wait
-        FLACProcess.start();
-        FLACProcess.waitForFinished(-1);
-
-        // Set the eventual return value to this FLAC
-        outputFLAC = conversionParameters->outputDir.path() + "/" + parsedFileSyntax + ".flac";
+        conversion->outputFile = outputFLAC;
+        conversion->jobs = {{programLocation, arguments, ""}};
     }
 
-    return outputFLAC;
+    return true;
+}
+
+// Removes the "ENCODER" and "ENCODER_OPTIONS" tags opusenc adds to its output
+static bool removeOpusEncoderTags(QString outputOpus) {
+#if defined(Q_OS_LINUX)
+    TagLib::Ogg::Opus::File outputOpusTagFile(outputOpus.toStdString().data());
+#elif defined(Q_OS_WIN)
+    TagLib::Ogg::Opus::File outputOpusTagFile(outputOpus.toStdWString().data());
+#endif
+    TagLib::PropertyMap outputOpusTagMap = outputOpusTagFile.properties();
+    outputOpusTagMap.erase("ENCODER");
+    outputOpusTagMap.erase("ENCODER_OPTIONS");
+    outputOpusTagFile.setProperties(outputOpusTagMap);
+    outputOpusTagFile.save();
+    return true;
 }
 
-// Converts a FLAC to a Opus
-QString convertToOpus(QString inputFLAC, conversionParameters_t *conversionParameters) {
+// Sets up converting a FLAC to an Opus
+static bool prepareOpusConversion(QString inputFLAC, conversionParameters_t *conversionParameters, trackConversion_t *conversion) {
     // Variables to hold dynamic tag-based filenames as defined by the user
     QString parsedFileSyntax = parseNamingSyntax(conversionParameters->syntaxInput, conversionParameters->codecInput, conversionParameters->presetInput, inputFLAC);
     QString parsedFolderSyntax = "";
@@ -896,12 +1247,10 @@ QString convertToOpus(QString inputFLAC, conversionParameters_t *conversionParam
     // Make any necessary folders for the file to live in
     QDir().mkpath(conversionParameters->outputDir.path() + "/" + parsedFolderSyntax);
 
-    QProcess OpusProcess;
     QString programLocation = checkInstalledProgram("sDefaultOpusLocation", "opusenc");
     if(programLocation == "") {
-        return "";
+        return false;
     }
-    OpusProcess.setProgram(programLocation);
 
     // Opus arguments
     // --quiet: suppress output
@@ -929,46 +1278,17 @@ QString convertToOpus(QString inputFLAC, conversionParameters_t *conversionParam
     }
 
     arguments << QDir::toNativeSeparators(inputFLAC) << QDir::toNativeSeparators(outputOpus);
-    OpusProcess.setArguments(arguments);
-
-    // Start and wait
-    OpusProcess.start();
-    OpusProcess.waitForFinished(-1);
-
-    // Remove the resultant "ENCODER" and "ENCODER_OPTIONS" tags from output Opus files
-#if defined(Q_OS_LINUX)
-    TagLib::Ogg::Opus::File outputOpusTagFile(outputOpus.toStdString().data());
-#elif defined(Q_OS_WIN)
-    TagLib::Ogg::Opus::File outputOpusTagFile(outputOpus.toStdWString().data());
-#endif
-    TagLib::PropertyMap outputOpusTagMap = outputOpusTagFile.properties();
-    outputOpusTagMap.erase("ENCODER");
-    outputOpusTagMap.erase("ENCODER_OPTIONS");
-    outputOpusTagFile.setProperties(outputOpusTagMap);
-    outputOpusTagFile.save();
 
-    return outputOpus;
+    conversion->outputFile = outputOpus;
+    conversion->jobs = {{programLocation, arguments, ""}};
+    conversion->finish = [outputOpus]() {
+        return removeOpusEncoderTags(outputOpus);
+    };
+    return true;
 }
 
-// Converts a FLAC to an MP3
-QString convertToMP3(QString inputFLAC, conversionParameters_t *conversionParameters) {
-    // Variables to hold dynamic tag-based filenames as defined by the user
-    QString parsedFileSyntax = parseNamingSyntax(conversionParameters->syntaxInput, conversionParameters->codecInput, conversionParameters->presetInput, inputFLAC);
-    QString parsedFolderSyntax = "";
-
-    // If the output is going to be in a nested folder(s)
-    if(parsedFileSyntax.contains('/')) {
-        // Set the folder to everything except the filename
-        parsedFolderSyntax = parsedFileSyntax.mid(0, parsedFileSyntax.lastIndexOf('/'));
-    }
-
-    // Eventual name of the output WAV and output MP3
-    QString outputWAV = conversionParameters->outputDir.path() + "/" + parsedFileSyntax + ".wav";
-    QString outputMP3 = conversionParameters->outputDir.path() + "/" + parsedFileSyntax + ".mp3";
-
-    // Make any necessary folders for the files to live in
-    QDir().mkpath(conversionParameters->outputDir.path() + "/" + parsedFolderSyntax);
-
+// Writes a FLAC's tags and pictures into the MP3 LAME made from it, which starts out with none
+static bool tagMP3Output(QString inputFLAC, QString outputMP3) {
     // Two QStringLists to be used as a pair for a tag and its data to live in (TRACKNUMBER == 01, YEAR == 2017, and so on)
     QStringList pendingTagNames;
     QStringList pendingTagData;
@@ -995,65 +1315,6 @@ QString convertToMP3(QString inputFLAC, conversionParameters_t *conversionParame
         it++;
     }
 
-    QProcess deFLACProcess;
-    QString programLocation = checkInstalledProgram("sDefaultFLACLocation", "flac");
-    if(programLocation == "") {
-        return "";
-    }
-    deFLACProcess.setProgram(programLocation);
-
-    // deFLAC arguments
-    // -d: decode to WAV
-    // -o: output location
-    QStringList arguments;
-    arguments << "-d" << QDir::toNativeSeparators(inputFLAC) << "-o" << QDir::toNativeSeparators(outputWAV);
-    deFLACProcess.setArguments(arguments);
-
-    // Start and wait
-    deFLACProcess.start();
-    deFLACProcess.waitForFinished(-1);
-
-    QProcess LAMEProcess;
-    programLocation = checkInstalledProgram("sDefaultLAMELocation", "lame");
-    if(programLocation == "") {
-        return "";
-    }
-    LAMEProcess.setProgram(programLocation);
-
-    // LAME arguments
-    // -q 0: use highest quality/slowest algorithms
-    // -V: variable bitrate mode (VBR)
-    // -b: constant bitrate mode (CBR)
-    arguments.clear();
-    arguments << "-q" << "0";
-
-    if(conversionParameters->presetInput == "245kbps VBR (V0)")      {arguments << "-V" << "0";}
-    else if(conversionParameters->presetInput == "225kbps VBR (V1)") {arguments << "-V" << "1";}
-    else if(conversionParameters->presetInput == "190kbps VBR (V2)") {arguments << "-V" << "2";}
-    else if(conversionParameters->presetInput == "175kbps VBR (V3)") {arguments << "-V" << "3";}
-    else if(conversionParameters->presetInput == "165kbps VBR (V4)") {arguments << "-V" << "4";}
-    else if(conversionParameters->presetInput == "130kbps VBR (V5)") {arguments << "-V" << "5";}
-    else if(conversionParameters->presetInput == "115kbps VBR (V6)") {arguments << "-V" << "6";}
-    else if(conversionParameters->presetInput == "100kbps VBR (V7)") {arguments << "-V" << "7";}
-    else if(conversionParameters->presetInput == "85kbps VBR (V8)")  {arguments << "-V" << "8";}
-    else if(conversionParameters->presetInput == "65kbps VBR (V9)")  {arguments << "-V" << "9";}
-    else if(conversionParameters->presetInput == "320kbps CBR")      {arguments << "-b" << "320";}
-    else if(conversionParameters->presetInput == "256kbps CBR")      {arguments << "-b" << "256";}
-    else if(conversionParameters->presetInput == "192kbps CBR")      {arguments << "-b" << "192";}
-    else if(conversionParameters->presetInput == "128kbps CBR")      {arguments << "-b" << "128";}
-    else if(conversionParameters->presetInput == "64kbps CBR")       {arguments << "-b" << "64";}
-
-    arguments << QDir::toNativeSeparators(outputWAV) << QDir::toNativeSeparators(outputMP3);
-
-    LAMEProcess.setArguments(arguments);
-
-    // Start and wait
-    LAMEProcess.start();
-    LAMEProcess.waitForFinished(-1);
-
-    // Remove the original WAV file
-    QFile(outputWAV).remove();
-
     // Create a TagFile and a PropertyMap for the resultant MP3. This MP3 will not have any data in its property map yet so we create a new one
 #if defined(Q_OS_LINUX)
     TagLib::MPEG::File outputMP3TagFile(outputMP3.toStdString().data());
@@ -1153,5 +1414,169 @@ QString convertToMP3(QString inputFLAC, conversionParameters_t *conversionParame
     // Save the MP3 file. Arguments in order: Save all tags, strip any tags that are not in the propertyMap, use id3v2.4, and don't save id3v1 tags)
     outputMP3TagFile.save(TagLib::MPEG::File::AllTags, true, 4, false);
 
-    return outputMP3;
+    return true;
+}
+
+// Sets up converting a FLAC to an MP3
+static bool prepareMP3Conversion(QString inputFLAC, conversionParameters_t *conversionParameters, trackConversion_t *conversion) {
+    // Variables to hold dynamic tag-based filenames as defined by the user
+    QString parsedFileSyntax = parseNamingSyntax(conversionParameters->syntaxInput, conversionParameters->codecInput, conversionParameters->presetInput, inputFLAC);
+    QString parsedFolderSyntax = "";
+
+    // If the output is going to be in a nested folder(s)
+    if(parsedFileSyntax.contains('/')) {
+        // Set the folder to everything except the filename
+        parsedFolderSyntax = parsedFileSyntax.mid(0, parsedFileSyntax.lastIndexOf('/'));
+    }
+
+    // Eventual name of the output MP3
+    QString outputMP3 = conversionParameters->outputDir.path() + "/" + parsedFileSyntax + ".mp3";
+
+    // Make any necessary folders for the files to live in
+    QDir().mkpath(conversionParameters->outputDir.path() + "/" + parsedFolderSyntax);
+
+    QString programLocation = checkInstalledProgram("sDefaultFLACLocation", "flac");
+    if(programLocation == "") {
+        return false;
+    }
+
+    // deFLAC arguments
+    // -d: decode to WAV
+    // -c: write the WAV to stdout, so it's never stored anywhere
+    // --silent: no progress output
+    QStringList arguments;
+    arguments << "-d" << "-c" << "--silent" << QDir::toNativeSeparators(inputFLAC);
+    processJob_t deFLACJob{programLocation, arguments, ""};
+
+    programLocation = checkInstalledProgram("sDefaultLAMELocation", "lame");
+    if(programLocation == "") {
+        return false;
+    }
+
+    // LAME arguments
+    // -q 0: use highest quality/slowest algorithms
+    // -V: variable bitrate mode (VBR)
+    // -b: constant bitrate mode (CBR)
+    arguments.clear();
+    arguments << "-q" << "0";
+
+    if(conversionParameters->presetInput == "245kbps VBR (V0)")      {arguments << "-V" << "0";}
+    else if(conversionParameters->presetInput == "225kbps VBR (V1)") {arguments << "-V" << "1";}
+    else if(conversionParameters->presetInput == "190kbps VBR (V2)") {arguments << "-V" << "2";}
+    else if(conversionParameters->presetInput == "175kbps VBR (V3)") {arguments << "-V" << "3";}
+    else if(conversionParameters->presetInput == "165kbps VBR (V4)") {arguments << "-V" << "4";}
+    else if(conversionParameters->presetInput == "130kbps VBR (V5)") {arguments << "-V" << "5";}
+    else if(conversionParameters->presetInput == "115kbps VBR (V6)") {arguments << "-V" << "6";}
+    else if(conversionParameters->presetInput == "100kbps VBR (V7)") {arguments << "-V" << "7";}
+    else if(conversionParameters->presetInput == "85kbps VBR (V8)")  {arguments << "-V" << "8";}
+    else if(conversionParameters->presetInput == "65kbps VBR (V9)")  {arguments << "-V" << "9";}
+    else if(conversionParameters->presetInput == "320kbps CBR")      {arguments << "-b" << "320";}
+    else if(conversionParameters->presetInput == "256kbps CBR")      {arguments << "-b" << "256";}
+    else if(conversionParameters->presetInput == "192kbps CBR")      {arguments << "-b" << "192";}
+    else if(conversionParameters->presetInput == "128kbps CBR")      {arguments << "-b" << "128";}
+    else if(conversionParameters->presetInput == "64kbps CBR")       {arguments << "-b" << "64";}
+
+    // -: read the WAV from stdin
+    arguments << "-" << QDir::toNativeSeparators(outputMP3);
+    processJob_t LAMEJob{programLocation, arguments, ""};
+
+    // Run FLAC with its stdout connected to LAME's stdin. LAME finishes once FLAC closes the pipe
+    // If either of them failed, the MP3 is at best a partial one
+    conversion->outputFile = outputMP3;
+    conversion->jobs = {deFLACJob, LAMEJob};
+    conversion->finish = [inputFLAC, outputMP3]() {
+        return tagMP3Output(inputFLAC, outputMP3);
+    };
+    return true;
+}
+
+// Starts converting a FLAC to the chosen codec and returns without waiting for its encoder, so only the process supervisor limits how many encoders run
+// Setting up (and the built-in resampler) runs on the calling thread. The encoder is then queued with the supervisor, and once it's done
+// its tagging runs on finishPool, after which trackConverted gets the output file, or "" if anything failed (a partial output is removed)
+void startTrackConversion(QString inputFLAC, conversionParameters_t *conversionParameters, int futureBPS, int futureSampleRate, QThreadPool *finishPool, std::function<void(QString)> trackConverted) {
+    trackConversion_t conversion{"", {}, nullptr};
+    bool prepared = false;
+    if(conversionParameters->codecInput == "FLAC") {
+        prepared = prepareFLACConversion(inputFLAC, conversionParameters, futureBPS, futureSampleRate, &conversion);
+    }
+    else if(conversionParameters->codecInput == "Opus") {
+        prepared = prepareOpusConversion(inputFLAC, conversionParameters, &conversion);
+    }
+    else if(conversionParameters->codecInput == "MP3") {
+        prepared = prepareMP3Conversion(inputFLAC, conversionParameters, &conversion);
+    }
+
+    QString outputFile = conversion.outputFile;
+    std::function<bool()> finish = conversion.finish;
+    auto finishConversion = [outputFile, finish, trackConverted](bool encoded) {
+        if(encoded && outputFile != "" && (!finish || finish())) {
+            trackConverted(outputFile);
+            return;
+        }
+        if(outputFile != "") {
+            QFile::remove(outputFile);
+        }
+        trackConverted("");
+    };
+
+    if(!prepared || conversion.jobs.isEmpty()) {
+        finishConversion(prepared);
+        return;
+    }
+
+    // The callback runs on the supervisor's thread, so the tagging is handed on to the pool
+    ProcessSupervisor::instance()->submit(conversion.jobs, [finishPool, finishConversion](const processResult_t &result) {
+        bool encoded = result.succeeded();
+        QtConcurrent::run(finishPool, [finishConversion, encoded]() {
+            finishConversion(encoded);
+        });
+    }, conversionParameters->cancelGroup);
+}
+
+// Reads a converted FLAC's STREAMINFO back and checks it against its input
+// It must hold every frame of the input (scaled to its own sample rate), and if the format didn't change, the very same audio MD5
+static bool verifyOutputFLAC(QString inputFLAC, QString outputFLAC) {
+    FLACMetadataReader inputFLACMetadata(inputFLAC);
+    FLACMetadataReader outputFLACMetadata(outputFLAC);
+    if(!inputFLACMetadata.isValid() || !outputFLACMetadata.isValid()) {
+        return false;
+    }
+
+    audioFormat_t inputFormat = inputFLACMetadata.audioFormat();
+    audioFormat_t outputFormat = outputFLACMetadata.audioFormat();
+    if(inputFormat.sampleRate <= 0 || outputFormat.sampleRate <= 0 || outputFormat.totalFrames <= 0 || outputFormat.channels != inputFormat.channels) {
+        return false;
+    }
+
+    // Same sample rate: frame for frame
+    if(outputFormat.sampleRate == inputFormat.sampleRate) {
+        if(outputFormat.totalFrames != inputFormat.totalFrames) {
+            return false;
+        }
+        // Same bit-depth as well: the samples themselves must be unchanged
+        if(outputFormat.bitsPerSample == inputFormat.bitsPerSample) {
+            return outputFLACMetadata.audioMD5() == inputFLACMetadata.audioMD5();
+        }
+        return true;
+    }
+
+    // Resampled: the length may only differ by the resampler's rounding (allow 10ms)
+    qint64 expectedFrames = inputFormat.totalFrames * outputFormat.sampleRate / inputFormat.sampleRate;
+    return qAbs(outputFormat.totalFrames - expectedFrames) <= outputFormat.sampleRate / 100;
+}
+
+// Deletes a temp FLAC once it has been converted, if nothing later on still needs it (see conversionParameters_t::releasableFLACs)
+// Keeps it if the conversion failed or wrote over it, and for FLAC outputs, unless the output reads back as a complete copy of it
+void releaseInputFLAC(QString inputFLAC, QString outputFile, conversionParameters_t *conversionParameters) {
+    if(!conversionParameters->releasableFLACs.contains(inputFLAC) || outputFile == "" || !QFileInfo(outputFile).exists() || QFileInfo(outputFile).size() == 0) {
+        return;
+    }
+    if(QFileInfo(outputFile).absoluteFilePath() == QFileInfo(inputFLAC).absoluteFilePath()) {
+        return;
+    }
+    if(outputFile.endsWith(".flac", Qt::CaseInsensitive) && !verifyOutputFLAC(inputFLAC, outputFile)) {
+        return;
+    }
+
+    QFile::remove(inputFLAC);
 }
@@ -1,14 +1,23 @@
 #ifndef HELPER_H
 #define HELPER_H
 
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <iomanip>
 
+#include <QByteArray>
+#include <QDateTime>
 #include <QDir>
+#include <QDirIterator>
+#include <QFuture>
+#include <QMap>
 #include <QProcess>
+#include <QSaveFile>
 #include <QSettings>
 #include <QtConcurrent/QtConcurrentRun>
 #include <QThreadPool>
+#include <QVector>
 #include <QImage>
 
 #include <attachedpictureframe.h>
@@ -18,32 +27,87 @@
 #include <opusfile.h>
 #include <tpropertymap.h>
 
+// Defined in processsupervisor.h, progress.h and pagecache.h, which need this header
+struct processResult_t;
+class ConversionProgress;
+struct pageCacheStats_t;
+
+// Folder (next to the temp folders) that finished temp folders are moved into, to be deleted in the background
+#define TRASH_FOLDER_NAME ".qMusicImportKit trash"
+// Files handed to each background deletion task
+#define TRASH_BATCH_SIZE 64
+
+// Audio stream properties of a FLAC, as stored in its STREAMINFO block
+struct audioFormat_t {
+    int sampleRate;
+    int bitsPerSample;
+    int channels;
+    qint64 totalFrames;
+};
+
+// What a FLAC's audio actually uses, as opposed to what its header claims (see hires.cpp)
+struct effectiveFormat_t {
+    QString inputFLAC;
+    int sampleRate;
+    int bitsPerSample;
+    // Bits that are ever non-zero; stored bits below this are padding
+    int effectiveBitsPerSample;
+    // Highest frequency (Hz) with any real content
+    double effectiveBandwidth;
+    // 44100 or 48000, whichever the sample rate is a multiple of (or the sample rate itself)
+    int baseSampleRate;
+    // Stored above 16-bit, but the audio fits in 16-bit without losing anything
+    bool paddedBitDepth;
+    // Stored above 48kHz, but there's nothing above the base sample rate's Nyquist frequency
+    bool upsampled;
+};
+
 struct conversionParameters_t {
     QStringList inputFLACs;
     QDir outputDir;
     QString presetInput;
     QString syntaxInput;
     QString codecInput;
+    // Scan results by input FLAC, filled in when the "Remove fake hi-res" preset is used
+    QMap<QString, effectiveFormat_t> effectiveFormats;
+    // Temp FLACs that no later stage needs, which are deleted as soon as they're converted to free up temp space
+    QStringList releasableFLACs;
+    // Converted file by input FLAC, filled in by convertToFormat (only for tracks that were converted)
+    QMap<QString, QString> outputsByInput;
+    // Input FLACs that convertToFormat couldn't convert (or that were cancelled)
+    QStringList failedInputs;
+    // Progress shown in the UI, and the process group to cancel along with it (null and 0 for drop folder albums)
+    ConversionProgress *progress;
+    quintptr cancelGroup;
+    // Where drop-behind adds up what it released from the page cache (null when drop-behind is off)
+    pageCacheStats_t *pageCacheStats;
 };
 
 void getShellPATH();
 QString getWSLPath(QString winLocation);
 bool isWSLLoudgainAvailable();
 bool removeDir(const QString &dirName);
+bool transferStagedFile(QString stagedFile, QString outputFile, pageCacheStats_t *pageCacheStats = nullptr);
+bool moveToTrash(QString dirName);
+void emptyTrash(QString trashDirName);
 QDir getNearestParent(QDir pathDir);
 QString cleanString(QString input, QString ignoredChars = "");
 QStringList findFiles(QDir rootDir, QStringList patternList = {"*.*"});
 QString checkInstalledProgram(QString location, QString programName = "", bool useSettingsKey = true);
 void openSpekWorker(QStringList inputFLACs);
+bool readAudioFormat(QString inputFLAC, audioFormat_t *audioFormat);
+QString getAudioMD5(QString inputFLAC);
+bool decodeFLACStream(QString inputFLAC, audioFormat_t *audioFormat, std::function<bool(const QByteArray &)> chunkCallback, quintptr cancelGroup = 0);
+void convertPCMToFloat(const QByteArray &rawPCM, int bitsPerSample, QVector<float> *outputSamples);
 QString parseNamingSyntax(QString syntax, QString codec, QString preset, QString filename, int futureBPS = -1, int futureSampleRate = -1);
-void compressGIF(QString inputGIF);
-void compressJPG(QString inputJPG);
-void compressPNGs(QStringList inputPNGs);
+QFuture<processResult_t> compressGIF(QString inputGIF);
+QFuture<processResult_t> compressJPG(QString inputJPG);
+QFuture<processResult_t> compressPNGs(QStringList inputPNGs);
 QString getRealImageFormat(QString inputImage);
 void compressImages(QStringList inputFiles);
-void convertWAV(QString inputWAV);
-QString convertToFLAC(QString inputFLAC, conversionParameters_t *conversionParameters, int futureBPS, int futureSampleRate);
-QString convertToOpus(QString inputFLAC, conversionParameters_t *conversionParameters);
-QString convertToMP3(QString inputFLAC, conversionParameters_t *conversionParameters);
+bool convertWAV(QString inputWAV, QString outputFLAC = "");
+void copyFLACMetadata(QString inputFLAC, QString outputFLAC);
+void startTrackConversion(QString inputFLAC, conversionParameters_t *conversionParameters, int futureBPS, int futureSampleRate, QThreadPool *finishPool, std::function<void(QString)> trackConverted);
+void releaseInputFLAC(QString inputFLAC, QString outputFile, conversionParameters_t *conversionParameters);
 
 #endif // HELPER_H
@@ -0,0 +1,274 @@
+#include "hires.h"
+#include "cpufeatures.h"
+
+// Bandwidth probe FFT size. Frequency resolution barely matters here, only where the content stops
+static const int probeFFTSize = 2048;
+// Only one in this many FFT frames is transformed, which is plenty for a long-term average and keeps the probe cheap
+static const int probeFrameInterval = 8;
+
+// ORs every sample of a block of raw little-endian PCM together, one byte lane per byte of a sample
+// Any bit that's still 0 afterwards is 0 in every sample
+static void orReduceSamplesScalar(const unsigned char *rawBytes, int byteCount, int bytesPerSample, unsigned char *sampleOR) {
+    for(int i = 0; i + bytesPerSample <= byteCount; i += bytesPerSample) {
+        for(int byte = 0; byte < bytesPerSample; byte++) {
+            sampleOR[byte] |= rawBytes[i + byte];
+        }
+    }
+}
+
+#if defined(MIK_X86_KERNELS)
+// AVX2 version of orReduceSamplesScalar
+// Reads bytesPerSample vectors per step, so every accumulator byte keeps lining up with the same byte of a sample (e.g. 96 bytes for 24-bit)
+__attribute__((target("avx2")))
+static void orReduceSamplesAVX2(const unsigned char *rawBytes, int byteCount, int bytesPerSample, unsigned char *sampleOR) {
+    __m256i accumulators[4] = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+    int stride = 32 * bytesPerSample;
+
+    int i = 0;
+    for(; i + stride <= byteCount; i += stride) {
+        for(int vector = 0; vector < bytesPerSample; vector++) {
+            accumulators[vector] = _mm256_or_si256(accumulators[vector], _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rawBytes + i + 32 * vector)));
+        }
+    }
+
+    // Fold every accumulator byte back into the sample byte it belongs to
+    unsigned char lanes[32];
+    for(int vector = 0; vector < bytesPerSample; vector++) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), accumulators[vector]);
+        for(int lane = 0; lane < 32; lane++) {
+            sampleOR[(32 * vector + lane) % bytesPerSample] |= lanes[lane];
+        }
+    }
+
+    // Leftover samples that don't fill a whole step
+    orReduceSamplesScalar(rawBytes + i, byteCount - i, bytesPerSample, sampleOR);
+}
+#endif
+
+#if defined(MIK_NEON_KERNELS)
+// NEON version of orReduceSamplesScalar, with 16-byte vectors
+static void orReduceSamplesNEON(const unsigned char *rawBytes, int byteCount, int bytesPerSample, unsigned char *sampleOR) {
+    uint8x16_t accumulators[4] = {vdupq_n_u8(0), vdupq_n_u8(0), vdupq_n_u8(0), vdupq_n_u8(0)};
+    int stride = 16 * bytesPerSample;
+
+    int i = 0;
+    for(; i + stride <= byteCount; i += stride) {
+        for(int vector = 0; vector < bytesPerSample; vector++) {
+            accumulators[vector] = vorrq_u8(accumulators[vector], vld1q_u8(rawBytes + i + 16 * vector));
+        }
+    }
+
+    unsigned char lanes[16];
+    for(int vector = 0; vector < bytesPerSample; vector++) {
+        vst1q_u8(lanes, accumulators[vector]);
+        for(int lane = 0; lane < 16; lane++) {
+            sampleOR[(16 * vector + lane) % bytesPerSample] |= lanes[lane];
+        }
+    }
+
+    orReduceSamplesScalar(rawBytes + i, byteCount - i, bytesPerSample, sampleOR);
+}
+#endif
+
+// Picks the fastest OR-reduction kernel the running CPU supports
+typedef void (*orReduceSamplesFunction)(const unsigned char *, int, int, unsigned char *);
+static orReduceSamplesFunction selectOrReduceSamples() {
+#if defined(MIK_X86_KERNELS)
+    if(cpuSupportsAVX2()) {
+        return orReduceSamplesAVX2;
+    }
+#endif
+#if defined(MIK_NEON_KERNELS)
+    return orReduceSamplesNEON;
+#endif
+    return orReduceSamplesScalar;
+}
+
+// True if a format is above CD/DAT quality in either bit-depth or sample rate
+bool isHiResFormat(int bitsPerSample, int sampleRate) {
+    return bitsPerSample > 16 || sampleRate > 48000;
+}
+
+// Decodes a FLAC and measures how many bits and how much bandwidth its audio really uses
+// Effective bit-depth comes from OR-ing every sample together (padding bits are never set)
+// Effective bandwidth comes from a sparse FFT probe: the frequency above which there's practically no energy left
+bool scanEffectiveFormat(QString inputFLAC, effectiveFormat_t *effectiveFormat) {
+    static const orReduceSamplesFunction orReduceSamples = selectOrReduceSamples();
+
+    audioFormat_t audioFormat;
+
+    effectiveFormat->inputFLAC = inputFLAC;
+    effectiveFormat->paddedBitDepth = false;
+    effectiveFormat->upsampled = false;
+
+    fftPlan_t plan;
+    createFFTPlan(probeFFTSize, &plan);
+    fftWorkspace_t workspace;
+    createFFTWorkspace(plan, &workspace);
+    int bins = probeFFTSize / 2 + 1;
+
+    unsigned char sampleOR[4] = {0, 0, 0, 0};
+
+    // Probe state: samples of the current FFT frame per channel, and how many frames have gone by
+    std::vector<std::vector<float>> channelFrames;
+    int framesFilled = 0;
+    int frameNumber = 0;
+    std::vector<float> powerSpectrum(bins);
+    std::vector<double> accumulatedSpectrum(bins, 0.0);
+
+    QVector<float> floatSamples;
+
+    bool decodeSucceeded = decodeFLACStream(inputFLAC, &audioFormat, [&](const QByteArray &rawPCM) {
+        int bytesPerSample = (audioFormat.bitsPerSample + 7) / 8;
+        int channels = audioFormat.channels;
+
+        // Bit-depth: every sample in the chunk
+        orReduceSamples(reinterpret_cast<const unsigned char *>(rawPCM.constData()), rawPCM.size(), bytesPerSample, sampleOR);
+
+        // Bandwidth: only every probeFrameInterval-th FFT frame is converted and transformed
+        if(channelFrames.empty()) {
+            channelFrames.assign(channels, std::vector<float>(probeFFTSize));
+        }
+
+        int chunkFrames = rawPCM.size() / (bytesPerSample * channels);
+        int chunkPosition = 0;
+        while(chunkPosition < chunkFrames) {
+            int framesLeftInFFT = probeFFTSize - framesFilled;
+            int framesTaken = qMin(framesLeftInFFT, chunkFrames - chunkPosition);
+
+            if(frameNumber % probeFrameInterval == 0) {
+                convertPCMToFloat(rawPCM.mid(chunkPosition * bytesPerSample * channels, framesTaken * bytesPerSample * channels), audioFormat.bitsPerSample, &floatSamples);
+                for(int frame = 0; frame < framesTaken; frame++) {
+                    for(int channel = 0; channel < channels; channel++) {
+                        channelFrames[channel][framesFilled + frame] = floatSamples[frame * channels + channel];
+                    }
+                }
+            }
+
+            framesFilled += framesTaken;
+            chunkPosition += framesTaken;
+
+            if(framesFilled == probeFFTSize) {
+                if(frameNumber % probeFrameInterval == 0) {
+                    for(int channel = 0; channel < channels; channel++) {
+                        computePowerSpectrum(plan, &workspace, channelFrames[channel].data(), powerSpectrum.data());
+                        accumulateSpectrum(powerSpectrum.data(), accumulatedSpectrum.data(), bins);
+                    }
+                }
+                framesFilled = 0;
+                frameNumber++;
+            }
+        }
+
+        return true;
+    });
+
+    if(!decodeSucceeded) {
+        return false;
+    }
+
+    effectiveFormat->sampleRate = audioFormat.sampleRate;
+    effectiveFormat->bitsPerSample = audioFormat.bitsPerSample;
+
+    // Effective bit-depth is the sample width minus the always-zero low bits. Digital silence uses no bits at all
+    // Counted against the whole-byte width (e.g. 24 for 20-bit), as odd bit-depths may or may not arrive left-justified.
+    // That can only overestimate, which is the safe direction
+    int containerBits = ((audioFormat.bitsPerSample + 7) / 8) * 8;
+    quint32 combinedOR = sampleOR[0] | sampleOR[1] << 8 | sampleOR[2] << 16 | static_cast<quint32>(sampleOR[3]) << 24;
+    int zeroLowBits = 0;
+    while(zeroLowBits < containerBits && !(combinedOR & (1u << zeroLowBits))) {
+        zeroLowBits++;
+    }
+    effectiveFormat->effectiveBitsPerSample = qMin(audioFormat.bitsPerSample, containerBits - zeroLowBits);
+
+    // Effective bandwidth: walk down from Nyquist until the energy above reaches the threshold (DC is left out of the total)
+    double totalEnergy = 0.0;
+    for(int k = 1; k < bins; k++) {
+        totalEnergy += accumulatedSpectrum[k];
+    }
+
+    double nyquist = audioFormat.sampleRate / 2.0;
+    effectiveFormat->effectiveBandwidth = 0.0;
+    if(totalEnergy > 0.0) {
+        double energyAbove = 0.0;
+        for(int k = bins - 1; k >= 1; k--) {
+            energyAbove += accumulatedSpectrum[k];
+            if(10.0 * std::log10(energyAbove / totalEnergy) > HIRES_BANDWIDTH_THRESHOLD) {
+                effectiveFormat->effectiveBandwidth = k * nyquist / (bins - 1);
+                break;
+            }
+        }
+    }
+
+    // Same base sample rate logic as convertToFormat (e.g. 48000 for 96kHz, 44100 for 88.2kHz)
+    if(audioFormat.sampleRate % 44100 == 0) {
+        effectiveFormat->baseSampleRate = 44100;
+    }
+    else if(audioFormat.sampleRate % 48000 == 0) {
+        effectiveFormat->baseSampleRate = 48000;
+    }
+    else {
+        effectiveFormat->baseSampleRate = audioFormat.sampleRate;
+    }
+
+    effectiveFormat->paddedBitDepth = audioFormat.bitsPerSample > 16 && effectiveFormat->effectiveBitsPerSample <= 16;
+
+    // A couple of FFT bins of leeway for the resampler's transition band
+    effectiveFormat->upsampled = audioFormat.sampleRate > 48000 && effectiveFormat->baseSampleRate != audioFormat.sampleRate &&
+            effectiveFormat->effectiveBandwidth <= effectiveFormat->baseSampleRate / 2.0 + 2.0 * nyquist / (bins - 1);
+
+    return true;
+}
+
+// Scans every FLAC in parallel, adding the results to effectiveFormats (FLACs that are already in it are skipped)
+void scanAlbumEffectiveFormats(QStringList inputFLACs, QMap<QString, effectiveFormat_t> *effectiveFormats) {
+    QStringList pendingFLACs;
+    foreach(QString currentFLAC, inputFLACs) {
+        if(!effectiveFormats->contains(currentFLAC)) {
+            pendingFLACs += currentFLAC;
+        }
+    }
+
+    // Initialize a pool for parallel threads. Default number of parallel threads is equal to processor's logical core count
+    QThreadPool scanPool;
+    QVector<effectiveFormat_t> scans(pendingFLACs.count());
+    // Whether each FLAC could be scanned, by index
+    QVector<bool> scanResults(pendingFLACs.count(), false);
+    effectiveFormat_t *scanData = scans.data();
+    bool *scanResultData = scanResults.data();
+    workSchedule_t scanSchedule;
+
+    // Longest tracks first
+    startLongestFirst(&scanPool, pendingFLACs, "Checking hi-res files", [=](int i) {
+        scanResultData[i] = scanEffectiveFormat(pendingFLACs[i], scanData + i);
+    }, &scanSchedule);
+    finishLongestFirst(&scanPool, &scanSchedule);
+
+    // FLACs that couldn't be scanned are left out, so nothing gets changed for them
+    for(int i = 0; i < pendingFLACs.count(); i++) {
+        if(scanResults[i]) {
+            effectiveFormats->insert(pendingFLACs[i], scans[i]);
+        }
+    }
+}
+
+// Builds a readable list of the FLACs that are only hi-res on paper, for showing to the user
+QString describeFakeHiRes(const QList<effectiveFormat_t> &effectiveFormats) {
+    QString description;
+
+    foreach(const effectiveFormat_t &effectiveFormat, effectiveFormats) {
+        QStringList findings;
+        if(effectiveFormat.paddedBitDepth) {
+            findings += QString("%1-bit audio padded to %2-bit").arg(effectiveFormat.effectiveBitsPerSample).arg(effectiveFormat.bitsPerSample);
+        }
+        if(effectiveFormat.upsampled) {
+            findings += QString("nothing above %1kHz at %2kHz").arg(effectiveFormat.effectiveBandwidth / 1000.0, 0, 'f', 1).arg(effectiveFormat.sampleRate / 1000.0);
+        }
+
+        if(!findings.isEmpty()) {
+            description += QFileInfo(effectiveFormat.inputFLAC).fileName() + "\n    " + findings.join(", ") + "\n";
+        }
+    }
+
+    return description;
+}
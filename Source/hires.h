@@ -0,0 +1,19 @@
+#ifndef HIRES_H
+#define HIRES_H
+
+#include <helper.h>
+#include <fft.h>
+#include <schedule.h>
+
+#include <QFileInfo>
+#include <QtMath>
+
+// Energy above a frequency has to be at least this far (dB) below the track's total energy to count as "nothing there"
+#define HIRES_BANDWIDTH_THRESHOLD -100.0
+
+bool isHiResFormat(int bitsPerSample, int sampleRate);
+bool scanEffectiveFormat(QString inputFLAC, effectiveFormat_t *effectiveFormat);
+void scanAlbumEffectiveFormats(QStringList inputFLACs, QMap<QString, effectiveFormat_t> *effectiveFormats);
+QString describeFakeHiRes(const QList<effectiveFormat_t> &effectiveFormats);
+
+#endif // HIRES_H
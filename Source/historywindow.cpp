@@ -0,0 +1,123 @@
+#include "historywindow.h"
+#include "ui_historywindow.h"
+
+HistoryWindow::HistoryWindow(QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::HistoryWindow)
+{
+    ui->setupUi(this);
+
+    // Disable resizing hints
+    setWindowFlags(Qt::Widget | Qt::MSWindowsFixedSizeDialogHint);
+
+    catalogue = openCatalogue();
+
+    ui->HistoryTableView->setModel(&historyModel);
+    ui->HistoryTableView->verticalHeader()->setVisible(false);
+
+    updateHistory();
+    updateStatistics();
+}
+
+HistoryWindow::~HistoryWindow()
+{
+    // The model's query has to go before its connection does
+    historyModel.clear();
+    closeCatalogue(&catalogue);
+    delete ui;
+}
+
+// Lists every imported album, newest first, filtered by the search box
+void HistoryWindow::updateHistory() {
+    if(!catalogue.isOpen()) {
+        return;
+    }
+
+    QSqlQuery query(catalogue);
+    query.prepare("SELECT datetime(albums.imported_at, 'unixepoch', 'localtime') AS Imported, albums.artist AS Artist, albums.album AS Album, "
+                  "albums.codec AS Format, albums.preset AS Preset, COUNT(tracks.id) AS Tracks, "
+                  "(SELECT SUM(stages.milliseconds) FROM stages WHERE stages.album_id = albums.id) / 1000 AS Seconds, albums.output_path AS Output "
+                  "FROM albums LEFT JOIN tracks ON tracks.album_id = albums.id "
+                  "WHERE albums.artist LIKE ? OR albums.album LIKE ? "
+                  "GROUP BY albums.id ORDER BY albums.imported_at DESC");
+    QString search = "%" + ui->HistorySearchLineEdit->text() + "%";
+    query.addBindValue(search);
+    query.addBindValue(search);
+    query.exec();
+
+    historyModel.setQuery(query);
+    ui->HistoryTableView->resizeColumnsToContents();
+}
+
+// Shows totals over the whole catalogue and where the time goes on average
+void HistoryWindow::updateStatistics() {
+    if(!catalogue.isOpen()) {
+        ui->HistoryStatisticsLabel->setText("The catalogue couldn't be opened.");
+        return;
+    }
+
+    QString statistics;
+    QSqlQuery query(catalogue);
+
+    // Totals
+    query.exec("SELECT (SELECT COUNT(*) FROM albums), COUNT(*), COALESCE(SUM(output_size), 0), COUNT(DISTINCT audio_md5) FROM tracks");
+    if(query.next()) {
+        statistics += QString::number(query.value(0).toLongLong()) + " albums and " + QString::number(query.value(1).toLongLong()) + " tracks imported (" +
+                      QString::number(query.value(3).toLongLong()) + " unique recordings), " + QString::number(query.value(2).toLongLong() / (1024.0 * 1024.0 * 1024.0), 'f', 2) + " GiB written.\n";
+    }
+
+    // Albums per format
+    QStringList formats;
+    query.exec("SELECT codec, COUNT(*) FROM albums GROUP BY codec ORDER BY COUNT(*) DESC");
+    while(query.next()) {
+        formats += query.value(0).toString() + ": " + query.value(1).toString();
+    }
+    if(!formats.isEmpty()) {
+        statistics += "Albums by format: " + formats.join(", ") + "\n";
+    }
+
+    // Average time spent per stage, slowest first
+    QStringList stages;
+    query.exec("SELECT stage, AVG(milliseconds) FROM stages GROUP BY stage ORDER BY AVG(milliseconds) DESC");
+    while(query.next()) {
+        stages += query.value(0).toString() + " " + QString::number(query.value(1).toDouble() / 1000.0, 'f', 1) + "s";
+    }
+    if(!stages.isEmpty()) {
+        statistics += "Average time per album: " + stages.join(", ") + "\n";
+    }
+
+    // How close the learned cost models get to the real finish times
+    // and how much memory the last batch of each kind of work was estimated to need and really used
+    QStringList predictions;
+    QStringList memoryPeaks;
+    QStringList prefetching;
+    foreach(costModelReport_t report, readCostModelReports()) {
+        if(report.predictions > 0) {
+            predictions += report.workType + " off by " + QString::number(report.averageError * 100.0, 'f', 0) + "% (last predicted " +
+                           QString::number(report.lastPredictedMilliseconds / 1000.0, 'f', 1) + "s, took " + QString::number(report.lastActualMilliseconds / 1000.0, 'f', 1) + "s)";
+        }
+        if(report.lastResidentPeakBytes > 0) {
+            memoryPeaks += report.workType + " estimated " + QString::number(report.lastEstimatedPeakBytes / (1024 * 1024)) + " MB, peak " +
+                           QString::number(report.lastResidentPeakBytes / (1024 * 1024)) + " MB";
+        }
+        // Time per sample with the last kind of prefetching, next to the time without any once both have been measured
+        if(report.lastPrefetchMode != "off" && report.lastPrefetchFiles > 0) {
+            QString prefetchReport = report.workType + " " + report.lastPrefetchMode + ", " + QString::number(report.lastPrefetchHits) + "/" + QString::number(report.lastPrefetchFiles) + " files ready in time";
+            if(report.prefetchedNanosecondsPerSample > 0.0 && report.unprefetchedNanosecondsPerSample > 0.0) {
+                prefetchReport += " (" + QString::number(report.prefetchedNanosecondsPerSample, 'f', 1) + " ns/sample, " + QString::number(report.unprefetchedNanosecondsPerSample, 'f', 1) + " without)";
+            }
+            prefetching += prefetchReport;
+        }
+    }
+    if(!predictions.isEmpty()) {
+        statistics += "Finish time predictions: " + predictions.join(", ") + "\n";
+    }
+    if(!memoryPeaks.isEmpty()) {
+        statistics += "Memory of the last run: " + memoryPeaks.join(", ") + "\n";
+    }
+    if(!prefetching.isEmpty()) {
+        statistics += "Prefetching: " + prefetching.join(", ") + "\n";
+    }
+
+    ui->HistoryStatisticsLabel->setText(statistics);
+}
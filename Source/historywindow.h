@@ -0,0 +1,34 @@
+#ifndef HISTORYWINDOW_H
+#define HISTORYWINDOW_H
+
+#include <catalogue.h>
+#include <schedule.h>
+
+#include <QDialog>
+#include <QHeaderView>
+#include <QSqlQueryModel>
+
+namespace Ui {
+class HistoryWindow;
+}
+
+class HistoryWindow : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit HistoryWindow(QWidget *parent = nullptr);
+    ~HistoryWindow();
+
+private:
+    Ui::HistoryWindow *ui;
+    // The window's own catalogue connection, kept open for as long as historyModel's query needs it
+    QSqlDatabase catalogue;
+    QSqlQueryModel historyModel;
+    void updateStatistics();
+
+private slots:
+    void updateHistory();
+};
+
+#endif // HISTORYWINDOW_H
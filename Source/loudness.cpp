@@ -0,0 +1,439 @@
+#include "loudness.h"
+
+#include <cmath>
+
+// Runs Loudgain over a list of FLACs, writing its ReplayGain tags into them
+// albumMode adds album gain, which requires every track of the album to be passed in at once
+// cancelGroup is passed on to the process supervisor, so a cancelled conversion can stop Loudgain too
+// Returns false if Loudgain is missing, failed or was cancelled, in which case its tags can't be trusted
+bool runLoudgain(QStringList inputFLACs, bool albumMode, quintptr cancelGroup) {
+    // Linux uses normal Loudgain
+#if defined(Q_OS_LINUX)
+    QString programLocation = checkInstalledProgram("sDefaultLoudgainLocation", "loudgain");
+    if(programLocation == "") {
+        return false;
+    }
+    // Windows requires WSL Loudgain as there is no native binary (yet)
+#elif defined(Q_OS_WIN)
+    QString programLocation = "wsl";
+#endif
+
+    // Loudgain arguments
+    // -a: calculates album gain
+    // -k: prevents clipping
+    // -s e: extra information calculation (Reference loudness and range)
+    QStringList arguments;
+#if defined(Q_OS_WIN)
+    arguments << "loudgain";
+#endif
+    if(albumMode) {
+        arguments << "-a";
+    }
+    arguments << "-k" << "-s" << "e";
+    foreach (QString currentFLAC, inputFLACs) {
+#if defined(Q_OS_LINUX)
+        arguments << QDir::toNativeSeparators(currentFLAC);
+#elif defined(Q_OS_WIN)
+        // Windows needs special handholding to convert from a NT path to a WSL path (C:\Users -> /mnt/c/Users)
+        arguments << getWSLPath(currentFLAC);
+#endif
+    }
+
+    // Run it through the process supervisor and wait
+    return runProcess({{programLocation, arguments, ""}}, cancelGroup).succeeded();
+}
+
+// Converts a mean-square block energy into LUFS
+static double energyToLoudness(double energy) {
+    return 10.0 * std::log10(energy) - 0.691;
+}
+
+// Returns the mean-square energy that a histogram bin stands for (the center of its 0.1 LU range)
+static double histogramBinEnergy(int bin) {
+    return std::pow(10.0, (bin / 10.0 - 69.95 + 0.691) / 10.0);
+}
+
+// Returns the histogram bin that a block energy falls into, or -1 if it is below the -70 LUFS absolute gate
+static int histogramBinIndex(double energy) {
+    if(energy <= 0.0) {
+        return -1;
+    }
+
+    int bin = static_cast<int>(std::floor((energyToLoudness(energy) + 70.0) * 10.0));
+
+    if(bin < 0) {
+        return -1;
+    }
+    // Anything louder than +30 LUFS is lumped into the top bin
+    if(bin >= LOUDNESS_HISTOGRAM_BINS) {
+        return LOUDNESS_HISTOGRAM_BINS - 1;
+    }
+
+    return bin;
+}
+
+// Returns the first bin at or above a relative gate's threshold energy
+static int relativeGateStartBin(double thresholdEnergy) {
+    int startBin = histogramBinIndex(thresholdEnergy);
+
+    // Thresholds below the absolute gate let every bin through
+    if(startBin < 0) {
+        return 0;
+    }
+    // A bin only passes the gate if its representative energy is above the threshold
+    if(thresholdEnergy > histogramBinEnergy(startBin)) {
+        startBin++;
+    }
+
+    return startBin;
+}
+
+// Sums one histogram type across tracks
+static QVector<quint64> mergeHistograms(const QList<loudnessHistograms_t> &trackHistograms, bool shortTerm) {
+    QVector<quint64> mergedHistogram(LOUDNESS_HISTOGRAM_BINS, 0);
+
+    foreach (const loudnessHistograms_t &currentHistograms, trackHistograms) {
+        const QVector<quint32> &currentHistogram = shortTerm ? currentHistograms.shortTermBlocks : currentHistograms.gatingBlocks;
+        for(int i = 0; i < currentHistogram.size() && i < LOUDNESS_HISTOGRAM_BINS; i++) {
+            mergedHistogram[i] += currentHistogram[i];
+        }
+    }
+
+    return mergedHistogram;
+}
+
+// Calculates the gating histograms for a FLAC as described by ITU-R BS.1770 (K-weighting, 400ms/3s blocks)
+// The audio is streamed through the flac binary, so memory use doesn't depend on track length. Cancelling cancelGroup stops it
+bool analyzeLoudnessHistograms(QString inputFLAC, loudnessHistograms_t *histograms, quintptr cancelGroup) {
+    histograms->gatingBlocks.fill(0, LOUDNESS_HISTOGRAM_BINS);
+    histograms->shortTermBlocks.fill(0, LOUDNESS_HISTOGRAM_BINS);
+
+    // Filter state and coefficients are set up on the first chunk, once the stream's format is known
+    bool filtersInitialized = false;
+    int channels = 0;
+    int samplesIn100ms = 0;
+    // K-weighting is a cascade of two biquads (high shelf, then high pass) per channel
+    double shelfB[3] = {0, 0, 0};
+    double shelfA[3] = {0, 0, 0};
+    double highPassB[3] = {1.0, -2.0, 1.0};
+    double highPassA[3] = {0, 0, 0};
+    // Transposed direct form II state: two values per biquad per channel
+    QVector<double> filterState;
+    // Per-channel weights (surround channels are boosted, LFE is ignored)
+    QVector<double> channelWeights;
+
+    // Weighted energy of the 100ms sub-block currently being filled, and how many frames are in it
+    double currentSubBlockEnergy = 0.0;
+    int currentSubBlockFrames = 0;
+    // The last 30 completed sub-blocks (3s), which is enough to build both block types
+    double subBlockEnergies[30] = {0};
+    qint64 completedSubBlocks = 0;
+
+    QVector<float> floatSamples;
+    audioFormat_t audioFormat;
+
+    bool decodeSucceeded = decodeFLACStream(inputFLAC, &audioFormat, [&](const QByteArray &rawPCM) {
+        if(!filtersInitialized) {
+            channels = audioFormat.channels;
+            double sampleRate = audioFormat.sampleRate;
+            samplesIn100ms = (audioFormat.sampleRate + 5) / 10;
+
+            // Pre-filter (high shelf) coefficients, derived for the stream's actual sample rate
+            double f0 = 1681.974450955533;
+            double G = 3.999843853973347;
+            double Q = 0.7071752369554196;
+            double K = std::tan(M_PI * f0 / sampleRate);
+            double Vh = std::pow(10.0, G / 20.0);
+            double Vb = std::pow(Vh, 0.4996667741545416);
+            double a0 = 1.0 + K / Q + K * K;
+            shelfB[0] = (Vh + Vb * K / Q + K * K) / a0;
+            shelfB[1] = 2.0 * (K * K - Vh) / a0;
+            shelfB[2] = (Vh - Vb * K / Q + K * K) / a0;
+            shelfA[1] = 2.0 * (K * K - 1.0) / a0;
+            shelfA[2] = (1.0 - K / Q + K * K) / a0;
+
+            // RLB (high pass) coefficients
+            f0 = 38.13547087602444;
+            Q = 0.5003270373238773;
+            K = std::tan(M_PI * f0 / sampleRate);
+            highPassA[1] = 2.0 * (K * K - 1.0) / (1.0 + K / Q + K * K);
+            highPassA[2] = (1.0 - K / Q + K * K) / (1.0 + K / Q + K * K);
+
+            filterState.fill(0.0, channels * 4);
+
+            // Channel weights follow FLAC's channel order (L, R, C, LFE, Ls, Rs)
+            channelWeights.fill(1.0, channels);
+            if(channels == 1) {
+                // Loudgain treats mono files as dual mono, so mono counts twice
+                channelWeights[0] = 2.0;
+            }
+            else if(channels == 4) {
+                channelWeights[2] = 1.41;
+                channelWeights[3] = 1.41;
+            }
+            else if(channels == 5) {
+                channelWeights[3] = 1.41;
+                channelWeights[4] = 1.41;
+            }
+            else if(channels >= 6) {
+                channelWeights[3] = 0.0;
+                channelWeights[4] = 1.41;
+                channelWeights[5] = 1.41;
+                // Channels past 5.1 aren't part of BS.1770's layout
+                for(int ch = 6; ch < channels; ch++) {
+                    channelWeights[ch] = 0.0;
+                }
+            }
+
+            filtersInitialized = true;
+        }
+
+        convertPCMToFloat(rawPCM, audioFormat.bitsPerSample, &floatSamples);
+        const float *samples = floatSamples.constData();
+        int frameCount = floatSamples.size() / channels;
+        double *state = filterState.data();
+
+        for(int frame = 0; frame < frameCount; frame++) {
+            for(int ch = 0; ch < channels; ch++) {
+                double *channelState = state + ch * 4;
+                double input = samples[frame * channels + ch];
+
+                // High shelf
+                double shelfOutput = shelfB[0] * input + channelState[0];
+                channelState[0] = shelfB[1] * input - shelfA[1] * shelfOutput + channelState[1];
+                channelState[1] = shelfB[2] * input - shelfA[2] * shelfOutput;
+
+                // High pass
+                double weightedOutput = highPassB[0] * shelfOutput + channelState[2];
+                channelState[2] = highPassB[1] * shelfOutput - highPassA[1] * weightedOutput + channelState[3];
+                channelState[3] = highPassB[2] * shelfOutput - highPassA[2] * weightedOutput;
+
+                currentSubBlockEnergy += channelWeights[ch] * weightedOutput * weightedOutput;
+            }
+
+            currentSubBlockFrames++;
+
+            // Every 100ms, close the sub-block and emit whichever blocks are due
+            if(currentSubBlockFrames == samplesIn100ms) {
+                subBlockEnergies[completedSubBlocks % 30] = currentSubBlockEnergy;
+                completedSubBlocks++;
+                currentSubBlockEnergy = 0.0;
+                currentSubBlockFrames = 0;
+
+                // Momentary (400ms) blocks overlap by 75%, so one is emitted every 100ms
+                if(completedSubBlocks >= 4) {
+                    double blockEnergy = 0.0;
+                    for(int i = 1; i <= 4; i++) {
+                        blockEnergy += subBlockEnergies[(completedSubBlocks - i) % 30];
+                    }
+                    int bin = histogramBinIndex(blockEnergy / (4.0 * samplesIn100ms));
+                    if(bin >= 0) {
+                        histograms->gatingBlocks[bin]++;
+                    }
+                }
+
+                // Short-term (3s) blocks are emitted every second
+                if(completedSubBlocks >= 30 && (completedSubBlocks - 30) % 10 == 0) {
+                    double blockEnergy = 0.0;
+                    for(int i = 0; i < 30; i++) {
+                        blockEnergy += subBlockEnergies[i];
+                    }
+                    int bin = histogramBinIndex(blockEnergy / (30.0 * samplesIn100ms));
+                    if(bin >= 0) {
+                        histograms->shortTermBlocks[bin]++;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }, cancelGroup);
+
+    return decodeSucceeded && filtersInitialized;
+}
+
+// Calculates the gated integrated loudness (LUFS) of several tracks' histograms as if they were one continuous stream
+// Returns -HUGE_VAL if nothing passes the gates (e.g. digital silence)
+double histogramIntegratedLoudness(const QList<loudnessHistograms_t> &trackHistograms) {
+    QVector<quint64> mergedHistogram = mergeHistograms(trackHistograms, false);
+
+    // Every stored block has already passed the absolute gate, so the relative gate is 10 LU below their mean
+    double energySum = 0.0;
+    quint64 blockCount = 0;
+    for(int i = 0; i < LOUDNESS_HISTOGRAM_BINS; i++) {
+        energySum += mergedHistogram[i] * histogramBinEnergy(i);
+        blockCount += mergedHistogram[i];
+    }
+
+    if(blockCount == 0) {
+        return -HUGE_VAL;
+    }
+
+    double relativeThreshold = (energySum / blockCount) * std::pow(10.0, -10.0 / 10.0);
+
+    // Average every block that passes the relative gate
+    energySum = 0.0;
+    blockCount = 0;
+    for(int i = relativeGateStartBin(relativeThreshold); i < LOUDNESS_HISTOGRAM_BINS; i++) {
+        energySum += mergedHistogram[i] * histogramBinEnergy(i);
+        blockCount += mergedHistogram[i];
+    }
+
+    if(blockCount == 0) {
+        return -HUGE_VAL;
+    }
+
+    return energyToLoudness(energySum / blockCount);
+}
+
+// Calculates the loudness range (LU) of several tracks' histograms as described by EBU Tech 3342
+double histogramLoudnessRange(const QList<loudnessHistograms_t> &trackHistograms) {
+    QVector<quint64> mergedHistogram = mergeHistograms(trackHistograms, true);
+
+    double energySum = 0.0;
+    quint64 blockCount = 0;
+    for(int i = 0; i < LOUDNESS_HISTOGRAM_BINS; i++) {
+        energySum += mergedHistogram[i] * histogramBinEnergy(i);
+        blockCount += mergedHistogram[i];
+    }
+
+    if(blockCount == 0) {
+        return 0.0;
+    }
+
+    // Loudness range uses a relative gate 20 LU below the mean
+    int startBin = relativeGateStartBin((energySum / blockCount) * std::pow(10.0, -20.0 / 10.0));
+
+    quint64 gatedCount = 0;
+    for(int i = startBin; i < LOUDNESS_HISTOGRAM_BINS; i++) {
+        gatedCount += mergedHistogram[i];
+    }
+
+    if(gatedCount == 0) {
+        return 0.0;
+    }
+
+    // The range is the distance between the 10th and 95th percentiles of the gated blocks
+    quint64 lowPercentile = static_cast<quint64>((gatedCount - 1) * 0.1 + 0.5);
+    quint64 highPercentile = static_cast<quint64>((gatedCount - 1) * 0.95 + 0.5);
+
+    quint64 runningCount = 0;
+    int currentBin = startBin;
+    while(runningCount <= lowPercentile && currentBin < LOUDNESS_HISTOGRAM_BINS) {
+        runningCount += mergedHistogram[currentBin++];
+    }
+    double lowEnergy = histogramBinEnergy(currentBin - 1);
+
+    while(runningCount <= highPercentile && currentBin < LOUDNESS_HISTOGRAM_BINS) {
+        runningCount += mergedHistogram[currentBin++];
+    }
+    double highEnergy = histogramBinEnergy(currentBin - 1);
+
+    return energyToLoudness(highEnergy) - energyToLoudness(lowEnergy);
+}
+
+// Packs a histogram into a compact blob for storage
+static QByteArray packHistogram(const QVector<quint32> &histogram) {
+    QByteArray packedHistogram;
+    QDataStream histogramStream(&packedHistogram, QIODevice::WriteOnly);
+    histogramStream << histogram;
+
+    // Most bins of a track's histogram are empty, so this compresses very well
+    return qCompress(packedHistogram);
+}
+
+// Reverses packHistogram
+static QVector<quint32> unpackHistogram(const QByteArray &packedHistogram) {
+    QVector<quint32> histogram;
+    QByteArray unpackedHistogram = qUncompress(packedHistogram);
+    QDataStream histogramStream(&unpackedHistogram, QIODevice::ReadOnly);
+    histogramStream >> histogram;
+
+    return histogram;
+}
+
+// Looks up every MD5 with a single prepared query. Audio that has never been analyzed is left out of cacheEntries
+static void queryLoudnessCache(QSqlDatabase catalogue, QStringList audioMD5s, QHash<QString, loudnessCacheEntry_t> *cacheEntries) {
+    if(!catalogue.isOpen()) {
+        return;
+    }
+
+    QSqlQuery query(catalogue);
+    query.prepare("SELECT integrated_loudness, true_peak, track_gain, track_range, gating_histogram, short_term_histogram FROM loudness WHERE audio_md5 = ?");
+    foreach(QString audioMD5, audioMD5s) {
+        query.addBindValue(audioMD5);
+        if(!query.exec() || !query.next()) {
+            continue;
+        }
+
+        loudnessCacheEntry_t cacheEntry;
+        cacheEntry.audioMD5 = audioMD5;
+        cacheEntry.integratedLoudness = query.value(0).toDouble();
+        cacheEntry.truePeak = query.value(1).toDouble();
+        cacheEntry.trackGain = query.value(2).toDouble();
+        cacheEntry.trackRange = query.value(3).toDouble();
+        cacheEntry.histograms.gatingBlocks = unpackHistogram(query.value(4).toByteArray());
+        cacheEntry.histograms.shortTermBlocks = unpackHistogram(query.value(5).toByteArray());
+
+        // Treat damaged entries as unknown audio so they get rescanned and overwritten
+        if(cacheEntry.histograms.gatingBlocks.size() != LOUDNESS_HISTOGRAM_BINS || cacheEntry.histograms.shortTermBlocks.size() != LOUDNESS_HISTOGRAM_BINS) {
+            continue;
+        }
+
+        cacheEntries->insert(audioMD5, cacheEntry);
+    }
+}
+
+// Looks up an album's tracks in the loudness cache (a table of the catalogue) by their audio MD5s
+// Audio that has never been analyzed, or whose entry is damaged, is left out of cacheEntries
+void readLoudnessCache(QStringList audioMD5s, QHash<QString, loudnessCacheEntry_t> *cacheEntries) {
+    audioMD5s.removeAll(QString(""));
+    if(audioMD5s.isEmpty()) {
+        return;
+    }
+
+    QSqlDatabase catalogue = openCatalogue();
+    queryLoudnessCache(catalogue, audioMD5s, cacheEntries);
+    closeCatalogue(&catalogue);
+}
+
+// Writes every entry in one transaction, so an entry is either stored whole or not at all
+static bool writeLoudnessEntries(QSqlDatabase catalogue, const QList<loudnessCacheEntry_t> &cacheEntries) {
+    if(!catalogue.isOpen() || !catalogue.transaction()) {
+        return false;
+    }
+
+    QSqlQuery query(catalogue);
+    query.prepare("INSERT OR REPLACE INTO loudness (audio_md5, integrated_loudness, true_peak, track_gain, track_range, gating_histogram, short_term_histogram) VALUES (?, ?, ?, ?, ?, ?, ?)");
+    foreach(const loudnessCacheEntry_t &cacheEntry, cacheEntries) {
+        if(cacheEntry.audioMD5 == "") {
+            continue;
+        }
+
+        query.addBindValue(cacheEntry.audioMD5);
+        query.addBindValue(cacheEntry.integratedLoudness);
+        query.addBindValue(cacheEntry.truePeak);
+        query.addBindValue(cacheEntry.trackGain);
+        query.addBindValue(cacheEntry.trackRange);
+        query.addBindValue(packHistogram(cacheEntry.histograms.gatingBlocks));
+        query.addBindValue(packHistogram(cacheEntry.histograms.shortTermBlocks));
+        if(!query.exec()) {
+            catalogue.rollback();
+            return false;
+        }
+    }
+
+    return catalogue.commit();
+}
+
+// Stores an album's newly scanned tracks in the loudness cache, replacing any previous entries for the same audio
+bool writeLoudnessCache(const QList<loudnessCacheEntry_t> &cacheEntries) {
+    if(cacheEntries.isEmpty()) {
+        return true;
+    }
+
+    QSqlDatabase catalogue = openCatalogue();
+    bool written = writeLoudnessEntries(catalogue, cacheEntries);
+    closeCatalogue(&catalogue);
+    return written;
+}
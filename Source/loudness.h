@@ -0,0 +1,41 @@
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include <catalogue.h>
+#include <helper.h>
+#include <processsupervisor.h>
+
+#include <QDataStream>
+#include <QHash>
+#include <QStandardPaths>
+#include <QtMath>
+
+// Number of 0.1 LU histogram bins between the -70 LUFS absolute gate and +30 LUFS (same layout as libebur128's histogram mode)
+#define LOUDNESS_HISTOGRAM_BINS 1000
+
+// Per-track gating histograms. Unlike a finished loudness value, these can be summed across tracks to get exact album values
+struct loudnessHistograms_t {
+    // 400ms momentary blocks, used for integrated loudness
+    QVector<quint32> gatingBlocks;
+    // 3s short-term blocks, used for loudness range
+    QVector<quint32> shortTermBlocks;
+};
+
+// Everything needed to write a track's ReplayGain tags and contribute to its album's, keyed by its audio MD5
+struct loudnessCacheEntry_t {
+    QString audioMD5;
+    double integratedLoudness;
+    double truePeak;
+    double trackGain;
+    double trackRange;
+    loudnessHistograms_t histograms;
+};
+
+bool runLoudgain(QStringList inputFLACs, bool albumMode, quintptr cancelGroup = 0);
+bool analyzeLoudnessHistograms(QString inputFLAC, loudnessHistograms_t *histograms, quintptr cancelGroup = 0);
+double histogramIntegratedLoudness(const QList<loudnessHistograms_t> &trackHistograms);
+double histogramLoudnessRange(const QList<loudnessHistograms_t> &trackHistograms);
+void readLoudnessCache(QStringList audioMD5s, QHash<QString, loudnessCacheEntry_t> *cacheEntries);
+bool writeLoudnessCache(const QList<loudnessCacheEntry_t> &cacheEntries);
+
+#endif // LOUDNESS_H
@@ -1,6 +1,8 @@
 #include "mainwindow.h"
 #include "settingswindow.h"
+#include "resampler.h"
 #include <QApplication>
+#include <QTextStream>
 
 int main(int argc, char *argv[])
 {
@@ -21,8 +23,34 @@ int main(int argc, char *argv[])
     getShellPATH();
 #endif
 
+    // "--null-test <input.flac> <sample rate>" compares the built-in resampler against SoX's and exits, for checking resampling quality
+    QStringList commandLine = QCoreApplication::arguments();
+    int nullTestIndex = commandLine.indexOf("--null-test");
+    if(nullTestIndex != -1 && nullTestIndex + 2 < commandLine.count()) {
+        double residualDB = 0.0;
+        double peakDifferenceDB = 0.0;
+        QTextStream output(stdout);
+
+        if(!nullTestResampler(commandLine[nullTestIndex + 1], commandLine[nullTestIndex + 2].toInt(), &residualDB, &peakDifferenceDB)) {
+            output << "Null test failed (is SoX installed?)\n";
+            return 1;
+        }
+
+        output << "Residual vs. SoX: " << residualDB << " dB, peak difference: " << peakDifferenceDB << " dBFS\n";
+        return 0;
+    }
 
     MainWindow w;
+
+    // "--watch" runs headless, converting every album dropped into the default input folder until the process is stopped
+    if(commandLine.contains("--watch")) {
+        if(!w.startDropFolderWatch()) {
+            QTextStream(stdout) << "Default input folder is invalid or the same as the default temp/output folder\n";
+            return 1;
+        }
+        return a.exec();
+    }
+
     w.show();
 
 
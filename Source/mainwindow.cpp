@@ -19,6 +19,19 @@ MainWindow::MainWindow(QWidget *parent) :
 #endif
 
     applyUserSettings();
+
+    // Finish deleting temp folders that were still in the trash when the program was last closed
+    QSettings MIKSettings;
+    if(MIKSettings.value("sDefaultTemp", "").toString() != "") {
+        emptyTrash(MIKSettings.value("sDefaultTemp", "").toString() + "/" + TRASH_FOLDER_NAME);
+    }
+
+    // Albums that finish arriving in the watched input folder get queued for conversion
+    connect(&dropFolderWatcher, &DropFolderWatcher::albumReady, this, &MainWindow::queueDroppedAlbum);
+
+    // Progress of conversions started by hand is shown under the convert button
+    connect(&conversionProgress, &ConversionProgress::progressPublished, this, &MainWindow::showConversionProgress);
+    connect(&conversionProgress, &ConversionProgress::ended, this, &MainWindow::conversionEnded);
 }
 
 MainWindow::~MainWindow()
@@ -62,11 +75,23 @@ void MainWindow::applyUserSettings() {
         ui->AutoWavConvertCheckBox->setEnabled(true);
         ui->AutoWavConvertCheckBox->setChecked(MIKSettings.value("bDefaultAutoWAVConvert", true).toBool());
         ui->AutoWavConvertCheckBox->setText("Convert input .wav files to .flac");
+        ui->TranscodeCheckBox->setEnabled(true);
+        ui->TranscodeCheckBox->setChecked(MIKSettings.value("bDefaultTranscodeCheck", false).toBool());
+        ui->TranscodeCheckBox->setText("Check for lossy transcodes before converting");
+        ui->SpectrogramCheckBox->setEnabled(true);
+        ui->SpectrogramCheckBox->setChecked(MIKSettings.value("bDefaultSpectrograms", false).toBool());
+        ui->SpectrogramCheckBox->setText("Save spectrogram images to output folder");
     }
     else {
         ui->AutoWavConvertCheckBox->setEnabled(false);
         ui->AutoWavConvertCheckBox->setChecked(false);
         ui->AutoWavConvertCheckBox->setText("Convert input .wav files to .flac\n(requires FLAC)");
+        ui->TranscodeCheckBox->setEnabled(false);
+        ui->TranscodeCheckBox->setChecked(false);
+        ui->TranscodeCheckBox->setText("Check for lossy transcodes before converting (requires FLAC)");
+        ui->SpectrogramCheckBox->setEnabled(false);
+        ui->SpectrogramCheckBox->setChecked(false);
+        ui->SpectrogramCheckBox->setText("Save spectrogram images to output folder (requires FLAC)");
     }
 
     // Opus check
@@ -188,6 +213,11 @@ void MainWindow::on_actionConfigure_triggered() {
     applyUserSettings();
 }
 
+void MainWindow::on_actionHistory_triggered() {
+    HistoryWindow *historyWindow = new HistoryWindow();
+    historyWindow->exec();
+}
+
 void MainWindow::on_actionAbout_triggered()
 {
     AboutWindow *aboutWindow = new AboutWindow();
@@ -321,29 +351,23 @@ void MainWindow::guessButton(bool defaultTempProtection) {
         return;
     }
 
-    // Get the tags of the first FLAC in the list
-
-    // Linux only wants StdStrings, while Windows prefers StdWStrings (char encoding errors possible if Windows uses StdStrings)
-#if defined(Q_OS_LINUX)
-    TagLib::FLAC::File firstFLACTagFile(inputFLACs[0].toStdString().data());
-#elif defined(Q_OS_WIN)
-    TagLib::FLAC::File firstFLACTagFile(inputFLACs[0].toStdWString().data());
-#endif
+    // Get the tags of the first FLAC in the list. Only its tags are read, so large embedded covers don't slow this down
+    FLACMetadataReader firstFLACMetadata(inputFLACs[0]);
 
     // Parse the tags for artist (preferred: albumartist, then album artist, then artist)
-    if(firstFLACTagFile.properties().contains("albumartist")) {
-        ui->ArtistLineEdit->setText(TStringToQString(firstFLACTagFile.properties()["albumartist"].front()).trimmed());
+    if(firstFLACMetadata.tagValue("albumartist") != "") {
+        ui->ArtistLineEdit->setText(firstFLACMetadata.tagValue("albumartist").trimmed());
     }
-    else if(firstFLACTagFile.properties().contains("album artist")) {
-        ui->ArtistLineEdit->setText(TStringToQString(firstFLACTagFile.properties()["album artist"].front()).trimmed());
+    else if(firstFLACMetadata.tagValue("album artist") != "") {
+        ui->ArtistLineEdit->setText(firstFLACMetadata.tagValue("album artist").trimmed());
     }
-    else if(firstFLACTagFile.properties().contains("artist")) {
-        ui->ArtistLineEdit->setText(TStringToQString(firstFLACTagFile.properties()["artist"].front()).trimmed());
+    else if(firstFLACMetadata.tagValue("artist") != "") {
+        ui->ArtistLineEdit->setText(firstFLACMetadata.tagValue("artist").trimmed());
     }
 
     // Parse the tags for album
-    if(firstFLACTagFile.properties().contains("album")) {
-        ui->AlbumLineEdit->setText(TStringToQString(firstFLACTagFile.properties()["album"].front()).trimmed());
+    if(firstFLACMetadata.tagValue("album") != "") {
+        ui->AlbumLineEdit->setText(firstFLACMetadata.tagValue("album").trimmed());
     }
 }
 
@@ -377,7 +401,8 @@ void MainWindow::renameLogCue(QStringList inputFiles, QDir outputDir, QString ar
 }
 
 // Copies a folder+files into another
-QStringList MainWindow::folderCopy(QDir fromDir, QDir toDir, QStringList patternList, QStringList dontCopyList) {
+// With a checksumSet, every file is hashed as it's copied (and checked against its copy if the set asks for it)
+QStringList MainWindow::folderCopy(QDir fromDir, QDir toDir, QStringList patternList, QStringList dontCopyList, pageCacheStats_t *pageCacheStats, checksumSet_t *checksumSet) {
     // List of successfully copied files for eventual return
     QStringList copiedFiles;
 
@@ -407,7 +432,15 @@ QStringList MainWindow::folderCopy(QDir fromDir, QDir toDir, QStringList pattern
         // Make sure the path for this new file exists
         QDir().mkpath(QFileInfo(toFilePath).path());
         // Copy the old file to this new string location
-        currentFile.copy(toFilePath);
+        if(checksumSet != nullptr) {
+            copyWithChecksum(currentFileString, toFilePath, checksumSet);
+        }
+        else {
+            currentFile.copy(toFilePath);
+        }
+        // With drop-behind, neither copy is kept in the page cache
+        dropFileCache(currentFileString, pageCacheStats);
+        dropFileCache(toFilePath, pageCacheStats);
         // Add it to the list of copied files
         copiedFiles += toFilePath;
     }
@@ -415,36 +448,126 @@ QStringList MainWindow::folderCopy(QDir fromDir, QDir toDir, QStringList pattern
     return copiedFiles;
 }
 
-// Worker for copying the input folder into the temp folder, intended so the GUI thread doesn't lock up
-void MainWindow::copyInputToTempWorker(QDir inputDir, QDir tempDir, bool convertWavs) {
-    // Copy the input to the output folder and get a list of files that were successfully copied
-    QStringList copiedFiles = folderCopy(inputDir, tempDir);
+// Copies (or extracts) the input folder into the temp folder, encoding WAVs on the way if enabled
+// showProgress updates the copy button's text with the current stage
+// With the hidden bDefaultVerifyCopies setting, every copied file is read back and compared to its source; returns the copies that didn't match
+// cancelGroup is passed on to the encoders that split CUE+image rips, so they can be stopped along with the rest of the group
+// WAVs that couldn't be encoded are copied as they are instead and listed in unconvertedWAVs
+QStringList MainWindow::copyInputFiles(QDir inputDir, QDir tempDir, bool convertWavs, bool showProgress, QStringList *unsplitCues, quintptr cancelGroup, QStringList *unconvertedWAVs) {
+    QSettings MIKSettings;
+    // Initialize a pool for parallel threads. Default number of parallel threads is equal to processor's logical core count
+    QThreadPool copyPool;
+    // WAVs that are encoded straight from the input folder instead of being copied
+    QStringList inputWAVs;
+    // Whether each of them failed to encode, by index
+    QVector<bool> wavFailures;
+    workSchedule_t wavSchedule;
+
+    // Archives (e.g. a Bandcamp .zip) are streamed straight into the temp folder, so they never have to be unpacked anywhere else first
+    if(isArchiveFile(inputDir.path())) {
+        if(showProgress) {
+            ui->CopyButton->setText("Extracting..."); // Technically not thread-safe but no competing events
+        }
+        extractArchive(inputDir.path(), tempDir, convertWavs);
+    }
 
     // If the WAV conversion checkbox is checked
-    if(convertWavs == true) {
-        // Get a list of "*.wav" files from the copiedFiles list
-        QStringList inputWAVs = copiedFiles.filter(".wav");
-
-        // If there are WAVs to be converted
-        if(!inputWAVs.empty()) {
-            // Update the copy stage
-            ui->CopyButton->setText("Converting WAVs..."); // Technically not thread-safe but no competing events
-
-            // Initialize a pool for parallel threads. Default number of parallel threads is equal to processor's logical core count
-            QThreadPool copyPool;
-
-            // For each WAV in the inputWAVs list
-            foreach (QString currentWAV, inputWAVs) {
-                // Pass that WAV into the convertWAV function in its own thread.
-                // The pool will execute the proper number of threads in parallel and will block subsequent WAVs until it has a slot open
-                QtConcurrent::run(&copyPool, convertWAV, currentWAV);
+    else if(convertWavs == true) {
+        inputWAVs = findFiles(inputDir, {"*.wav"});
+
+        // Where each WAV would have been copied to, as is and as a FLAC
+        QStringList outputWAVs;
+        QStringList outputFLACs;
+        foreach (QString currentWAV, inputWAVs) {
+            QString outputWAV = currentWAV;
+            outputWAV.replace(inputDir.path(), tempDir.path());
+            QDir().mkpath(QFileInfo(outputWAV).path());
+            outputWAVs += outputWAV;
+            outputFLACs += outputWAV.left(outputWAV.length() - QFileInfo(outputWAV).suffix().length()) + "flac";
+        }
+        wavFailures.fill(false, inputWAVs.count());
+        bool *wavFailureData = wavFailures.data();
+
+        // Encode every WAV from the input folder to where it would have been copied, so the WAV itself is never written to the temp folder
+        // Encoding starts right away (longest WAVs first) and runs alongside the copy below
+        // The pool will execute the proper number of threads in parallel and will block subsequent WAVs until it has a slot open
+        // A WAV that can't be encoded is copied after all, so the track isn't lost
+        startLongestFirst(&copyPool, inputWAVs, "Encoding WAVs", [=](int i) {
+            if(!convertWAV(inputWAVs[i], outputFLACs[i])) {
+                QFile::copy(inputWAVs[i], outputWAVs[i]);
+                wavFailureData[i] = true;
             }
+        }, &wavSchedule);
+    }
+
+    // Copy everything else from the input to the temp folder
+    checksumSet_t copyChecksums;
+    copyChecksums.verify = true;
+    if(!isArchiveFile(inputDir.path())) {
+        folderCopy(inputDir, tempDir, {"*"}, inputWAVs, nullptr, MIKSettings.value("bDefaultVerifyCopies", false).toBool() ? &copyChecksums : nullptr);
+    }
+
+    // If there are WAVs still being converted
+    if(showProgress && copyPool.activeThreadCount() > 0) {
+        // Update the copy stage
+        ui->CopyButton->setText("Converting WAVs..."); // Technically not thread-safe but no competing events
+    }
 
-            // Wait for all WAVs to be converted before proceeding
-            copyPool.waitForDone();
+    // Wait for all WAVs to be converted before proceeding
+    if(!inputWAVs.isEmpty()) {
+        finishLongestFirst(&copyPool, &wavSchedule);
+    }
+    for(int i = 0; i < wavFailures.count(); i++) {
+        if(wavFailures[i] && unconvertedWAVs != nullptr) {
+            *unconvertedWAVs += inputWAVs[i];
+        }
+    }
+
+    // CUE+image rips are split into tracks here, so everything after the copy sees an album like any other (WAV images have been encoded by now if they were going to be)
+    if(MIKSettings.value("bDefaultSplitCueImages", true).toBool() && checkInstalledProgram("sDefaultFLACLocation", "flac") != "") {
+        if(showProgress) {
+            ui->CopyButton->setText("Splitting CUE images..."); // Technically not thread-safe but no competing events
+        }
+        QStringList failedCues = splitCueImages(tempDir, cancelGroup);
+        if(unsplitCues != nullptr) {
+            *unsplitCues = failedCues;
         }
     }
 
+    return copyChecksums.mismatchedFiles;
+}
+
+// Worker for copying the input folder into the temp folder, intended so the GUI thread doesn't lock up
+void MainWindow::copyInputToTempWorker(QDir inputDir, QDir tempDir, bool convertWavs) {
+    QStringList unsplitCues;
+    QStringList unconvertedWAVs;
+    QStringList mismatchedFiles = copyInputFiles(inputDir, tempDir, convertWavs, true, &unsplitCues, 0, &unconvertedWAVs);
+
+    // Bad copies are left in place, so the user can see which ones they were
+    if(!mismatchedFiles.isEmpty()) {
+        QString mismatchedList = QDir::toNativeSeparators(mismatchedFiles.join("\n"));
+        // Dialogs have to be created on the GUI thread
+        QMetaObject::invokeMethod(this, [this, mismatchedList]() {
+            QMessageBox::warning(this, "Warning", "The following copies don't match their source:\n\n" + mismatchedList, QMessageBox::Ok);
+        }, Qt::QueuedConnection);
+    }
+
+    // WAVs that couldn't be encoded were copied as they are, so they have to be encoded by hand before they're converted along with the rest
+    if(!unconvertedWAVs.isEmpty()) {
+        QString unconvertedList = QDir::toNativeSeparators(unconvertedWAVs.join("\n"));
+        QMetaObject::invokeMethod(this, [this, unconvertedList]() {
+            QMessageBox::warning(this, "Warning", "The following WAVs couldn't be encoded to FLAC and were copied as they are:\n\n" + unconvertedList, QMessageBox::Ok);
+        }, Qt::QueuedConnection);
+    }
+
+    // Images that couldn't be split are left whole, to be dealt with by hand
+    if(!unsplitCues.isEmpty()) {
+        QString unsplitList = QDir::toNativeSeparators(unsplitCues.join("\n"));
+        QMetaObject::invokeMethod(this, [this, unsplitList]() {
+            QMessageBox::warning(this, "Warning", "The images of the following CUE sheets couldn't be split into tracks:\n\n" + unsplitList, QMessageBox::Ok);
+        }, Qt::QueuedConnection);
+    }
+
     // Set the UI back to normal to indicate copying is finished
     ui->CopyButton->setText("Copy input folder to temp folder"); // Technically not thread-safe but no competing events
     ui->CopyButton->setEnabled(true); // Technically not thread-safe but no competing events
@@ -466,8 +589,11 @@ void MainWindow::copyInputToTemp() {
     QDir inputDir(ui->InputLineEdit->text());
     QDir tempDir(ui->TempLineEdit->text());
 
+    // An archive can stand in for an input folder
+    bool inputIsArchive = isArchiveFile(inputDir.path());
+
     // Return if either of the paths are invalid
-    if(inputDir.path() == "." || tempDir.path() == "." || !inputDir.exists() || !tempDir.exists()) {
+    if(inputDir.path() == "." || tempDir.path() == "." || (!inputDir.exists() && !inputIsArchive) || !tempDir.exists()) {
         QMessageBox::critical(this, "Alert", "Input or temp path invalid.", QMessageBox::Ok);
         return;
     }
@@ -480,12 +606,15 @@ void MainWindow::copyInputToTemp() {
         }
     }
 
+    // Archives get a temp folder named after them, without the extension (e.g. "Artist - Album.zip" -> "Artist - Album")
+    QString tempFolderName = inputIsArchive ? QFileInfo(inputDir.path()).completeBaseName() : inputDir.dirName();
+
     // Disable copy button to denote process is executing
     ui->CopyButton->setText("Copying...");
     ui->CopyButton->setEnabled(false);
 
     // Start the copy process in another thread
-    QtConcurrent::run(this, &MainWindow::copyInputToTempWorker, inputDir, QDir(tempDir.path() + "/" + inputDir.dirName()), ui->AutoWavConvertCheckBox->isChecked());
+    QtConcurrent::run(this, &MainWindow::copyInputToTempWorker, inputDir, QDir(tempDir.path() + "/" + tempFolderName), ui->AutoWavConvertCheckBox->isChecked());
 }
 
 // Opens Discogs in the default web browser based on guessed metadata
@@ -654,11 +783,12 @@ void MainWindow::on_ConvertToComboBox_currentIndexChanged(const QString &format)
     // FLAC
     if(format == "FLAC") {
         ui->ConvertToPresetComboBox->addItem("Standard");
-        if(checkInstalledProgram("sDefaultSoXLocation", "sox") != "") {
-            ui->ConvertToPresetComboBox->addItem("Force 16-bit");
-            ui->ConvertToPresetComboBox->addItem("Force 44.1kHz/48kHz");
-            ui->ConvertToPresetComboBox->addItem("Force 16-bit and 44.1kHz/48kHz");
-        }
+        ui->ConvertToPresetComboBox->addItem("Force 16-bit");
+        ui->ConvertToPresetComboBox->addItem("Force 44.1kHz/48kHz");
+        // Resampled audio is handed to FLAC in whole bytes, so odd bit-depths don't survive it
+        ui->ConvertToPresetComboBox->setItemData(ui->ConvertToPresetComboBox->count() - 1, "Audio with an odd bit-depth (e.g. 20-bit) comes out as 24-bit when it's resampled", Qt::ToolTipRole);
+        ui->ConvertToPresetComboBox->addItem("Force 16-bit and 44.1kHz/48kHz");
+        ui->ConvertToPresetComboBox->addItem("Remove fake hi-res");
 
         // Set to "Standard" by default
         ui->ConvertToPresetComboBox->setCurrentText("Standard");
@@ -701,46 +831,138 @@ void MainWindow::on_ConvertToComboBox_currentIndexChanged(const QString &format)
 }
 
 // Calculates ReplayGain information (album and track-based) for the QStringList of inputFLACs
-void MainWindow::calculateReplayGain (QStringList inputFLACs) {
+// Track values for audio that has been scanned before come from the loudness cache, so Loudgain only runs on audio it hasn't seen
+// Album values are always merged from the tracks' gating histograms, so they stay correct whether or not the album's track list changed
+// cancelGroup is passed on to Loudgain's process and the histogram decoders, so cancelling the conversion stops them
+void MainWindow::calculateReplayGain (QStringList inputFLACs, quintptr cancelGroup) {
     // Sort the files to ensure we process them in the right order
     inputFLACs.sort();
 
-    QProcess LoudgainProcess;
-    // Linux uses normal Loudgain
+    // Loudgain is still needed for new audio (and true peak), so don't write anything if it's missing
 #if defined(Q_OS_LINUX)
-    QString programLocation = checkInstalledProgram("sDefaultLoudgainLocation", "loudgain");
-    if(programLocation == "") {
+    if(checkInstalledProgram("sDefaultLoudgainLocation", "loudgain") == "") {
         return;
     }
-    // Windows requires WSL Loudgain as there is no native binary (yet)
-#elif defined(Q_OS_WIN)
-    QString programLocation = "wsl";
 #endif
-    LoudgainProcess.setProgram(programLocation);
 
-    // Loudgain arguments
-    // -a: calculates album gain
-    // -k: prevents clipping
-    // -s e: extra information calculation (Reference loudness and range)
-    QStringList arguments;
-#if defined(Q_OS_WIN)
-    arguments << "loudgain";
-#endif
-    arguments << "-a" << "-k" << "-s" << "e";
+    // Cache entries for every input FLAC, in the same order as inputFLACs
+    QList<loudnessCacheEntry_t> trackEntries;
+    // FLACs whose audio isn't in the cache yet, and where their entries live in trackEntries
+    QStringList uncachedFLACs;
+    QList<int> uncachedIndexes;
+
+    QStringList audioMD5s;
     foreach (QString currentFLAC, inputFLACs) {
+        audioMD5s += getAudioMD5(currentFLAC);
+    }
+
+    // The whole album is looked up at once
+    QHash<QString, loudnessCacheEntry_t> cachedEntries;
+    readLoudnessCache(audioMD5s, &cachedEntries);
+
+    for(int i = 0; i < inputFLACs.count(); i++) {
+        loudnessCacheEntry_t currentEntry;
+
+        if(audioMD5s[i] != "" && cachedEntries.contains(audioMD5s[i])) {
+            currentEntry = cachedEntries.value(audioMD5s[i]);
+        } else {
+            currentEntry.audioMD5 = audioMD5s[i];
+            uncachedFLACs += inputFLACs[i];
+            uncachedIndexes += trackEntries.count();
+        }
+
+        trackEntries += currentEntry;
+    }
+
+    // Scan any audio the cache doesn't know about yet
+    if(!uncachedFLACs.isEmpty()) {
+        // Histograms are gathered in parallel threads first, then Loudgain handles track gain and true peak
+        // Loudgain writes its tags into the very files the histogram pass decodes (and may rewrite them whole to make room), so the two never overlap
+        QThreadPool loudnessPool;
+        QVector<loudnessHistograms_t> uncachedHistograms(uncachedFLACs.count());
+        QVector<bool> histogramResults(uncachedFLACs.count(), false);
+        loudnessHistograms_t *histogramData = uncachedHistograms.data();
+        bool *histogramResultData = histogramResults.data();
+        workSchedule_t loudnessSchedule;
+
+        // Longest tracks first, so the last one to finish isn't a long track that started late
+        startLongestFirst(&loudnessPool, uncachedFLACs, "Scanning loudness", [=](int i) {
+            histogramResultData[i] = analyzeLoudnessHistograms(uncachedFLACs[i], histogramData + i, cancelGroup);
+        }, &loudnessSchedule);
+
+        finishLongestFirst(&loudnessPool, &loudnessSchedule);
+
+        // Track mode only, as album values are merged from the histograms afterwards
+        bool loudgainSucceeded = runLoudgain(uncachedFLACs, false, cancelGroup);
+
+        bool scanSucceeded = loudgainSucceeded;
+        // Tracks that were scanned completely, which are cached together once all of them have been read back
+        QList<loudnessCacheEntry_t> scannedEntries;
+
+        for(int i = 0; scanSucceeded && i < uncachedFLACs.count(); i++) {
+            // Read back the values Loudgain wrote
+            FLACMetadataReader currentFLACReader(uncachedFLACs[i]);
+            QString trackGain = currentFLACReader.tagValue("REPLAYGAIN_TRACK_GAIN");
+            QString truePeak = currentFLACReader.tagValue("REPLAYGAIN_TRACK_PEAK");
+
+            if(!histogramResults[i] || trackGain == "" || truePeak == "") {
+                scanSucceeded = false;
+                break;
+            }
+
+            loudnessCacheEntry_t &currentEntry = trackEntries[uncachedIndexes[i]];
+            // Values are stored as e.g. "-7.23 dB", so only the number is kept
+            currentEntry.trackGain = trackGain.split(' ').first().toDouble();
+            currentEntry.truePeak = truePeak.split(' ').first().toDouble();
+            currentEntry.trackRange = currentFLACReader.tagValue("REPLAYGAIN_TRACK_RANGE").split(' ').first().toDouble();
+            currentEntry.histograms = uncachedHistograms[i];
+            currentEntry.integratedLoudness = histogramIntegratedLoudness({currentEntry.histograms});
+
+            scannedEntries += currentEntry;
+        }
+
+        writeLoudnessCache(scannedEntries);
+
+        // If the histograms couldn't be gathered (e.g. FLAC is missing), fall back to a plain Loudgain album scan of everything
+        if(!scanSucceeded) {
+            // Without Loudgain's own tags there is nothing to add the reference loudness to
+            if(!runLoudgain(inputFLACs, true, cancelGroup)) {
+                return;
+            }
+
+            foreach (QString currentFLAC, inputFLACs) {
 #if defined(Q_OS_LINUX)
-        arguments << QDir::toNativeSeparators(currentFLAC);
+                TagLib::FLAC::File currentFLACTagFile(currentFLAC.toStdString().data());
 #elif defined(Q_OS_WIN)
-        // Windows needs special handholding to convert from a NT path to a WSL path (C:\Users -> /mnt/c/Users)
-        arguments << getWSLPath(currentFLAC);
+                TagLib::FLAC::File currentFLACTagFile(currentFLAC.toStdWString().data());
 #endif
+                TagLib::PropertyMap currentFLACTagMap = currentFLACTagFile.properties();
+                currentFLACTagMap.replace("REPLAYGAIN_REFERENCE_LOUDNESS", TagLib::String("89.00 dB"));
+                currentFLACTagFile.setProperties(currentFLACTagMap);
+                currentFLACTagFile.save();
+            }
+
+            return;
+        }
+    }
+
+    // Merge every track's histograms into album values, as if the album were one continuous stream
+    QList<loudnessHistograms_t> albumHistograms;
+    double albumPeak = 0.0;
+    foreach (const loudnessCacheEntry_t &currentEntry, trackEntries) {
+        albumHistograms += currentEntry.histograms;
+        albumPeak = qMax(albumPeak, currentEntry.truePeak);
     }
 
-    LoudgainProcess.setArguments(arguments);
+    // RG 2.0 targets -18 LUFS
+    double albumLoudness = histogramIntegratedLoudness(albumHistograms);
+    double albumGain = qIsFinite(albumLoudness) ? -18.0 - albumLoudness : 0.0;
+    double albumRange = histogramLoudnessRange(albumHistograms);
 
-    // Start and wait
-    LoudgainProcess.start();
-    LoudgainProcess.waitForFinished(-1);
+    // Same clipping prevention as Loudgain's -k: lower the gain so the true peak stays at or below -1 dBTP
+    if(albumPeak > 0.0 && albumGain + 20.0 * std::log10(albumPeak) > -1.0) {
+        albumGain = -1.0 - 20.0 * std::log10(albumPeak);
+    }
 
     // Manually insert a traditional reference loudness (e.g. 89 dB) instead of loudgain's relative reference loudness (e.g. -18 dB)
     // The formula to get the reference loudness is "107 dB + Reference Loudness." RG 2.0 relative reference loudness is at -18 dB.
@@ -748,16 +970,26 @@ void MainWindow::calculateReplayGain (QStringList inputFLACs) {
     // This is a temporary workaround until the loudgain author gets back to me on fixing this
     // Other programs do not expect the relative reference loudness format and will interpret it as -125 dB instead of 89 dB (107 + x = -18)
     // This is an extremely significant difference and will likely cause damage to audio equipment, including your ears
-    foreach (QString currentFLAC, inputFLACs) {
+    for(int i = 0; i < inputFLACs.count(); i++) {
         // Open a TagFile and PropertyMap of each input file
         // Linux only wants StdStrings, while Windows prefers StdWStrings (char encoding errors possible if Windows uses StdStrings)
 #if defined(Q_OS_LINUX)
-        TagLib::FLAC::File currentFLACTagFile(currentFLAC.toStdString().data());
+        TagLib::FLAC::File currentFLACTagFile(inputFLACs[i].toStdString().data());
 #elif defined(Q_OS_WIN)
-        TagLib::FLAC::File currentFLACTagFile(currentFLAC.toStdWString().data());
+        TagLib::FLAC::File currentFLACTagFile(inputFLACs[i].toStdWString().data());
 #endif
         TagLib::PropertyMap currentFLACTagMap = currentFLACTagFile.properties();
 
+        // Track values, either straight from the cache or as Loudgain just wrote them. Formatted the same way Loudgain formats them
+        currentFLACTagMap.replace("REPLAYGAIN_TRACK_GAIN", QStringToTString(QString::number(trackEntries[i].trackGain, 'f', 2) + " dB"));
+        currentFLACTagMap.replace("REPLAYGAIN_TRACK_PEAK", QStringToTString(QString::number(trackEntries[i].truePeak, 'f', 6)));
+        currentFLACTagMap.replace("REPLAYGAIN_TRACK_RANGE", QStringToTString(QString::number(trackEntries[i].trackRange, 'f', 2) + " dB"));
+
+        // Album values merged from the histograms
+        currentFLACTagMap.replace("REPLAYGAIN_ALBUM_GAIN", QStringToTString(QString::number(albumGain, 'f', 2) + " dB"));
+        currentFLACTagMap.replace("REPLAYGAIN_ALBUM_PEAK", QStringToTString(QString::number(albumPeak, 'f', 6)));
+        currentFLACTagMap.replace("REPLAYGAIN_ALBUM_RANGE", QStringToTString(QString::number(albumRange, 'f', 2) + " dB"));
+
         // We manually insert the correct reference loudness, which needs to be correct for Opus's RG calculation (matches other scanners' format as well)
         currentFLACTagMap.replace("REPLAYGAIN_REFERENCE_LOUDNESS", TagLib::String("89.00 dB"));
 
@@ -773,37 +1005,21 @@ QStringList MainWindow::convertToFormat(conversionParameters_t *conversionParame
     // Disambiguate folder names later on, putting lower samplerates and lower BPS into higher folders
     int highestSampleRate = 0;
     int highestBPS = 0;
-    // Holds the base sample rate for SoX to use
+    // Holds the base sample rate to resample to
     int highestBaseSampleRate = 0;
 
-    // Open the firstFLAC with TagLib, read some important data, then immediately destroy it
-    // Under Windows, TagLib cannot open the same file multiple times so must be completely destroyed before the next access
-    {
-        // Used partially in guesswork, pulls tag/file data from first .flac file
-        // Linux only wants StdStrings, while Windows prefers StdWStrings (char encoding errors possible if Windows uses StdStrings)
-#if defined(Q_OS_LINUX)
-        TagLib::FLAC::File firstFLACTagFile(conversionParameters->inputFLACs[0].toStdString().data());
-#elif defined(Q_OS_WIN)
-        TagLib::FLAC::File firstFLACTagFile(conversionParameters->inputFLACs[0].toStdWString().data());
-#endif
-        highestSampleRate = firstFLACTagFile.audioProperties()->sampleRate();
-        highestBPS = firstFLACTagFile.audioProperties()->bitsPerSample();
-    }
-
-    // Find the highest BPS and samplerate in the input files
+    // Find the highest BPS and samplerate in the input files (only their STREAMINFO is read)
     foreach(QString currentFLAC, conversionParameters->inputFLACs) {
-        // Linux only wants StdStrings, while Windows prefers StdWStrings (char encoding errors possible if Windows uses StdStrings)
-#if defined(Q_OS_LINUX)
-        TagLib::FLAC::File tempLoopTagFile(currentFLAC.toStdString().data());
-#elif defined(Q_OS_WIN)
-        TagLib::FLAC::File tempLoopTagFile(currentFLAC.toStdWString().data());
-#endif
+        audioFormat_t currentFormat;
+        if(!readAudioFormat(currentFLAC, &currentFormat)) {
+            continue;
+        }
 
-        if(tempLoopTagFile.audioProperties()->sampleRate() > highestSampleRate) {
-            highestSampleRate = tempLoopTagFile.audioProperties()->sampleRate();
+        if(currentFormat.sampleRate > highestSampleRate) {
+            highestSampleRate = currentFormat.sampleRate;
         }
-        if(tempLoopTagFile.audioProperties()->bitsPerSample() > highestBPS) {
-            highestBPS = tempLoopTagFile.audioProperties()->bitsPerSample();
+        if(currentFormat.bitsPerSample > highestBPS) {
+            highestBPS = currentFormat.bitsPerSample;
         }
     }
 
@@ -819,97 +1035,235 @@ QStringList MainWindow::convertToFormat(conversionParameters_t *conversionParame
         highestBaseSampleRate = highestSampleRate;
     }
 
+    // Variables for input into ParseNamingSyntax, disambiguating output. Only FLAC output can change format
+    int futureBPS = -1;
+    int futureSampleRate = -1;
+
     // FLAC
     if(conversionParameters->codecInput == "FLAC") {
-        // Initialize a variable for input into ParseNamingSyntax, disambiguating output
-        int futureBPS = highestBPS;
+        futureBPS = highestBPS;
 
         // If other files are going to reduce bit depth, change the futureBPS accordingly
         if(conversionParameters->presetInput == "Force 16-bit" || conversionParameters->presetInput == "Force 16-bit and 44.1kHz/48kHz") {
             futureBPS = 16;
         }
 
-        // Initialize a variable for input into ParseNamingSyntax, disambiguating output
-        int futureSampleRate = highestSampleRate;
+        futureSampleRate = highestSampleRate;
 
         // If other files are going to resample, change the futureSampleRate accordingly
         if(conversionParameters->presetInput == "Force 44.1kHz/48kHz" || conversionParameters->presetInput == "Force 16-bit and 44.1kHz/48kHz") {
+            // Resampled odd bit-depths (e.g. 20-bit) come out as the next whole-byte size
+            if(highestSampleRate != highestBaseSampleRate) {
+                futureBPS = ((futureBPS + 7) / 8) * 8;
+            }
             futureSampleRate = highestBaseSampleRate;
         }
 
-        QThreadPool convertFLACPool;
-        // QList that will hold the QFuture of every thread we launch, allowing us to launch many threads and check their results later
-        QList<QFuture<QString>> futureList;
+        // Fake hi-res files only lose their padding/empty bandwidth, so the future format depends on what each file really contains
+        if(conversionParameters->presetInput == "Remove fake hi-res") {
+            // Scan anything that wasn't already scanned before conversion started
+            scanAlbumEffectiveFormats(conversionParameters->inputFLACs, &conversionParameters->effectiveFormats);
+
+            futureBPS = 0;
+            futureSampleRate = 0;
+            foreach(QString currentFLAC, conversionParameters->inputFLACs) {
+                audioFormat_t currentFormat;
+                if(!readAudioFormat(currentFLAC, &currentFormat)) {
+                    continue;
+                }
+
+                // Files that weren't scanned or aren't fake keep their format
+                effectiveFormat_t currentEffectiveFormat = conversionParameters->effectiveFormats.value(currentFLAC);
+                futureBPS = qMax(futureBPS, currentEffectiveFormat.paddedBitDepth ? 16 : currentFormat.bitsPerSample);
+                futureSampleRate = qMax(futureSampleRate, currentEffectiveFormat.upsampled ? currentEffectiveFormat.baseSampleRate : currentFormat.sampleRate);
+            }
+        }
+    }
 
-        // For every FLAC in the parameters
-        foreach(QString currentFLAC, conversionParameters->inputFLACs) {
-            // Send the FLAC and its parameters to convertToFLAC and store its QFuture into the futureList
-            futureList.append(QtConcurrent::run(&convertFLACPool, convertToFLAC, currentFLAC, conversionParameters, futureBPS, futureSampleRate));
+    // Threads only set tracks up (or run the built-in resampler) and tag them afterwards; the encoders in between run under the process supervisor,
+    // so its limit is the only one on how many run at once and no thread sits waiting for one
+    // Tagging has a pool of its own, as it's what frees a track's memory for the tracks that are waiting for it on convertPool
+    QThreadPool convertPool;
+    QThreadPool tagPool;
+    QThreadPool *tagPoolPointer = &tagPool;
+    // Holds each track's output file, by input index
+    QVector<QString> results(conversionParameters->inputFLACs.count());
+    QString *resultData = results.data();
+    workSchedule_t convertSchedule;
+
+    // Send every FLAC and its parameters to its encoder, longest tracks first
+    // The temp FLAC is released right after, without waiting for the rest of the album
+    startLongestFirstAsync(&convertPool, conversionParameters->inputFLACs, "Converting " + conversionParameters->codecInput + " " + conversionParameters->presetInput, [=](int i, std::function<void()> taskFinished) {
+        QString currentFLAC = conversionParameters->inputFLACs[i];
+        ConversionProgress *progress = conversionParameters->progress;
+
+        // Tracks still queued when the conversion is cancelled are skipped
+        if(progress != nullptr) {
+            if(progress->isCancelled()) {
+                taskFinished();
+                return;
+            }
+            progress->trackStarted(currentFLAC);
         }
-        convertFLACPool.waitForDone();
 
-        // For every QFuture
-        foreach(QFuture<QString> currentFuture, futureList) {
-            // Add its returned value to outputFiles
-            outputFiles += currentFuture.result();
+        startTrackConversion(currentFLAC, conversionParameters, futureBPS, futureSampleRate, tagPoolPointer, [=](QString outputFile) {
+            // A track that was cancelled midway may be left half-written, so its temp FLAC is kept
+            bool cancelled = progress != nullptr && progress->isCancelled();
+            if(!cancelled) {
+                releaseInputFLAC(currentFLAC, outputFile, conversionParameters);
+            }
+            // The source has been read in full; with drop-behind it doesn't stay in the page cache
+            dropFileCache(currentFLAC, conversionParameters->pageCacheStats);
+            if(progress != nullptr) {
+                progress->trackFinished(currentFLAC, !cancelled && outputFile != "");
+            }
+            resultData[i] = outputFile;
+            taskFinished();
+        });
+    }, &convertSchedule);
+    finishLongestFirst(&convertPool, &convertSchedule);
+
+    // For every result
+    for(int i = 0; i < results.count(); i++) {
+        // Tracks that failed (or were cancelled) returned a blank path, which isn't an output
+        if(results[i] == "") {
+            conversionParameters->failedInputs += conversionParameters->inputFLACs[i];
+            continue;
         }
+        // Add its returned value to outputFiles
+        outputFiles += results[i];
+        conversionParameters->outputsByInput.insert(conversionParameters->inputFLACs[i], results[i]);
     }
 
-    // Opus
-    else if (conversionParameters->codecInput == "Opus") {
-        QThreadPool convertOpusPool;
-        // QList that will hold the QFuture of every thread we launch, allowing us to launch many threads and check their results later
-        QList<QFuture<QString>> futureList;
+    outputFiles.sort();
+    return outputFiles;
+}
+
+// Helper function that runs in a background thread and is the backbone for the full conversion process, including pre and post tasks
+QString MainWindow::convertBackgroundWorker(uiSelections_t uiSelections) {
+    QSettings MIKSettings;
 
-        // For every FLAC in the parameters
-        foreach(QString currentFLAC, conversionParameters->inputFLACs) {
-            // Send the FLAC and its parameters to convertToOpus and store its QFuture into the futureList
-            futureList.append(QtConcurrent::run(&convertOpusPool, convertToOpus, currentFLAC, conversionParameters));
+    // Time spent in each stage, for the catalogue
+    QMap<QString, qint64> stageTimings;
+    QElapsedTimer stageTimer;
+    stageTimer.start();
+    QString currentStage = "Preparing";
+
+    // Drop folder albums run without any progress display, and can't be cancelled
+    ConversionProgress *progress = uiSelections.unattended ? nullptr : &conversionProgress;
+    auto isCancelled = [&]() {
+        return progress != nullptr && progress->isCancelled();
+    };
+
+    // Shows the current stage on the convert button, unless this album came from the drop folder
+    auto showStage = [&](QString stage) {
+        stageTimings[currentStage] += stageTimer.restart();
+        currentStage = QString(stage).remove("...");
+        if(progress != nullptr) {
+            progress->setStage(stage);
         }
-        convertOpusPool.waitForDone();
+    };
 
-        // For every QFuture
-        foreach(QFuture<QString> currentFuture, futureList) {
-            // Add its returned value to outputFiles
-            outputFiles += currentFuture.result();
+    // Get a list of all FLACs in the tempDir
+    QStringList inputFLACs = findFiles(uiSelections.tempDir, {"*.flac"});
+
+    // Return if there are no FLACs
+    if(inputFLACs.count() == 0) {
+        if(!uiSelections.unattended) {
+            QMessageBox::critical(this, "Alert", "No valid files to convert.", QMessageBox::Ok);
         }
+        return "No valid files to convert";
     }
 
-    // MP3
-    else if (conversionParameters->codecInput == "MP3") {
-        QThreadPool convertMP3Pool;
-        // QList that will hold the QFuture of every thread we launch, allowing us to launch many threads and check their results later
-        QList<QFuture<QString>> futureList;
+    if(progress != nullptr) {
+        progress->begin(inputFLACs);
+    }
+
+    // Identify the audio by its STREAMINFO MD5, which only needs the header, so the catalogue can be checked and filled in later
+    QList<catalogueTrack_t> catalogueTracks;
+    QStringList audioMD5s;
+    foreach(QString currentFLAC, inputFLACs) {
+        FLACMetadataReader currentMetadata(currentFLAC);
+        audioFormat_t currentFormat = currentMetadata.audioFormat();
+        QString audioMD5 = QString(currentMetadata.audioMD5().toHex());
+        audioMD5s += audioMD5;
+        catalogueTracks.append(catalogueTrack_t{currentFLAC, audioMD5, currentFormat.sampleRate, currentFormat.bitsPerSample, "", "", 0, ""});
+    }
 
-        // For every FLAC in the parameters
-        foreach(QString currentFLAC, conversionParameters->inputFLACs) {
-            // Send the FLAC and its parameters to convertToMP3 and store its QFuture into the futureList
-            futureList.append(QtConcurrent::run(&convertMP3Pool, convertToMP3, currentFLAC, conversionParameters));
+    // Nobody is around to ask for drop folder albums, so skip anything that was already imported the same way
+    // (Albums started by hand are checked in convertInitialize)
+    catalogueMatch_t catalogueMatch;
+    if(uiSelections.unattended && findCatalogueMatch(audioMD5s, uiSelections.codecInput, uiSelections.presetInput, &catalogueMatch) && catalogueMatch.matchedTracks >= inputFLACs.count()) {
+        if(uiSelections.deleteTempEnabled && !moveToTrash(uiSelections.tempDir.path())) {
+            removeDir(uiSelections.tempDir.path());
         }
-        convertMP3Pool.waitForDone();
+        return "Skipped, " + describeCatalogueMatch(catalogueMatch, inputFLACs.count());
+    }
+
+    // Check CD rips against the CRCs and AccurateRip checksums in their EAC/XLD logs, so a bad rip is caught before anything is converted
+    if(MIKSettings.value("bDefaultVerifyRipLogs", true).toBool() && checkInstalledProgram("sDefaultFLACLocation", "flac") != "") {
+        QList<ripLog_t> ripLogs = findRipLogs(uiSelections.tempDir);
+        if(!ripLogs.isEmpty()) {
+            showStage("Verifying rip logs...");
+            QString ripLogDescription = verifyRipLogs(ripLogs);
+
+            // Nobody is around to decide for drop folder albums, so leave them alone
+            if(ripLogDescription != "" && uiSelections.unattended) {
+                return "Skipped, rip doesn't match its log:\n" + ripLogDescription.trimmed();
+            }
+
+            if(ripLogDescription != "") {
+                QMessageBox::StandardButton warning = QMessageBox::No;
+                // Dialogs have to be created on the GUI thread, so block this thread until the user answers there
+                QMetaObject::invokeMethod(this, [&]() {
+                    warning = QMessageBox::warning(this, "Warning", "The following don't match their rip log:\n\n" + ripLogDescription + "\nConvert anyway?", QMessageBox::Yes | QMessageBox::No);
+                }, Qt::BlockingQueuedConnection);
 
-        // For every QFuture
-        foreach(QFuture<QString> currentFuture, futureList) {
-            // Add its returned value to outputFiles
-            outputFiles += currentFuture.result();
+                if(warning == QMessageBox::No) {
+                    return "Cancelled, rip doesn't match its log";
+                }
+            }
         }
     }
 
-    outputFiles.sort();
-    return outputFiles;
-}
+    // Scan every FLAC for signs of a lossy source before spending time converting it
+    if(uiSelections.transcodeCheckEnabled) {
+        showStage("Checking for transcodes...");
 
-// Helper function that runs in a background thread and is the backbone for the full conversion process, including pre and post tasks
-void MainWindow::convertBackgroundWorker(uiSelections_t uiSelections) {
-    QSettings MIKSettings;
+        // One track per thread; each track's FFTs are vectorized within its thread
+        QThreadPool spectrumPool;
+        QVector<spectrumAnalysis_t> analyses(inputFLACs.count());
+        spectrumAnalysis_t *analysisData = analyses.data();
+        workSchedule_t spectrumSchedule;
+        startLongestFirst(&spectrumPool, inputFLACs, "Checking for transcodes", [=](int i) {
+            analyzeSpectrum(inputFLACs[i], analysisData + i);
+        }, &spectrumSchedule);
+        finishLongestFirst(&spectrumPool, &spectrumSchedule);
 
-    // Get a list of all FLACs in the tempDir
-    QStringList inputFLACs = findFiles(uiSelections.tempDir, {"*.flac"});
+        QString transcodeDescription = describeTranscodeResults(analyses.toList());
 
-    // Return if there are no FLACs
-    if(inputFLACs.count() == 0) {
-        QMessageBox::critical(this, "Alert", "No valid files to convert.", QMessageBox::Ok);
-        return;
+        // Nobody is around to decide for drop folder albums, so leave them alone
+        if(transcodeDescription != "" && uiSelections.unattended) {
+            return "Skipped, possible lossy transcodes:\n" + transcodeDescription.trimmed();
+        }
+
+        // If anything was flagged, let the user decide whether to keep going
+        if(transcodeDescription != "") {
+            QMessageBox::StandardButton warning = QMessageBox::No;
+            // Dialogs have to be created on the GUI thread, so block this thread until the user answers there
+            QMetaObject::invokeMethod(this, [&]() {
+                warning = QMessageBox::warning(this, "Warning", "The following files look like lossy transcodes:\n\n" + transcodeDescription + "\nConvert anyway?", QMessageBox::Yes | QMessageBox::No);
+            }, Qt::BlockingQueuedConnection);
+
+            if(warning == QMessageBox::No) {
+                return "Cancelled, possible lossy transcodes";
+            }
+        }
+    }
+
+    // Nothing has been written yet, so there's nothing to clean up
+    if(isCancelled()) {
+        return "Cancelled";
     }
 
     QStringList outputFiles;
@@ -917,93 +1271,502 @@ void MainWindow::convertBackgroundWorker(uiSelections_t uiSelections) {
 
     // Struct that contains many parameters for passing into a later thread. QThreads don't allow more than 5 parameters to be passed in, so they are all packaged into a struct
     conversionParameters_t conversionParameters{inputFLACs, uiSelections.outputDir, uiSelections.presetInput, uiSelections.syntaxInput, uiSelections.codecInput};
+    conversionParameters.progress = progress;
+    conversionParameters.cancelGroup = progress != nullptr ? progress->cancelGroup() : 0;
+
+    // With drop-behind, every file is taken out of the page cache once nothing is going to read it again soon, so large runs don't evict everything else
+    pageCacheStats_t pageCacheStats{};
+    pageCacheStats_t *dropBehindStats = isDropBehindEnabled() ? &pageCacheStats : nullptr;
+    conversionParameters.pageCacheStats = dropBehindStats;
+
+    // With the hidden bDefaultChecksumManifests setting, a .sha256 and an .ffp are written into the album's folder
+    // Hashes are taken as files are copied, and converted files are hashed for the catalogue anyway, so the manifests don't read the album again
+    bool writeManifests = MIKSettings.value("bDefaultChecksumManifests", false).toBool();
+    checksumSet_t albumChecksums;
+    albumChecksums.verify = false;
+
+    // If a staging folder is set (e.g. a local drive when the output folder is a network share), everything is encoded and tagged there first
+    // Finished files are then moved to the output folder in the background while later stages keep working
+    QDir stagingRootDir(MIKSettings.value("sDefaultStagingFolder", "").toString());
+    QScopedPointer<QTemporaryDir> stagingDir;
+    if(stagingRootDir.path() != "." && stagingRootDir.exists() && stagingRootDir != uiSelections.outputDir) {
+        // A folder of its own per conversion, so drop folder albums that run at the same time never mix
+        stagingDir.reset(new QTemporaryDir(stagingRootDir.path() + "/qMusicImportKit-XXXXXX"));
+        if(stagingDir->isValid()) {
+            conversionParameters.outputDir = QDir(stagingDir->path());
+        }
+        else {
+            stagingDir.reset();
+        }
+    }
+
+    // Transfers run alongside the rest of the process, but only a few at once so the output volume isn't flooded
+    QThreadPool transferPool;
+    transferPool.setMaxThreadCount(qMax(1, MIKSettings.value("iDefaultTransferJobs", 4).toInt()));
+    QStringList transferredFiles;
+    QList<QFuture<bool>> transferList;
+
+    // Queues staged files for transfer to their place in the output folder
+    auto queueTransfers = [&](QStringList stagedFiles) {
+        if(stagingDir.isNull()) {
+            return;
+        }
+        foreach(QString stagedFile, stagedFiles) {
+            if(transferredFiles.contains(stagedFile)) {
+                continue;
+            }
+            QString outputFile = uiSelections.outputDir.path() + stagedFile.mid(stagingDir->path().length());
+            transferredFiles += stagedFile;
+            transferList.append(QtConcurrent::run(&transferPool, transferStagedFile, stagedFile, outputFile, dropBehindStats));
+        }
+    };
+
+    // A plain FLAC re-encode keeps hi-res files as they are, so check whether any of them are only hi-res on paper and offer to fix them
+    if(uiSelections.codecInput == "FLAC" && uiSelections.presetInput == "Standard") {
+        QStringList hiResFLACs;
+        foreach(QString currentFLAC, inputFLACs) {
+            audioFormat_t currentFormat;
+            if(readAudioFormat(currentFLAC, &currentFormat) && isHiResFormat(currentFormat.bitsPerSample, currentFormat.sampleRate)) {
+                hiResFLACs += currentFLAC;
+            }
+        }
+
+        if(!hiResFLACs.isEmpty()) {
+            showStage("Checking hi-res files...");
+            scanAlbumEffectiveFormats(hiResFLACs, &conversionParameters.effectiveFormats);
+
+            QString fakeHiResDescription = describeFakeHiRes(conversionParameters.effectiveFormats.values());
+            if(fakeHiResDescription != "" && !uiSelections.unattended) {
+                QMessageBox::StandardButton suggestion = QMessageBox::No;
+                // Dialogs have to be created on the GUI thread, so block this thread until the user answers there
+                QMetaObject::invokeMethod(this, [&]() {
+                    suggestion = QMessageBox::question(this, "Fake hi-res", "The following files are hi-res on paper only:\n\n" + fakeHiResDescription + "\nReduce them to their real bit-depth/sample rate? Nothing audible or inaudible will be lost.", QMessageBox::Yes | QMessageBox::No);
+                }, Qt::BlockingQueuedConnection);
+
+                if(suggestion == QMessageBox::Yes) {
+                    conversionParameters.presetInput = "Remove fake hi-res";
+                }
+            }
+        }
+    }
+
+    if(isCancelled()) {
+        return "Cancelled";
+    }
+
+    QString artist = "";
+    QString album = "";
+
+    // Used partially in guesswork, pulls data from first .flac file
+    // Read before converting, since the temp FLACs may be released during conversion
+    {
+        FLACMetadataReader firstFLACMetadata(inputFLACs[0]);
+
+        // Parse the tags for artist (preferred, albumartist, then album artist, then artist)
+        if(firstFLACMetadata.tagValue("albumartist") != "") {
+            artist = cleanString(firstFLACMetadata.tagValue("albumartist"));
+        }
+        else if(firstFLACMetadata.tagValue("album artist") != "") {
+            artist = cleanString(firstFLACMetadata.tagValue("album artist"));
+        }
+        else if(firstFLACMetadata.tagValue("artist") != "") {
+            artist = cleanString(firstFLACMetadata.tagValue("artist"));
+        }
+
+        // Parse the tags for album
+        if(firstFLACMetadata.tagValue("album") != "") {
+            album = cleanString(firstFLACMetadata.tagValue("album"));
+        }
+    }
+
+    // If the temp folder is going to be deleted anyway, free each temp FLAC as soon as it's converted instead of at the very end
+    // Only FLACs that no later stage reads: spectrograms render from them, and copy contents may copy them
+    if(uiSelections.deleteTempEnabled && !uiSelections.spectrogramsEnabled && !uiSelections.outputDir.path().startsWith(uiSelections.tempDir.path())) {
+        QStringList patternList;
+        if(uiSelections.copyContentsEnabled && uiSelections.copyContents != "") {
+            patternList = uiSelections.copyContents.split(';');
+            patternList.replaceInStrings(QRegExp("^\\s+|\\s+$"), "");
+            patternList.removeAll(QString(""));
+        }
+        foreach(QString currentFLAC, inputFLACs) {
+            if(patternList.isEmpty() || !QDir::match(patternList, QFileInfo(currentFLAC).fileName())) {
+                conversionParameters.releasableFLACs += currentFLAC;
+            }
+        }
+    }
+
+    // Everything from here on runs as a graph of steps, so steps that don't touch the same files overlap
+    // (e.g. images are compressed and logs renamed while the audio is still being encoded)
+    TaskGraph conversionGraph;
+    QMutex stageMutex;
+    QStringList runningStages;
+
+    // Show every step that's currently running on the convert button
+    auto updateRunningStages = [&](QString stage, bool started) {
+        QMutexLocker stageLocker(&stageMutex);
+        if(started) {
+            runningStages += stage;
+        }
+        else {
+            runningStages.removeOne(stage);
+        }
+        if(progress != nullptr && !runningStages.isEmpty()) {
+            progress->setStage(runningStages.join(" "));
+        }
+    };
+    connect(&conversionGraph, &TaskGraph::nodeStarted, [&](QString stage) {
+        updateRunningStages(stage, true);
+    });
+    connect(&conversionGraph, &TaskGraph::nodeFinished, [&](QString stage) {
+        updateRunningStages(stage, false);
+    });
+
+    // Names of what each step produces, which later steps list as their inputs
+    // "audio": converted files, "tagged audio": converted files with ReplayGain, "catalogue": hashes of the converted files,
+    // "extras": copied files, "named extras": renamed .log/.cue, "images": compressed images, "spectrograms": rendered spectrograms,
+    // "album": everything in its output folder, "manifests": its checksum manifests, "transferred": everything moved out of the staging folder,
+    // "torrent": the album's .torrent
+    QStringList taggedAudio = {"audio"};
 
     // If the codec is FLAC, calculate ReplayGain after we convert.
     // Resampling and reducing bit depth will affect audio data and thus ReplayGain, so it needs to be calculated afterwards
     if(uiSelections.codecInput == "FLAC") {
-        ui->ConvertButton->setText("Converting..."); // Technically not thread-safe but no competing events
-        // Send the necessary info to the conversion function and get back a list of converted files
-        outputFiles += convertToFormat(&conversionParameters);
+        conversionGraph.addNode("Converting...", {}, {"audio"}, [&]() {
+            // Send the necessary info to the conversion function and get back a list of converted files
+            outputFiles += convertToFormat(&conversionParameters);
+            // A missing track would leave the album incomplete, so nothing after this runs (and the temp folder is kept)
+            return !outputFiles.isEmpty() && conversionParameters.failedInputs.isEmpty();
+        });
         if(uiSelections.RGEnabled) {
-            ui->ConvertButton->setText("Calculating ReplayGain..."); // Technically not thread-safe but no competing events
-            calculateReplayGain(outputFiles);
+            conversionGraph.addNode("Calculating ReplayGain...", {"audio"}, {"tagged audio"}, [&]() {
+                calculateReplayGain(outputFiles, conversionParameters.cancelGroup);
+                return true;
+            });
+            taggedAudio = QStringList{"tagged audio"};
         }
     }
     // Else if a file is lossy, calculate ReplayGain before we convert.
     // Opus and MP3 both use their parent FLAC's ReplayGain data to calculate their own ReplayGain so it needs to be calculated for the parent before conversion
     else {
+        QStringList convertInputs;
         if(uiSelections.RGEnabled) {
-            ui->ConvertButton->setText("Calculating ReplayGain..."); // Technically not thread-safe but no competing events
-            calculateReplayGain(inputFLACs);
+            conversionGraph.addNode("Calculating ReplayGain...", {}, {"source gain"}, [&]() {
+                calculateReplayGain(inputFLACs, conversionParameters.cancelGroup);
+                return true;
+            });
+            convertInputs += "source gain";
+        }
+        conversionGraph.addNode("Converting...", convertInputs, {"audio"}, [&]() {
+            outputFiles += convertToFormat(&conversionParameters);
+            // A missing track would leave the album incomplete, so nothing after this runs (and the temp folder is kept)
+            return !outputFiles.isEmpty() && conversionParameters.failedInputs.isEmpty();
+        });
+    }
+
+    // Hash the converted files and read their gain for the catalogue, before they're moved out of a staging folder
+    conversionGraph.addNode("Cataloguing...", taggedAudio, {"catalogue"}, [&]() {
+        QThreadPool cataloguePool;
+        for(int i = 0; i < catalogueTracks.count(); i++) {
+            catalogueTracks[i].outputFile = conversionParameters.outputsByInput.value(catalogueTracks[i].inputFLAC);
+            if(catalogueTracks[i].outputFile == "") {
+                continue;
+            }
+            catalogueTrack_t *currentTrack = &catalogueTracks[i];
+            // Hashing is the last read of a converted file, unless it's transferred out of a staging folder afterwards (which drops it itself)
+            pageCacheStats_t *outputCacheStats = stagingDir.isNull() ? dropBehindStats : nullptr;
+            QtConcurrent::run(&cataloguePool, [currentTrack, outputCacheStats, &albumChecksums]() {
+                currentTrack->outputSHA256 = getFileSHA256(currentTrack->outputFile);
+                recordChecksum(&albumChecksums, currentTrack->outputFile, currentTrack->outputSHA256);
+                currentTrack->outputSize = QFileInfo(currentTrack->outputFile).size();
+                currentTrack->trackGain = readTrackGain(currentTrack->outputFile);
+                dropFileCache(currentTrack->outputFile, outputCacheStats);
+            });
+        }
+        cataloguePool.waitForDone();
+
+        // The converted files won't be touched anymore, so start moving them out while everything else is copied and rendered
+        // (Unless manifests are written, which list the album's folder in the staging folder, so everything has to still be there)
+        if(!writeManifests) {
+            queueTransfers(outputFiles);
         }
-        ui->ConvertButton->setText("Converting..."); // Technically not thread-safe but no competing events
-        outputFiles += convertToFormat(&conversionParameters);
+        return true;
+    });
+
+    // The album's output folder depends on the converted files' names, so extras are gathered in a folder of their own and moved in once the audio is done
+    // If the output folder is inside the temp folder, that folder would be copied along with everything else, so extras wait for the audio there instead
+    bool outputInsideTemp = conversionParameters.outputDir.path().startsWith(uiSelections.tempDir.path());
+    QScopedPointer<QTemporaryDir> extrasDir;
+    if(!outputInsideTemp) {
+        extrasDir.reset(new QTemporaryDir(conversionParameters.outputDir.path() + "/.qMusicImportKit extras-XXXXXX"));
+        if(!extrasDir->isValid()) {
+            extrasDir.reset();
+        }
+    }
+    QStringList extrasInputs;
+    if(extrasDir.isNull()) {
+        extrasInputs += "audio";
+    }
+    // For lossy codecs, ReplayGain tags are written into the temp FLACs that extras are copied from and spectrograms are read from
+    if(uiSelections.RGEnabled && uiSelections.codecInput != "FLAC") {
+        extrasInputs += "source gain";
     }
 
-    // Folder that files were copied to
-    QDir outputDir(QFileInfo(outputFiles[0]).dir());
+    // Folder that files were copied to (inside the staging folder if there is one)
+    QDir outputDir;
+    // Folder that files will end up in
+    QDir finalOutputDir;
+    // Folder that extras are copied/rendered to
+    auto extrasOutputDir = [&]() {
+        return extrasDir.isNull() ? QDir(QFileInfo(outputFiles[0]).dir()) : QDir(extrasDir->path());
+    };
 
-    // Used partially in guesswork, pulls data from first .flac file
-    // Linux only wants StdStrings, while Windows prefers StdWStrings (char encoding errors possible if Windows uses StdStrings)
-#if defined(Q_OS_LINUX)
-    TagLib::FLAC::File firstFLACTagFile(inputFLACs[0].toStdString().data());
-#elif defined(Q_OS_WIN)
-    TagLib::FLAC::File firstFLACTagFile(inputFLACs[0].toStdWString().data());
-#endif
-    QString artist = "";
-    QString album = "";
+    QStringList albumInputs = {"audio"};
 
-    // Parse the tags for artist (preferred, albumartist, then album artist, then artist)
-    if(firstFLACTagFile.properties().contains("albumartist")) {
-        artist = cleanString(TStringToQString(firstFLACTagFile.properties()["albumartist"].front()));
+    // If copying files is enabled and the list of filetypes to copy isn't empty
+    if(uiSelections.copyContentsEnabled && uiSelections.copyContents != "") {
+        conversionGraph.addNode("Copying other files...", extrasInputs, {"extras"}, [&]() {
+            QStringList patternList = uiSelections.copyContents.split(';');
+
+            // Copy, then store copied files into a list for later use. Converted files are only in the temp folder if the output folder is inside it
+            copiedFiles += folderCopy(uiSelections.tempDir, extrasOutputDir(), patternList, extrasDir.isNull() ? outputFiles : QStringList{}, dropBehindStats, writeManifests ? &albumChecksums : nullptr);
+            return true;
+        });
+        albumInputs += "extras";
+
+        // Rename .logs and .cues if enabled
+        if(uiSelections.renameLogCueEnabled) {
+            conversionGraph.addNode("Renaming .log/.cue...", {"extras"}, {"named extras"}, [&]() {
+                renameLogCue(copiedFiles, extrasOutputDir(), artist, album);
+                return true;
+            });
+            albumInputs += "named extras";
+        }
+
+        // Compress images if enabled (logs and images are different files, so this runs alongside the renaming)
+        if(uiSelections.compressImagesEnabled) {
+            conversionGraph.addNode("Compressing images...", {"extras"}, {"images"}, [&]() {
+                compressImages(copiedFiles);
+                return true;
+            });
+            albumInputs += "images";
+        }
     }
-    else if(firstFLACTagFile.properties().contains("album artist")) {
-        artist = cleanString(TStringToQString(firstFLACTagFile.properties()["album artist"].front()));
+
+    // Render spectrograms of the source FLACs next to the .log if enabled (before the temp folder can be deleted)
+    if(uiSelections.spectrogramsEnabled) {
+        conversionGraph.addNode("Rendering spectrograms...", extrasInputs, {"spectrograms"}, [&]() {
+            renderAlbumSpectrograms(inputFLACs, extrasOutputDir(), MIKSettings.value("bDefaultSpectrogramDetail", false).toBool());
+            return true;
+        });
+        albumInputs += "spectrograms";
+    }
+
+    // Move the extras into the album's folder once it's known
+    int failedExtras = 0;
+    // Extras as they ended up in the album's folder
+    QStringList albumExtras;
+    conversionGraph.addNode("Collecting extras...", albumInputs, {"album"}, [&]() {
+        outputDir = QFileInfo(outputFiles[0]).dir();
+        finalOutputDir = outputDir;
+        if(!stagingDir.isNull()) {
+            finalOutputDir = QDir(uiSelections.outputDir.path() + outputDir.path().mid(stagingDir->path().length()));
+        }
+
+        if(extrasDir.isNull()) {
+            albumExtras = copiedFiles;
+        }
+        else {
+            foreach(QString extraFile, findFiles(QDir(extrasDir->path()), {"*"})) {
+                QString albumFile = outputDir.path() + extraFile.mid(extrasDir->path().length());
+                QDir().mkpath(QFileInfo(albumFile).path());
+                if(!QFile::rename(extraFile, albumFile)) {
+                    failedExtras++;
+                }
+                else {
+                    albumExtras += albumFile;
+                    moveChecksum(&albumChecksums, extraFile, albumFile);
+                }
+            }
+        }
+        return failedExtras == 0;
+    });
+
+    QStringList deleteTempInputs = {"album"};
+    QStringList transferInputs = {"album", "catalogue"};
+
+    // Write the manifests once everything is in the album's folder, so they're moved out of a staging folder along with the rest
+    // A manifest that can't be written only gets mentioned in the result; the album itself is fine
+    bool manifestsWritten = false;
+    if(writeManifests) {
+        conversionGraph.addNode("Writing checksums...", {"album", "catalogue"}, {"manifests"}, [&]() {
+            QString manifestName = (artist != "" && album != "") ? artist + " - " + album : "checksums";
+            QStringList manifestFiles = writeChecksumManifests(outputDir, manifestName, &albumChecksums);
+            albumExtras += manifestFiles;
+            manifestsWritten = !manifestFiles.isEmpty();
+            return true;
+        });
+        deleteTempInputs += "manifests";
+        transferInputs += "manifests";
+    }
+
+    // Move out everything else that was written to the staging folder, then wait until the output folder has all of it
+    int failedTransfers = 0;
+    if(!stagingDir.isNull()) {
+        conversionGraph.addNode("Transferring...", transferInputs, {"transferred"}, [&]() {
+            queueTransfers(findFiles(QDir(stagingDir->path()), {"*"}));
+            transferPool.waitForDone();
+
+            foreach(QFuture<bool> currentTransfer, transferList) {
+                if(!currentTransfer.result()) {
+                    failedTransfers++;
+                }
+            }
+            return failedTransfers == 0;
+        });
+        deleteTempInputs += "transferred";
     }
-    else if(firstFLACTagFile.properties().contains("artist")) {
-        artist = cleanString(TStringToQString(firstFLACTagFile.properties()["artist"].front()));
+
+    // Create a torrent of the album's folder next to it, once everything is in its final place
+    // Most of the album was just written, so it's hashed straight from the page cache
+    bool createTorrentEnabled = MIKSettings.value("bDefaultCreateTorrent", false).toBool();
+    bool torrentCreated = false;
+    if(createTorrentEnabled) {
+        conversionGraph.addNode("Creating torrent...", stagingDir.isNull() ? transferInputs : QStringList{"transferred"}, {"torrent"}, [&]() {
+            torrentCreated = createTorrent(finalOutputDir, finalOutputDir.path() + ".torrent", readTorrentSettings());
+            // The album itself is fine either way, so a torrent that couldn't be created is only mentioned in the result
+            return true;
+        });
     }
 
-    // Parse the tags for album
-    if(firstFLACTagFile.properties().contains("album")) {
-        album = cleanString(TStringToQString(firstFLACTagFile.properties()["album"].front()));
+    // Delete temp folder if enabled (and the temp folder isn't the output folder)
+    // It's only moved aside here and deleted in the background, falling back to deleting it right away if it can't be moved
+    if(uiSelections.deleteTempEnabled) {
+        conversionGraph.addNode("Deleting temp folder...", deleteTempInputs, {}, [&]() {
+            if(uiSelections.tempDir != finalOutputDir && !moveToTrash(uiSelections.tempDir.path())) {
+                removeDir(uiSelections.tempDir.path());
+            }
+            return true;
+        });
     }
 
-    // If copying files is enabled and the list of filetypes to copy isn't empty
-    if(uiSelections.copyContentsEnabled && uiSelections.copyContents != "") {
-        ui->ConvertButton->setText("Copying other files..."); // Technically not thread-safe but no competing events
-        QStringList patternList = uiSelections.copyContents.split(';');
+    // Cancelling stops every step that hasn't started yet. The encoders and Loudgain are killed by the progress model itself
+    if(progress != nullptr) {
+        connect(progress, &ConversionProgress::cancelRequested, &conversionGraph, &TaskGraph::cancel, Qt::DirectConnection);
+        // In case it was cancelled before the connection was made
+        if(progress->isCancelled()) {
+            conversionGraph.cancel();
+        }
+    }
 
-        // Copy, then store copied files into a list for later use
-        copiedFiles += folderCopy(uiSelections.tempDir, outputDir, patternList, outputFiles);
+    // Converting is the first step on the button; the time of each step is recorded separately below
+    showStage("Converting...");
+    conversionGraph.run();
+    stageTimer.restart();
+    QMap<QString, qint64> graphTimings = conversionGraph.nodeTimings();
+    foreach(QString stage, graphTimings.keys()) {
+        stageTimings[stage] += graphTimings.value(stage);
     }
 
-    // Rename .logs and .cues if enabled
-    if(uiSelections.renameLogCueEnabled) {
-        renameLogCue(copiedFiles, outputDir, artist, album);
+    // Clean up after a cancelled conversion. Tracks that finished are kept, anything else is partial and gets removed
+    // Extras are removed along with their folder, and the temp folder is kept so the album can be converted again
+    if(isCancelled()) {
+        showStage("Cleaning up...");
+        transferPool.waitForDone();
+
+        int keptFiles = 0;
+        foreach(QString currentFLAC, inputFLACs) {
+            QString outputFile = conversionParameters.outputsByInput.value(currentFLAC);
+            if(outputFile == "") {
+                continue;
+            }
+            if(progress->trackState(currentFLAC) == TRACKPROGRESS_DONE) {
+                keptFiles++;
+                continue;
+            }
+            QFile::remove(outputFile);
+
+            // Remove the folders the naming syntax made for it, if nothing else is in them
+            QDir parentDir = QFileInfo(outputFile).dir();
+            while(parentDir.path().startsWith(conversionParameters.outputDir.path() + "/") && QDir().rmdir(parentDir.path())) {
+                parentDir = QFileInfo(parentDir.path()).dir();
+            }
+        }
+
+        // Finished tracks that were still waiting in the staging folder are left there
+        if(!stagingDir.isNull() && !findFiles(QDir(stagingDir->path()), {"*"}).isEmpty()) {
+            stagingDir->setAutoRemove(false);
+            return "Cancelled, " + QString::number(keptFiles) + " finished files were kept in " + QDir::toNativeSeparators(stagingDir->path());
+        }
+        return "Cancelled, " + QString::number(keptFiles) + " finished files were kept";
     }
 
-    // Compress images if enabled
-    if(uiSelections.compressImagesEnabled) {
-        ui->ConvertButton->setText("Compressing images..."); // Technically not thread-safe but no competing events
-        compressImages(copiedFiles);
+    // Return if nothing could be converted
+    if(outputFiles.isEmpty()) {
+        return "Conversion failed";
     }
 
-    // Delete temp folder if enabled (and the temp folder isn't the output folder)
-    if(uiSelections.deleteTempEnabled && uiSelections.tempDir != outputDir) {
-        removeDir(uiSelections.tempDir.path());
-        //uiSelections.tempDir.removeRecursively(); // FIXME
-        //QDir().rmdir(uiSelections.tempDir.path()); // FIXME
+    // Return if any track couldn't be converted. The ones that were converted are left where they are
+    if(!conversionParameters.failedInputs.isEmpty()) {
+        return "Conversion failed, " + QString::number(conversionParameters.failedInputs.count()) + " of " + QString::number(inputFLACs.count()) + " tracks couldn't be converted";
+    }
+
+    // Keep the extras if any couldn't be moved, so nothing is lost
+    if(failedExtras > 0) {
+        extrasDir->setAutoRemove(false);
+        return QString::number(failedExtras) + " files couldn't be moved to the album folder, they were left in " + QDir::toNativeSeparators(extrasDir->path());
+    }
+
+    // Keep the staging folder if anything couldn't be moved, so nothing is lost
+    if(failedTransfers > 0) {
+        stagingDir->setAutoRemove(false);
+        return QString::number(failedTransfers) + " files couldn't be moved to the output folder, they were left in " + QDir::toNativeSeparators(stagingDir->path());
     }
 
     // Open resultant folder if enabled
     if(uiSelections.openFolderEnabled) {
-        QDesktopServices::openUrl(QUrl::fromLocalFile(outputDir.path()));
+        QDesktopServices::openUrl(QUrl::fromLocalFile(finalOutputDir.path()));
+    }
+
+    QString result = "Converted " + QString::number(outputFiles.count()) + " files into " + QDir::toNativeSeparators(finalOutputDir.path());
+    if(writeManifests && !manifestsWritten) {
+        result += ", the checksum manifests couldn't be written";
+    }
+    if(createTorrentEnabled) {
+        result += torrentCreated ? ", torrent created" : ", the torrent couldn't be created";
+    }
+
+    // Drop-behind: whatever the album's files still have in the page cache goes too (e.g. sources read again for spectrograms, and compressed images)
+    if(dropBehindStats != nullptr) {
+        QStringList albumFiles = inputFLACs + outputFiles + albumExtras;
+        foreach(QString albumFile, albumFiles) {
+            // Files from a staging folder were moved to the same place in the output folder
+            if(!stagingDir.isNull() && albumFile.startsWith(stagingDir->path())) {
+                albumFile = uiSelections.outputDir.path() + albumFile.mid(stagingDir->path().length());
+            }
+            dropFileCache(albumFile, dropBehindStats);
+        }
+        result += ", " + describePageCacheStats(dropBehindStats);
+    }
+
+    // Remember the album, so it's recognized if it's imported again and shows up in the history
+    stageTimings[currentStage] += stageTimer.restart();
+    catalogueAlbum_t catalogueAlbum{artist, album, uiSelections.inputDir.path(), finalOutputDir.path(), uiSelections.codecInput, uiSelections.presetInput, getToolVersions(uiSelections.codecInput), {}, stageTimings};
+    foreach(catalogueTrack_t currentTrack, catalogueTracks) {
+        if(currentTrack.outputFile == "") {
+            continue;
+        }
+        // Files from a staging folder were moved to the same place in the output folder
+        if(!stagingDir.isNull()) {
+            currentTrack.outputFile = uiSelections.outputDir.path() + currentTrack.outputFile.mid(stagingDir->path().length());
+        }
+        catalogueAlbum.tracks.append(currentTrack);
     }
+    recordCatalogueAlbum(&catalogueAlbum);
 
-    // Set the convert button's text back to normal to denote process completion
-    ui->ConvertButton->setText("Convert"); // Technically not thread-safe but no competing events
-    ui->ConvertButton->setEnabled(true);   // Technically not thread-safe but no competing events
+    // Drop folder albums leave the UI alone, since the user may be working on something else in it
+    if(uiSelections.unattended) {
+        return result;
+    }
 
     // If delete temp folder is enabled, also reset some UI elements (assuming user is finished with this album)
     if(uiSelections.deleteTempEnabled) {
@@ -1024,6 +1787,8 @@ void MainWindow::convertBackgroundWorker(uiSelections_t uiSelections) {
         ui->ArtistLineEdit->setText(""); // Technically not thread-safe but no competing events
         ui->AlbumLineEdit->setText(""); // Technically not thread-safe but no competing events
     }
+
+    return result;
 }
 
 // Initial conversion function to handle the initialization and pass control to a non-GUI thread
@@ -1071,8 +1836,23 @@ void MainWindow::convertInitialize() {
         }
     }
 
-    // Disable convert button to denote process is executing
+    // Check the catalogue for audio that was already imported the same way. Only the FLAC headers are read, so this is instant
+    QStringList tempFLACs = findFiles(tempDir, {"*.flac"});
+    QStringList audioMD5s;
+    foreach(QString currentFLAC, tempFLACs) {
+        audioMD5s += getAudioMD5(currentFLAC);
+    }
+    catalogueMatch_t catalogueMatch;
+    if(findCatalogueMatch(audioMD5s, ui->ConvertToComboBox->currentText(), ui->ConvertToPresetComboBox->currentText(), &catalogueMatch)) {
+        QMessageBox::StandardButton warning = QMessageBox::warning(this, "Warning", describeCatalogueMatch(catalogueMatch, tempFLACs.count()) + ".\n\nConvert anyway?", QMessageBox::Yes | QMessageBox::No);
+        if(warning == QMessageBox::No){
+            return;
+        }
+    }
+
+    // Disable convert button to denote process is executing, and allow it to be cancelled
     ui->ConvertButton->setEnabled(false);
+    ui->CancelButton->setEnabled(true);
 
     // Pack the UI state into a struct so functions can use the data as it was when the user launched the conversion process
     // Allows the user to change the UI after starting without it affecting the process
@@ -1088,10 +1868,203 @@ void MainWindow::convertInitialize() {
                                 ui->DeleteTempFolderCheckBox->isChecked(),
                                 ui->ConvertOpenFolderCheckBox->isChecked(),
                                 ui->ConvertToComboBox->currentText(),
-                                ui->ConvertToPresetComboBox->currentText()};
+                                ui->ConvertToPresetComboBox->currentText(),
+                                ui->TranscodeCheckBox->isChecked(),
+                                ui->SpectrogramCheckBox->isChecked(),
+                                false};
+
+    // Pass the struct into a non-GUI thread. The convert button is put back once it returns, whichever way the conversion ended
+    QtConcurrent::run([this, uiSelections]() {
+        conversionProgress.end(convertBackgroundWorker(uiSelections));
+    });
+}
+
+// Cancels the conversion started by hand, if one is running
+void MainWindow::cancelConversion() {
+    ui->CancelButton->setEnabled(false);
+    conversionProgress.cancel();
+}
+
+// Shows the latest progress of the conversion under the convert button
+void MainWindow::showConversionProgress(progressSnapshot_t snapshot) {
+    ui->ConvertButton->setText(snapshot.stage);
+
+    // The bar follows audio length rather than track count, so one long track doesn't make it jump
+    ui->ConvertProgressBar->setMaximum(qMax(1, qRound(snapshot.audioSecondsTotal)));
+    ui->ConvertProgressBar->setValue(qRound(snapshot.audioSecondsDone));
+
+    QStringList details;
+    details += QString::number(snapshot.doneTracks) + "/" + QString::number(snapshot.totalTracks) + " tracks";
+    if(snapshot.failedTracks > 0) {
+        details += QString::number(snapshot.failedTracks) + " failed";
+    }
+    if(snapshot.megabytesPerSecond > 0.0) {
+        details += QString::number(snapshot.megabytesPerSecond, 'f', 1) + " MB/s";
+    }
+    if(snapshot.secondsLeft >= 0) {
+        details += QString::number(snapshot.secondsLeft / 60) + ":" + QString::number(snapshot.secondsLeft % 60).rightJustified(2, '0') + " left";
+    }
+    if(snapshot.runningTracks > 0) {
+        details += "now: " + snapshot.runningTrackNames.join(", ");
+    }
+    ui->ConvertProgressLabel->setText(details.join(", "));
+    ui->ConvertProgressLabel->setToolTip(snapshot.runningTrackNames.join("\n"));
+}
+
+// Puts the convert button back once the conversion has ended, and shows how it went until the next one
+void MainWindow::conversionEnded(QString result) {
+    ui->ConvertButton->setText("Convert");
+    ui->ConvertButton->setEnabled(true);
+    ui->CancelButton->setEnabled(false);
+    ui->ConvertProgressLabel->setText(result);
+    ui->ConvertProgressLabel->setToolTip(result);
+}
+
+// Starts watching the default input folder for new albums. Returns false if it isn't set or doesn't exist
+bool MainWindow::startDropFolderWatch() {
+    QSettings MIKSettings;
+    QDir dropDir(MIKSettings.value("sDefaultInput", "").toString());
+
+    // Temp and converted albums would land back in the drop folder and get picked up again
+    if(dropDir == QDir(MIKSettings.value("sDefaultTemp", "").toString()) || dropDir == QDir(MIKSettings.value("sDefaultOutput", "").toString())) {
+        return false;
+    }
+
+    if(!dropFolderWatcher.start(dropDir)) {
+        return false;
+    }
+
+    // Keep the menu in sync when watching is started from the command line
+    ui->actionWatchInputFolder->blockSignals(true);
+    ui->actionWatchInputFolder->setChecked(true);
+    ui->actionWatchInputFolder->blockSignals(false);
+    return true;
+}
+
+// Runs when "Watch Default Input Folder" is toggled in the file menu
+void MainWindow::on_actionWatchInputFolder_toggled(bool checked) {
+    if(!checked) {
+        dropFolderWatcher.stop();
+        return;
+    }
 
-    // Pass the struct into a non-GUI thread
-    QtConcurrent::run(this, &MainWindow::convertBackgroundWorker, uiSelections);
+    if(!startDropFolderWatch()) {
+        QMessageBox::critical(this, "Alert", "Default input folder is invalid or the same as the default temp/output folder.", QMessageBox::Ok);
+        ui->actionWatchInputFolder->blockSignals(true);
+        ui->actionWatchInputFolder->setChecked(false);
+        ui->actionWatchInputFolder->blockSignals(false);
+    }
+}
+
+// Queues an album that finished arriving in the drop folder
+void MainWindow::queueDroppedAlbum(QString albumPath) {
+    QSettings MIKSettings;
+
+    // Each album already runs its own tracks in parallel, so by default albums are processed one at a time
+    dropFolderPool.setMaxThreadCount(qMax(1, MIKSettings.value("iDefaultDropFolderJobs", 1).toInt()));
+    QtConcurrent::run(&dropFolderPool, this, &MainWindow::dropFolderWorker, albumPath);
+}
+
+// Runs the whole pipeline on a drop folder album using the saved default settings, then logs the result in the default output folder
+void MainWindow::dropFolderWorker(QString albumPath) {
+    QSettings MIKSettings;
+    QDir tempDir(MIKSettings.value("sDefaultTemp", "").toString());
+    QDir outputDir(MIKSettings.value("sDefaultOutput", "").toString());
+    QString syntax = MIKSettings.value("sDefaultSyntax", "").toString();
+    QString codec = MIKSettings.value("sDefaultConvertFormat", "").toString();
+    QString preset = MIKSettings.value("sDefaultConvertPreset", "").toString();
+
+    // The temp folder can live inside the drop folder, but it's not an album
+    if(QDir(albumPath) == tempDir) {
+        return;
+    }
+
+    // The same checks as a manual conversion, except the results go to the log instead of a dialog
+    if(outputDir.path() == "." || !outputDir.exists()) {
+        return;
+    }
+    if(tempDir.path() == "." || !tempDir.exists()) {
+        appendDropFolderLog(outputDir, albumPath, "Default temp folder does not exist");
+        return;
+    }
+    if(syntax == "" || codec == "" || preset == "") {
+        appendDropFolderLog(outputDir, albumPath, "Default naming syntax or conversion format is not set");
+        return;
+    }
+
+    // Archives get a temp folder named after them, without the extension
+    QString tempFolderName = isArchiveFile(albumPath) ? QFileInfo(albumPath).completeBaseName() : QDir(albumPath).dirName();
+    QDir albumTempDir(tempDir.path() + "/" + tempFolderName);
+
+    // Never mix two albums in the same temp folder
+    if(albumTempDir.exists()) {
+        appendDropFolderLog(outputDir, albumPath, "Temp folder " + QDir::toNativeSeparators(albumTempDir.path()) + " already exists");
+        return;
+    }
+
+    // Wait for enough free temp space before starting, so several albums can run on a small drive without filling it up
+    // The album needs its own size in temp, and about as much again if its converted files are written to the same drive
+    qint64 albumBytes = getAlbumSize(albumPath);
+    QDir stagingDir(MIKSettings.value("sDefaultStagingFolder", "").toString());
+    QStorageInfo tempStorage(tempDir);
+    if(QStorageInfo(outputDir).device() == tempStorage.device() || (stagingDir.path() != "." && QStorageInfo(stagingDir).device() == tempStorage.device())) {
+        albumBytes *= 2;
+    }
+    if(!reserveTempSpace(tempDir, albumBytes)) {
+        appendDropFolderLog(outputDir, albumPath, "Not enough free space in the default temp folder");
+        return;
+    }
+
+    bool FLACInstalled = checkInstalledProgram("sDefaultFLACLocation", "flac") != "";
+    QStringList unsplitCues;
+    QStringList unconvertedWAVs;
+    QStringList mismatchedFiles = copyInputFiles(QDir(albumPath), albumTempDir, FLACInstalled && MIKSettings.value("bDefaultAutoWAVConvert", true).toBool(), false, &unsplitCues, 0, &unconvertedWAVs);
+
+    // A bad copy would be converted and published as if it were fine, so the album is skipped and its temp folder removed, so it can be dropped again
+    if(!mismatchedFiles.isEmpty()) {
+        removeDir(albumTempDir.path());
+        releaseTempSpace(albumBytes);
+        appendDropFolderLog(outputDir, albumPath, QString::number(mismatchedFiles.count()) + " files didn't match their source after copying to the temp folder");
+        return;
+    }
+
+    // Only FLACs are converted, so a WAV that couldn't be encoded would be missing from the album; it's left for a manual import instead
+    if(!unconvertedWAVs.isEmpty()) {
+        removeDir(albumTempDir.path());
+        releaseTempSpace(albumBytes);
+        appendDropFolderLog(outputDir, albumPath, QString::number(unconvertedWAVs.count()) + " WAVs couldn't be encoded to FLAC");
+        return;
+    }
+
+    // An image that couldn't be split would be published as one long track, so the album is left for a manual import instead
+    if(!unsplitCues.isEmpty()) {
+        removeDir(albumTempDir.path());
+        releaseTempSpace(albumBytes);
+        appendDropFolderLog(outputDir, albumPath, QString::number(unsplitCues.count()) + " CUE images couldn't be split into tracks");
+        return;
+    }
+
+    bool copyContentsEnabled = MIKSettings.value("bDefaultSpecificFileTypes", false).toBool();
+    uiSelections_t uiSelections{QDir(albumPath),
+                                albumTempDir,
+                                outputDir,
+                                syntax,
+                                MIKSettings.value("bDefaultRG", true).toBool(),
+                                copyContentsEnabled,
+                                MIKSettings.value("sDefaultSpecificFileTypesText", "").toString(),
+                                copyContentsEnabled && MIKSettings.value("bDefaultRenameLogCue", true).toBool(),
+                                copyContentsEnabled && MIKSettings.value("bDefaultCompressImages", false).toBool(),
+                                MIKSettings.value("bDefaultDeleteSourceFolder", true).toBool(),
+                                false,
+                                codec,
+                                preset,
+                                FLACInstalled && MIKSettings.value("bDefaultTranscodeCheck", false).toBool(),
+                                FLACInstalled && MIKSettings.value("bDefaultSpectrograms", false).toBool(),
+                                true};
+
+    QString result = convertBackgroundWorker(uiSelections);
+    releaseTempSpace(albumBytes);
+    appendDropFolderLog(outputDir, albumPath, result);
 }
 
 // Runs when the "copy contents" QCheckBox is changed. Dynamically enables/disables other settings that are only relevant depending on this QCheckBox's status
@@ -3,19 +3,42 @@
 
 #include <settingswindow.h>
 #include <aboutwindow.h>
+#include <archive.h>
+#include <catalogue.h>
+#include <checksum.h>
+#include <cuesplit.h>
+#include <dropfolder.h>
+#include <flacmetadata.h>
 #include <helper.h>
+#include <historywindow.h>
+#include <hires.h>
+#include <loudness.h>
+#include <pagecache.h>
+#include <processsupervisor.h>
+#include <progress.h>
+#include <riplog.h>
+#include <schedule.h>
+#include <spectrogram.h>
+#include <spectrum.h>
+#include <taskgraph.h>
+#include <torrent.h>
 
 #include <QDesktopServices>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFileDialog>
 #include <QFuture>
 #include <QLineEdit>
 #include <QMainWindow>
 #include <QMessageBox>
+#include <QMutex>
 #include <QProcess>
+#include <QScopedPointer>
 #include <QSettings>
 #include <QStandardPaths>
 #include <QStringList>
+#include <QTemporaryDir>
+#include <QThreadPool>
 #include <QtConcurrent/QtConcurrentRun>
 #include <QThread>
 #include <QUrl>
@@ -34,6 +57,10 @@ struct uiSelections_t {
     bool openFolderEnabled;
     QString codecInput;
     QString presetInput;
+    bool transcodeCheckEnabled;
+    bool spectrogramsEnabled;
+    // Set for drop folder albums, which run without any dialogs or UI updates
+    bool unattended;
 };
 
 namespace Ui {
@@ -47,6 +74,7 @@ class MainWindow : public QMainWindow
 public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
+    bool startDropFolderWatch();
 
 private:
     Ui::MainWindow *ui;
@@ -54,16 +82,26 @@ private:
     void folderOpen(QLineEdit* initLineEdit);
     void folderChooser(QLineEdit* initLineEdit);
     void renameLogCue(QStringList inputFiles, QDir outputFolder, QString artist, QString album);
-    QStringList folderCopy(QDir fromDir, QDir toDir, QStringList patternList = {"*"}, QStringList dontCopyList = {});
+    QStringList folderCopy(QDir fromDir, QDir toDir, QStringList patternList = {"*"}, QStringList dontCopyList = {}, pageCacheStats_t *pageCacheStats = nullptr, checksumSet_t *checksumSet = nullptr);
+    QStringList copyInputFiles(QDir inputDir, QDir tempDir, bool convertWavs, bool showProgress = true, QStringList *unsplitCues = nullptr, quintptr cancelGroup = 0, QStringList *unconvertedWAVs = nullptr);
     void copyInputToTempWorker(QDir inputPath, QDir tempPath, bool convertWavs = false);
-    void calculateReplayGain (QStringList inputFLACs);
+    void calculateReplayGain (QStringList inputFLACs, quintptr cancelGroup = 0);
     QStringList convertToFormat(conversionParameters_t *conversionParameters);
-    void convertBackgroundWorker(uiSelections_t uiSelections);
+    QString convertBackgroundWorker(uiSelections_t uiSelections);
+    void dropFolderWorker(QString albumPath);
+    DropFolderWatcher dropFolderWatcher;
+    // Albums from the drop folder are processed here, separately from anything started by hand
+    QThreadPool dropFolderPool;
+    // Progress of the conversion started by hand (drop folder albums aren't shown)
+    ConversionProgress conversionProgress;
 
 private slots:
     void on_actionQuit_triggered();
     void on_actionConfigure_triggered();
     void on_actionAbout_triggered();
+    void on_actionHistory_triggered();
+    void on_actionWatchInputFolder_toggled(bool checked);
+    void queueDroppedAlbum(QString albumPath);
     void openInputFolderChooser();
     void openTempFolderChooser();
     void openOutputFolderChooser();
@@ -84,6 +122,9 @@ private slots:
     void openAlbumArtFetcher();
     void on_ConvertToComboBox_currentIndexChanged(const QString &format);
     void convertInitialize();
+    void cancelConversion();
+    void showConversionProgress(progressSnapshot_t snapshot);
+    void conversionEnded(QString result);
     void on_CopyContentsCheckBox_stateChanged(int state);
 };
 
@@ -0,0 +1,97 @@
+#include "pagecache.h"
+
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Drop-behind is set with the hidden bDefaultDropBehind setting, and only does anything where the OS can be told to drop a file's cache
+bool isDropBehindEnabled() {
+#if defined(Q_OS_LINUX)
+    QSettings MIKSettings;
+    return MIKSettings.value("bDefaultDropBehind", false).toBool();
+#else
+    return false;
+#endif
+}
+
+#if defined(Q_OS_LINUX)
+// Bytes of an open file that are in the page cache right now. The file is mapped but never touched, so nothing is read in
+static qint64 residentBytes(int fileDescriptor, qint64 fileSize) {
+    if(fileSize <= 0) {
+        return 0;
+    }
+
+    void *mappedFile = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    if(mappedFile == MAP_FAILED) {
+        return 0;
+    }
+
+    long pageSize = sysconf(_SC_PAGE_SIZE);
+    QVector<unsigned char> pageResidency(static_cast<int>((fileSize + pageSize - 1) / pageSize));
+    qint64 resident = 0;
+    if(mincore(mappedFile, fileSize, pageResidency.data()) == 0) {
+        foreach(unsigned char pageFlags, pageResidency) {
+            resident += (pageFlags & 1) ? pageSize : 0;
+        }
+    }
+
+    munmap(mappedFile, fileSize);
+    return qMin(resident, fileSize);
+}
+#endif
+
+// Takes a file that nothing is going to read again soon out of the page cache (drop-behind)
+// Written data is flushed to disk first, as only clean pages can be dropped. What was cached and what was released are added to pageCacheStats
+void dropFileCache(QString path, pageCacheStats_t *pageCacheStats) {
+    if(pageCacheStats == nullptr) {
+        return;
+    }
+
+#if defined(Q_OS_LINUX)
+    int fileDescriptor = open(QFile::encodeName(path).constData(), O_RDONLY);
+    if(fileDescriptor < 0) {
+        return;
+    }
+
+    qint64 fileSize = QFileInfo(path).size();
+    qint64 cachedBefore = residentBytes(fileDescriptor, fileSize);
+
+    // Start writeback of anything still dirty and wait for it, without forcing a journal commit like fdatasync would
+    sync_file_range(fileDescriptor, 0, 0, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+    posix_fadvise(fileDescriptor, 0, 0, POSIX_FADV_DONTNEED);
+
+    qint64 cachedAfter = residentBytes(fileDescriptor, fileSize);
+    close(fileDescriptor);
+
+    pageCacheStats->cachedBytes += cachedBefore;
+    pageCacheStats->releasedBytes += qMax(0LL, cachedBefore - cachedAfter);
+#else
+    Q_UNUSED(path);
+#endif
+}
+
+// How much of a file is in the page cache right now, or 0 where that can't be told
+qint64 cachedFileBytes(QString path) {
+#if defined(Q_OS_LINUX)
+    int fileDescriptor = open(QFile::encodeName(path).constData(), O_RDONLY);
+    if(fileDescriptor < 0) {
+        return 0;
+    }
+    qint64 cachedBytes = residentBytes(fileDescriptor, QFileInfo(path).size());
+    close(fileDescriptor);
+    return cachedBytes;
+#else
+    Q_UNUSED(path);
+    return 0;
+#endif
+}
+
+// e.g. "page cache: 1830 MB released, 12 MB left behind (a normal run leaves 1842 MB)"
+QString describePageCacheStats(pageCacheStats_t *pageCacheStats) {
+    qint64 cachedMB = pageCacheStats->cachedBytes / (1024 * 1024);
+    qint64 releasedMB = pageCacheStats->releasedBytes / (1024 * 1024);
+
+    return "page cache: " + QString::number(releasedMB) + " MB released, " + QString::number(cachedMB - releasedMB) + " MB left behind (a normal run leaves " + QString::number(cachedMB) + " MB)";
+}
@@ -0,0 +1,20 @@
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include <helper.h>
+
+#include <atomic>
+
+// How much of the page cache a conversion filled with its files, for the drop-behind report
+// cachedBytes is what a normal run leaves behind; releasedBytes is how much of it drop-behind gave back
+struct pageCacheStats_t {
+    std::atomic<qint64> cachedBytes;
+    std::atomic<qint64> releasedBytes;
+};
+
+bool isDropBehindEnabled();
+void dropFileCache(QString path, pageCacheStats_t *pageCacheStats);
+qint64 cachedFileBytes(QString path);
+QString describePageCacheStats(pageCacheStats_t *pageCacheStats);
+
+#endif // PAGECACHE_H
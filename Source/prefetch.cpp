@@ -0,0 +1,271 @@
+#include "prefetch.h"
+
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+// File systems whose files are read over the network, where a few large sequential reads beat many small parallel ones
+static const QStringList networkFileSystems = {"nfs", "nfs4", "cifs", "smb3", "smbfs", "fuse.sshfs", "9p", "afpfs", "davfs"};
+
+// Where a file's first extent starts on its disk, or its inode number if the file system can't tell (files created together usually get nearby inodes)
+static quint64 readDiskPosition(QString path) {
+#if defined(Q_OS_LINUX)
+    int fileDescriptor = open(QFile::encodeName(path).constData(), O_RDONLY);
+    if(fileDescriptor < 0) {
+        return 0;
+    }
+
+    quint64 diskPosition = 0;
+    struct {
+        struct fiemap map;
+        struct fiemap_extent extent;
+    } extentRequest;
+    memset(&extentRequest, 0, sizeof(extentRequest));
+    extentRequest.map.fm_length = FIEMAP_MAX_OFFSET;
+    extentRequest.map.fm_extent_count = 1;
+
+    struct stat fileStat;
+    if(ioctl(fileDescriptor, FS_IOC_FIEMAP, &extentRequest.map) == 0 && extentRequest.map.fm_mapped_extents > 0) {
+        diskPosition = extentRequest.extent.fe_physical;
+    }
+    else if(fstat(fileDescriptor, &fileStat) == 0) {
+        diskPosition = fileStat.st_ino;
+    }
+
+    close(fileDescriptor);
+    return diskPosition;
+#else
+    Q_UNUSED(path);
+    return 0;
+#endif
+}
+
+// Asks the kernel to start reading a whole file into the page cache, without waiting for it
+static void adviseWillNeed(QString path) {
+#if defined(Q_OS_LINUX)
+    int fileDescriptor = open(QFile::encodeName(path).constData(), O_RDONLY);
+    if(fileDescriptor < 0) {
+        return;
+    }
+    posix_fadvise(fileDescriptor, 0, 0, POSIX_FADV_WILLNEED);
+    close(fileDescriptor);
+#else
+    Q_UNUSED(path);
+#endif
+}
+
+// Picks how to prefetch files stored where path is: advice for SSDs, sequential readers for spinning disks and network shares
+prefetchMode_t detectPrefetchMode(QString path) {
+    QString fileSystemType = QString(QStorageInfo(path).fileSystemType()).toLower();
+
+#if defined(Q_OS_LINUX)
+    if(networkFileSystems.contains(fileSystemType)) {
+        return PREFETCH_SEQUENTIAL;
+    }
+
+    struct stat fileStat;
+    if(stat(QFile::encodeName(path).constData(), &fileStat) != 0) {
+        return PREFETCH_ADVISE;
+    }
+
+    // Partitions don't have a queue of their own, so fall back to their disk's
+    QString deviceFolder = "/sys/dev/block/" + QString::number(major(fileStat.st_dev)) + ":" + QString::number(minor(fileStat.st_dev));
+    foreach(QString rotationalLocation, QStringList{deviceFolder + "/queue/rotational", deviceFolder + "/../queue/rotational"}) {
+        QFile rotationalFile(rotationalLocation);
+        if(rotationalFile.open(QIODevice::ReadOnly)) {
+            return rotationalFile.readAll().trimmed() == "1" ? PREFETCH_SEQUENTIAL : PREFETCH_ADVISE;
+        }
+    }
+    return PREFETCH_ADVISE;
+#elif defined(Q_OS_WIN)
+    // Windows can't be given page cache advice and already reads ahead on local drives, but network shares still gain from large sequential reads
+    QString rootPath = QDir::toNativeSeparators(QStorageInfo(path).rootPath());
+    if(GetDriveTypeW(reinterpret_cast<const wchar_t *>(rootPath.utf16())) == DRIVE_REMOTE) {
+        return PREFETCH_SEQUENTIAL;
+    }
+    return PREFETCH_NONE;
+#else
+    return networkFileSystems.contains(fileSystemType) ? PREFETCH_SEQUENTIAL : PREFETCH_NONE;
+#endif
+}
+
+QString describePrefetchMode(prefetchMode_t mode) {
+    switch(mode) {
+    case PREFETCH_ADVISE:
+        return "advised";
+    case PREFETCH_SEQUENTIAL:
+        return "sequential";
+    default:
+        return "off";
+    }
+}
+
+// queuedFiles are in the order their tasks will start. The first runningTasks of them start right away, so prefetching begins after them
+InputPrefetcher::InputPrefetcher(QStringList queuedFiles, int runningTasks) :
+    outstandingBytes(0),
+    startedFiles(qMin(qMax(1, runningTasks), queuedFiles.count())),
+    stopping(false)
+{
+    QSettings MIKSettings;
+    budgetBytes = MIKSettings.value("iDefaultPrefetchMB", PREFETCH_DEFAULT_BUDGET_MB).toLongLong() * 1024 * 1024;
+    windowFiles = qMax(1, runningTasks) * PREFETCH_WINDOW_PER_TASK;
+
+    // Nothing to read ahead if every file starts right away
+    mode = PREFETCH_NONE;
+    if(budgetBytes > 0 && startedFiles < queuedFiles.count()) {
+        mode = detectPrefetchMode(queuedFiles.first());
+    }
+    batchStats = prefetchStats_t{mode, 0, 0, 0};
+
+    for(int i = 0; i < queuedFiles.count(); i++) {
+        files.append(prefetchFile_t{queuedFiles[i], QFileInfo(queuedFiles[i]).size(), mode != PREFETCH_NONE ? readDiskPosition(queuedFiles[i]) : 0, false, false, i < startedFiles});
+    }
+
+    if(mode == PREFETCH_SEQUENTIAL) {
+        readerPool.setMaxThreadCount(PREFETCH_SEQUENTIAL_READERS);
+        for(int i = 0; i < PREFETCH_SEQUENTIAL_READERS; i++) {
+            QtConcurrent::run(&readerPool, [this]() {
+                readerLoop();
+            });
+        }
+    }
+
+    QMutexLocker prefetchLocker(&prefetchMutex);
+    topUp();
+}
+
+// Stops the readers. Files that were being read are left partly cached, which does no harm
+InputPrefetcher::~InputPrefetcher() {
+    {
+        QMutexLocker prefetchLocker(&prefetchMutex);
+        stopping = true;
+        readsQueued.wakeAll();
+    }
+    readerPool.waitForDone();
+}
+
+// Called by a task as it starts on the file at queueIndex: its prefetched data no longer counts against the budget, and the window moves on
+void InputPrefetcher::fileStarted(int queueIndex) {
+    QMutexLocker prefetchLocker(&prefetchMutex);
+    if(queueIndex < 0 || queueIndex >= files.count() || files[queueIndex].started) {
+        return;
+    }
+
+    files[queueIndex].started = true;
+    if(files[queueIndex].issued) {
+        outstandingBytes -= files[queueIndex].size;
+    }
+    if(files[queueIndex].prefetched) {
+        batchStats.hits++;
+    }
+
+    while(startedFiles < files.count() && files[startedFiles].started) {
+        startedFiles++;
+    }
+    topUp();
+}
+
+prefetchStats_t InputPrefetcher::stats() {
+    QMutexLocker prefetchLocker(&prefetchMutex);
+    return batchStats;
+}
+
+// Issues the files in the window that fit in the budget, in on-disk order. Has to be called with prefetchMutex locked
+void InputPrefetcher::topUp() {
+    if(mode == PREFETCH_NONE || stopping) {
+        return;
+    }
+
+    QList<int> newFiles;
+    int windowEnd = qMin(files.count(), startedFiles + windowFiles);
+    for(int i = startedFiles; i < windowEnd; i++) {
+        if(files[i].issued || files[i].started) {
+            continue;
+        }
+        // A file bigger than the whole budget is still prefetched, but only once nothing else is outstanding
+        if(outstandingBytes > 0 && outstandingBytes + files[i].size > budgetBytes) {
+            break;
+        }
+        files[i].issued = true;
+        outstandingBytes += files[i].size;
+        batchStats.files++;
+        batchStats.bytes += files[i].size;
+        newFiles += i;
+    }
+    if(newFiles.isEmpty()) {
+        return;
+    }
+
+    if(mode == PREFETCH_ADVISE) {
+        // The kernel schedules the reads itself, so the order only matters to keep its queue short
+        std::sort(newFiles.begin(), newFiles.end(), [this](int a, int b) {
+            return files[a].diskPosition < files[b].diskPosition;
+        });
+        foreach(int fileIndex, newFiles) {
+            adviseWillNeed(files[fileIndex].path);
+            files[fileIndex].prefetched = true;
+        }
+        return;
+    }
+
+    // Readers always take the file closest to the start of the disk, so the head sweeps in one direction
+    readQueue.insert(readQueue.end(), newFiles.begin(), newFiles.end());
+    std::sort(readQueue.begin(), readQueue.end(), [this](int a, int b) {
+        return files[a].diskPosition < files[b].diskPosition;
+    });
+    readsQueued.wakeAll();
+}
+
+// Loop of each sequential reader: read queued files whole, in large blocks, until the prefetcher is stopped
+void InputPrefetcher::readerLoop() {
+    QByteArray readBuffer(PREFETCH_BLOCK_SIZE, Qt::Uninitialized);
+    QMutexLocker prefetchLocker(&prefetchMutex);
+
+    forever {
+        while(readQueue.empty() && !stopping) {
+            readsQueued.wait(&prefetchMutex);
+        }
+        if(stopping) {
+            return;
+        }
+
+        int fileIndex = readQueue.front();
+        readQueue.pop_front();
+        // Its task got to it first, and reading it now would only compete with the task
+        if(files[fileIndex].started) {
+            continue;
+        }
+        QString path = files[fileIndex].path;
+        prefetchLocker.unlock();
+
+        bool complete = false;
+        QFile inputFile(path);
+        if(inputFile.open(QIODevice::ReadOnly)) {
+            forever {
+                qint64 readBytes = inputFile.read(readBuffer.data(), PREFETCH_BLOCK_SIZE);
+                if(readBytes <= 0) {
+                    complete = readBytes == 0;
+                    break;
+                }
+
+                QMutexLocker startedLocker(&prefetchMutex);
+                if(files[fileIndex].started || stopping) {
+                    break;
+                }
+            }
+        }
+
+        prefetchLocker.relock();
+        if(complete) {
+            files[fileIndex].prefetched = true;
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <helper.h>
+
+#include <QMutex>
+#include <QStorageInfo>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <deque>
+
+// Most input data (MB) read ahead of the tasks at once, unless iDefaultPrefetchMB says otherwise (0 turns prefetching off)
+#define PREFETCH_DEFAULT_BUDGET_MB 256
+// How many queued files past the running ones are considered for prefetching, per running task
+#define PREFETCH_WINDOW_PER_TASK 2
+// Readers used on spinning disks and network shares, and how much each of them reads at once
+#define PREFETCH_SEQUENTIAL_READERS 2
+#define PREFETCH_BLOCK_SIZE (4 * 1024 * 1024)
+
+// How upcoming files are brought into the page cache
+enum prefetchMode_t {
+    // Nothing is prefetched (turned off, or the OS can't be asked)
+    PREFETCH_NONE,
+    // The kernel is told which files are needed next and reads them in the background (SSDs, where seeking is free)
+    PREFETCH_ADVISE,
+    // A few threads read whole files one after another in large blocks, in on-disk order (spinning disks and network shares)
+    PREFETCH_SEQUENTIAL
+};
+
+// What the prefetcher did during a batch
+struct prefetchStats_t {
+    prefetchMode_t mode;
+    int files;
+    // Files that were completely prefetched before their task started
+    int hits;
+    qint64 bytes;
+};
+
+// One file of the queue, as far as the prefetcher is concerned
+struct prefetchFile_t {
+    QString path;
+    qint64 size;
+    // Where the file starts on disk (or its inode where that can't be read), to read the files in a window with as little seeking as possible
+    quint64 diskPosition;
+    bool issued;
+    bool prefetched;
+    bool started;
+};
+
+// Reads the next files of a scheduler's queue ahead of the tasks that will read them, so encoders reading cold files in parallel don't make a spinning disk seek all the time
+// Only files within a window past the running tasks are prefetched, and only while the data read ahead but not yet used stays under a budget
+class InputPrefetcher
+{
+public:
+    InputPrefetcher(QStringList queuedFiles, int runningTasks);
+    ~InputPrefetcher();
+    void fileStarted(int queueIndex);
+    prefetchStats_t stats();
+
+private:
+    QMutex prefetchMutex;
+    QWaitCondition readsQueued;
+    QVector<prefetchFile_t> files;
+    prefetchMode_t mode;
+    int windowFiles;
+    qint64 budgetBytes;
+    // Data issued for prefetching whose task hasn't started yet
+    qint64 outstandingBytes;
+    // Files before this queue position have started (or were already running when the prefetcher was created)
+    int startedFiles;
+    // Files waiting for a sequential reader, in on-disk order
+    std::deque<int> readQueue;
+    bool stopping;
+    QThreadPool readerPool;
+    prefetchStats_t batchStats;
+    void topUp();
+    void readerLoop();
+};
+
+prefetchMode_t detectPrefetchMode(QString path);
+QString describePrefetchMode(prefetchMode_t mode);
+
+#endif // PREFETCH_H
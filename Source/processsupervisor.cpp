@@ -0,0 +1,445 @@
+#include "processsupervisor.h"
+
+// Running slots held by the current thread for its streamed programs
+static thread_local int heldSlots = 0;
+
+bool processResult_t::succeeded() const {
+    if(!started || exitCodes.isEmpty()) {
+        return false;
+    }
+    foreach(int exitCode, exitCodes) {
+        if(exitCode != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ProcessSupervisor::ProcessSupervisor(QObject *parent) :
+    QObject(parent),
+    runningPipelines(0)
+{
+    QSettings MIKSettings;
+    maxRunningPipelines = qMax(1, MIKSettings.value("iDefaultProcessJobs", QThread::idealThreadCount()).toInt());
+
+    // Every QProcess is created and watched from this thread's event loop
+    supervisorThread.setObjectName("Process supervisor");
+    moveToThread(&supervisorThread);
+    supervisorThread.start();
+}
+
+// The supervisor lives for the rest of the program, so children that are still running at exit aren't torn down from under their callers
+ProcessSupervisor *ProcessSupervisor::instance() {
+    static ProcessSupervisor *supervisor = new ProcessSupervisor();
+    return supervisor;
+}
+
+int ProcessSupervisor::maxRunning() {
+    QMutexLocker pendingLocker(&pendingMutex);
+    return maxRunningPipelines;
+}
+
+void ProcessSupervisor::setMaxRunning(int maxRunning) {
+    {
+        QMutexLocker pendingLocker(&pendingMutex);
+        maxRunningPipelines = qMax(1, maxRunning);
+        slotFreed.wakeAll();
+    }
+    QMetaObject::invokeMethod(this, "startPending", Qt::QueuedConnection);
+}
+
+// Queues a pipeline and returns right away. The returned future gets the result once every program has exited
+// finishedCallback (if any) runs on the supervisor's thread first, so it should only do quick work like renaming a file
+// cancelGroup (if not 0) lets cancelGroup() stop this pipeline along with everything else submitted under the same value
+QFuture<processResult_t> ProcessSupervisor::submit(QList<processJob_t> jobs, std::function<void(const processResult_t &)> finishedCallback, quintptr cancelGroup) {
+    supervisedPipeline_t *pipeline = new supervisedPipeline_t;
+    pipeline->jobs = jobs;
+    pipeline->finishedCallback = finishedCallback;
+    pipeline->result = processResult_t{false, {}, QByteArray(), 0};
+    pipeline->runningProcesses = 0;
+    pipeline->launching = false;
+    pipeline->cancelGroup = cancelGroup;
+    pipeline->futureInterface.reportStarted();
+    QFuture<processResult_t> future = pipeline->futureInterface.future();
+
+    {
+        QMutexLocker pendingLocker(&pendingMutex);
+        pendingPipelines.append(pipeline);
+    }
+    QMetaObject::invokeMethod(this, "startPending", Qt::QueuedConnection);
+
+    return future;
+}
+
+// Drops every queued pipeline of a group and kills the ones that are running. Their results are reported as failed as usual
+// Pipelines submitted under the group afterwards are dropped as well, until resetGroup() is called
+// Returns right away; the killed programs finish (and their pipelines complete) shortly after
+void ProcessSupervisor::cancelGroup(quintptr cancelGroup) {
+    if(cancelGroup == 0) {
+        return;
+    }
+
+    {
+        QMutexLocker pendingLocker(&pendingMutex);
+        cancelledGroups.insert(cancelGroup);
+    }
+
+    QMetaObject::invokeMethod(this, [this, cancelGroup]() {
+        QList<supervisedPipeline_t *> droppedPipelines;
+        {
+            QMutexLocker pendingLocker(&pendingMutex);
+            for(int i = 0; i < pendingPipelines.count(); i++) {
+                if(pendingPipelines[i]->cancelGroup == cancelGroup) {
+                    droppedPipelines += pendingPipelines.takeAt(i--);
+                }
+            }
+        }
+
+        // Never started, so they never took up a running slot either
+        foreach(supervisedPipeline_t *pipeline, droppedPipelines) {
+            pipeline->timer.start();
+            reportPipeline(pipeline);
+        }
+
+        foreach(supervisedPipeline_t *pipeline, launchedPipelines) {
+            if(pipeline->cancelGroup != cancelGroup) {
+                continue;
+            }
+            foreach(QProcess *process, pipeline->processes) {
+                if(process->state() != QProcess::NotRunning) {
+                    process->kill();
+                }
+            }
+        }
+    }, Qt::QueuedConnection);
+}
+
+// Lets pipelines of a cancelled group run again
+void ProcessSupervisor::resetGroup(quintptr cancelGroup) {
+    QMutexLocker pendingLocker(&pendingMutex);
+    cancelledGroups.remove(cancelGroup);
+}
+
+bool ProcessSupervisor::isCancelled(quintptr cancelGroup) {
+    QMutexLocker pendingLocker(&pendingMutex);
+    return cancelledGroups.contains(cancelGroup);
+}
+
+// Takes a running slot for a program the calling thread streams itself (see SupervisedProcess), waiting while every slot is taken
+// A thread that already holds one (e.g. for a decoder that feeds the encoder it's starting) gets another for free, so it never waits on itself
+// Returns false if the group is cancelled before a slot frees up
+bool ProcessSupervisor::acquireSlot(quintptr cancelGroup) {
+    QMutexLocker pendingLocker(&pendingMutex);
+    if(heldSlots == 0) {
+        while(runningPipelines >= maxRunningPipelines && !cancelledGroups.contains(cancelGroup)) {
+            slotFreed.wait(&pendingMutex, PROCESSSUPERVISOR_POLL_INTERVAL);
+        }
+    }
+    if(cancelledGroups.contains(cancelGroup)) {
+        return false;
+    }
+
+    if(heldSlots++ == 0) {
+        runningPipelines++;
+    }
+    return true;
+}
+
+// Gives back a slot taken by acquireSlot(), from the same thread
+void ProcessSupervisor::releaseSlot() {
+    {
+        QMutexLocker pendingLocker(&pendingMutex);
+        if(--heldSlots > 0) {
+            return;
+        }
+        runningPipelines--;
+        slotFreed.wakeAll();
+    }
+    QMetaObject::invokeMethod(this, "startPending", Qt::QueuedConnection);
+}
+
+// Keeps track of a child's process ID while it runs, so its memory can be sampled (see readResidentMemory())
+void ProcessSupervisor::childStarted(QProcess *process) {
+    QMutexLocker pendingLocker(&pendingMutex);
+    runningChildren.insert(process, process->processId());
+}
+
+void ProcessSupervisor::childFinished(QProcess *process) {
+    QMutexLocker pendingLocker(&pendingMutex);
+    runningChildren.remove(process);
+}
+
+QList<qint64> ProcessSupervisor::runningChildIds() {
+    QMutexLocker pendingLocker(&pendingMutex);
+    return runningChildren.values();
+}
+
+// Starts queued pipelines, in the order they were submitted, until the limit is reached
+void ProcessSupervisor::startPending() {
+    while(true) {
+        supervisedPipeline_t *pipeline = nullptr;
+        bool dropped = false;
+        {
+            QMutexLocker pendingLocker(&pendingMutex);
+            if(pendingPipelines.isEmpty() || runningPipelines >= maxRunningPipelines) {
+                return;
+            }
+            pipeline = pendingPipelines.takeFirst();
+            dropped = cancelledGroups.contains(pipeline->cancelGroup);
+            if(!dropped) {
+                runningPipelines++;
+            }
+        }
+
+        // Submitted after its group was cancelled
+        if(dropped) {
+            pipeline->timer.start();
+            reportPipeline(pipeline);
+            continue;
+        }
+        launchPipeline(pipeline);
+    }
+}
+
+void ProcessSupervisor::launchPipeline(supervisedPipeline_t *pipeline) {
+    pipeline->timer.start();
+    launchedPipelines += pipeline;
+
+    for(int i = 0; i < pipeline->jobs.count(); i++) {
+        QProcess *process = new QProcess();
+        process->setProgram(pipeline->jobs[i].program);
+        process->setArguments(pipeline->jobs[i].arguments);
+        pipeline->processes.append(process);
+        pipeline->result.exitCodes.append(-1);
+
+        // Keep stderr as it arrives, so the pipe never fills up and blocks the child
+        connect(process, &QProcess::readyReadStandardError, this, [pipeline, process]() {
+            QByteArray standardError = process->readAllStandardError();
+            int room = PROCESSSUPERVISOR_STDERR_LIMIT * pipeline->processes.count() - pipeline->result.standardError.size();
+            if(room > 0) {
+                pipeline->result.standardError += standardError.left(room);
+            }
+        });
+        connect(process, &QProcess::started, this, [this, process]() {
+            childStarted(process);
+        });
+        connect(process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, [this, pipeline, process]() {
+            processFinished(pipeline, process);
+        });
+        connect(process, &QProcess::errorOccurred, this, [this, pipeline, process](QProcess::ProcessError error) {
+            // A program that never started won't emit finished()
+            if(error == QProcess::FailedToStart) {
+                processFinished(pipeline, process);
+            }
+        });
+    }
+
+    // Chain the programs, and send the last one's output to its file (or nowhere)
+    for(int i = 0; i < pipeline->processes.count() - 1; i++) {
+        pipeline->processes[i]->setStandardOutputProcess(pipeline->processes[i + 1]);
+    }
+    QString outputFile = pipeline->jobs.isEmpty() ? "" : pipeline->jobs.last().outputFile;
+    if(!pipeline->processes.isEmpty()) {
+        pipeline->processes.last()->setStandardOutputFile(outputFile != "" ? outputFile : QProcess::nullDevice());
+    }
+
+    pipeline->result.started = !pipeline->processes.isEmpty();
+    pipeline->runningProcesses = pipeline->processes.count();
+    if(pipeline->runningProcesses == 0) {
+        completePipeline(pipeline);
+        return;
+    }
+
+    // A program that fails to start can report it from inside start(), so the pipeline isn't completed until every program has been dealt with
+    pipeline->launching = true;
+    foreach(QProcess *process, pipeline->processes) {
+        // Programs after one that failed to start would only wait for input that never comes
+        if(!pipeline->result.started) {
+            pipeline->runningProcesses--;
+            continue;
+        }
+        process->start();
+    }
+    pipeline->launching = false;
+
+    if(pipeline->runningProcesses == 0) {
+        completePipeline(pipeline);
+    }
+}
+
+void ProcessSupervisor::processFinished(supervisedPipeline_t *pipeline, QProcess *process) {
+    childFinished(process);
+    int processIndex = pipeline->processes.indexOf(process);
+    if(process->error() == QProcess::FailedToStart) {
+        pipeline->result.started = false;
+        // The rest of the pipeline would otherwise wait for input that never comes
+        foreach(QProcess *otherProcess, pipeline->processes) {
+            if(otherProcess->state() != QProcess::NotRunning) {
+                otherProcess->kill();
+            }
+        }
+    }
+    else if(process->exitStatus() == QProcess::NormalExit) {
+        pipeline->result.exitCodes[processIndex] = process->exitCode();
+    }
+    int room = PROCESSSUPERVISOR_STDERR_LIMIT * pipeline->processes.count() - pipeline->result.standardError.size();
+    if(room > 0) {
+        pipeline->result.standardError += process->readAllStandardError().left(room);
+    }
+
+    if(--pipeline->runningProcesses == 0 && !pipeline->launching) {
+        completePipeline(pipeline);
+    }
+}
+
+// Hands the result to whoever is waiting and makes room for the next pipeline
+void ProcessSupervisor::completePipeline(supervisedPipeline_t *pipeline) {
+    launchedPipelines.removeOne(pipeline);
+    reportPipeline(pipeline);
+
+    {
+        QMutexLocker pendingLocker(&pendingMutex);
+        runningPipelines--;
+        slotFreed.wakeAll();
+    }
+    startPending();
+}
+
+// Hands the result to whoever is waiting and frees the pipeline
+void ProcessSupervisor::reportPipeline(supervisedPipeline_t *pipeline) {
+    pipeline->result.milliseconds = pipeline->timer.elapsed();
+
+    if(pipeline->finishedCallback) {
+        pipeline->finishedCallback(pipeline->result);
+    }
+    pipeline->futureInterface.reportResult(pipeline->result);
+    pipeline->futureInterface.reportFinished();
+
+    foreach(QProcess *process, pipeline->processes) {
+        process->disconnect(this);
+        process->deleteLater();
+    }
+    delete pipeline;
+}
+
+// Runs a pipeline through the supervisor and waits for it. For callers that need the result before they can go on
+// Never call this from a finishedCallback, as the supervisor would be waiting for itself
+processResult_t runProcess(QList<processJob_t> jobs, quintptr cancelGroup) {
+    return ProcessSupervisor::instance()->submit(jobs, nullptr, cancelGroup).result();
+}
+
+SupervisedProcess::SupervisedProcess(processJob_t job, quintptr cancelGroup) :
+    job(job),
+    cancelGroup(cancelGroup),
+    holdsSlot(false),
+    cancelled(false)
+{
+}
+
+// A program that's still running here was abandoned halfway, so it's killed
+SupervisedProcess::~SupervisedProcess() {
+    stop();
+}
+
+// Waits for a running slot and starts the program. Returns false if it couldn't be started or its group was cancelled first
+bool SupervisedProcess::start() {
+    if(!ProcessSupervisor::instance()->acquireSlot(cancelGroup)) {
+        cancelled = true;
+        return false;
+    }
+    holdsSlot = true;
+
+    process.setProgram(job.program);
+    process.setArguments(job.arguments);
+    if(job.outputFile != "") {
+        process.setStandardOutputFile(job.outputFile);
+    }
+    // Only stdin and stdout are used, so discard stderr to keep its pipe from filling up
+    process.setStandardErrorFile(QProcess::nullDevice());
+
+    process.start();
+    if(!process.waitForStarted(-1)) {
+        release();
+        return false;
+    }
+    ProcessSupervisor::instance()->childStarted(&process);
+    return true;
+}
+
+// Waits for more of the program's stdout and appends it to output
+// Returns false once the program has exited and everything has been read (output may still have been appended to), or if its group was cancelled
+bool SupervisedProcess::readOutput(QByteArray *output) {
+    while(!isCancelled()) {
+        bool moreData = process.waitForReadyRead(PROCESSSUPERVISOR_POLL_INTERVAL);
+        output->append(process.readAllStandardOutput());
+        if(moreData) {
+            return true;
+        }
+        // Timing out only means the program is still busy
+        if(process.state() == QProcess::NotRunning) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// Writes everything in input to the program's stdin, waiting while it catches up
+bool SupervisedProcess::write(const QByteArray &input) {
+    if(process.write(input) != input.size()) {
+        return false;
+    }
+    while(process.bytesToWrite() > 0) {
+        if(isCancelled()) {
+            return false;
+        }
+        if(!process.waitForBytesWritten(PROCESSSUPERVISOR_POLL_INTERVAL) && process.state() == QProcess::NotRunning) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Closes stdin and waits for the program to exit. Returns true if it exited with 0 and wasn't cancelled
+bool SupervisedProcess::finish() {
+    if(!holdsSlot) {
+        return false;
+    }
+
+    process.closeWriteChannel();
+    while(process.state() != QProcess::NotRunning && !isCancelled()) {
+        process.waitForFinished(PROCESSSUPERVISOR_POLL_INTERVAL);
+    }
+    bool succeeded = !cancelled && process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+
+    release();
+    return succeeded;
+}
+
+// Kills the program (e.g. once the caller has read all it needed) and frees its slot
+void SupervisedProcess::stop() {
+    if(process.state() != QProcess::NotRunning) {
+        process.kill();
+        process.waitForFinished(-1);
+    }
+    release();
+}
+
+// Kills the program as soon as its group is cancelled
+bool SupervisedProcess::isCancelled() {
+    if(!cancelled && cancelGroup != 0 && ProcessSupervisor::instance()->isCancelled(cancelGroup)) {
+        cancelled = true;
+        if(process.state() != QProcess::NotRunning) {
+            process.kill();
+            process.waitForFinished(-1);
+        }
+    }
+    return cancelled;
+}
+
+void SupervisedProcess::release() {
+    if(holdsSlot) {
+        holdsSlot = false;
+        ProcessSupervisor::instance()->childFinished(&process);
+        ProcessSupervisor::instance()->releaseSlot();
+    }
+}
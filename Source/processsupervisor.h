@@ -0,0 +1,125 @@
+#ifndef PROCESSSUPERVISOR_H
+#define PROCESSSUPERVISOR_H
+
+#include <helper.h>
+
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QThread>
+#include <QWaitCondition>
+
+// Most stderr kept per child; tools that print progress bars would otherwise fill memory
+#define PROCESSSUPERVISOR_STDERR_LIMIT (64 * 1024)
+// How often (ms) a thread that's waiting on a streamed program checks whether its group was cancelled
+#define PROCESSSUPERVISOR_POLL_INTERVAL 100
+
+// One program to run. In a pipeline, each program's stdout is connected to the next one's stdin
+struct processJob_t {
+    QString program;
+    QStringList arguments;
+    // File the last program's stdout is written to, or blank to discard it
+    QString outputFile;
+};
+
+// How a pipeline went
+struct processResult_t {
+    // Whether every program could be started
+    bool started;
+    // Exit code of each program, in pipeline order (-1 if it crashed or never started)
+    QList<int> exitCodes;
+    // stderr of every program, as it arrived
+    QByteArray standardError;
+    qint64 milliseconds;
+    bool succeeded() const;
+};
+
+// A pipeline that is waiting for its turn or running
+struct supervisedPipeline_t {
+    QList<processJob_t> jobs;
+    QFutureInterface<processResult_t> futureInterface;
+    std::function<void(const processResult_t &)> finishedCallback;
+    QList<QProcess *> processes;
+    processResult_t result;
+    int runningProcesses;
+    bool launching;
+    // Pipelines sharing a group can be cancelled together (0 for none)
+    quintptr cancelGroup;
+    QElapsedTimer timer;
+};
+
+// Runs every external program from one event loop thread, instead of one blocked thread per child
+// How many pipelines run at once is its own limit (iDefaultProcessJobs), not the size of whatever thread pool asked for them
+class ProcessSupervisor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ProcessSupervisor *instance();
+    QFuture<processResult_t> submit(QList<processJob_t> jobs, std::function<void(const processResult_t &)> finishedCallback = nullptr, quintptr cancelGroup = 0);
+    void cancelGroup(quintptr cancelGroup);
+    void resetGroup(quintptr cancelGroup);
+    int maxRunning();
+    void setMaxRunning(int maxRunning);
+    bool isCancelled(quintptr cancelGroup);
+    bool acquireSlot(quintptr cancelGroup);
+    void releaseSlot();
+    void childStarted(QProcess *process);
+    void childFinished(QProcess *process);
+    QList<qint64> runningChildIds();
+
+private:
+    explicit ProcessSupervisor(QObject *parent = nullptr);
+    QThread supervisorThread;
+    QMutex pendingMutex;
+    QList<supervisedPipeline_t *> pendingPipelines;
+    // Groups whose pipelines are dropped instead of started, until they're reset
+    QSet<quintptr> cancelledGroups;
+    // Pipelines and streamed programs that are running, which together stay within maxRunningPipelines
+    int runningPipelines;
+    int maxRunningPipelines;
+    QWaitCondition slotFreed;
+    // Process ID of every child that's running, whether the supervisor or a SupervisedProcess started it (for memory sampling)
+    QHash<QProcess *, qint64> runningChildren;
+    // Pipelines that were started and haven't finished yet. Only used from the supervisor's thread
+    QList<supervisedPipeline_t *> launchedPipelines;
+    void launchPipeline(supervisedPipeline_t *pipeline);
+    void processFinished(supervisedPipeline_t *pipeline, QProcess *process);
+    void completePipeline(supervisedPipeline_t *pipeline);
+    void reportPipeline(supervisedPipeline_t *pipeline);
+
+private slots:
+    void startPending();
+};
+
+// A program whose stdin and stdout are streamed by the thread that started it, for audio that's decoded or encoded on the fly
+// It takes one of the supervisor's running slots while it runs and is killed along with its cancel group; only the waiting happens on the caller's thread
+// job.outputFile works as usual; if it's blank, stdout is read through readOutput() instead of being discarded. stderr is discarded
+class SupervisedProcess
+{
+public:
+    explicit SupervisedProcess(processJob_t job, quintptr cancelGroup = 0);
+    ~SupervisedProcess();
+    bool start();
+    bool readOutput(QByteArray *output);
+    bool write(const QByteArray &input);
+    bool finish();
+    void stop();
+    bool isCancelled();
+
+private:
+    QProcess process;
+    processJob_t job;
+    quintptr cancelGroup;
+    bool holdsSlot;
+    bool cancelled;
+    void release();
+};
+
+processResult_t runProcess(QList<processJob_t> jobs, quintptr cancelGroup = 0);
+
+#endif // PROCESSSUPERVISOR_H
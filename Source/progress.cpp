@@ -0,0 +1,163 @@
+#include "progress.h"
+
+ConversionProgress::ConversionProgress(QObject *parent) :
+    QObject(parent),
+    totalAudioMilliseconds(0),
+    audioMillisecondsDone(0),
+    bytesDone(0),
+    firstTrackStartedAt(0),
+    cancelled(false)
+{
+    publishTimer.setInterval(PROGRESS_PUBLISH_INTERVAL);
+    connect(&publishTimer, &QTimer::timeout, this, &ConversionProgress::publish);
+}
+
+// Starts tracking a conversion of inputFLACs. Only their STREAMINFO is read, for the length of each track
+// Can be called from any thread, but not while another conversion is being tracked
+void ConversionProgress::begin(QStringList inputFLACs) {
+    {
+        QMutexLocker trackLocker(&trackMutex);
+        trackFLACs = inputFLACs;
+        trackIndexes.clear();
+        trackAudioMilliseconds.fill(0, inputFLACs.count());
+        trackBytes.fill(0, inputFLACs.count());
+        trackStates.reset(new std::atomic<int>[inputFLACs.count()]);
+        totalAudioMilliseconds = 0;
+
+        for(int i = 0; i < inputFLACs.count(); i++) {
+            trackIndexes.insert(inputFLACs[i], i);
+            trackStates[i] = TRACKPROGRESS_QUEUED;
+            trackBytes[i] = QFileInfo(inputFLACs[i]).size();
+
+            audioFormat_t currentFormat;
+            if(readAudioFormat(inputFLACs[i], &currentFormat) && currentFormat.sampleRate > 0) {
+                trackAudioMilliseconds[i] = currentFormat.totalFrames * 1000 / currentFormat.sampleRate;
+            }
+            totalAudioMilliseconds += trackAudioMilliseconds[i];
+        }
+    }
+
+    audioMillisecondsDone = 0;
+    bytesDone = 0;
+    firstTrackStartedAt = 0;
+    setStage("Preparing...");
+
+    // The timer belongs to the GUI thread, so it has to be started there
+    QMetaObject::invokeMethod(&publishTimer, "start", Qt::QueuedConnection);
+}
+
+// Stops publishing and lets the UI know the conversion is over, whichever way it ended, along with the worker's result
+void ConversionProgress::end(QString result) {
+    QMetaObject::invokeMethod(this, [this, result]() {
+        publishTimer.stop();
+        publish();
+        // Reset here rather than in begin(), so a cancel right after starting isn't lost
+        cancelled = false;
+        ProcessSupervisor::instance()->resetGroup(cancelGroup());
+        emit ended(result);
+    }, Qt::QueuedConnection);
+}
+
+void ConversionProgress::setStage(QString stage) {
+    QMutexLocker stageLocker(&stageMutex);
+    currentStage = stage;
+}
+
+void ConversionProgress::trackStarted(QString inputFLAC) {
+    int trackIndex = trackIndexes.value(inputFLAC, -1);
+    if(trackIndex < 0) {
+        return;
+    }
+    trackStates[trackIndex] = TRACKPROGRESS_RUNNING;
+
+    // Throughput is measured from the first track on, so the checks before converting don't drag it down
+    qint64 notStarted = 0;
+    firstTrackStartedAt.compare_exchange_strong(notStarted, QDateTime::currentMSecsSinceEpoch());
+}
+
+void ConversionProgress::trackFinished(QString inputFLAC, bool succeeded) {
+    int trackIndex = trackIndexes.value(inputFLAC, -1);
+    if(trackIndex < 0) {
+        return;
+    }
+    trackStates[trackIndex] = succeeded ? TRACKPROGRESS_DONE : TRACKPROGRESS_FAILED;
+
+    // Failed tracks still took their time, so they count towards the rate all the same
+    audioMillisecondsDone += trackAudioMilliseconds[trackIndex];
+    bytesDone += trackBytes[trackIndex];
+}
+
+trackProgressState_t ConversionProgress::trackState(QString inputFLAC) {
+    int trackIndex = trackIndexes.value(inputFLAC, -1);
+    if(trackIndex < 0) {
+        return TRACKPROGRESS_QUEUED;
+    }
+    return static_cast<trackProgressState_t>(trackStates[trackIndex].load());
+}
+
+// Stops the conversion: queued tracks are skipped, the running encoders are killed and the conversion's steps are cancelled
+// The worker cleans up the partial outputs once everything has stopped
+void ConversionProgress::cancel() {
+    if(cancelled.exchange(true)) {
+        return;
+    }
+    setStage("Cancelling...");
+
+    ProcessSupervisor::instance()->cancelGroup(cancelGroup());
+    emit cancelRequested();
+}
+
+bool ConversionProgress::isCancelled() {
+    return cancelled;
+}
+
+// Value the conversion's processes are submitted under, so they can be killed together
+quintptr ConversionProgress::cancelGroup() {
+    return reinterpret_cast<quintptr>(this);
+}
+
+// Takes a snapshot of the counters and sends it to the UI
+void ConversionProgress::publish() {
+    progressSnapshot_t snapshot{"", 0, 0, 0, 0, {}, 0.0, 0.0, 0.0, -1, cancelled};
+    {
+        QMutexLocker stageLocker(&stageMutex);
+        snapshot.stage = currentStage;
+    }
+
+    {
+        QMutexLocker trackLocker(&trackMutex);
+        snapshot.totalTracks = trackFLACs.count();
+        for(int i = 0; i < trackFLACs.count(); i++) {
+            switch(trackStates[i].load()) {
+            case TRACKPROGRESS_RUNNING:
+                snapshot.runningTracks++;
+                snapshot.runningTrackNames += QFileInfo(trackFLACs[i]).completeBaseName();
+                break;
+            case TRACKPROGRESS_DONE:
+                snapshot.doneTracks++;
+                break;
+            case TRACKPROGRESS_FAILED:
+                snapshot.failedTracks++;
+                break;
+            default:
+                break;
+            }
+        }
+        snapshot.audioSecondsTotal = totalAudioMilliseconds / 1000.0;
+    }
+    snapshot.audioSecondsDone = audioMillisecondsDone / 1000.0;
+
+    qint64 startedAt = firstTrackStartedAt;
+    double elapsedSeconds = startedAt > 0 ? (QDateTime::currentMSecsSinceEpoch() - startedAt) / 1000.0 : 0.0;
+    if(elapsedSeconds > 0.0) {
+        snapshot.megabytesPerSecond = bytesDone / 1000000.0 / elapsedSeconds;
+
+        // Tracks are converted in parallel, so this is album seconds per wall clock second rather than one track's speed
+        double audioSecondsPerSecond = snapshot.audioSecondsDone / elapsedSeconds;
+        if(audioSecondsPerSecond > 0.0 && !snapshot.cancelled) {
+            snapshot.secondsLeft = qRound64((snapshot.audioSecondsTotal - snapshot.audioSecondsDone) / audioSecondsPerSecond);
+        }
+    }
+
+    emit progressPublished(snapshot);
+}
@@ -0,0 +1,96 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <helper.h>
+#include <processsupervisor.h>
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QTimer>
+
+#include <atomic>
+#include <memory>
+
+// How often (ms) the UI is sent a new snapshot, no matter how often the workers report
+#define PROGRESS_PUBLISH_INTERVAL 250
+
+// Where a track is in the conversion
+enum trackProgressState_t {
+    TRACKPROGRESS_QUEUED,
+    TRACKPROGRESS_RUNNING,
+    TRACKPROGRESS_DONE,
+    TRACKPROGRESS_FAILED
+};
+
+// Everything the UI shows about a running conversion, as of one moment
+struct progressSnapshot_t {
+    // What the album is going through, e.g. "Converting... Compressing images..."
+    QString stage;
+    int totalTracks;
+    int runningTracks;
+    int doneTracks;
+    int failedTracks;
+    // File names of the tracks that are being converted right now
+    QStringList runningTrackNames;
+    // Audio length of the finished tracks, and of the whole album
+    double audioSecondsDone;
+    double audioSecondsTotal;
+    // Input FLAC data read by the finished tracks, per second since the first track started
+    double megabytesPerSecond;
+    // Time left at the current audio seconds per second, or -1 while there isn't anything to go on
+    qint64 secondsLeft;
+    bool cancelled;
+};
+
+// Progress of one attended conversion, shared between the worker threads and the UI
+// Workers only touch atomics, so reporting never waits on anything. The UI gets a snapshot through a signal every PROGRESS_PUBLISH_INTERVAL ms
+class ConversionProgress : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ConversionProgress(QObject *parent = nullptr);
+    void begin(QStringList inputFLACs);
+    void end(QString result);
+    void setStage(QString stage);
+    void trackStarted(QString inputFLAC);
+    void trackFinished(QString inputFLAC, bool succeeded);
+    trackProgressState_t trackState(QString inputFLAC);
+    bool isCancelled();
+    quintptr cancelGroup();
+
+public slots:
+    void cancel();
+
+signals:
+    // Emitted on the GUI thread
+    void progressPublished(progressSnapshot_t snapshot);
+    void ended(QString result);
+    // Emitted from whichever thread called cancel(); connect with Qt::DirectConnection to stop work right away
+    void cancelRequested();
+
+private:
+    QTimer publishTimer;
+    // Only guards the track list against begin() replacing it while a snapshot is being taken
+    QMutex trackMutex;
+    QStringList trackFLACs;
+    QHash<QString, int> trackIndexes;
+    QVector<qint64> trackAudioMilliseconds;
+    QVector<qint64> trackBytes;
+    std::unique_ptr<std::atomic<int>[]> trackStates;
+    qint64 totalAudioMilliseconds;
+    std::atomic<qint64> audioMillisecondsDone;
+    std::atomic<qint64> bytesDone;
+    // When the first track started (ms since epoch), or 0 if none has yet
+    std::atomic<qint64> firstTrackStartedAt;
+    std::atomic<bool> cancelled;
+    QMutex stageMutex;
+    QString currentStage;
+
+private slots:
+    void publish();
+};
+
+#endif // PROGRESS_H
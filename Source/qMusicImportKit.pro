@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui sql
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -29,19 +29,67 @@ CONFIG += \
 
 SOURCES += \
         aboutwindow.cpp \
+        archive.cpp \
+        catalogue.cpp \
+        checksum.cpp \
+        crc.cpp \
+        cuesplit.cpp \
+        dropfolder.cpp \
+        fft.cpp \
+        flacmetadata.cpp \
         helper.cpp \
+        hires.cpp \
+        historywindow.cpp \
+        loudness.cpp \
         main.cpp \
         mainwindow.cpp \
-        settingswindow.cpp
+        pagecache.cpp \
+        prefetch.cpp \
+        processsupervisor.cpp \
+        progress.cpp \
+        resampler.cpp \
+        riplog.cpp \
+        schedule.cpp \
+        settingswindow.cpp \
+        sha.cpp \
+        spectrogram.cpp \
+        spectrum.cpp \
+        taskgraph.cpp \
+        torrent.cpp
 
 HEADERS += \
         aboutwindow.h \
+        archive.h \
+        catalogue.h \
+        checksum.h \
+        cpufeatures.h \
+        crc.h \
+        cuesplit.h \
+        dropfolder.h \
+        fft.h \
+        flacmetadata.h \
         helper.h \
+        hires.h \
+        historywindow.h \
+        loudness.h \
         mainwindow.h \
-        settingswindow.h
+        pagecache.h \
+        prefetch.h \
+        processsupervisor.h \
+        progress.h \
+        resampler.h \
+        riplog.h \
+        schedule.h \
+        settingswindow.h \
+        sha.h \
+        spectrogram.h \
+        spectrum.h \
+        taskgraph.h \
+        torrent.h
 
 FORMS += \
         aboutwindow.ui \
+        historywindow.ui \
         mainwindow.ui \
         settingswindow.ui
 
@@ -64,5 +112,8 @@ win32: LIBS += -L'C:/Program Files (x86)/taglib/lib/' -ltag
 win32: INCLUDEPATH += 'C:/Program Files (x86)/taglib/include/taglib'
 win32: DEPENDPATH += 'C:/Program Files (x86)/taglib/include/taglib'
 
+# Resident memory of the program, for the memory budget's reports
+win32: LIBS += -lpsapi
+
 RESOURCES += \
     data.qrc
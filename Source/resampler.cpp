@@ -0,0 +1,531 @@
+#include "resampler.h"
+#include "cpufeatures.h"
+
+#include <cmath>
+
+// Multiplies count taps by count samples and sums the products. count must be a multiple of 4
+// Samples stay 32-bit floats (they're exact copies of 16/24-bit input) but everything is summed in doubles,
+// as the filter's stopband is far below what float rounding noise would allow
+static double dotProductScalar(const double *taps, const float *samples, int count) {
+    double sum = 0.0;
+    for(int k = 0; k < count; k++) {
+        sum += taps[k] * samples[k];
+    }
+    return sum;
+}
+
+#if defined(MIK_X86_KERNELS)
+// AVX2 version of dotProductScalar, 8 products at a time into two accumulators
+__attribute__((target("avx2,fma")))
+static double dotProductAVX2(const double *taps, const float *samples, int count) {
+    __m256d sumA = _mm256_setzero_pd();
+    __m256d sumB = _mm256_setzero_pd();
+
+    int k = 0;
+    for(; k + 8 <= count; k += 8) {
+        __m256 sampleBlock = _mm256_loadu_ps(samples + k);
+        sumA = _mm256_fmadd_pd(_mm256_loadu_pd(taps + k), _mm256_cvtps_pd(_mm256_castps256_ps128(sampleBlock)), sumA);
+        sumB = _mm256_fmadd_pd(_mm256_loadu_pd(taps + k + 4), _mm256_cvtps_pd(_mm256_extractf128_ps(sampleBlock, 1)), sumB);
+    }
+
+    // Leftover group of 4
+    if(k < count) {
+        sumA = _mm256_fmadd_pd(_mm256_loadu_pd(taps + k), _mm256_cvtps_pd(_mm_loadu_ps(samples + k)), sumA);
+    }
+
+    // Add the four lanes together
+    __m256d sum = _mm256_add_pd(sumA, sumB);
+    __m128d pairSum = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(pairSum, _mm_unpackhi_pd(pairSum, pairSum)));
+}
+#endif
+
+// Double-precision vectors only exist on 64-bit ARM
+#if defined(MIK_NEON_KERNELS) && defined(__aarch64__)
+// NEON version of dotProductScalar, 4 products at a time into two accumulators
+static double dotProductNEON(const double *taps, const float *samples, int count) {
+    float64x2_t sumA = vdupq_n_f64(0.0);
+    float64x2_t sumB = vdupq_n_f64(0.0);
+
+    for(int k = 0; k < count; k += 4) {
+        float32x4_t sampleBlock = vld1q_f32(samples + k);
+        sumA = vfmaq_f64(sumA, vld1q_f64(taps + k), vcvt_f64_f32(vget_low_f32(sampleBlock)));
+        sumB = vfmaq_f64(sumB, vld1q_f64(taps + k + 2), vcvt_high_f64_f32(sampleBlock));
+    }
+
+    return vaddvq_f64(vaddq_f64(sumA, sumB));
+}
+#endif
+
+// Picks the fastest dot product kernel the running CPU supports
+typedef double (*dotProductFunction)(const double *, const float *, int);
+static dotProductFunction selectDotProduct() {
+#if defined(MIK_X86_KERNELS)
+    if(cpuSupportsAVX2()) {
+        return dotProductAVX2;
+    }
+#endif
+#if defined(MIK_NEON_KERNELS) && defined(__aarch64__)
+    return dotProductNEON;
+#endif
+    return dotProductScalar;
+}
+
+// Modified Bessel function of the first kind, order 0, used by the Kaiser window
+static double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double halfX = x / 2.0;
+
+    for(int k = 1; k < 200; k++) {
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+        if(term < sum * 1e-21) {
+            break;
+        }
+    }
+
+    return sum;
+}
+
+// Blocks from every file being converted share one pool, so converting several files at once doesn't multiply the thread count
+static QThreadPool *resamplerPool() {
+    static QThreadPool pool;
+    return &pool;
+}
+
+// Limits how many blocks (and the input or output each one holds) can be alive at once, across all files
+// A block holds its slot from submission until it has been handed on in order
+static QSemaphore *resamplerSlots() {
+    static QSemaphore slots(QThread::idealThreadCount() * 2);
+    return &slots;
+}
+
+// Designs the filter for converting inputSampleRate to outputSampleRate
+// A Kaiser-windowed sinc is used, sized for RESAMPLER_STOPBAND_ATTENUATION over the gap between RESAMPLER_PASSBAND and the Nyquist frequency
+bool createResamplerPlan(int inputSampleRate, int outputSampleRate, resamplerPlan_t *plan) {
+    if(inputSampleRate <= 0 || outputSampleRate <= 0) {
+        return false;
+    }
+
+    const double pi = 3.14159265358979323846;
+
+    // Reduce the ratio as far as possible (e.g. 96000 -> 44100 is 147/320) to keep the number of phases down
+    int commonDivisor = inputSampleRate;
+    int remainder = outputSampleRate;
+    while(remainder != 0) {
+        int previousRemainder = remainder;
+        remainder = commonDivisor % remainder;
+        commonDivisor = previousRemainder;
+    }
+
+    plan->inputSampleRate = inputSampleRate;
+    plan->outputSampleRate = outputSampleRate;
+    plan->upFactor = outputSampleRate / commonDivisor;
+    plan->downFactor = inputSampleRate / commonDivisor;
+
+    // The filter runs at the upsampled rate, and has to remove everything above the lower of the two Nyquist frequencies
+    double upsampledRate = static_cast<double>(inputSampleRate) * plan->upFactor;
+    double nyquist = qMin(inputSampleRate, outputSampleRate) / 2.0;
+    double transitionWidth = (nyquist - nyquist * RESAMPLER_PASSBAND) / upsampledRate;
+    double cutoff = (nyquist * RESAMPLER_PASSBAND + nyquist) / 2.0 / upsampledRate;
+
+    // Kaiser's estimates for the filter length and window shape needed to reach the attenuation
+    int halfLength = static_cast<int>(std::ceil((RESAMPLER_STOPBAND_ATTENUATION - 7.95) / (2.285 * 2.0 * pi * transitionWidth) / 2.0));
+    int filterLength = halfLength * 2 + 1;
+    double beta = 0.1102 * (RESAMPLER_STOPBAND_ATTENUATION - 8.7);
+    double windowScale = besselI0(beta);
+
+    QVector<double> filter(filterLength);
+    double filterSum = 0.0;
+    for(int k = 0; k < filterLength; k++) {
+        double offset = k - halfLength;
+        double sinc = (offset == 0) ? 1.0 : std::sin(2.0 * pi * cutoff * offset) / (2.0 * pi * cutoff * offset);
+        double windowPosition = offset / halfLength;
+        filter[k] = 2.0 * cutoff * sinc * besselI0(beta * std::sqrt(qMax(0.0, 1.0 - windowPosition * windowPosition))) / windowScale;
+        filterSum += filter[k];
+    }
+
+    // Every phase only sees one in upFactor taps, so the whole filter is scaled to sum to upFactor for unity gain
+    plan->filterDelay = halfLength;
+    int tapsPerPhase = (filterLength + plan->upFactor - 1) / plan->upFactor;
+    plan->tapsPerPhase = (tapsPerPhase + 3) / 4 * 4;
+    plan->coefficients.fill(0.0, plan->upFactor * plan->tapsPerPhase);
+
+    for(int phase = 0; phase < plan->upFactor; phase++) {
+        double *phaseTaps = plan->coefficients.data() + phase * plan->tapsPerPhase;
+        for(int i = 0; phase + i * plan->upFactor < filterLength; i++) {
+            // Tap i multiplies the sample i frames back, so it goes i places from the end
+            phaseTaps[plan->tapsPerPhase - 1 - i] = filter[phase + i * plan->upFactor] * plan->upFactor / filterSum;
+        }
+    }
+
+    return true;
+}
+
+// Computes every output frame of a block from its input window
+void resampleBlock(const resamplerPlan_t *plan, int channels, resamplerBlock_t *block) {
+    static const dotProductFunction dotProduct = selectDotProduct();
+
+    block->output.resize(block->outputFrames * channels);
+    float peak = 0.0f;
+
+    for(int channel = 0; channel < channels; channel++) {
+        const float *channelWindow = block->window.constData() + static_cast<qint64>(channel) * block->windowFrames;
+
+        for(int i = 0; i < block->outputFrames; i++) {
+            // Position of this output frame on the upsampled timeline, shifted by the filter's delay
+            qint64 upsampledPosition = (block->firstOutputFrame + i) * plan->downFactor + plan->filterDelay;
+            qint64 newestFrame = upsampledPosition / plan->upFactor;
+            int phase = static_cast<int>(upsampledPosition % plan->upFactor);
+
+            const float *samples = channelWindow + (newestFrame - plan->tapsPerPhase + 1 - block->windowStart);
+            float value = static_cast<float>(dotProduct(plan->coefficients.constData() + phase * plan->tapsPerPhase, samples, plan->tapsPerPhase));
+
+            block->output[i * channels + channel] = value;
+            peak = qMax(peak, std::fabs(value));
+        }
+    }
+
+    block->peak = peak;
+}
+
+// Converts interleaved floats into raw little-endian PCM of bitsPerSample (a multiple of 8)
+// With ditherEnabled, triangular (TPDF) dither of +/-1 LSB is added before rounding, like SoX's default "dither"
+void quantizeSamples(const float *input, qint64 sampleCount, float gain, int bitsPerSample, bool ditherEnabled, quint32 ditherSeed, char *output) {
+    int bytesPerSample = bitsPerSample / 8;
+    qint64 fullScale = 1LL << (bitsPerSample - 1);
+    double scale = static_cast<double>(gain) * fullScale;
+
+    // Small xorshift generator, seeded per call so blocks can be dithered on any thread in any order and still give the same file
+    quint32 ditherState = ditherSeed * 2654435761u;
+    if(ditherState == 0) {
+        ditherState = 1;
+    }
+    auto nextUniform = [&ditherState]() {
+        ditherState ^= ditherState << 13;
+        ditherState ^= ditherState >> 17;
+        ditherState ^= ditherState << 5;
+        return (ditherState >> 8) * (1.0 / 16777216.0);
+    };
+
+    for(qint64 i = 0; i < sampleCount; i++) {
+        double value = input[i] * scale;
+
+        // The difference of two uniform values has a triangular distribution
+        if(ditherEnabled) {
+            value += nextUniform() - nextUniform();
+        }
+
+        qint64 sample = qBound(-fullScale, static_cast<qint64>(std::floor(value + 0.5)), fullScale - 1);
+        for(int byte = 0; byte < bytesPerSample; byte++) {
+            output[i * bytesPerSample + byte] = static_cast<char>((sample >> (8 * byte)) & 0xFF);
+        }
+    }
+}
+
+// Runs one block on the shared pool, then frees its input
+static void resampleBlockWorker(const resamplerPlan_t *plan, int channels, resamplerBlock_t *block) {
+    resampleBlock(plan, channels, block);
+    block->window.clear();
+    block->window.squeeze();
+}
+
+// Decodes inputFLAC and resamples it with plan, splitting the track into blocks that are resampled on several threads as soon as their input has arrived
+// Each block carries its own copy of the input it needs, overlapping its neighbours by the filter's length, so blocks never depend on each other
+// Finished blocks are passed to blockCallback in order and freed right after, so only a few blocks are ever held regardless of track length
+// blockCallback can return false to stop early, which makes this return false. So does cancelling cancelGroup, which stops the decoder
+bool resampleAudio(QString inputFLAC, const resamplerPlan_t &plan, audioFormat_t *audioFormat, std::function<bool(const resamplerBlock_t &)> blockCallback, quintptr cancelGroup) {
+    // Blocks that have been submitted but not handed on yet, oldest first, with the QFuture of the thread resampling each one
+    QList<QSharedPointer<resamplerBlock_t>> pendingBlocks;
+    QList<QFuture<void>> futureList;
+    qint64 submittedBlocks = 0;
+    bool blocksAccepted = true;
+
+    // Decoded input that blocks still need, one QVector per channel, starting at frame pendingStart
+    QVector<QVector<float>> pendingInput;
+    qint64 pendingStart = 0;
+    qint64 decodedFrames = 0;
+    qint64 blockOutputFrames = static_cast<qint64>(plan.outputSampleRate) * RESAMPLER_BLOCK_SECONDS;
+    QVector<float> chunkSamples;
+
+    // Range of input frames an output frame's filter covers
+    auto firstInputFrame = [&plan](qint64 outputFrame) {
+        return (outputFrame * plan.downFactor + plan.filterDelay) / plan.upFactor - plan.tapsPerPhase + 1;
+    };
+    auto lastInputFrame = [&plan](qint64 outputFrame) {
+        return (outputFrame * plan.downFactor + plan.filterDelay) / plan.upFactor;
+    };
+
+    // Hands finished blocks to blockCallback in order, then frees them and their slots
+    // With waitForOldest, the oldest block is waited for even if it's still running
+    auto deliverBlocks = [&](bool waitForOldest) {
+        while(!pendingBlocks.isEmpty() && (waitForOldest || futureList.first().isFinished())) {
+            futureList.takeFirst().waitForFinished();
+            QSharedPointer<resamplerBlock_t> block = pendingBlocks.takeFirst();
+            if(blocksAccepted) {
+                blocksAccepted = blockCallback(*block);
+            }
+            resamplerSlots()->release();
+            waitForOldest = false;
+        }
+    };
+
+    // Hands every block whose input is complete to the pool
+    auto submitBlocks = [&](bool endOfInput) {
+        int channels = pendingInput.count();
+
+        while(true) {
+            qint64 firstOutput = submittedBlocks * blockOutputFrames;
+            qint64 endOutput = firstOutput + blockOutputFrames;
+
+            // Once the input's length is known, so is the output's
+            if(endOfInput) {
+                endOutput = qMin(endOutput, (decodedFrames * plan.upFactor + plan.downFactor - 1) / plan.downFactor);
+                if(firstOutput >= endOutput) {
+                    break;
+                }
+            }
+            else if(lastInputFrame(endOutput - 1) >= decodedFrames) {
+                break;
+            }
+
+            QSharedPointer<resamplerBlock_t> block(new resamplerBlock_t);
+            block->firstOutputFrame = firstOutput;
+            block->outputFrames = static_cast<int>(endOutput - firstOutput);
+            block->windowStart = firstInputFrame(firstOutput);
+            block->windowFrames = static_cast<int>(lastInputFrame(endOutput - 1) - block->windowStart + 1);
+            block->peak = 0.0f;
+
+            // Frames before the start or past the end of the track are silence
+            block->window.fill(0.0f, block->windowFrames * channels);
+            qint64 copyStart = qMax(block->windowStart, pendingStart);
+            qint64 copyEnd = qMin(block->windowStart + block->windowFrames, decodedFrames);
+            for(int channel = 0; channel < channels && copyEnd > copyStart; channel++) {
+                std::copy(pendingInput[channel].constData() + (copyStart - pendingStart), pendingInput[channel].constData() + (copyEnd - pendingStart),
+                          block->window.data() + static_cast<qint64>(channel) * block->windowFrames + (copyStart - block->windowStart));
+            }
+
+            // Every slot may be held by this track's own finished blocks, so hand those on until one frees up
+            while(!resamplerSlots()->tryAcquire()) {
+                if(pendingBlocks.isEmpty()) {
+                    resamplerSlots()->acquire();
+                    break;
+                }
+                deliverBlocks(true);
+            }
+            pendingBlocks.append(block);
+            futureList.append(QtConcurrent::run(resamplerPool(), resampleBlockWorker, &plan, channels, block.data()));
+            submittedBlocks++;
+
+            // Drop the input that no later block will need
+            qint64 droppedFrames = qMin(firstInputFrame(endOutput) - pendingStart, static_cast<qint64>(channels > 0 ? pendingInput[0].count() : 0));
+            if(droppedFrames > 0) {
+                for(int channel = 0; channel < channels; channel++) {
+                    pendingInput[channel].remove(0, static_cast<int>(droppedFrames));
+                }
+                pendingStart += droppedFrames;
+            }
+        }
+    };
+
+    bool decodeSuccess = decodeFLACStream(inputFLAC, audioFormat, [&](const QByteArray &rawPCM) {
+        int channels = audioFormat->channels;
+        if(pendingInput.isEmpty()) {
+            pendingInput.resize(channels);
+        }
+
+        // Split the interleaved chunk into channels
+        convertPCMToFloat(rawPCM, audioFormat->bitsPerSample, &chunkSamples);
+        int chunkFrames = chunkSamples.count() / channels;
+        for(int channel = 0; channel < channels; channel++) {
+            int previousFrames = pendingInput[channel].count();
+            pendingInput[channel].resize(previousFrames + chunkFrames);
+            float *channelData = pendingInput[channel].data() + previousFrames;
+            for(int i = 0; i < chunkFrames; i++) {
+                channelData[i] = chunkSamples[i * channels + channel];
+            }
+        }
+        decodedFrames += chunkFrames;
+
+        submitBlocks(false);
+        deliverBlocks(false);
+        return blocksAccepted;
+    }, cancelGroup);
+
+    // The last blocks are cut short to the track's real length
+    if(decodeSuccess && blocksAccepted && !pendingInput.isEmpty()) {
+        submitBlocks(true);
+    }
+
+    // Blocks point into plan, so they all have to finish before returning, even on failure
+    while(!pendingBlocks.isEmpty()) {
+        deliverBlocks(true);
+    }
+
+    return decodeSuccess && blocksAccepted && !pendingInput.isEmpty();
+}
+
+// Resamples inputFLAC to outputSampleRate and reduces it to outputBitsPerSample (a multiple of 8), encoding the result with FLAC -8 into outputFLAC
+// Equivalent to "sox -G <input> -b <bits> <output> rate -v -L <rate> dither", without the extra process and with the filtering spread over every core
+// Cancelling cancelGroup kills both the decoder and the encoder
+bool resampleFLAC(QString inputFLAC, QString outputFLAC, int outputSampleRate, int outputBitsPerSample, bool ditherEnabled, quintptr cancelGroup) {
+    audioFormat_t audioFormat;
+    if(!readAudioFormat(inputFLAC, &audioFormat) || audioFormat.channels <= 0) {
+        return false;
+    }
+
+    QString programLocation = checkInstalledProgram("sDefaultFLACLocation", "flac");
+    if(programLocation == "") {
+        return false;
+    }
+
+    // FLAC arguments
+    // -f: force
+    // -V: verify
+    // -8: level 8 compression (highest)
+    // --force-raw-format: input is headerless audio
+    // --endian/--sign/--channels/--bps/--sample-rate: describe the raw input
+    // -: read the input from stdin
+    // -o: output location
+    QStringList arguments;
+    arguments << "-f" << "-V" << "-8" << "--force-raw-format" << "--endian=little" << "--sign=signed"
+              << "--channels=" + QString::number(audioFormat.channels) << "--bps=" + QString::number(outputBitsPerSample) << "--sample-rate=" + QString::number(outputSampleRate)
+              << "-" << "-o" << QDir::toNativeSeparators(outputFLAC);
+
+    // Only stdin is used, so stdout is discarded
+    SupervisedProcess FLACProcess({programLocation, arguments, QProcess::nullDevice()}, cancelGroup);
+    bool success = true;
+
+    // Only the bit-depth changes, so there's no filter to overshoot and samples can be converted as they're decoded
+    // The encoder is started first; the decoder it's fed from then shares its running slot
+    if(audioFormat.sampleRate == outputSampleRate) {
+        QVector<float> chunkSamples;
+        QByteArray rawPCM;
+        quint32 chunkNumber = 0;
+        // Stopping the decoder early isn't a failure to it, so a failed write has to be remembered here
+        bool written = true;
+
+        success = FLACProcess.start() && decodeFLACStream(inputFLAC, &audioFormat, [&](const QByteArray &inputPCM) {
+            convertPCMToFloat(inputPCM, audioFormat.bitsPerSample, &chunkSamples);
+            rawPCM.resize(chunkSamples.count() * (outputBitsPerSample / 8));
+            quantizeSamples(chunkSamples.constData(), chunkSamples.count(), 1.0f, outputBitsPerSample, ditherEnabled, ++chunkNumber, rawPCM.data());
+            written = FLACProcess.write(rawPCM);
+            return written;
+        }, cancelGroup) && written;
+    }
+
+    // Guarding: the filter can overshoot on loud material, so the whole track is turned down just enough that nothing clips (like SoX's -G)
+    // That gain is only known once every block has been resampled, so the first pass spills the float output to a temp file instead of memory
+    // and the second pass reads it back a block at a time to be turned down, dithered and fed to FLAC (which isn't started until then)
+    else {
+        resamplerPlan_t plan;
+        QTemporaryFile floatFile;
+        float peak = 0.0f;
+
+        success = createResamplerPlan(audioFormat.sampleRate, outputSampleRate, &plan) && floatFile.open() &&
+                  resampleAudio(inputFLAC, plan, &audioFormat, [&](const resamplerBlock_t &block) {
+            peak = qMax(peak, block.peak);
+            qint64 blockBytes = block.output.count() * static_cast<qint64>(sizeof(float));
+            return floatFile.write(reinterpret_cast<const char *>(block.output.constData()), blockBytes) == blockBytes;
+        }, cancelGroup);
+
+        if(success) {
+            double fullScale = static_cast<double>(1LL << (outputBitsPerSample - 1));
+            float limit = static_cast<float>((fullScale - (ditherEnabled ? 2.0 : 1.0)) / fullScale);
+            float gain = (peak > limit) ? limit / peak : 1.0f;
+
+            qint64 chunkBytes = static_cast<qint64>(outputSampleRate) * RESAMPLER_BLOCK_SECONDS * audioFormat.channels * static_cast<qint64>(sizeof(float));
+            QByteArray rawPCM;
+            quint32 chunkNumber = 0;
+
+            success = floatFile.seek(0) && FLACProcess.start();
+            while(success && !floatFile.atEnd()) {
+                QByteArray floatChunk = floatFile.read(chunkBytes);
+                qint64 chunkSamples = floatChunk.size() / static_cast<int>(sizeof(float));
+                if(chunkSamples == 0) {
+                    success = false;
+                    break;
+                }
+
+                rawPCM.resize(static_cast<int>(chunkSamples * (outputBitsPerSample / 8)));
+                quantizeSamples(reinterpret_cast<const float *>(floatChunk.constData()), chunkSamples, gain, outputBitsPerSample, ditherEnabled, ++chunkNumber, rawPCM.data());
+                success = FLACProcess.write(rawPCM);
+            }
+        }
+    }
+
+    // FLAC finishes once its input is closed. On failure it's killed instead, so it can't finish a file from partial input
+    if(!success) {
+        FLACProcess.stop();
+        return false;
+    }
+    return FLACProcess.finish();
+}
+
+// Null test: resamples inputFLAC both with this resampler and with SoX's "rate -v -L" (no guarding or dither on either), then subtracts one from the other
+// residualDB is the energy of the difference relative to the signal's, and peakDifferenceDB the largest single difference in dBFS
+bool nullTestResampler(QString inputFLAC, int outputSampleRate, double *residualDB, double *peakDifferenceDB) {
+    audioFormat_t audioFormat;
+    resamplerPlan_t plan;
+    if(!readAudioFormat(inputFLAC, &audioFormat) || !createResamplerPlan(audioFormat.sampleRate, outputSampleRate, &plan)) {
+        return false;
+    }
+
+    QString programLocation = checkInstalledProgram("sDefaultSoXLocation", "sox");
+    if(programLocation == "") {
+        return false;
+    }
+
+    // SoX arguments
+    // -D: no dithering
+    // -t raw: headerless output
+    // -e floating-point -b 32: 32-bit float samples, so nothing is rounded
+    // -L: little-endian samples (before the output file)
+    // -: write the output to stdout
+    // rate: add the "rate" effect to the effect chain
+    // -v: very high quality
+    // -L: linear phase response (after "rate")
+    QStringList arguments;
+    arguments << QDir::toNativeSeparators(inputFLAC) << "-D" << "-t" << "raw" << "-e" << "floating-point" << "-b" << "32" << "-L" << "-"
+              << "rate" << "-v" << "-L" << QString::number(outputSampleRate);
+
+    // Start, and read everything SoX writes until it exits
+    SupervisedProcess SoXProcess({programLocation, arguments, ""});
+    QByteArray SoXOutput;
+    if(!SoXProcess.start()) {
+        return false;
+    }
+    while(SoXProcess.readOutput(&SoXOutput)) {
+    }
+    if(!SoXProcess.finish()) {
+        return false;
+    }
+
+    // Both outputs are interleaved floats, compared sample by sample for as long as both last
+    const float *SoXSamples = reinterpret_cast<const float *>(SoXOutput.constData());
+    qint64 SoXSampleCount = SoXOutput.size() / static_cast<int>(sizeof(float));
+    qint64 sampleIndex = 0;
+    double signalEnergy = 0.0;
+    double residualEnergy = 0.0;
+    double peakDifference = 0.0;
+
+    bool resampled = resampleAudio(inputFLAC, plan, &audioFormat, [&](const resamplerBlock_t &block) {
+        for(int i = 0; i < block.output.count() && sampleIndex < SoXSampleCount; i++, sampleIndex++) {
+            double difference = static_cast<double>(block.output[i]) - SoXSamples[sampleIndex];
+            signalEnergy += static_cast<double>(SoXSamples[sampleIndex]) * SoXSamples[sampleIndex];
+            residualEnergy += difference * difference;
+            peakDifference = qMax(peakDifference, std::fabs(difference));
+        }
+        return true;
+    });
+    if(!resampled) {
+        return false;
+    }
+
+    // Silence on both sides counts as a perfect match
+    *residualDB = (residualEnergy > 0.0 && signalEnergy > 0.0) ? 10.0 * std::log10(residualEnergy / signalEnergy) : -INFINITY;
+    *peakDifferenceDB = (peakDifference > 0.0) ? 20.0 * std::log10(peakDifference) : -INFINITY;
+
+    return sampleIndex > 0;
+}
@@ -0,0 +1,54 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <helper.h>
+#include <processsupervisor.h>
+
+#include <QSemaphore>
+#include <QSharedPointer>
+#include <QTemporaryFile>
+#include <QtMath>
+
+// Filter quality, chosen to match SoX's "rate -v -L" (very high quality, linear phase): 95% of the output band is kept flat
+// and everything above the output's Nyquist frequency is attenuated by this many dB
+#define RESAMPLER_PASSBAND 0.95
+#define RESAMPLER_STOPBAND_ATTENUATION 170.0
+// Length of the blocks tracks are split into for resampling on several threads, in seconds of output
+#define RESAMPLER_BLOCK_SECONDS 5
+
+// Polyphase filter for converting between two sample rates
+// The rate ratio is reduced to upFactor/downFactor, and the filter is split into upFactor phases so only taps that land on real samples are ever multiplied
+struct resamplerPlan_t {
+    int inputSampleRate;
+    int outputSampleRate;
+    int upFactor;
+    int downFactor;
+    // Taps per phase, padded with zeros to a multiple of 4 for the vector kernels
+    int tapsPerPhase;
+    // Center of the filter in upsampled samples, compensated for so the output isn't delayed (linear phase)
+    qint64 filterDelay;
+    // Every phase's taps one after another, each stored in reverse so they line up with the samples they multiply
+    QVector<double> coefficients;
+};
+
+// One stretch of a track being resampled, with enough input on either side for the filter to see past its edges
+struct resamplerBlock_t {
+    qint64 firstOutputFrame;
+    int outputFrames;
+    // Input frames from windowStart on, one channel after another
+    qint64 windowStart;
+    int windowFrames;
+    QVector<float> window;
+    // Output frames, interleaved like the raw PCM they become
+    QVector<float> output;
+    float peak;
+};
+
+bool createResamplerPlan(int inputSampleRate, int outputSampleRate, resamplerPlan_t *plan);
+void resampleBlock(const resamplerPlan_t *plan, int channels, resamplerBlock_t *block);
+void quantizeSamples(const float *input, qint64 sampleCount, float gain, int bitsPerSample, bool ditherEnabled, quint32 ditherSeed, char *output);
+bool resampleAudio(QString inputFLAC, const resamplerPlan_t &plan, audioFormat_t *audioFormat, std::function<bool(const resamplerBlock_t &)> blockCallback, quintptr cancelGroup = 0);
+bool resampleFLAC(QString inputFLAC, QString outputFLAC, int outputSampleRate, int outputBitsPerSample, bool ditherEnabled, quintptr cancelGroup = 0);
+bool nullTestResampler(QString inputFLAC, int outputSampleRate, double *residualDB, double *peakDifferenceDB);
+
+#endif // RESAMPLER_H
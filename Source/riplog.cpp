@@ -0,0 +1,335 @@
+#include "riplog.h"
+
+// Formats a checksum the way rippers print them
+static QString hexChecksum(quint32 checksum) {
+    return QString("%1").arg(checksum, 8, 16, QChar('0')).toUpper();
+}
+
+// Reads a log's text. EAC writes UTF-16 with a BOM, XLD plain UTF-8
+static QString readLogText(QString logPath) {
+    QFile logFile(logPath);
+    if(!logFile.open(QIODevice::ReadOnly)) {
+        return "";
+    }
+    QByteArray logData = logFile.readAll();
+    return QTextCodec::codecForUtfText(logData, QTextCodec::codecForName("UTF-8"))->toUnicode(logData);
+}
+
+// Parses the checksums out of an EAC or XLD log: every track's Copy CRC (EAC) or CRC32 hash (XLD), its AccurateRip v1/v2 checksums as the ripper computed them,
+// the range CRC of image rips and the TOC. Returns false for anything that isn't an EAC or XLD log
+bool parseRipLog(QString logPath, ripLog_t *ripLog) {
+    *ripLog = ripLog_t{logPath, "", false, 0, 0, {}};
+
+    QString logText = readLogText(logPath);
+    if(logText.contains("Exact Audio Copy")) {
+        ripLog->ripper = "EAC";
+    }
+    else if(logText.contains("X Lossless Decoder")) {
+        ripLog->ripper = "XLD";
+    }
+    else {
+        return false;
+    }
+
+    QRegExp trackHeader("^Track\\s+(\\d+)$", Qt::CaseInsensitive);
+    QRegExp allTracksHeader("^All Tracks$", Qt::CaseInsensitive);
+    // "1 | 0:00.00 | 4:07.52 | 0 | 18601" (EAC) or "1 | 00:00:00 | 04:07:52 | 0 | 18601" (XLD)
+    QRegExp tocLine("^(\\d+)\\s*\\|\\s*[\\d:.]+\\s*\\|\\s*[\\d:.]+\\s*\\|\\s*(\\d+)\\s*\\|\\s*(\\d+)$");
+    QRegExp copyCRCLine("^(?:Copy CRC|CRC32 hash\\s*:)\\s*([0-9A-F]{8})$", Qt::CaseInsensitive);
+    // EAC, per track: "Accurately ripped (confidence 5)  [ABCDEF12]  (AR v2)" or "Cannot be verified as accurate (confidence 3)  [ABCDEF12], AccurateRip returned [...]  (AR v2)"
+    QRegExp EACAccurateRipLine("^(?:Accurately ripped|Cannot be verified)[^\\[]*\\[([0-9A-F]{8})\\](?:.*\\(AR v(\\d)\\))?", Qt::CaseInsensitive);
+    // EAC image rips list them in a summary instead: "Track  1  accurately ripped (confidence 5)  [ABCDEF12]  (AR v2)"
+    QRegExp EACSummaryLine("^Track\\s+(\\d+)\\s+(?:accurately ripped|cannot be verified)[^\\[]*\\[([0-9A-F]{8})\\](?:.*\\(AR v(\\d)\\))?", Qt::CaseInsensitive);
+    // XLD: "AccurateRip v2 signature : ABCDEF12", or just "AccurateRip signature" (v1) in older versions
+    QRegExp XLDAccurateRipLine("^AccurateRip (?:v(\\d) )?signature\\s*:\\s*([0-9A-F]{8})", Qt::CaseInsensitive);
+    QRegExp nullSamplesLine("^Null samples used in CRC calculations\\s*:?\\s*No\\b", Qt::CaseInsensitive);
+
+    bool nullSamplesSkipped = false;
+    int currentTrack = 0;
+    QMap<int, qint64> tocSamples;
+
+    // Adds an AccurateRip checksum to a track, making the track if the log hasn't mentioned it yet
+    auto setAccurateRip = [&](int trackNumber, int version, quint32 checksum) {
+        ripLogTrack_t *logTrack = &ripLog->tracks[trackNumber];
+        logTrack->number = trackNumber;
+        if(version == 2) {
+            logTrack->hasAccurateRipV2 = true;
+            logTrack->accurateRipV2 = checksum;
+        }
+        else {
+            logTrack->hasAccurateRipV1 = true;
+            logTrack->accurateRipV1 = checksum;
+        }
+    };
+
+    foreach(QString logLine, logText.split(QRegExp("[\r\n]+"), QString::SkipEmptyParts)) {
+        logLine = logLine.trimmed();
+
+        if(nullSamplesLine.indexIn(logLine) == 0) {
+            nullSamplesSkipped = true;
+        }
+        else if(tocLine.indexIn(logLine) == 0) {
+            tocSamples[tocLine.cap(1).toInt()] = (tocLine.cap(3).toLongLong() - tocLine.cap(2).toLongLong() + 1) * RIPLOG_SAMPLES_PER_SECTOR;
+        }
+        else if(EACSummaryLine.indexIn(logLine) == 0) {
+            setAccurateRip(EACSummaryLine.cap(1).toInt(), EACSummaryLine.cap(3).toInt(), EACSummaryLine.cap(2).toUInt(nullptr, 16));
+        }
+        else if(trackHeader.indexIn(logLine) == 0) {
+            currentTrack = trackHeader.cap(1).toInt();
+            ripLog->tracks[currentTrack].number = currentTrack;
+        }
+        else if(allTracksHeader.indexIn(logLine) == 0) {
+            currentTrack = 0;
+        }
+
+        // Before the first track section, a CRC belongs to the whole range
+        else if(copyCRCLine.indexIn(logLine) == 0) {
+            quint32 copyCRC = copyCRCLine.cap(1).toUInt(nullptr, 16);
+            if(currentTrack > 0) {
+                ripLog->tracks[currentTrack].hasCopyCRC = true;
+                ripLog->tracks[currentTrack].copyCRC = copyCRC;
+            }
+            else {
+                ripLog->hasRangeCRC = true;
+                ripLog->rangeCRC = copyCRC;
+            }
+        }
+
+        else if(currentTrack > 0 && EACAccurateRipLine.indexIn(logLine) == 0) {
+            // EAC before 0.99 only had v1, and didn't say so
+            setAccurateRip(currentTrack, EACAccurateRipLine.cap(2).isEmpty() ? 1 : EACAccurateRipLine.cap(2).toInt(), EACAccurateRipLine.cap(1).toUInt(nullptr, 16));
+        }
+        else if(currentTrack > 0 && XLDAccurateRipLine.indexIn(logLine) == 0) {
+            setAccurateRip(currentTrack, XLDAccurateRipLine.cap(1).isEmpty() ? 1 : XLDAccurateRipLine.cap(1).toInt(), XLDAccurateRipLine.cap(2).toUInt(nullptr, 16));
+        }
+    }
+
+    // Without null samples, EAC's CRCs leave out the silent samples, which the CRCs here can't be compared to
+    if(nullSamplesSkipped) {
+        ripLog->hasRangeCRC = false;
+        for(QMap<int, ripLogTrack_t>::iterator logTrack = ripLog->tracks.begin(); logTrack != ripLog->tracks.end(); ++logTrack) {
+            logTrack->hasCopyCRC = false;
+        }
+    }
+
+    // The last track ripped is AccurateRip's last track; data tracks after it are never ripped. Without track sections, go by the TOC
+    ripLog->lastTrackNumber = !ripLog->tracks.isEmpty() ? ripLog->tracks.lastKey() : (!tocSamples.isEmpty() ? tocSamples.lastKey() : 0);
+    for(QMap<int, ripLogTrack_t>::iterator logTrack = ripLog->tracks.begin(); logTrack != ripLog->tracks.end(); ++logTrack) {
+        logTrack->tocSamples = tocSamples.value(logTrack.key(), 0);
+    }
+
+    return true;
+}
+
+// Finds every EAC and XLD log under rootDir that has anything to check
+QList<ripLog_t> findRipLogs(QDir rootDir) {
+    QList<ripLog_t> ripLogs;
+
+    foreach(QString logPath, findFiles(rootDir, {"*.log"})) {
+        ripLog_t ripLog;
+        if(!parseRipLog(logPath, &ripLog)) {
+            continue;
+        }
+
+        bool hasChecksums = ripLog.hasRangeCRC;
+        foreach(ripLogTrack_t logTrack, ripLog.tracks) {
+            hasChecksums = hasChecksums || logTrack.hasCopyCRC || logTrack.hasAccurateRipV1 || logTrack.hasAccurateRipV2;
+        }
+        if(hasChecksums) {
+            ripLogs.append(ripLog);
+        }
+    }
+
+    return ripLogs;
+}
+
+// Matches a log's tracks to the FLACs next to it, by their TRACKNUMBER tags or, failing that, by file name order if there are as many of each
+static QMap<int, QString> matchLogTracks(ripLog_t *ripLog) {
+    QDir logDir = QFileInfo(ripLog->logPath).dir();
+    QStringList trackFLACs;
+    foreach(QString fileName, logDir.entryList({"*.flac"}, QDir::Files, QDir::Name)) {
+        trackFLACs += logDir.filePath(fileName);
+    }
+
+    QMap<int, QString> matchedTracks;
+    bool numbersUsable = true;
+    foreach(QString trackFLAC, trackFLACs) {
+        // "3" or "3/12"
+        int trackNumber = FLACMetadataReader(trackFLAC).tagValue("TRACKNUMBER").section('/', 0, 0).toInt();
+        if(trackNumber <= 0 || matchedTracks.contains(trackNumber)) {
+            numbersUsable = false;
+            break;
+        }
+        matchedTracks.insert(trackNumber, trackFLAC);
+    }
+
+    if(numbersUsable) {
+        return matchedTracks;
+    }
+
+    matchedTracks.clear();
+    if(trackFLACs.count() == ripLog->tracks.count()) {
+        QList<int> trackNumbers = ripLog->tracks.keys();
+        for(int i = 0; i < trackNumbers.count(); i++) {
+            matchedTracks.insert(trackNumbers[i], trackFLACs[i]);
+        }
+    }
+    return matchedTracks;
+}
+
+// Decodes one track and works out its CRC-32 and AccurateRip v1/v2 checksums in a single pass
+// Stops early if another track has already turned out not to match its log
+static void checkRipTrack(ripCheck_t *ripCheck, std::atomic<bool> *mismatchFound) {
+    audioFormat_t audioFormat = {0, 0, 0, 0};
+    // Only CD audio can be compared to a CD rip's log
+    if(!readAudioFormat(ripCheck->inputFLAC, &audioFormat) || audioFormat.sampleRate != 44100 || audioFormat.bitsPerSample != 16 || audioFormat.channels != 2) {
+        return;
+    }
+
+    // A hidden track before track 1 (kept there when an image is split) isn't part of AccurateRip's track 1, so it's left out of the AccurateRip checksums
+    qint64 hiddenSamples = 0;
+    if(ripCheck->logTrack.number == 1 && ripCheck->logTrack.tocSamples > 0 && audioFormat.totalFrames > ripCheck->logTrack.tocSamples) {
+        hiddenSamples = audioFormat.totalFrames - ripCheck->logTrack.tocSamples;
+    }
+    qint64 accurateRipSamples = audioFormat.totalFrames - hiddenSamples;
+    // Multipliers (1-based sample positions within the track) that count towards AccurateRip
+    qint64 firstMultiplier = ripCheck->firstTrack ? RIPLOG_ACCURATERIP_SKIP - 1 : 1;
+    qint64 lastMultiplier = ripCheck->lastTrack ? accurateRipSamples - RIPLOG_ACCURATERIP_SKIP : accurateRipSamples;
+
+    quint32 copyCRC = 0;
+    quint32 accurateRipV1 = 0;
+    quint32 accurateRipV2High = 0;
+    qint64 decodedSamples = 0;
+    bool stopped = false;
+
+    bool decoded = decodeFLACStream(ripCheck->inputFLAC, &audioFormat, [&](const QByteArray &rawPCM) {
+        if(*mismatchFound) {
+            stopped = true;
+            return false;
+        }
+
+        copyCRC = crc32Update(copyCRC, rawPCM.constData(), rawPCM.size());
+
+        // Each stereo sample is one little-endian 32-bit word, left channel in the low half
+        const uchar *sampleBytes = reinterpret_cast<const uchar *>(rawPCM.constData());
+        qint64 chunkSamples = rawPCM.size() / 4;
+        qint64 chunkMultiplier = decodedSamples + 1 - hiddenSamples;
+        qint64 firstSample = qMax(static_cast<qint64>(0), firstMultiplier - chunkMultiplier);
+        qint64 lastSample = qMin(chunkSamples - 1, lastMultiplier - chunkMultiplier);
+        for(qint64 i = firstSample; i <= lastSample; i++) {
+            quint64 product = static_cast<quint64>(qFromLittleEndian<quint32>(sampleBytes + i * 4)) * static_cast<quint64>(chunkMultiplier + i);
+            // v1 keeps the low 32 bits of every product; v2 adds their high 32 bits as well
+            accurateRipV1 += static_cast<quint32>(product);
+            accurateRipV2High += static_cast<quint32>(product >> 32);
+        }
+        decodedSamples += chunkSamples;
+        return true;
+    });
+
+    if(!decoded || stopped) {
+        return;
+    }
+
+    ripCheck->computed = true;
+    ripCheck->samples = decodedSamples;
+    ripCheck->copyCRC = copyCRC;
+    ripCheck->accurateRipV1 = accurateRipV1;
+    ripCheck->accurateRipV2 = accurateRipV1 + accurateRipV2High;
+
+    const ripLogTrack_t &logTrack = ripCheck->logTrack;
+    if((logTrack.hasCopyCRC && copyCRC != logTrack.copyCRC)
+            || (logTrack.hasAccurateRipV1 && ripCheck->accurateRipV1 != logTrack.accurateRipV1)
+            || (logTrack.hasAccurateRipV2 && ripCheck->accurateRipV2 != logTrack.accurateRipV2)) {
+        *mismatchFound = true;
+    }
+}
+
+// Checks every track next to each log against the CRCs and AccurateRip checksums the ripper logged, all tracks in parallel
+// Entirely offline: only the values in the logs are used, not the AccurateRip database. Once one track doesn't match, the rest stop
+// Returns a description of what didn't match, or "" if everything that could be checked matched
+QString verifyRipLogs(QList<ripLog_t> ripLogs) {
+    QVector<ripCheck_t> ripChecks;
+    // Where each log's checks start in ripChecks, and how many it has
+    QVector<QPair<int, int>> logChecks;
+
+    for(int i = 0; i < ripLogs.count(); i++) {
+        QMap<int, QString> matchedTracks = matchLogTracks(&ripLogs[i]);
+        int firstCheck = ripChecks.count();
+        foreach(ripLogTrack_t logTrack, ripLogs[i].tracks) {
+            if(matchedTracks.contains(logTrack.number)) {
+                ripChecks.append(ripCheck_t{matchedTracks.value(logTrack.number), logTrack, logTrack.number == 1, logTrack.number == ripLogs[i].lastTrackNumber, false, 0, 0, 0, 0});
+            }
+        }
+        logChecks.append(qMakePair(firstCheck, ripChecks.count() - firstCheck));
+    }
+
+    if(ripChecks.isEmpty()) {
+        return "";
+    }
+
+    QStringList inputFLACs;
+    foreach(ripCheck_t ripCheck, ripChecks) {
+        inputFLACs += ripCheck.inputFLAC;
+    }
+
+    // One track per thread, longest first so the last one to finish isn't a long one
+    QThreadPool verifyPool;
+    workSchedule_t verifySchedule;
+    std::atomic<bool> mismatchFound(false);
+    ripCheck_t *checkData = ripChecks.data();
+    startLongestFirst(&verifyPool, inputFLACs, "Verifying rip logs", [checkData, &mismatchFound](int i) {
+        checkRipTrack(checkData + i, &mismatchFound);
+    }, &verifySchedule);
+    finishLongestFirst(&verifyPool, &verifySchedule);
+
+    QString description;
+    int uncheckedTracks = 0;
+    foreach(ripCheck_t ripCheck, ripChecks) {
+        if(!ripCheck.computed) {
+            uncheckedTracks++;
+            continue;
+        }
+
+        QString trackDescription;
+        const ripLogTrack_t &logTrack = ripCheck.logTrack;
+        if(logTrack.hasCopyCRC && ripCheck.copyCRC != logTrack.copyCRC) {
+            trackDescription += QString("    CRC %1, log says %2\n").arg(hexChecksum(ripCheck.copyCRC)).arg(hexChecksum(logTrack.copyCRC));
+        }
+        if(logTrack.hasAccurateRipV1 && ripCheck.accurateRipV1 != logTrack.accurateRipV1) {
+            trackDescription += QString("    AccurateRip v1 %1, log says %2\n").arg(hexChecksum(ripCheck.accurateRipV1)).arg(hexChecksum(logTrack.accurateRipV1));
+        }
+        if(logTrack.hasAccurateRipV2 && ripCheck.accurateRipV2 != logTrack.accurateRipV2) {
+            trackDescription += QString("    AccurateRip v2 %1, log says %2\n").arg(hexChecksum(ripCheck.accurateRipV2)).arg(hexChecksum(logTrack.accurateRipV2));
+        }
+        if(trackDescription != "") {
+            description += QFileInfo(ripCheck.inputFLAC).fileName() + "\n" + trackDescription;
+        }
+    }
+
+    // Image rips only have a CRC of the whole range. Tracks were checked separately, so their CRCs are combined into the range's, in track order
+    for(int i = 0; i < ripLogs.count() && !mismatchFound; i++) {
+        int firstCheck = logChecks[i].first;
+        int checkCount = logChecks[i].second;
+        if(!ripLogs[i].hasRangeCRC || checkCount == 0 || checkCount != ripLogs[i].tracks.count()) {
+            continue;
+        }
+
+        bool rangeComplete = true;
+        quint32 rangeCRC = 0;
+        for(int j = firstCheck; j < firstCheck + checkCount; j++) {
+            // Logs with a CRC per track were checked track by track already
+            rangeComplete = rangeComplete && ripChecks[j].computed && !ripChecks[j].logTrack.hasCopyCRC;
+            rangeCRC = (j == firstCheck) ? ripChecks[j].copyCRC : crc32Combine(rangeCRC, ripChecks[j].copyCRC, ripChecks[j].samples * 4);
+        }
+
+        if(rangeComplete && rangeCRC != ripLogs[i].rangeCRC) {
+            description += QString("%1\n    Range CRC %2, log says %3\n").arg(QFileInfo(ripLogs[i].logPath).fileName()).arg(hexChecksum(rangeCRC)).arg(hexChecksum(ripLogs[i].rangeCRC));
+        }
+    }
+
+    if(description != "" && uncheckedTracks > 0) {
+        description += QString("(%1 other tracks weren't checked)\n").arg(uncheckedTracks);
+    }
+
+    return description;
+}
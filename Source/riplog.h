@@ -0,0 +1,64 @@
+#ifndef RIPLOG_H
+#define RIPLOG_H
+
+#include <crc.h>
+#include <flacmetadata.h>
+#include <helper.h>
+#include <schedule.h>
+
+#include <QMap>
+#include <QTextCodec>
+#include <QThreadPool>
+#include <QtEndian>
+
+#include <atomic>
+
+// Samples (stereo frames) per CD sector, the unit of every position in a log's TOC
+#define RIPLOG_SAMPLES_PER_SECTOR 588
+// AccurateRip leaves out the first five sectors of the disc's first track (but one sample) and the last five of its last track, where drive offsets make rips differ
+#define RIPLOG_ACCURATERIP_SKIP (5 * RIPLOG_SAMPLES_PER_SECTOR)
+
+// One track of a rip log, with whichever checksums the ripper wrote for it
+struct ripLogTrack_t {
+    int number;
+    // Length from the log's TOC (INDEX 01 to the next track's INDEX 01), or 0 if the TOC doesn't list it
+    qint64 tocSamples;
+    bool hasCopyCRC;
+    quint32 copyCRC;
+    bool hasAccurateRipV1;
+    quint32 accurateRipV1;
+    bool hasAccurateRipV2;
+    quint32 accurateRipV2;
+};
+
+// What's needed from an EAC or XLD log to check a rip against it
+struct ripLog_t {
+    QString logPath;
+    // "EAC" or "XLD"
+    QString ripper;
+    // Copy CRC of the whole range, which is all image rips get
+    bool hasRangeCRC;
+    quint32 rangeCRC;
+    // AccurateRip's last track, which loses its last five sectors
+    int lastTrackNumber;
+    QMap<int, ripLogTrack_t> tracks;
+};
+
+// One FLAC to check against its log entry, and what its decoded audio came to
+struct ripCheck_t {
+    QString inputFLAC;
+    ripLogTrack_t logTrack;
+    bool firstTrack;
+    bool lastTrack;
+    bool computed;
+    qint64 samples;
+    quint32 copyCRC;
+    quint32 accurateRipV1;
+    quint32 accurateRipV2;
+};
+
+bool parseRipLog(QString logPath, ripLog_t *ripLog);
+QList<ripLog_t> findRipLogs(QDir rootDir);
+QString verifyRipLogs(QList<ripLog_t> ripLogs);
+
+#endif // RIPLOG_H
@@ -0,0 +1,452 @@
+#include "schedule.h"
+
+#if defined(Q_OS_LINUX)
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+// Learned cost models are kept next to the loudness cache
+static QString costModelLocation() {
+    QString modelFolder = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(modelFolder);
+
+    return modelFolder + "/costmodels.ini";
+}
+
+// QSettings treats slashes as nested groups, and presets like "Force 44.1kHz/48kHz" contain them
+static QString costModelGroup(QString workType) {
+    return workType.replace('/', '-').replace('\\', '-');
+}
+
+// Reads the sample count of a WAV from its fmt and data chunks, or returns 0 if it isn't a readable WAV
+static double estimateWAVSamples(QString inputWAV) {
+    QFile wavFile(inputWAV);
+    if(!wavFile.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    QByteArray riffHeader = wavFile.read(12);
+    if(riffHeader.size() < 12 || !riffHeader.startsWith("RIFF") || riffHeader.mid(8, 4) != "WAVE") {
+        return 0;
+    }
+
+    int bitsPerSample = 0;
+    while(!wavFile.atEnd()) {
+        // Chunk header: 4-byte ID, 4-byte little-endian length
+        QByteArray chunkHeader = wavFile.read(8);
+        if(chunkHeader.size() < 8) {
+            return 0;
+        }
+        const uchar *chunkLengthBytes = reinterpret_cast<const uchar *>(chunkHeader.constData() + 4);
+        qint64 chunkLength = static_cast<qint64>(chunkLengthBytes[0]) | (static_cast<qint64>(chunkLengthBytes[1]) << 8) | (static_cast<qint64>(chunkLengthBytes[2]) << 16) | (static_cast<qint64>(chunkLengthBytes[3]) << 24);
+
+        if(chunkHeader.startsWith("fmt ")) {
+            QByteArray formatChunk = wavFile.read(qMin(chunkLength, static_cast<qint64>(16)));
+            if(formatChunk.size() < 16) {
+                return 0;
+            }
+            bitsPerSample = static_cast<uchar>(formatChunk[14]) | (static_cast<uchar>(formatChunk[15]) << 8);
+            wavFile.seek(wavFile.pos() - 16);
+        }
+        else if(chunkHeader.startsWith("data")) {
+            if(bitsPerSample <= 0) {
+                return 0;
+            }
+            // Streamed WAVs sometimes leave the length at its maximum, so never count past the end of the file
+            return static_cast<double>(qMin(chunkLength, wavFile.size() - wavFile.pos())) / ((bitsPerSample + 7) / 8);
+        }
+
+        // Chunks are padded to an even length
+        if(!wavFile.seek(wavFile.pos() + chunkLength + (chunkLength & 1))) {
+            return 0;
+        }
+    }
+
+    return 0;
+}
+
+// Estimates how much work a file is: its length × sample rate × channels, i.e. the number of samples that have to be processed
+// Only metadata is read (STREAMINFO for FLACs, the header for WAVs). Anything else is estimated from its size
+double estimateWorkSamples(QString inputFile) {
+    if(QFileInfo(inputFile).suffix().toLower() == "flac") {
+        audioFormat_t audioFormat;
+        if(readAudioFormat(inputFile, &audioFormat) && audioFormat.totalFrames > 0) {
+            return static_cast<double>(audioFormat.totalFrames) * audioFormat.channels;
+        }
+    }
+    else if(QFileInfo(inputFile).suffix().toLower() == "wav") {
+        double wavSamples = estimateWAVSamples(inputFile);
+        if(wavSamples > 0) {
+            return wavSamples;
+        }
+    }
+
+    // Roughly one sample per two bytes, which is exact for 16-bit PCM and keeps the order right for everything else
+    return QFileInfo(inputFile).size() / 2.0;
+}
+
+// Estimates the most memory a task will use at once (including the external programs it runs), from the file's metadata
+// Pictures are what matters for tagging: TagLib keeps every embedded picture of the input in memory, and each copy into another tag format adds another
+// Resampling streams its output through a temp file, so it only adds a few blocks of audio however long the track is
+qint64 estimateTaskMemory(QString inputFile, QString workType) {
+    qint64 memoryBytes = SCHEDULE_TASK_BASE_MEMORY;
+    if(QFileInfo(inputFile).suffix().toLower() != "flac" || !workType.startsWith("Converting ")) {
+        // Decoding and analysis stream the audio through fixed-size buffers
+        return memoryBytes;
+    }
+
+    FLACMetadataReader inputMetadata(inputFile);
+    if(!inputMetadata.isValid()) {
+        return memoryBytes;
+    }
+
+    qint64 pictureBytes = 0;
+    foreach(flacPicture_t currentPicture, inputMetadata.pictures()) {
+        pictureBytes += currentPicture.dataLength;
+    }
+
+    // MP3: the input FLAC's pictures, their AttachedPictureFrame copies and the rendered ID3v2 tag
+    if(workType.startsWith("Converting MP3")) {
+        memoryBytes += 3 * pictureBytes;
+    }
+    // Opus: opusenc base64-encodes the pictures, and TagLib reads them back from the output to remove the encoder tags
+    else if(workType.startsWith("Converting Opus")) {
+        memoryBytes += 3 * pictureBytes;
+    }
+    // FLAC: the encoder copies the metadata over, and resampled files get their tags and pictures copied afterwards
+    else {
+        memoryBytes += 2 * pictureBytes;
+
+        if(workType.contains("Force") || workType.contains("Remove fake hi-res")) {
+            // A couple of blocks in flight (input window and float output) plus the chunk being dithered, none longer than RESAMPLER_BLOCK_SECONDS
+            audioFormat_t audioFormat = inputMetadata.audioFormat();
+            memoryBytes += static_cast<qint64>(audioFormat.sampleRate) * RESAMPLER_BLOCK_SECONDS * audioFormat.channels * 4 * 8;
+        }
+    }
+
+    return memoryBytes;
+}
+
+// How much memory (bytes) the tasks admitted at once may be estimated to use. Set with iDefaultMemoryBudgetMB, half of the machine's memory by default
+qint64 memoryBudgetBytes() {
+    QSettings MIKSettings;
+    qint64 budgetMB = MIKSettings.value("iDefaultMemoryBudgetMB", 0).toLongLong();
+    if(budgetMB > 0) {
+        return budgetMB * 1024 * 1024;
+    }
+
+    qint64 physicalBytes = 0;
+#if defined(Q_OS_LINUX)
+    physicalBytes = static_cast<qint64>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGE_SIZE);
+#elif defined(Q_OS_WIN)
+    MEMORYSTATUSEX memoryStatus;
+    memoryStatus.dwLength = sizeof(memoryStatus);
+    if(GlobalMemoryStatusEx(&memoryStatus)) {
+        physicalBytes = static_cast<qint64>(memoryStatus.ullTotalPhys);
+    }
+#endif
+
+    return physicalBytes > 0 ? physicalBytes / 2 : SCHEDULE_FALLBACK_MEMORY_BUDGET * 1024LL * 1024;
+}
+
+// Current resident memory (bytes) of the program, or of one of its children by process ID, or 0 if it can't be read
+qint64 readResidentMemory(qint64 processId) {
+#if defined(Q_OS_LINUX)
+    // Second field of statm: resident pages
+    QFile statmFile("/proc/" + (processId > 0 ? QString::number(processId) : QString("self")) + "/statm");
+    if(!statmFile.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    QList<QByteArray> statmFields = statmFile.readAll().split(' ');
+    if(statmFields.count() < 2) {
+        return 0;
+    }
+    return statmFields[1].toLongLong() * sysconf(_SC_PAGE_SIZE);
+#elif defined(Q_OS_WIN)
+    HANDLE process = processId > 0 ? OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_VM_READ, FALSE, static_cast<DWORD>(processId)) : GetCurrentProcess();
+    if(process == NULL) {
+        return 0;
+    }
+    PROCESS_MEMORY_COUNTERS memoryCounters;
+    bool counted = GetProcessMemoryInfo(process, &memoryCounters, sizeof(memoryCounters));
+    if(processId > 0) {
+        CloseHandle(process);
+    }
+    return counted ? static_cast<qint64>(memoryCounters.WorkingSetSize) : 0;
+#else
+    Q_UNUSED(processId);
+    return 0;
+#endif
+}
+
+// Resident memory of the program plus every child that's running under the process supervisor (bytes)
+static qint64 readTotalResidentMemory() {
+    qint64 residentBytes = readResidentMemory();
+    foreach(qint64 childId, ProcessSupervisor::instance()->runningChildIds()) {
+        residentBytes += readResidentMemory(childId);
+    }
+    return residentBytes;
+}
+
+// Peaks of the tasks that are running right now (across every batch), which are raised every SCHEDULE_MEMORY_SAMPLE_INTERVAL ms
+// A single reading when a task ends would miss everything it (and its encoder) used along the way
+static QMutex samplerMutex;
+static QWaitCondition samplerWake;
+static QSet<qint64 *> sampledPeaks;
+static bool samplerRunning = false;
+
+// The sampler only runs while there are tasks to sample for
+static QThreadPool *samplerPool() {
+    static QThreadPool *pool = [] {
+        QThreadPool *sampler = new QThreadPool();
+        sampler->setMaxThreadCount(1);
+        return sampler;
+    }();
+    return pool;
+}
+
+static void sampleResidentMemory() {
+    QMutexLocker samplerLocker(&samplerMutex);
+    while(!sampledPeaks.isEmpty()) {
+        samplerLocker.unlock();
+        qint64 residentBytes = readTotalResidentMemory();
+        samplerLocker.relock();
+
+        foreach(qint64 *peakBytes, sampledPeaks) {
+            *peakBytes = qMax(*peakBytes, residentBytes);
+        }
+        samplerWake.wait(&samplerMutex, SCHEDULE_MEMORY_SAMPLE_INTERVAL);
+    }
+    samplerRunning = false;
+}
+
+// Raises *peakBytes to the highest resident memory sampled from now on, until stopSampling()
+static void startSampling(qint64 *peakBytes) {
+    qint64 residentBytes = readTotalResidentMemory();
+    QMutexLocker samplerLocker(&samplerMutex);
+    *peakBytes = qMax(*peakBytes, residentBytes);
+    sampledPeaks.insert(peakBytes);
+    if(!samplerRunning) {
+        samplerRunning = true;
+        QtConcurrent::run(samplerPool(), sampleResidentMemory);
+    }
+}
+
+// Takes one last sample, while whatever the task held (e.g. a saved tag) is still counted
+static void stopSampling(qint64 *peakBytes) {
+    qint64 residentBytes = readTotalResidentMemory();
+    QMutexLocker samplerLocker(&samplerMutex);
+    *peakBytes = qMax(*peakBytes, residentBytes);
+    sampledPeaks.remove(peakBytes);
+}
+
+// Memory promised to tasks that are currently running, across every pool (drop folder albums run side by side)
+static QMutex memoryMutex;
+static QWaitCondition memoryFreed;
+static qint64 reservedMemoryBytes = 0;
+
+// Blocks until bytes more fit in the memory budget (on top of what running tasks have reserved), then reserves it
+// A task bigger than the whole budget still runs, but only once nothing else is running. Returns the total reserved after admitting it
+qint64 reserveMemory(qint64 bytes) {
+    QMutexLocker memoryLocker(&memoryMutex);
+    qint64 budgetBytes = memoryBudgetBytes();
+
+    while(reservedMemoryBytes > 0 && reservedMemoryBytes + bytes > budgetBytes) {
+        memoryFreed.wait(&memoryMutex);
+    }
+
+    reservedMemoryBytes += bytes;
+    return reservedMemoryBytes;
+}
+
+// Gives back memory reserved with reserveMemory once a task is done, and wakes up tasks that are waiting for it
+void releaseMemory(qint64 bytes) {
+    QMutexLocker memoryLocker(&memoryMutex);
+    reservedMemoryBytes = qMax(0LL, reservedMemoryBytes - bytes);
+    memoryFreed.wakeAll();
+}
+
+// Predicts when a batch finishes by replaying the longest-first order on the pool's threads
+static qint64 predictFinishTime(const QVector<double> &sortedSamples, int threadCount, double nanosecondsPerSample) {
+    QVector<double> threadFinishTimes(qMax(1, threadCount), 0.0);
+
+    foreach(double currentSamples, sortedSamples) {
+        // Each task goes to whichever thread frees up first
+        double *earliestThread = std::min_element(threadFinishTimes.begin(), threadFinishTimes.end());
+        *earliestThread += currentSamples * nanosecondsPerSample;
+    }
+
+    return static_cast<qint64>(*std::max_element(threadFinishTimes.begin(), threadFinishTimes.end()) / 1000000.0);
+}
+
+// Queues task(i) for every file in pool, longest (by estimated work) first, so one long track submitted last doesn't decide when the batch finishes
+// Each task only starts once its estimated memory fits in the memory budget, so many threads working on files with huge embedded pictures don't run the machine out of memory
+// Returns right away. finishLongestFirst() waits for the batch and learns from it; schedule has to stay alive until then
+void startLongestFirst(QThreadPool *pool, QStringList inputFiles, QString workType, std::function<void(int)> task, workSchedule_t *schedule) {
+    startLongestFirstAsync(pool, inputFiles, workType, [task](int i, std::function<void()> taskFinished) {
+        task(i);
+        taskFinished();
+    }, schedule);
+}
+
+// Like startLongestFirst(), for tasks that hand part of their work on (e.g. to an encoder run by the process supervisor) instead of waiting for it
+// task(i, taskFinished) has to call taskFinished once, from any thread, when all of its work is done. Until then its memory stays reserved and its time keeps counting
+void startLongestFirstAsync(QThreadPool *pool, QStringList inputFiles, QString workType, std::function<void(int, std::function<void()>)> task, workSchedule_t *schedule) {
+    schedule->workType = workType;
+    schedule->workSamples.resize(inputFiles.count());
+    schedule->taskMilliseconds.fill(0, inputFiles.count());
+    schedule->taskMemoryBytes.fill(0, inputFiles.count());
+    schedule->admittedMemoryBytes.fill(0, inputFiles.count());
+    schedule->residentMemoryBytes.fill(0, inputFiles.count());
+    schedule->predictedMilliseconds = -1;
+    schedule->finishedTasks.reset(new QSemaphore(0));
+
+    QVector<int> order(inputFiles.count());
+    for(int i = 0; i < inputFiles.count(); i++) {
+        schedule->workSamples[i] = estimateWorkSamples(inputFiles[i]);
+        schedule->taskMemoryBytes[i] = estimateTaskMemory(inputFiles[i], workType);
+        order[i] = i;
+    }
+
+    // Longest first; equal estimates keep their original (alphabetical) order
+    std::stable_sort(order.begin(), order.end(), [schedule](int a, int b) {
+        return schedule->workSamples[a] > schedule->workSamples[b];
+    });
+
+    // Predict the finish time if this kind of work has been timed before
+    QSettings costModels(costModelLocation(), QSettings::IniFormat);
+    double nanosecondsPerSample = costModels.value(costModelGroup(workType) + "/nanosecondsPerSample", 0.0).toDouble();
+    if(nanosecondsPerSample > 0.0) {
+        QVector<double> sortedSamples;
+        foreach(int i, order) {
+            sortedSamples += schedule->workSamples[i];
+        }
+        schedule->predictedMilliseconds = predictFinishTime(sortedSamples, pool->maxThreadCount(), nanosecondsPerSample);
+    }
+
+    schedule->elapsedTimer.start();
+
+    // The files the tasks will read, in the order they'll read them, so the next ones can be brought into the page cache ahead of time
+    QStringList queuedFiles;
+    foreach(int i, order) {
+        queuedFiles += inputFiles[i];
+    }
+    schedule->prefetcher.reset(new InputPrefetcher(queuedFiles, pool->maxThreadCount()));
+    InputPrefetcher *prefetcher = schedule->prefetcher.data();
+    QSharedPointer<QSemaphore> finishedTasks = schedule->finishedTasks;
+
+    // The pool runs tasks in the order they're queued
+    qint64 *taskMilliseconds = schedule->taskMilliseconds.data();
+    qint64 *admittedMemoryBytes = schedule->admittedMemoryBytes.data();
+    qint64 *residentMemoryBytes = schedule->residentMemoryBytes.data();
+    for(int queueIndex = 0; queueIndex < order.count(); queueIndex++) {
+        int i = order[queueIndex];
+        qint64 memoryBytes = schedule->taskMemoryBytes[i];
+        QtConcurrent::run(pool, [task, taskMilliseconds, admittedMemoryBytes, residentMemoryBytes, memoryBytes, prefetcher, finishedTasks, queueIndex, i]() {
+            admittedMemoryBytes[i] = reserveMemory(memoryBytes);
+            prefetcher->fileStarted(queueIndex);
+            startSampling(residentMemoryBytes + i);
+            QSharedPointer<QElapsedTimer> taskTimer(new QElapsedTimer);
+            taskTimer->start();
+            task(i, [taskMilliseconds, residentMemoryBytes, memoryBytes, finishedTasks, taskTimer, i]() {
+                taskMilliseconds[i] = taskTimer->elapsed();
+                // Before the memory is given back
+                stopSampling(residentMemoryBytes + i);
+                releaseMemory(memoryBytes);
+                finishedTasks->release();
+            });
+        });
+    }
+}
+
+// Waits for a batch queued by startLongestFirst(), then updates its cost model and how far off the prediction was
+// Returns how long the batch took
+qint64 finishLongestFirst(QThreadPool *pool, workSchedule_t *schedule) {
+    // Tasks may still be finishing on other threads after their part on the pool is done
+    if(!schedule->finishedTasks.isNull()) {
+        schedule->finishedTasks->acquire(schedule->workSamples.count());
+    }
+    pool->waitForDone();
+    qint64 actualMilliseconds = schedule->elapsedTimer.elapsed();
+
+    schedule->prefetchStats = prefetchStats_t{PREFETCH_NONE, 0, 0, 0};
+    if(!schedule->prefetcher.isNull()) {
+        schedule->prefetchStats = schedule->prefetcher->stats();
+        schedule->prefetcher.reset();
+    }
+
+    double totalSamples = 0.0;
+    qint64 totalMilliseconds = 0;
+    for(int i = 0; i < schedule->workSamples.count(); i++) {
+        totalSamples += schedule->workSamples[i];
+        totalMilliseconds += schedule->taskMilliseconds[i];
+    }
+
+    // Nothing to learn from an empty batch
+    if(totalSamples <= 0.0 || totalMilliseconds <= 0) {
+        return actualMilliseconds;
+    }
+
+    // Several albums can finish at once, so only one updates the models at a time
+    static QMutex costModelMutex;
+    QMutexLocker costModelLocker(&costModelMutex);
+
+    QSettings costModels(costModelLocation(), QSettings::IniFormat);
+    costModels.beginGroup(costModelGroup(schedule->workType));
+
+    // Keep the batch's memory use next to its timing, so the estimates can be checked against what was really used
+    costModels.setValue("lastEstimatedPeakBytes", *std::max_element(schedule->admittedMemoryBytes.begin(), schedule->admittedMemoryBytes.end()));
+    costModels.setValue("lastResidentPeakBytes", *std::max_element(schedule->residentMemoryBytes.begin(), schedule->residentMemoryBytes.end()));
+
+    // Time per sample as measured inside the tasks, so time spent waiting for a free thread doesn't count (waiting for a free encoder does)
+    double measuredRate = totalMilliseconds * 1000000.0 / totalSamples;
+    double learnedRate = costModels.value("nanosecondsPerSample", 0.0).toDouble();
+    learnedRate = learnedRate > 0.0 ? learnedRate + SCHEDULE_LEARNING_RATE * (measuredRate - learnedRate) : measuredRate;
+    costModels.setValue("nanosecondsPerSample", learnedRate);
+
+    // The same rate, learned separately for each kind of prefetching, so what prefetching gains shows up in the statistics
+    QString prefetchMode = describePrefetchMode(schedule->prefetchStats.mode);
+    double modeRate = costModels.value(prefetchMode + "NanosecondsPerSample", 0.0).toDouble();
+    modeRate = modeRate > 0.0 ? modeRate + SCHEDULE_LEARNING_RATE * (measuredRate - modeRate) : measuredRate;
+    costModels.setValue(prefetchMode + "NanosecondsPerSample", modeRate);
+    costModels.setValue("lastPrefetchMode", prefetchMode);
+    costModels.setValue("lastPrefetchFiles", schedule->prefetchStats.files);
+    costModels.setValue("lastPrefetchHits", schedule->prefetchStats.hits);
+
+    // Keep track of how good the predictions are
+    if(schedule->predictedMilliseconds >= 0 && actualMilliseconds > 0) {
+        double error = qAbs(actualMilliseconds - schedule->predictedMilliseconds) / static_cast<double>(actualMilliseconds);
+        int predictions = costModels.value("predictions", 0).toInt();
+        double averageError = costModels.value("averageError", 0.0).toDouble();
+        costModels.setValue("averageError", (averageError * predictions + error) / (predictions + 1));
+        costModels.setValue("predictions", predictions + 1);
+        costModels.setValue("lastPredictedMilliseconds", schedule->predictedMilliseconds);
+        costModels.setValue("lastActualMilliseconds", actualMilliseconds);
+    }
+    costModels.endGroup();
+
+    return actualMilliseconds;
+}
+
+// Every cost model that has made at least one prediction or measured its memory, for the history window
+QList<costModelReport_t> readCostModelReports() {
+    QList<costModelReport_t> reports;
+    QSettings costModels(costModelLocation(), QSettings::IniFormat);
+
+    foreach(QString workType, costModels.childGroups()) {
+        costModels.beginGroup(workType);
+        QString prefetchMode = costModels.value("lastPrefetchMode", "off").toString();
+        costModelReport_t report{workType, costModels.value("lastPredictedMilliseconds").toLongLong(), costModels.value("lastActualMilliseconds").toLongLong(), costModels.value("averageError").toDouble(),
+                                 costModels.value("predictions", 0).toInt(), costModels.value("lastEstimatedPeakBytes", 0).toLongLong(), costModels.value("lastResidentPeakBytes", 0).toLongLong(),
+                                 prefetchMode, costModels.value("lastPrefetchFiles", 0).toInt(), costModels.value("lastPrefetchHits", 0).toInt(),
+                                 costModels.value(prefetchMode + "NanosecondsPerSample", 0.0).toDouble(), costModels.value("offNanosecondsPerSample", 0.0).toDouble()};
+        if(report.predictions > 0 || report.lastResidentPeakBytes > 0) {
+            reports += report;
+        }
+        costModels.endGroup();
+    }
+
+    return reports;
+}
@@ -0,0 +1,83 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <flacmetadata.h>
+#include <helper.h>
+#include <prefetch.h>
+#include <processsupervisor.h>
+#include <resampler.h>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QSet>
+#include <QSemaphore>
+#include <QSharedPointer>
+#include <QStandardPaths>
+#include <QWaitCondition>
+
+#include <algorithm>
+
+// How far each finished run moves a learned cost model towards what was just measured
+#define SCHEDULE_LEARNING_RATE 0.3
+// Memory (bytes) every task is assumed to need on top of what its file adds: thread stack, pipes, QProcess and TagLib bookkeeping
+#define SCHEDULE_TASK_BASE_MEMORY (8LL * 1024 * 1024)
+// Memory budget (MB) used when there's no iDefaultMemoryBudgetMB setting and the machine's memory can't be read
+#define SCHEDULE_FALLBACK_MEMORY_BUDGET 4096
+// How often (ms) resident memory is sampled while tasks run
+#define SCHEDULE_MEMORY_SAMPLE_INTERVAL 100
+
+// A batch of per-file tasks that is run longest first, along with what's needed to check the prediction afterwards
+struct workSchedule_t {
+    // Name of the cost model, e.g. "Converting MP3 245kbps VBR (V0)"
+    QString workType;
+    // Estimated work (samples × channels) of each task, in the order the files were given
+    QVector<double> workSamples;
+    // How long each task took to run
+    QVector<qint64> taskMilliseconds;
+    // Estimated peak memory of each task, what all admitted tasks were estimated to use once it was admitted,
+    // and the highest resident memory of the program and its running children that was sampled while it ran
+    QVector<qint64> taskMemoryBytes;
+    QVector<qint64> admittedMemoryBytes;
+    QVector<qint64> residentMemoryBytes;
+    // Released once by every task that's done, including the part of its work it handed on to other threads
+    QSharedPointer<QSemaphore> finishedTasks;
+    // Reads the next queued files ahead of their tasks while the batch runs, and what it did once the batch is done
+    QSharedPointer<InputPrefetcher> prefetcher;
+    prefetchStats_t prefetchStats;
+    // Finish time predicted from the learned cost model, or -1 if nothing has been learned yet
+    qint64 predictedMilliseconds;
+    QElapsedTimer elapsedTimer;
+};
+
+// How a cost model's predictions have turned out so far
+struct costModelReport_t {
+    QString workType;
+    qint64 lastPredictedMilliseconds;
+    qint64 lastActualMilliseconds;
+    // Average of how far off (as a fraction of the actual time) the finish time predictions were
+    double averageError;
+    int predictions;
+    // Estimated memory of every admitted task at the busiest point of the last batch, and the highest resident memory (program plus children) that was sampled
+    qint64 lastEstimatedPeakBytes;
+    qint64 lastResidentPeakBytes;
+    // How the last batch was prefetched, and the time per sample learned with that kind of prefetching and without any
+    QString lastPrefetchMode;
+    int lastPrefetchFiles;
+    int lastPrefetchHits;
+    double prefetchedNanosecondsPerSample;
+    double unprefetchedNanosecondsPerSample;
+};
+
+double estimateWorkSamples(QString inputFile);
+qint64 estimateTaskMemory(QString inputFile, QString workType);
+qint64 memoryBudgetBytes();
+qint64 readResidentMemory(qint64 processId = 0);
+qint64 reserveMemory(qint64 bytes);
+void releaseMemory(qint64 bytes);
+void startLongestFirst(QThreadPool *pool, QStringList inputFiles, QString workType, std::function<void(int)> task, workSchedule_t *schedule);
+void startLongestFirstAsync(QThreadPool *pool, QStringList inputFiles, QString workType, std::function<void(int, std::function<void()>)> task, workSchedule_t *schedule);
+qint64 finishLongestFirst(QThreadPool *pool, workSchedule_t *schedule);
+QList<costModelReport_t> readCostModelReports();
+
+#endif // SCHEDULE_H
@@ -40,6 +40,9 @@ SettingsWindow::SettingsWindow(QWidget *parent) :
     if(QDir(MIKSettings.value("sDefaultOutput", "").toString()).exists()) {
         ui->DefaultOutputLineEdit->setText(QDir::toNativeSeparators(MIKSettings.value("sDefaultOutput", "").toString()));
     }
+    if(MIKSettings.value("sDefaultStagingFolder", "").toString() != "" && QDir(MIKSettings.value("sDefaultStagingFolder", "").toString()).exists()) {
+        ui->DefaultStagingLineEdit->setText(QDir::toNativeSeparators(MIKSettings.value("sDefaultStagingFolder", "").toString()));
+    }
     ui->DefaultSyntaxComboBox->setCurrentText(MIKSettings.value("sDefaultSyntax", "").toString());
     ui->DefaultAutoWAVConvertCheckBox->setChecked(MIKSettings.value("bDefaultAutoWAVConvert", true).toBool());
     ui->DefaultRGCheckBox->setChecked(MIKSettings.value("bDefaultRG", true).toBool());
@@ -53,6 +56,15 @@ SettingsWindow::SettingsWindow(QWidget *parent) :
     ui->DefaultCompressPNGCheckBox->setChecked(MIKSettings.value("bDefaultCompressPNG", false).toBool());
     ui->DefaultDeleteSourceFolderCheckBox->setChecked(MIKSettings.value("bDefaultDeleteSourceFolder", true).toBool());
     ui->DefaultOpenFolderCheckBox->setChecked(MIKSettings.value("bDefaultOpenFolder", false).toBool());
+    ui->DefaultTranscodeCheckCheckBox->setChecked(MIKSettings.value("bDefaultTranscodeCheck", false).toBool());
+    ui->DefaultSpectrogramsCheckBox->setChecked(MIKSettings.value("bDefaultSpectrograms", false).toBool());
+    ui->DefaultSpectrogramDetailCheckBox->setChecked(MIKSettings.value("bDefaultSpectrogramDetail", false).toBool());
+    ui->DefaultCreateTorrentCheckBox->setChecked(MIKSettings.value("bDefaultCreateTorrent", false).toBool());
+    ui->DefaultTorrentAnnounceLineEdit->setText(MIKSettings.value("sDefaultTorrentAnnounce", "").toString());
+    ui->DefaultTorrentPrivateCheckBox->setChecked(MIKSettings.value("bDefaultTorrentPrivate", true).toBool());
+    ui->DefaultTorrentSourceLineEdit->setText(MIKSettings.value("sDefaultTorrentSource", "").toString());
+    ui->DefaultTorrentPieceSizeComboBox->setCurrentText(MIKSettings.value("sDefaultTorrentPieceSize", "Auto").toString());
+    ui->DefaultTorrentVersionComboBox->setCurrentText(MIKSettings.value("sDefaultTorrentVersion", "v1").toString());
     ui->DefaultConvertFormatComboBox->setCurrentText(MIKSettings.value("sDefaultConvertFormat", "FLAC").toString());
     updateConvertPresetsOnFormatChange(ui->DefaultConvertFormatComboBox->currentText());
     ui->DefaultConvertPresetComboBox->setCurrentText(MIKSettings.value("sDefaultConvertPreset", "Standard").toString());
@@ -191,6 +203,17 @@ SettingsWindow::SettingsWindow(QWidget *parent) :
         }
     }
 
+    // 7-Zip check
+    tempProgramLocation = checkInstalledProgram("sDefaultSevenZipLocation", "7z");
+    if(tempProgramLocation != "") {
+        if(tempProgramLocation != "7z") {
+            ui->DefaultSevenZipLineEdit->setText(QDir::toNativeSeparators(tempProgramLocation));
+        }
+        else {
+            ui->DefaultSevenZipLineEdit->setText(QString("(7-Zip autodetected)"));
+        }
+    }
+
     updateFLACOptions();
 //    updateConversionOptions(); Necessary but updateFLACOptions also calls this so not needed for now
     updateReplaygainOptions();
@@ -261,6 +284,10 @@ void SettingsWindow::openDefaultOutputFolderChooser() {
     folderChooser(ui->DefaultOutputLineEdit);
 }
 
+void SettingsWindow::openDefaultStagingFolderChooser() {
+    folderChooser(ui->DefaultStagingLineEdit);
+}
+
 void SettingsWindow::openDefaultFLACFileChooser() {
 #if defined(Q_OS_LINUX)
     fileChooser(ui->DefaultFLACLineEdit);
@@ -365,6 +392,14 @@ void SettingsWindow::openDefaultTaggerFileChooser() {
 #endif
 }
 
+void SettingsWindow::openDefaultSevenZipFileChooser() {
+#if defined(Q_OS_LINUX)
+    fileChooser(ui->DefaultSevenZipLineEdit);
+#elif defined(Q_OS_WIN)
+    fileChooser(ui->DefaultSevenZipLineEdit, "7-Zip Binary (7z.exe)");
+#endif
+}
+
 // Runs when the user presses "Accept" and stores selected settings into the config file
 // Mostly input validation
 void SettingsWindow::settingsAccept() {
@@ -379,6 +414,10 @@ void SettingsWindow::settingsAccept() {
     if(QDir(ui->DefaultOutputLineEdit->text()).exists()) {
         MIKSettings.setValue("sDefaultOutput", QDir::toNativeSeparators(ui->DefaultOutputLineEdit->text()));
     }
+    // The staging folder is optional, so clearing it turns staging off
+    if(ui->DefaultStagingLineEdit->text() == "" || QDir(ui->DefaultStagingLineEdit->text()).exists()) {
+        MIKSettings.setValue("sDefaultStagingFolder", QDir::toNativeSeparators(ui->DefaultStagingLineEdit->text()));
+    }
 
     MIKSettings.setValue("sDefaultSyntax", ui->DefaultSyntaxComboBox->currentText());
     MIKSettings.setValue("bDefaultAutoWAVConvert", ui->DefaultAutoWAVConvertCheckBox->isChecked());
@@ -393,6 +432,15 @@ void SettingsWindow::settingsAccept() {
     MIKSettings.setValue("bDefaultCompressPNG", ui->DefaultCompressPNGCheckBox->isChecked());
     MIKSettings.setValue("bDefaultDeleteSourceFolder", ui->DefaultDeleteSourceFolderCheckBox->isChecked());
     MIKSettings.setValue("bDefaultOpenFolder", ui->DefaultOpenFolderCheckBox->isChecked());
+    MIKSettings.setValue("bDefaultTranscodeCheck", ui->DefaultTranscodeCheckCheckBox->isChecked());
+    MIKSettings.setValue("bDefaultSpectrograms", ui->DefaultSpectrogramsCheckBox->isChecked());
+    MIKSettings.setValue("bDefaultSpectrogramDetail", ui->DefaultSpectrogramDetailCheckBox->isChecked());
+    MIKSettings.setValue("bDefaultCreateTorrent", ui->DefaultCreateTorrentCheckBox->isChecked());
+    MIKSettings.setValue("sDefaultTorrentAnnounce", ui->DefaultTorrentAnnounceLineEdit->text().trimmed());
+    MIKSettings.setValue("bDefaultTorrentPrivate", ui->DefaultTorrentPrivateCheckBox->isChecked());
+    MIKSettings.setValue("sDefaultTorrentSource", ui->DefaultTorrentSourceLineEdit->text().trimmed());
+    MIKSettings.setValue("sDefaultTorrentPieceSize", ui->DefaultTorrentPieceSizeComboBox->currentText());
+    MIKSettings.setValue("sDefaultTorrentVersion", ui->DefaultTorrentVersionComboBox->currentText());
     MIKSettings.setValue("sDefaultConvertFormat", ui->DefaultConvertFormatComboBox->currentText());
     MIKSettings.setValue("sDefaultConvertPreset", ui->DefaultConvertPresetComboBox->currentText());
 
@@ -436,6 +484,9 @@ void SettingsWindow::settingsAccept() {
     if(ui->DefaultTaggerLineEdit->text() == "" || QFileInfo(ui->DefaultTaggerLineEdit->text()).isFile()) {
         MIKSettings.setValue("sDefaultTaggerLocation", QDir::toNativeSeparators(ui->DefaultTaggerLineEdit->text()));
     }
+    if(ui->DefaultSevenZipLineEdit->text() == "" || QFileInfo(ui->DefaultSevenZipLineEdit->text()).isFile()) {
+        MIKSettings.setValue("sDefaultSevenZipLocation", QDir::toNativeSeparators(ui->DefaultSevenZipLineEdit->text()));
+    }
     this->close();
 }
 
@@ -509,10 +560,27 @@ void SettingsWindow::updateFLACOptions() {
             ui->DefaultAutoWAVConvertCheckBox->setChecked(MIKSettings.value("bDefaultAutoWAVConvert", true).toBool());
             ui->DefaultAutoWAVConvertCheckBox->setEnabled(true);
         }
+        // The transcode check and spectrograms decode through FLAC as well
+        if(!ui->DefaultTranscodeCheckCheckBox->isEnabled()) {
+            ui->DefaultTranscodeCheckCheckBox->setChecked(MIKSettings.value("bDefaultTranscodeCheck", false).toBool());
+            ui->DefaultTranscodeCheckCheckBox->setEnabled(true);
+        }
+        if(!ui->DefaultSpectrogramsCheckBox->isEnabled()) {
+            ui->DefaultSpectrogramsCheckBox->setChecked(MIKSettings.value("bDefaultSpectrograms", false).toBool());
+            ui->DefaultSpectrogramsCheckBox->setEnabled(true);
+            ui->DefaultSpectrogramDetailCheckBox->setChecked(MIKSettings.value("bDefaultSpectrogramDetail", false).toBool());
+            ui->DefaultSpectrogramDetailCheckBox->setEnabled(true);
+        }
     }
     else {
         ui->DefaultAutoWAVConvertCheckBox->setEnabled(false);
         ui->DefaultAutoWAVConvertCheckBox->setChecked(false);
+        ui->DefaultTranscodeCheckCheckBox->setEnabled(false);
+        ui->DefaultTranscodeCheckCheckBox->setChecked(false);
+        ui->DefaultSpectrogramsCheckBox->setEnabled(false);
+        ui->DefaultSpectrogramsCheckBox->setChecked(false);
+        ui->DefaultSpectrogramDetailCheckBox->setEnabled(false);
+        ui->DefaultSpectrogramDetailCheckBox->setChecked(false);
     }
 
     updateConversionOptions();
@@ -633,12 +701,10 @@ void SettingsWindow::updateConvertPresetsOnFormatChange(const QString &format) {
     // FLAC
     if(format == "FLAC") {
         ui->DefaultConvertPresetComboBox->addItem("Standard");
-
-        if(checkInstalledProgram(ui->DefaultSoXLineEdit->text(), "sox", false) != "") {
-            ui->DefaultConvertPresetComboBox->addItem("Force 16-bit");
-            ui->DefaultConvertPresetComboBox->addItem("Force 44.1kHz/48kHz");
-            ui->DefaultConvertPresetComboBox->addItem("Force 16-bit and 44.1kHz/48kHz");
-        }
+        ui->DefaultConvertPresetComboBox->addItem("Force 16-bit");
+        ui->DefaultConvertPresetComboBox->addItem("Force 44.1kHz/48kHz");
+        ui->DefaultConvertPresetComboBox->addItem("Force 16-bit and 44.1kHz/48kHz");
+        ui->DefaultConvertPresetComboBox->addItem("Remove fake hi-res");
     }
 
     // Opus
@@ -32,6 +32,7 @@ private slots:
     void openDefaultInputFolderChooser();
     void openDefaultTempFolderChooser();
     void openDefaultOutputFolderChooser();
+    void openDefaultStagingFolderChooser();
     void openDefaultFLACFileChooser();
     void openDefaultLAMEFileChooser();
     void openDefaultOpusFileChooser();
@@ -43,6 +44,7 @@ private slots:
     void openDefaultAlbumArtFetcherFileChooser();
     void openDefaultSpectrogramAnalysisFileChooser();
     void openDefaultTaggerFileChooser();
+    void openDefaultSevenZipFileChooser();
     void settingsAccept();
     void updateConversionOptions();
     void updateFLACOptions();
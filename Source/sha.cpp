@@ -0,0 +1,207 @@
+#include "sha.h"
+#include "cpufeatures.h"
+
+#include <cstring>
+
+// One-shot SHA-1 and SHA-256 for hashing torrent pieces, which are hashed by the thousand from several threads at once
+// The SHA-NI kernels only compress whole 64-byte blocks; the padding is done here. Other CPUs go through QCryptographicHash
+
+#if defined(MIK_X86_KERNELS)
+static const quint32 sha1InitialState[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+static const quint32 sha256InitialState[8] = {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+
+alignas(16) static const quint32 sha256RoundConstants[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+// Four SHA-1 rounds. The round function has to be an immediate, so it's picked here rather than passed through
+__attribute__((target("sha,sse4.1")))
+static inline __m128i sha1Rounds(__m128i abcd, __m128i e, int group) {
+    switch(group / 5) {
+    case 0:
+        return _mm_sha1rnds4_epu32(abcd, e, 0);
+    case 1:
+        return _mm_sha1rnds4_epu32(abcd, e, 1);
+    case 2:
+        return _mm_sha1rnds4_epu32(abcd, e, 2);
+    default:
+        return _mm_sha1rnds4_epu32(abcd, e, 3);
+    }
+}
+
+// Compresses blockCount 64-byte blocks into a SHA-1 state with the SHA extensions
+__attribute__((target("sha,sse4.1")))
+static void sha1BlocksSHANI(quint32 *state, const unsigned char *blocks, qint64 blockCount) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607LL, 0x08090A0B0C0D0E0FLL);
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0x1B);
+    __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+    for(qint64 block = 0; block < blockCount; block++) {
+        const unsigned char *data = blocks + block * 64;
+        __m128i abcdSaved = abcd;
+        __m128i e0Saved = e0;
+        __m128i e1;
+
+        // Message schedule, four words per vector; each vector is reused for every fourth group of rounds
+        __m128i message[4];
+        for(int i = 0; i < 4; i++) {
+            message[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16 * i)), byteSwap);
+        }
+
+        // Rounds 0-3
+        e0 = _mm_add_epi32(e0, message[0]);
+        e1 = abcd;
+        abcd = sha1Rounds(abcd, e0, 0);
+
+        // Rounds 4-11, while the schedule gets going
+        e1 = _mm_sha1nexte_epu32(e1, message[1]);
+        e0 = abcd;
+        abcd = sha1Rounds(abcd, e1, 1);
+        message[0] = _mm_sha1msg1_epu32(message[0], message[1]);
+
+        e0 = _mm_sha1nexte_epu32(e0, message[2]);
+        e1 = abcd;
+        abcd = sha1Rounds(abcd, e0, 2);
+        message[1] = _mm_sha1msg1_epu32(message[1], message[2]);
+        message[0] = _mm_xor_si128(message[0], message[2]);
+
+        // Rounds 12-79. Schedule vectors computed past round 79 are never used
+        for(int group = 3; group < 20; group++) {
+            __m128i current = message[group % 4];
+            if(group % 2 == 1) {
+                e1 = _mm_sha1nexte_epu32(e1, current);
+                e0 = abcd;
+            }
+            else {
+                e0 = _mm_sha1nexte_epu32(e0, current);
+                e1 = abcd;
+            }
+            message[(group + 1) % 4] = _mm_sha1msg2_epu32(message[(group + 1) % 4], current);
+            abcd = sha1Rounds(abcd, group % 2 == 1 ? e1 : e0, group);
+            message[(group + 3) % 4] = _mm_sha1msg1_epu32(message[(group + 3) % 4], current);
+            message[(group + 2) % 4] = _mm_xor_si128(message[(group + 2) % 4], current);
+        }
+
+        e0 = _mm_sha1nexte_epu32(e0, e0Saved);
+        abcd = _mm_add_epi32(abcd, abcdSaved);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = static_cast<quint32>(_mm_extract_epi32(e0, 3));
+}
+
+// Compresses blockCount 64-byte blocks into a SHA-256 state with the SHA extensions
+__attribute__((target("sha,sse4.1")))
+static void sha256BlocksSHANI(quint32 *state, const unsigned char *blocks, qint64 blockCount) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0C0D0E0F08090A0BLL, 0x0405060700010203LL);
+
+    // The instructions keep the state as ABEF and CDGH
+    __m128i cdab = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state)), 0xB1);
+    __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(state + 4)), 0x1B);
+    __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+    for(qint64 block = 0; block < blockCount; block++) {
+        const unsigned char *data = blocks + block * 64;
+        __m128i abefSaved = abef;
+        __m128i cdghSaved = cdgh;
+
+        __m128i message[4];
+        for(int group = 0; group < 16; group++) {
+            if(group < 4) {
+                message[group] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16 * group)), byteSwap);
+            }
+            __m128i current = message[group % 4];
+
+            __m128i roundInput = _mm_add_epi32(current, _mm_load_si128(reinterpret_cast<const __m128i *>(sha256RoundConstants + 4 * group)));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, roundInput);
+
+            // Finish the schedule vector for four groups later, from this one and the one before it
+            if(group >= 3) {
+                __m128i &next = message[(group + 1) % 4];
+                next = _mm_add_epi32(next, _mm_alignr_epi8(current, message[(group + 3) % 4], 4));
+                next = _mm_sha256msg2_epu32(next, current);
+            }
+
+            roundInput = _mm_shuffle_epi32(roundInput, 0x0E);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, roundInput);
+
+            if(group >= 1) {
+                message[(group + 3) % 4] = _mm_sha256msg1_epu32(message[(group + 3) % 4], current);
+            }
+        }
+
+        abef = _mm_add_epi32(abef, abefSaved);
+        cdgh = _mm_add_epi32(cdgh, cdghSaved);
+    }
+
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
+
+// Runs a whole message through a block function: the full blocks straight from data, then the padded tail (one or two blocks)
+// Both SHA-1 and SHA-256 pad the same way and store the state big-endian
+static void hashMessage(void (*compressBlocks)(quint32 *, const unsigned char *, qint64), const quint32 *initialState, int stateWords, const char *data, qint64 length, char *digest) {
+    quint32 state[8];
+    memcpy(state, initialState, stateWords * sizeof(quint32));
+
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+    qint64 fullBlocks = length / 64;
+    compressBlocks(state, bytes, fullBlocks);
+
+    unsigned char tail[128] = {};
+    int tailLength = static_cast<int>(length - fullBlocks * 64);
+    memcpy(tail, bytes + fullBlocks * 64, tailLength);
+    tail[tailLength] = 0x80;
+    int tailBlocks = tailLength < 56 ? 1 : 2;
+    quint64 bitLength = static_cast<quint64>(length) * 8;
+    for(int i = 0; i < 8; i++) {
+        tail[tailBlocks * 64 - 1 - i] = static_cast<unsigned char>(bitLength >> (8 * i));
+    }
+    compressBlocks(state, tail, tailBlocks);
+
+    for(int i = 0; i < stateWords; i++) {
+        digest[4 * i] = static_cast<char>(state[i] >> 24);
+        digest[4 * i + 1] = static_cast<char>(state[i] >> 16);
+        digest[4 * i + 2] = static_cast<char>(state[i] >> 8);
+        digest[4 * i + 3] = static_cast<char>(state[i]);
+    }
+}
+#endif
+
+// Writes the SHA-1 of length bytes of data to digest (SHA1_DIGEST_SIZE bytes)
+void sha1Digest(const char *data, qint64 length, char *digest) {
+#if defined(MIK_X86_KERNELS)
+    if(cpuSupportsSHA()) {
+        hashMessage(sha1BlocksSHANI, sha1InitialState, 5, data, length, digest);
+        return;
+    }
+#endif
+    QCryptographicHash pieceHash(QCryptographicHash::Sha1);
+    pieceHash.addData(data, static_cast<int>(length));
+    memcpy(digest, pieceHash.result().constData(), SHA1_DIGEST_SIZE);
+}
+
+// Writes the SHA-256 of length bytes of data to digest (SHA256_DIGEST_SIZE bytes)
+void sha256Digest(const char *data, qint64 length, char *digest) {
+#if defined(MIK_X86_KERNELS)
+    if(cpuSupportsSHA()) {
+        hashMessage(sha256BlocksSHANI, sha256InitialState, 8, data, length, digest);
+        return;
+    }
+#endif
+    QCryptographicHash blockHash(QCryptographicHash::Sha256);
+    blockHash.addData(data, static_cast<int>(length));
+    memcpy(digest, blockHash.result().constData(), SHA256_DIGEST_SIZE);
+}
@@ -0,0 +1,15 @@
+#ifndef SHA_H
+#define SHA_H
+
+#include <helper.h>
+
+#include <QCryptographicHash>
+
+// Digest sizes in bytes
+#define SHA1_DIGEST_SIZE 20
+#define SHA256_DIGEST_SIZE 32
+
+void sha1Digest(const char *data, qint64 length, char *digest);
+void sha256Digest(const char *data, qint64 length, char *digest);
+
+#endif // SHA_H
@@ -0,0 +1,314 @@
+#include "spectrogram.h"
+
+// The FFT only needs enough bins to give every pixel row its own frequency (4 bins per row at 44.1kHz)
+static const int spectrogramFFTSize = SPECTROGRAM_PLOT_HEIGHT * 4;
+
+// Lowest level shown; anything quieter is drawn black
+static const double spectrogramFloor = -120.0;
+
+// Margins around the plot for the title and axis labels
+static const int spectrogramMarginLeft = 60;
+static const int spectrogramMarginRight = 20;
+static const int spectrogramMarginTop = 30;
+static const int spectrogramMarginBottom = 30;
+
+// One image being built up while the audio streams past
+// Each pixel column averages every FFT whose center falls inside its slice of time, so memory only depends on the image size
+struct spectrogramCanvas_t {
+    qint64 startFrame;
+    qint64 endFrame;
+    // Frame at which the next FFT's window ends
+    qint64 nextFFTEnd;
+    qint64 hop;
+    // Summed power per column and row, column after column
+    std::vector<float> columnPower;
+    std::vector<int> columnCounts;
+};
+
+// Sets up a canvas for the frames between startFrame and endFrame
+static void createSpectrogramCanvas(qint64 startFrame, qint64 endFrame, spectrogramCanvas_t *canvas) {
+    canvas->startFrame = startFrame;
+    canvas->endFrame = endFrame;
+
+    // At least one FFT per column, but never more than 50% overlap for long tracks (every sample still gets seen)
+    canvas->hop = qBound(static_cast<qint64>(1), (endFrame - startFrame) / SPECTROGRAM_PLOT_WIDTH, static_cast<qint64>(spectrogramFFTSize / 2));
+
+    // The first window is centered on startFrame
+    canvas->nextFFTEnd = startFrame + spectrogramFFTSize / 2;
+
+    canvas->columnPower.assign(SPECTROGRAM_PLOT_WIDTH * SPECTROGRAM_PLOT_HEIGHT, 0.0f);
+    canvas->columnCounts.assign(SPECTROGRAM_PLOT_WIDTH, 0);
+}
+
+// Adds one FFT's row powers into the column its center falls in
+static void addToSpectrogramCanvas(spectrogramCanvas_t *canvas, qint64 centerFrame, const std::vector<float> &rowPower) {
+    if(centerFrame < canvas->startFrame || centerFrame >= canvas->endFrame) {
+        return;
+    }
+
+    int column = static_cast<int>((centerFrame - canvas->startFrame) * SPECTROGRAM_PLOT_WIDTH / (canvas->endFrame - canvas->startFrame));
+    float *columnData = canvas->columnPower.data() + column * SPECTROGRAM_PLOT_HEIGHT;
+    for(int row = 0; row < SPECTROGRAM_PLOT_HEIGHT; row++) {
+        columnData[row] += rowPower[row];
+    }
+    canvas->columnCounts[column]++;
+}
+
+// Maps 0.0-1.0 onto a Spek-like palette (black, blue, purple, red, orange, yellow, white)
+static QRgb spectrogramColor(double level) {
+    static const double stops[][4] = {
+        {0.00,   0,   0,   0},
+        {0.15,   0,   0,  96},
+        {0.35, 112,   0, 160},
+        {0.55, 208,   0,  64},
+        {0.75, 255, 128,   0},
+        {0.90, 255, 224,   0},
+        {1.00, 255, 255, 255}
+    };
+
+    level = qBound(0.0, level, 1.0);
+
+    int stop = 1;
+    while(stop < 6 && level > stops[stop][0]) {
+        stop++;
+    }
+
+    double position = (level - stops[stop - 1][0]) / (stops[stop][0] - stops[stop - 1][0]);
+    return qRgb(qRound(stops[stop - 1][1] + position * (stops[stop][1] - stops[stop - 1][1])),
+                qRound(stops[stop - 1][2] + position * (stops[stop][2] - stops[stop - 1][2])),
+                qRound(stops[stop - 1][3] + position * (stops[stop][3] - stops[stop - 1][3])));
+}
+
+// Picks a "nice" tick spacing that fits at most maxTicks ticks across range
+static double spectrogramTickStep(double range, int maxTicks, const QList<double> &niceSteps) {
+    foreach(double step, niceSteps) {
+        if(range / step <= maxTicks) {
+            return step;
+        }
+    }
+    return niceSteps.last();
+}
+
+// Turns a finished canvas into a labelled PNG
+static bool saveSpectrogramCanvas(const spectrogramCanvas_t &canvas, int sampleRate, QString title, QString outputPNG) {
+    QImage spectrogramImage(spectrogramMarginLeft + SPECTROGRAM_PLOT_WIDTH + spectrogramMarginRight,
+                            spectrogramMarginTop + SPECTROGRAM_PLOT_HEIGHT + spectrogramMarginBottom,
+                            QImage::Format_RGB32);
+    spectrogramImage.fill(Qt::black);
+
+    // Full-scale sine through a Hann window peaks at (size/4)^2, which is used as 0dBFS
+    double fullScale = std::pow(spectrogramFFTSize / 4.0, 2.0);
+
+    // Plot. Row 0 is the top of the image, which is the Nyquist frequency
+    for(int column = 0; column < SPECTROGRAM_PLOT_WIDTH; column++) {
+        if(canvas.columnCounts[column] == 0) {
+            continue;
+        }
+
+        const float *columnData = canvas.columnPower.data() + column * SPECTROGRAM_PLOT_HEIGHT;
+        for(int row = 0; row < SPECTROGRAM_PLOT_HEIGHT; row++) {
+            double power = columnData[SPECTROGRAM_PLOT_HEIGHT - 1 - row] / canvas.columnCounts[column];
+            double level = 10.0 * std::log10(power / fullScale + 1e-20);
+            spectrogramImage.setPixel(spectrogramMarginLeft + column, spectrogramMarginTop + row, spectrogramColor(1.0 - level / spectrogramFloor));
+        }
+    }
+
+    QPainter painter(&spectrogramImage);
+    painter.setPen(Qt::white);
+    QFont labelFont = painter.font();
+    labelFont.setPointSize(8);
+    painter.setFont(labelFont);
+
+    // Title
+    painter.drawText(QRect(spectrogramMarginLeft, 0, SPECTROGRAM_PLOT_WIDTH, spectrogramMarginTop), Qt::AlignLeft | Qt::AlignVCenter, title);
+
+    // Frequency axis
+    double nyquistKHz = sampleRate / 2000.0;
+    double frequencyStep = spectrogramTickStep(nyquistKHz, 12, {1.0, 2.0, 5.0, 10.0, 20.0, 50.0});
+    for(double frequency = 0.0; frequency <= nyquistKHz; frequency += frequencyStep) {
+        int y = spectrogramMarginTop + SPECTROGRAM_PLOT_HEIGHT - 1 - qRound(frequency / nyquistKHz * (SPECTROGRAM_PLOT_HEIGHT - 1));
+        painter.drawLine(spectrogramMarginLeft - 5, y, spectrogramMarginLeft - 1, y);
+        painter.drawText(QRect(0, y - 8, spectrogramMarginLeft - 8, 16), Qt::AlignRight | Qt::AlignVCenter, QString::number(frequency) + " kHz");
+    }
+
+    // Time axis, in seconds from the start of the track
+    double startSeconds = static_cast<double>(canvas.startFrame) / sampleRate;
+    double lengthSeconds = static_cast<double>(canvas.endFrame - canvas.startFrame) / sampleRate;
+    double timeStep = spectrogramTickStep(lengthSeconds, 10, {0.5, 1.0, 2.0, 5.0, 10.0, 15.0, 30.0, 60.0, 120.0, 300.0, 600.0, 900.0, 1800.0});
+    for(double seconds = std::ceil(startSeconds / timeStep) * timeStep; seconds <= startSeconds + lengthSeconds; seconds += timeStep) {
+        int x = spectrogramMarginLeft + qRound((seconds - startSeconds) / lengthSeconds * (SPECTROGRAM_PLOT_WIDTH - 1));
+        int y = spectrogramMarginTop + SPECTROGRAM_PLOT_HEIGHT;
+        painter.drawLine(x, y, x, y + 4);
+
+        // m:ss, with tenths for sub-second steps
+        int wholeSeconds = static_cast<int>(seconds);
+        QString timeLabel = QString("%1:%2").arg(wholeSeconds / 60).arg(wholeSeconds % 60, 2, 10, QChar('0'));
+        if(timeStep < 1.0) {
+            timeLabel += "." + QString::number(qRound((seconds - wholeSeconds) * 10.0) % 10);
+        }
+        painter.drawText(QRect(x - 40, y + 5, 80, spectrogramMarginBottom - 5), Qt::AlignHCenter | Qt::AlignTop, timeLabel);
+    }
+
+    painter.end();
+
+    return spectrogramImage.save(outputPNG, "PNG");
+}
+
+// Renders a spectrogram PNG of a whole FLAC, plus an optional zoomed detail of the middle few seconds, in a single decode pass
+// Audio is streamed through a short ring buffer, so memory stays the same no matter how long the track is
+bool renderSpectrograms(QString inputFLAC, QString outputPNG, QString detailPNG) {
+    audioFormat_t audioFormat;
+    if(!readAudioFormat(inputFLAC, &audioFormat) || audioFormat.totalFrames <= 0 || audioFormat.channels <= 0) {
+        return false;
+    }
+
+    fftPlan_t plan;
+    createFFTPlan(spectrogramFFTSize, &plan);
+    fftWorkspace_t workspace;
+    createFFTWorkspace(plan, &workspace);
+    int bins = spectrogramFFTSize / 2 + 1;
+
+    // Full track, plus the detail centered on the middle of the track if requested
+    QList<spectrogramCanvas_t> canvases;
+    spectrogramCanvas_t fullCanvas;
+    createSpectrogramCanvas(0, audioFormat.totalFrames, &fullCanvas);
+    canvases.append(fullCanvas);
+
+    if(detailPNG != "") {
+        qint64 detailFrames = qMin(static_cast<qint64>(SPECTROGRAM_DETAIL_SECONDS) * audioFormat.sampleRate, audioFormat.totalFrames);
+        qint64 detailStart = (audioFormat.totalFrames - detailFrames) / 2;
+        spectrogramCanvas_t detailCanvas;
+        createSpectrogramCanvas(detailStart, detailStart + detailFrames, &detailCanvas);
+        canvases.append(detailCanvas);
+    }
+
+    // Ring buffer holding the last spectrogramFFTSize frames of every channel
+    int channels = audioFormat.channels;
+    std::vector<std::vector<float>> ringBuffers(channels, std::vector<float>(spectrogramFFTSize, 0.0f));
+    int ringPosition = 0;
+    qint64 framePosition = 0;
+
+    std::vector<float> frameSamples(spectrogramFFTSize);
+    std::vector<float> powerSpectrum(bins);
+    std::vector<float> rowPower(SPECTROGRAM_PLOT_HEIGHT);
+
+    // Runs every FFT that's due now that framePosition frames have been buffered
+    auto runDueFFTs = [&]() {
+        bool rowPowerReady = false;
+
+        for(int i = 0; i < canvases.count(); i++) {
+            spectrogramCanvas_t &canvas = canvases[i];
+            if(canvas.nextFFTEnd != framePosition) {
+                continue;
+            }
+
+            // Canvases share an FFT when they're due at the same frame
+            if(!rowPowerReady) {
+                std::fill(rowPower.begin(), rowPower.end(), 0.0f);
+
+                for(int channel = 0; channel < channels; channel++) {
+                    // Unroll the ring into a contiguous frame, oldest sample first
+                    const std::vector<float> &ringBuffer = ringBuffers[channel];
+                    std::copy(ringBuffer.begin() + ringPosition, ringBuffer.end(), frameSamples.begin());
+                    std::copy(ringBuffer.begin(), ringBuffer.begin() + ringPosition, frameSamples.begin() + (spectrogramFFTSize - ringPosition));
+
+                    computePowerSpectrum(plan, &workspace, frameSamples.data(), powerSpectrum.data());
+
+                    // Each row keeps its loudest bin so thin lines don't disappear, averaged across channels
+                    for(int row = 0; row < SPECTROGRAM_PLOT_HEIGHT; row++) {
+                        int firstBin = row * (bins - 1) / SPECTROGRAM_PLOT_HEIGHT;
+                        int lastBin = (row + 1) * (bins - 1) / SPECTROGRAM_PLOT_HEIGHT;
+                        float loudestBin = 0.0f;
+                        for(int bin = firstBin; bin <= lastBin; bin++) {
+                            loudestBin = qMax(loudestBin, powerSpectrum[bin]);
+                        }
+                        rowPower[row] += loudestBin / channels;
+                    }
+                }
+
+                rowPowerReady = true;
+            }
+
+            addToSpectrogramCanvas(&canvas, framePosition - spectrogramFFTSize / 2, rowPower);
+            canvas.nextFFTEnd += canvas.hop;
+        }
+    };
+
+    QVector<float> floatSamples;
+
+    bool decodeSucceeded = decodeFLACStream(inputFLAC, &audioFormat, [&](const QByteArray &rawPCM) {
+        convertPCMToFloat(rawPCM, audioFormat.bitsPerSample, &floatSamples);
+
+        int frames = floatSamples.size() / channels;
+        for(int frame = 0; frame < frames; frame++) {
+            for(int channel = 0; channel < channels; channel++) {
+                ringBuffers[channel][ringPosition] = floatSamples[frame * channels + channel];
+            }
+            ringPosition = (ringPosition + 1) % spectrogramFFTSize;
+            framePosition++;
+
+            runDueFFTs();
+        }
+
+        return true;
+    });
+
+    if(!decodeSucceeded) {
+        return false;
+    }
+
+    // Pad with silence so the windows centered on the last frames still get run
+    for(int frame = 0; frame < spectrogramFFTSize / 2; frame++) {
+        for(int channel = 0; channel < channels; channel++) {
+            ringBuffers[channel][ringPosition] = 0.0f;
+        }
+        ringPosition = (ringPosition + 1) % spectrogramFFTSize;
+        framePosition++;
+
+        runDueFFTs();
+    }
+
+    QString title = QFileInfo(inputFLAC).fileName() + QString("  |  %1 Hz, %2-bit, %3 channel(s)").arg(audioFormat.sampleRate).arg(audioFormat.bitsPerSample).arg(channels);
+
+    bool saveSucceeded = saveSpectrogramCanvas(canvases[0], audioFormat.sampleRate, title, outputPNG);
+    if(detailPNG != "") {
+        saveSucceeded = saveSpectrogramCanvas(canvases[1], audioFormat.sampleRate, title + "  |  detail", detailPNG) && saveSucceeded;
+    }
+
+    return saveSucceeded;
+}
+
+// Renders spectrograms for every FLAC of an album in parallel, saving them into outputDir as "<track> spectrogram.png"
+// Returns the list of images that were written
+QStringList renderAlbumSpectrograms(QStringList inputFLACs, QDir outputDir, bool detailEnabled) {
+    QStringList outputPNGs;
+    QStringList detailPNGs;
+
+    foreach(QString currentFLAC, inputFLACs) {
+        QString baseName = outputDir.path() + "/" + QFileInfo(currentFLAC).completeBaseName();
+        outputPNGs += baseName + " spectrogram.png";
+        detailPNGs += detailEnabled ? baseName + " spectrogram detail.png" : "";
+    }
+
+    // Initialize a pool for parallel threads. Default number of parallel threads is equal to processor's logical core count
+    QThreadPool spectrogramPool;
+    // QList that will hold the QFuture of every thread we launch, allowing us to launch many threads and check their results later
+    QList<QFuture<bool>> futureList;
+
+    for(int i = 0; i < inputFLACs.count(); i++) {
+        futureList.append(QtConcurrent::run(&spectrogramPool, renderSpectrograms, inputFLACs[i], outputPNGs[i], detailPNGs[i]));
+    }
+    spectrogramPool.waitForDone();
+
+    QStringList writtenPNGs;
+    for(int i = 0; i < inputFLACs.count(); i++) {
+        if(futureList[i].result()) {
+            writtenPNGs += outputPNGs[i];
+            if(detailEnabled) {
+                writtenPNGs += detailPNGs[i];
+            }
+        }
+    }
+
+    return writtenPNGs;
+}
@@ -0,0 +1,21 @@
+#ifndef SPECTROGRAM_H
+#define SPECTROGRAM_H
+
+#include <helper.h>
+#include <fft.h>
+
+#include <QFileInfo>
+#include <QImage>
+#include <QPainter>
+#include <QtMath>
+
+// Size of the plotted area of every spectrogram, in pixels. Labels and margins are added around it
+#define SPECTROGRAM_PLOT_WIDTH 1000
+#define SPECTROGRAM_PLOT_HEIGHT 512
+// Length of the zoomed detail spectrogram, in seconds
+#define SPECTROGRAM_DETAIL_SECONDS 5
+
+bool renderSpectrograms(QString inputFLAC, QString outputPNG, QString detailPNG = "");
+QStringList renderAlbumSpectrograms(QStringList inputFLACs, QDir outputDir, bool detailEnabled);
+
+#endif // SPECTROGRAM_H
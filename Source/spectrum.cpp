@@ -0,0 +1,266 @@
+#include "spectrum.h"
+
+// Known cut-offs left behind by common lossy encodes (see the Spek section of the README)
+struct lossySignature_t {
+    double cutoffFrequency;
+    const char *sourceName;
+    // Whether this encode also drops the 16kHz+ scalefactor band, leaving a shelf there
+    bool expectsShelf;
+};
+
+static const lossySignature_t lossySignatures[] = {
+    {20500.0, "MP3 320kbps CBR", true},
+    {20000.0, "MP3 256kbps CBR", true},
+    {19500.0, "MP3 245kbps VBR (V0)", true},
+    {19000.0, "MP3 192kbps CBR", true},
+    {18500.0, "MP3 190kbps VBR (V2)", true},
+    {16000.0, "MP3 128kbps CBR", false}
+};
+
+// How far (Hz) a measured cut-off may be from a signature's and still match it
+static const double signatureTolerance = 350.0;
+
+// Decodes a FLAC and builds its long-term average spectrum, then checks it for the cut-offs and shelves lossy encoders leave behind
+// Only one FLAC is handled per call so callers can run one call per track in parallel threads
+bool analyzeSpectrum(QString inputFLAC, spectrumAnalysis_t *analysis) {
+    analysis->inputFLAC = inputFLAC;
+    analysis->sampleRate = 0;
+    analysis->averageSpectrum.clear();
+    analysis->cutoffFrequency = 0.0;
+    analysis->shelfAt16k = false;
+    analysis->suspectedSource = "";
+    analysis->confidence = 0.0;
+    analysis->likelyTranscode = false;
+
+    audioFormat_t audioFormat;
+
+    // Created once the format is known (on the first chunk)
+    fftPlan_t plan;
+    plan.size = 0;
+    fftWorkspace_t workspace;
+    int bins = 0;
+    int hop = 0;
+
+    // Deinterleaved samples waiting to fill a full FFT frame, one buffer per channel
+    std::vector<std::vector<float>> channelBuffers;
+    std::vector<float> powerSpectrum;
+    std::vector<double> accumulatedSpectrum;
+    qint64 accumulatedFrames = 0;
+
+    QVector<float> floatSamples;
+
+    bool decodeSucceeded = decodeFLACStream(inputFLAC, &audioFormat, [&](const QByteArray &rawPCM) {
+        if(plan.size == 0) {
+            // Aim for roughly 10Hz per bin, which is enough to place a cut-off within a few bins at any sample rate
+            int fftSize = 4;
+            while(fftSize < audioFormat.sampleRate / 12) {
+                fftSize *= 2;
+            }
+
+            createFFTPlan(fftSize, &plan);
+            createFFTWorkspace(plan, &workspace);
+            bins = fftSize / 2 + 1;
+            // 50% overlap, as the Hann window nearly silences the edges of each frame
+            hop = fftSize / 2;
+
+            channelBuffers.resize(audioFormat.channels);
+            powerSpectrum.resize(bins);
+            accumulatedSpectrum.assign(bins, 0.0);
+        }
+
+        convertPCMToFloat(rawPCM, audioFormat.bitsPerSample, &floatSamples);
+
+        // Split the interleaved samples into per-channel buffers
+        int channels = audioFormat.channels;
+        int frames = floatSamples.size() / channels;
+        for(int channel = 0; channel < channels; channel++) {
+            std::vector<float> &channelBuffer = channelBuffers[channel];
+            size_t oldSize = channelBuffer.size();
+            channelBuffer.resize(oldSize + frames);
+            for(int frame = 0; frame < frames; frame++) {
+                channelBuffer[oldSize + frame] = floatSamples[frame * channels + channel];
+            }
+        }
+
+        // Transform every full frame that's waiting
+        while(static_cast<int>(channelBuffers[0].size()) >= plan.size) {
+            for(int channel = 0; channel < channels; channel++) {
+                const float *frameData = channelBuffers[channel].data();
+
+                // Skip (near) digital silence, otherwise quiet intros and gaps drag the average towards the noise floor
+                double energy = 0.0;
+                for(int i = 0; i < plan.size; i++) {
+                    energy += frameData[i] * frameData[i];
+                }
+                if(energy / plan.size < 1e-9) {
+                    continue;
+                }
+
+                computePowerSpectrum(plan, &workspace, frameData, powerSpectrum.data());
+                accumulateSpectrum(powerSpectrum.data(), accumulatedSpectrum.data(), bins);
+                accumulatedFrames++;
+            }
+
+            for(int channel = 0; channel < channels; channel++) {
+                channelBuffers[channel].erase(channelBuffers[channel].begin(), channelBuffers[channel].begin() + hop);
+            }
+        }
+
+        return true;
+    });
+
+    if(!decodeSucceeded || plan.size == 0) {
+        return false;
+    }
+
+    analysis->sampleRate = audioFormat.sampleRate;
+    analysis->cutoffFrequency = audioFormat.sampleRate / 2.0;
+
+    // A completely silent track has nothing to judge
+    if(accumulatedFrames == 0) {
+        return true;
+    }
+
+    // Average and convert to dB. The small offset keeps empty bins finite
+    analysis->averageSpectrum.resize(bins);
+    for(int k = 0; k < bins; k++) {
+        analysis->averageSpectrum[k] = 10.0 * std::log10(accumulatedSpectrum[k] / accumulatedFrames + 1e-20);
+    }
+
+    detectLossySignature(analysis);
+
+    return true;
+}
+
+// Looks for a high-frequency cliff and a 16kHz shelf in an analysis' average spectrum, then scores how much it looks like a lossy encode
+void detectLossySignature(spectrumAnalysis_t *analysis) {
+    int bins = analysis->averageSpectrum.size();
+    double nyquist = analysis->sampleRate / 2.0;
+
+    if(bins < 2 || nyquist <= 0.0) {
+        return;
+    }
+
+    double binWidth = nyquist / (bins - 1);
+
+    // Prefix sums of the spectrum, so the mean level of any band is a single subtraction
+    QVector<double> prefixSum(bins + 1, 0.0);
+    for(int k = 0; k < bins; k++) {
+        prefixSum[k + 1] = prefixSum[k] + analysis->averageSpectrum[k];
+    }
+
+    // Mean level in dB between two frequencies (clamped to the spectrum)
+    auto bandMean = [&](double lowFrequency, double highFrequency) {
+        int lowBin = qBound(0, static_cast<int>(lowFrequency / binWidth), bins - 1);
+        int highBin = qBound(lowBin + 1, static_cast<int>(highFrequency / binWidth), bins);
+        return (prefixSum[highBin] - prefixSum[lowBin]) / (highBin - lowBin);
+    };
+
+    // Lossy encoders low-pass everything above their cut-off, which shows up as a sudden drop to the noise floor
+    // Compare the level just below each candidate frequency to the level just above it, and keep the steepest drop
+    // Anything under 10kHz isn't considered; that's well below any real encoder's cut-off
+    double steepestDrop = 0.0;
+    double steepestFrequency = nyquist;
+    for(double candidate = 10000.0; candidate <= nyquist - 600.0; candidate += binWidth) {
+        double below = bandMean(candidate - 1500.0, candidate - 300.0);
+        double above = bandMean(candidate + 300.0, qMin(candidate + 1500.0, nyquist - 100.0));
+        if(below - above > steepestDrop) {
+            steepestDrop = below - above;
+            steepestFrequency = candidate;
+        }
+    }
+
+    // Under 20dB is a natural roll-off, not a filter
+    if(steepestDrop < 20.0) {
+        return;
+    }
+
+    // Narrow the cut-off down to the last bin that still sits near the passband level
+    double passbandLevel = bandMean(steepestFrequency - 1500.0, steepestFrequency - 300.0);
+    double cutoffFrequency = steepestFrequency - 300.0;
+    for(double frequency = steepestFrequency - 300.0; frequency <= qMin(steepestFrequency + 300.0, nyquist); frequency += binWidth) {
+        if(bandMean(frequency, frequency + binWidth) >= passbandLevel - 10.0) {
+            cutoffFrequency = frequency;
+        }
+    }
+
+    // Every lossless master gets low-passed right below Nyquist by its ADC/resampler, so a cliff there means nothing
+    // Cliffs above 21kHz in hi-res files are normal for upsampled CD masters, which isn't a lossy problem
+    if(cutoffFrequency >= qMin(nyquist - 1000.0, 21000.0)) {
+        return;
+    }
+
+    analysis->cutoffFrequency = cutoffFrequency;
+
+    // A real encoder cut-off stays at the floor all the way up. Content returning above it is more likely a notch or a quiet mix
+    double floorLevel = bandMean(cutoffFrequency + 300.0, qMin(cutoffFrequency + 1500.0, nyquist - 100.0));
+    bool floorIsFlat = true;
+    for(double frequency = cutoffFrequency + 1500.0; frequency + 500.0 <= nyquist - 100.0; frequency += 500.0) {
+        if(bandMean(frequency, frequency + 500.0) > floorLevel + 10.0) {
+            floorIsFlat = false;
+            break;
+        }
+    }
+
+    // The 16kHz shelf: a step down at 16kHz that's larger than the general slope of the spectrum just below it
+    if(cutoffFrequency > 17000.0) {
+        double step = bandMean(15000.0, 15800.0) - bandMean(16200.0, 17000.0);
+        double slope = bandMean(14200.0, 15000.0) - bandMean(15000.0, 15800.0);
+        analysis->shelfAt16k = step >= 5.0 && step - qMax(slope, 0.0) >= 4.0;
+    }
+
+    // Find the encode whose cut-off is closest to the one measured
+    const lossySignature_t *closestSignature = nullptr;
+    for(const lossySignature_t &signature : lossySignatures) {
+        if(qAbs(signature.cutoffFrequency - cutoffFrequency) <= signatureTolerance &&
+                (closestSignature == nullptr || qAbs(signature.cutoffFrequency - cutoffFrequency) < qAbs(closestSignature->cutoffFrequency - cutoffFrequency))) {
+            closestSignature = &signature;
+        }
+    }
+
+    // Name the most likely source. MP3s that normally leave a shelf but didn't here point to AAC, Vorbis, etc.
+    if(closestSignature != nullptr && (analysis->shelfAt16k || !closestSignature->expectsShelf)) {
+        analysis->suspectedSource = closestSignature->sourceName;
+    }
+    else if(closestSignature != nullptr || analysis->shelfAt16k) {
+        analysis->suspectedSource = "AAC, Vorbis, or other lossy encoder";
+    }
+    else {
+        analysis->suspectedSource = "Unknown lossy encoder";
+    }
+
+    // Confidence is mostly the steepness of the cliff (20dB = 0.1, 40dB+ = 0.55), with extra weight for a shelf and a known cut-off
+    double confidence = 0.55 * qBound(0.0, (steepestDrop - 15.0) / 25.0, 1.0);
+    if(analysis->shelfAt16k) {
+        confidence += 0.25;
+    }
+    if(closestSignature != nullptr) {
+        confidence += 0.2;
+    }
+    if(!floorIsFlat) {
+        confidence *= 0.5;
+    }
+
+    analysis->confidence = qBound(0.0, confidence, 1.0);
+    analysis->likelyTranscode = analysis->confidence >= TRANSCODE_CONFIDENCE_THRESHOLD;
+}
+
+// Builds a readable list of the tracks flagged as likely transcodes, for showing to the user
+QString describeTranscodeResults(const QList<spectrumAnalysis_t> &analyses) {
+    QString description;
+
+    foreach(const spectrumAnalysis_t &analysis, analyses) {
+        if(!analysis.likelyTranscode) {
+            continue;
+        }
+
+        description += QString("%1\n    %2 (cut-off %3kHz%4, %5% confidence)\n")
+                .arg(QFileInfo(analysis.inputFLAC).fileName())
+                .arg(analysis.suspectedSource)
+                .arg(analysis.cutoffFrequency / 1000.0, 0, 'f', 1)
+                .arg(analysis.shelfAt16k ? ", 16kHz shelf" : "")
+                .arg(qRound(analysis.confidence * 100.0));
+    }
+
+    return description;
+}
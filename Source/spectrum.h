@@ -0,0 +1,32 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <helper.h>
+#include <fft.h>
+
+#include <QtMath>
+
+// Confidence (0.0 to 1.0) at or above which a track is reported as a likely transcode
+#define TRANSCODE_CONFIDENCE_THRESHOLD 0.6
+
+// Result of scanning one FLAC's long-term average spectrum for the marks lossy encoders leave behind
+struct spectrumAnalysis_t {
+    QString inputFLAC;
+    int sampleRate;
+    // Long-term average power per FFT bin in dB, from 0 Hz to the Nyquist frequency
+    QVector<double> averageSpectrum;
+    // Frequency (Hz) of the steepest high-frequency cliff, or the Nyquist frequency if there isn't one
+    double cutoffFrequency;
+    // MP3 encoders drop the 16kHz+ scalefactor band at lower bitrates, leaving a visible step there
+    bool shelfAt16k;
+    // Encoder/bitrate whose signature matches best (e.g. "MP3 320kbps CBR"), or "" if nothing matched
+    QString suspectedSource;
+    double confidence;
+    bool likelyTranscode;
+};
+
+bool analyzeSpectrum(QString inputFLAC, spectrumAnalysis_t *analysis);
+void detectLossySignature(spectrumAnalysis_t *analysis);
+QString describeTranscodeResults(const QList<spectrumAnalysis_t> &analyses);
+
+#endif // SPECTRUM_H
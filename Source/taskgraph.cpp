@@ -0,0 +1,260 @@
+#include "taskgraph.h"
+
+TaskGraph::TaskGraph(QObject *parent) :
+    QObject(parent),
+    unfinishedNodes(0),
+    cancelRequested(false)
+{
+}
+
+// Adds a step to the graph and returns its index. Nodes are linked when the graph is run, so they can be added in any order
+int TaskGraph::addNode(QString name, QStringList inputs, QStringList outputs, std::function<bool()> run) {
+    nodes.append(taskNode_t{name, inputs, outputs, run, TASKNODE_WAITING, {}, 0, 0});
+    return nodes.count() - 1;
+}
+
+// Makes every node depend on the nodes that produce its inputs
+void TaskGraph::linkNodes() {
+    for(int i = 0; i < nodes.count(); i++) {
+        nodes[i].dependents.clear();
+        nodes[i].pendingInputs = 0;
+    }
+
+    for(int i = 0; i < nodes.count(); i++) {
+        for(int j = 0; j < nodes.count(); j++) {
+            if(i == j) {
+                continue;
+            }
+            foreach(QString currentInput, nodes[i].inputs) {
+                if(nodes[j].outputs.contains(currentInput)) {
+                    nodes[j].dependents += i;
+                    nodes[i].pendingInputs++;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Checks that every node can eventually run, i.e. no node (indirectly) depends on itself
+bool TaskGraph::isAcyclic() {
+    QVector<int> pendingInputs(nodes.count());
+    QList<int> readyNodes;
+    for(int i = 0; i < nodes.count(); i++) {
+        pendingInputs[i] = nodes[i].pendingInputs;
+        if(pendingInputs[i] == 0) {
+            readyNodes += i;
+        }
+    }
+
+    int reachedNodes = 0;
+    while(!readyNodes.isEmpty()) {
+        int nodeIndex = readyNodes.takeFirst();
+        reachedNodes++;
+        foreach(int dependentIndex, nodes[nodeIndex].dependents) {
+            if(--pendingInputs[dependentIndex] == 0) {
+                readyNodes += dependentIndex;
+            }
+        }
+    }
+
+    return reachedNodes == nodes.count();
+}
+
+// Runs every node and blocks until all of them have finished, failed or been cancelled
+// Returns true if every node succeeded
+bool TaskGraph::run(int threadCount) {
+    threadCount = qMax(1, qMin(threadCount, nodes.count()));
+    linkNodes();
+
+    // Nodes in a dependency cycle would never become ready and keep the workers waiting forever
+    if(!isAcyclic()) {
+        return false;
+    }
+
+    QMutexLocker graphLocker(&graphMutex);
+    readyQueues = QVector<std::deque<int>>(threadCount);
+    unfinishedNodes = 0;
+
+    // Hand out the nodes that can start right away across the threads. Nodes cancelled before the graph started are left out
+    int nextQueue = 0;
+    for(int i = 0; i < nodes.count(); i++) {
+        if(nodes[i].state != TASKNODE_WAITING) {
+            continue;
+        }
+        unfinishedNodes++;
+        if(nodes[i].pendingInputs == 0) {
+            nodes[i].state = TASKNODE_READY;
+            readyQueues[nextQueue].push_back(i);
+            nextQueue = (nextQueue + 1) % threadCount;
+        }
+    }
+    for(int i = 0; i < nodes.count(); i++) {
+        if(nodes[i].state == TASKNODE_CANCELLED) {
+            cancelDependents(i);
+        }
+    }
+    graphLocker.unlock();
+
+    QThreadPool graphPool;
+    graphPool.setMaxThreadCount(threadCount);
+    for(int i = 0; i < threadCount; i++) {
+        QtConcurrent::run(&graphPool, this, &TaskGraph::runWorker, i);
+    }
+    graphPool.waitForDone();
+
+    foreach(taskNode_t currentNode, nodes) {
+        if(currentNode.state != TASKNODE_SUCCEEDED) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Takes a node to run, or returns -1 if there's nothing to run right now. Has to be called with graphMutex locked
+int TaskGraph::takeReadyNode(int threadIndex) {
+    // Newest node of this thread's own queue first, as it usually works on the files the thread just wrote
+    if(!readyQueues[threadIndex].empty()) {
+        int nodeIndex = readyQueues[threadIndex].back();
+        readyQueues[threadIndex].pop_back();
+        return nodeIndex;
+    }
+
+    // Otherwise steal the oldest node of another thread's queue
+    for(int i = 1; i < readyQueues.count(); i++) {
+        std::deque<int> &victimQueue = readyQueues[(threadIndex + i) % readyQueues.count()];
+        if(!victimQueue.empty()) {
+            int nodeIndex = victimQueue.front();
+            victimQueue.pop_front();
+            return nodeIndex;
+        }
+    }
+
+    return -1;
+}
+
+// Loop of each graph thread: run ready nodes until every node has finished
+void TaskGraph::runWorker(int threadIndex) {
+    QMutexLocker graphLocker(&graphMutex);
+
+    while(unfinishedNodes > 0) {
+        int nodeIndex = takeReadyNode(threadIndex);
+        if(nodeIndex < 0) {
+            workAvailable.wait(&graphMutex);
+            continue;
+        }
+
+        // Nodes can be cancelled while they wait in a queue
+        if(nodes[nodeIndex].state == TASKNODE_CANCELLED) {
+            continue;
+        }
+
+        nodes[nodeIndex].state = TASKNODE_RUNNING;
+        std::function<bool()> nodeRun = nodes[nodeIndex].run;
+        QString nodeName = nodes[nodeIndex].name;
+
+        // Run the node without holding the lock, so other threads can keep taking nodes
+        graphLocker.unlock();
+        emit nodeStarted(nodeName);
+        QElapsedTimer nodeTimer;
+        nodeTimer.start();
+        bool succeeded = !cancelRequested && nodeRun();
+        qint64 nodeMilliseconds = nodeTimer.elapsed();
+        emit nodeFinished(nodeName, succeeded);
+        graphLocker.relock();
+
+        nodes[nodeIndex].milliseconds = nodeMilliseconds;
+        unfinishedNodes--;
+
+        if(succeeded && nodes[nodeIndex].state == TASKNODE_RUNNING) {
+            nodes[nodeIndex].state = TASKNODE_SUCCEEDED;
+            // Dependents that now have all of their inputs go to this thread's queue, where they'll run next
+            foreach(int dependentIndex, nodes[nodeIndex].dependents) {
+                if(--nodes[dependentIndex].pendingInputs == 0 && nodes[dependentIndex].state == TASKNODE_WAITING) {
+                    nodes[dependentIndex].state = TASKNODE_READY;
+                    readyQueues[threadIndex].push_back(dependentIndex);
+                }
+            }
+        }
+        else {
+            nodes[nodeIndex].state = cancelRequested ? TASKNODE_CANCELLED : TASKNODE_FAILED;
+            cancelDependents(nodeIndex);
+        }
+
+        // Wake up the other threads for new nodes, or so they can return once everything is done
+        workAvailable.wakeAll();
+    }
+}
+
+// Cancels everything that depends on a node, directly or not. Has to be called with graphMutex locked
+void TaskGraph::cancelDependents(int nodeIndex) {
+    foreach(int dependentIndex, nodes[nodeIndex].dependents) {
+        taskNodeState_t dependentState = nodes[dependentIndex].state;
+        if(dependentState == TASKNODE_WAITING || dependentState == TASKNODE_READY) {
+            nodes[dependentIndex].state = TASKNODE_CANCELLED;
+            unfinishedNodes--;
+            emit nodeCancelled(nodes[dependentIndex].name);
+            cancelDependents(dependentIndex);
+        }
+    }
+}
+
+// Cancels a node that hasn't started yet, along with everything that depends on it. Nodes that already started run to completion
+void TaskGraph::cancelNode(QString name) {
+    QMutexLocker graphLocker(&graphMutex);
+
+    for(int i = 0; i < nodes.count(); i++) {
+        if(nodes[i].name == name && (nodes[i].state == TASKNODE_WAITING || nodes[i].state == TASKNODE_READY)) {
+            nodes[i].state = TASKNODE_CANCELLED;
+            unfinishedNodes--;
+            emit nodeCancelled(name);
+            cancelDependents(i);
+        }
+    }
+
+    workAvailable.wakeAll();
+}
+
+// Cancels every node that hasn't started yet. Long-running nodes can check isCancelled() to stop early
+void TaskGraph::cancel() {
+    cancelRequested = true;
+
+    QMutexLocker graphLocker(&graphMutex);
+    for(int i = 0; i < nodes.count(); i++) {
+        if(nodes[i].state == TASKNODE_WAITING || nodes[i].state == TASKNODE_READY) {
+            nodes[i].state = TASKNODE_CANCELLED;
+            unfinishedNodes--;
+            emit nodeCancelled(nodes[i].name);
+        }
+    }
+
+    workAvailable.wakeAll();
+}
+
+bool TaskGraph::isCancelled() {
+    return cancelRequested;
+}
+
+taskNodeState_t TaskGraph::nodeState(QString name) {
+    QMutexLocker graphLocker(&graphMutex);
+
+    foreach(taskNode_t currentNode, nodes) {
+        if(currentNode.name == name) {
+            return currentNode.state;
+        }
+    }
+    return TASKNODE_CANCELLED;
+}
+
+// How long each node that ran took, by node name
+QMap<QString, qint64> TaskGraph::nodeTimings() {
+    QMutexLocker graphLocker(&graphMutex);
+
+    QMap<QString, qint64> timings;
+    foreach(taskNode_t currentNode, nodes) {
+        if(currentNode.state == TASKNODE_SUCCEEDED || currentNode.state == TASKNODE_FAILED) {
+            timings[QString(currentNode.name).remove("...")] += currentNode.milliseconds;
+        }
+    }
+    return timings;
+}
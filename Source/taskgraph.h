@@ -0,0 +1,78 @@
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <helper.h>
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <deque>
+
+// States a node of a TaskGraph goes through
+enum taskNodeState_t {
+    TASKNODE_WAITING,
+    TASKNODE_READY,
+    TASKNODE_RUNNING,
+    TASKNODE_SUCCEEDED,
+    TASKNODE_FAILED,
+    TASKNODE_CANCELLED
+};
+
+// One step of a TaskGraph. It runs once every node producing one of its inputs has succeeded
+struct taskNode_t {
+    // Shown while it runs, e.g. "Compressing images..."
+    QString name;
+    // Named things the node reads and writes (e.g. "audio", "extras"), used to work out what it depends on
+    QStringList inputs;
+    QStringList outputs;
+    // Does the work. Returning false fails the node, which cancels everything that depends on it
+    std::function<bool()> run;
+    taskNodeState_t state;
+    // Nodes that can't start before this one has succeeded, and how many nodes this one is still waiting for
+    QList<int> dependents;
+    int pendingInputs;
+    qint64 milliseconds;
+};
+
+// Runs a set of steps on a few threads, in whatever order their inputs and outputs allow, so steps that don't touch the same files overlap
+// Each thread has its own queue of ready nodes and takes work from the others' queues when it runs out (work stealing)
+class TaskGraph : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TaskGraph(QObject *parent = nullptr);
+    int addNode(QString name, QStringList inputs, QStringList outputs, std::function<bool()> run);
+    bool run(int threadCount = QThread::idealThreadCount());
+    void cancelNode(QString name);
+    void cancel();
+    bool isCancelled();
+    taskNodeState_t nodeState(QString name);
+    QMap<QString, qint64> nodeTimings();
+
+signals:
+    // Emitted from the thread running the node; connect with Qt::QueuedConnection to touch the UI
+    void nodeStarted(QString name);
+    void nodeFinished(QString name, bool succeeded);
+    void nodeCancelled(QString name);
+
+private:
+    QList<taskNode_t> nodes;
+    // Ready nodes, one queue per thread. A thread takes its newest node, and steals the oldest node of another thread's queue
+    QVector<std::deque<int>> readyQueues;
+    QMutex graphMutex;
+    QWaitCondition workAvailable;
+    int unfinishedNodes;
+    std::atomic<bool> cancelRequested;
+    void linkNodes();
+    bool isAcyclic();
+    void cancelDependents(int nodeIndex);
+    int takeReadyNode(int threadIndex);
+    void runWorker(int threadIndex);
+};
+
+#endif // TASKGRAPH_H
@@ -0,0 +1,379 @@
+#include "torrent.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Bencoding. Lists and dictionaries take values that are already encoded; QMap keeps dictionary keys in the raw byte order the format asks for
+static QByteArray bencodeInteger(qint64 value) {
+    return "i" + QByteArray::number(value) + "e";
+}
+
+static QByteArray bencodeString(QByteArray value) {
+    return QByteArray::number(value.size()) + ":" + value;
+}
+
+static QByteArray bencodeList(QList<QByteArray> encodedItems) {
+    QByteArray encodedList = "l";
+    foreach(QByteArray encodedItem, encodedItems) {
+        encodedList += encodedItem;
+    }
+    return encodedList + "e";
+}
+
+static QByteArray bencodeDictionary(QMap<QByteArray, QByteArray> encodedValues) {
+    QByteArray encodedDictionary = "d";
+    foreach(QByteArray key, encodedValues.keys()) {
+        encodedDictionary += bencodeString(key) + encodedValues.value(key);
+    }
+    return encodedDictionary + "e";
+}
+
+static QByteArray bencodePath(QStringList pathComponents) {
+    QList<QByteArray> encodedComponents;
+    foreach(QString pathComponent, pathComponents) {
+        encodedComponents += bencodeString(pathComponent.toUtf8());
+    }
+    return bencodeList(encodedComponents);
+}
+
+static qint64 nextPowerOfTwo(qint64 value) {
+    qint64 powerOfTwo = 1;
+    while(powerOfTwo < value) {
+        powerOfTwo *= 2;
+    }
+    return powerOfTwo;
+}
+
+// Root of a SHA-256 merkle tree over a layer of hashes, padded with padHash up to leafCount leaves (a power of two)
+static QByteArray merkleRoot(QByteArray layer, qint64 leafCount, QByteArray padHash) {
+    while(layer.size() / SHA256_DIGEST_SIZE < leafCount) {
+        layer += padHash;
+    }
+    while(layer.size() > SHA256_DIGEST_SIZE) {
+        QByteArray parentLayer(layer.size() / 2, Qt::Uninitialized);
+        for(int i = 0; i < parentLayer.size() / SHA256_DIGEST_SIZE; i++) {
+            sha256Digest(layer.constData() + 2 * SHA256_DIGEST_SIZE * i, 2 * SHA256_DIGEST_SIZE, parentLayer.data() + SHA256_DIGEST_SIZE * i);
+        }
+        layer = parentLayer;
+    }
+    return layer;
+}
+
+// Reads length bytes of the v1 piece stream (every file back to back) from offset
+static bool readStream(const QVector<torrentFile_t> &files, qint64 offset, char *buffer, qint64 length) {
+    // First file that ends after offset
+    int fileIndex = std::upper_bound(files.begin(), files.end(), offset, [](qint64 streamOffset, const torrentFile_t &file) {
+        return streamOffset < file.offset + file.size;
+    }) - files.begin();
+
+    while(length > 0 && fileIndex < files.count()) {
+        const torrentFile_t &file = files[fileIndex];
+        qint64 readLength = qMin(length, file.size - (offset - file.offset));
+        if(readLength > 0) {
+            QFile inputFile(file.path);
+            if(!inputFile.open(QIODevice::ReadOnly) || !inputFile.seek(offset - file.offset) || inputFile.read(buffer, readLength) != readLength) {
+                return false;
+            }
+            buffer += readLength;
+            offset += readLength;
+            length -= readLength;
+        }
+        fileIndex++;
+    }
+    return length == 0;
+}
+
+// Hashes the pieces of a v1 torrent's task, into pieces (SHA1_DIGEST_SIZE bytes per piece)
+static bool hashStreamPieces(const QVector<torrentFile_t> &files, qint64 streamSize, qint64 pieceSize, torrentTask_t task, char *pieces) {
+    QByteArray pieceBuffer(static_cast<int>(pieceSize), Qt::Uninitialized);
+    for(qint64 piece = task.firstPiece; piece < task.firstPiece + task.pieceCount; piece++) {
+        qint64 pieceLength = qMin(pieceSize, streamSize - piece * pieceSize);
+        if(!readStream(files, piece * pieceSize, pieceBuffer.data(), pieceLength)) {
+            return false;
+        }
+        sha1Digest(pieceBuffer.constData(), pieceLength, pieces + SHA1_DIGEST_SIZE * piece);
+    }
+    return true;
+}
+
+// Hashes the pieces of one file's task: each piece's merkle subtree into pieceLayer, and for hybrid torrents its (padded) SHA-1 into pieces
+static bool hashFilePieces(const torrentFile_t &file, qint64 pieceSize, torrentVersion_t version, torrentTask_t task, char *pieceLayer, char *pieces) {
+    QFile inputFile(file.path);
+    if(!inputFile.open(QIODevice::ReadOnly) || !inputFile.seek(task.firstPiece * pieceSize)) {
+        return false;
+    }
+
+    qint64 filePieces = (file.size + pieceSize - 1) / pieceSize;
+    QByteArray pieceBuffer(static_cast<int>(pieceSize), Qt::Uninitialized);
+    QByteArray leaves;
+    for(qint64 piece = task.firstPiece; piece < task.firstPiece + task.pieceCount; piece++) {
+        qint64 pieceLength = qMin(pieceSize, file.size - piece * pieceSize);
+        if(inputFile.read(pieceBuffer.data(), pieceLength) != pieceLength) {
+            return false;
+        }
+
+        // A file of one piece is its own tree, only padded up to a power of two of its blocks; longer files are padded to whole pieces
+        int blockCount = static_cast<int>((pieceLength + TORRENT_BLOCK_SIZE - 1) / TORRENT_BLOCK_SIZE);
+        leaves.resize(blockCount * SHA256_DIGEST_SIZE);
+        for(int block = 0; block < blockCount; block++) {
+            qint64 blockOffset = static_cast<qint64>(block) * TORRENT_BLOCK_SIZE;
+            sha256Digest(pieceBuffer.constData() + blockOffset, qMin(static_cast<qint64>(TORRENT_BLOCK_SIZE), pieceLength - blockOffset), leaves.data() + SHA256_DIGEST_SIZE * block);
+        }
+        qint64 leafCount = filePieces > 1 ? pieceSize / TORRENT_BLOCK_SIZE : nextPowerOfTwo(blockCount);
+        QByteArray pieceRoot = merkleRoot(leaves, leafCount, QByteArray(SHA256_DIGEST_SIZE, '\0'));
+        memcpy(pieceLayer + SHA256_DIGEST_SIZE * piece, pieceRoot.constData(), SHA256_DIGEST_SIZE);
+
+        if(version == TORRENT_HYBRID) {
+            // The padding file after it fills the rest of the file's last piece with zeros
+            if(piece == filePieces - 1 && file.padding > 0) {
+                memset(pieceBuffer.data() + pieceLength, 0, file.padding);
+                pieceLength += file.padding;
+            }
+            sha1Digest(pieceBuffer.constData(), pieceLength, pieces + SHA1_DIGEST_SIZE * (file.firstPiece + piece));
+        }
+    }
+    return true;
+}
+
+// The file tree of a v2 torrent, from depth on, for the given files (all sharing their path up to depth)
+static QByteArray bencodeFileTree(const QVector<torrentFile_t> &files, QList<int> fileIndexes, int depth) {
+    QMap<QByteArray, QList<int>> children;
+    foreach(int fileIndex, fileIndexes) {
+        children[files[fileIndex].pathComponents[depth].toUtf8()] += fileIndex;
+    }
+
+    QMap<QByteArray, QByteArray> encodedChildren;
+    foreach(QByteArray childName, children.keys()) {
+        QList<int> childIndexes = children.value(childName);
+        const torrentFile_t &firstChild = files[childIndexes[0]];
+        if(firstChild.pathComponents.count() > depth + 1) {
+            encodedChildren.insert(childName, bencodeFileTree(files, childIndexes, depth + 1));
+            continue;
+        }
+
+        QMap<QByteArray, QByteArray> fileEntry;
+        fileEntry.insert("length", bencodeInteger(firstChild.size));
+        if(firstChild.size > 0) {
+            fileEntry.insert("pieces root", bencodeString(firstChild.piecesRoot));
+        }
+        QMap<QByteArray, QByteArray> fileNode;
+        fileNode.insert("", bencodeDictionary(fileEntry));
+        encodedChildren.insert(childName, bencodeDictionary(fileNode));
+    }
+    return bencodeDictionary(encodedChildren);
+}
+
+// Torrent options as set in the settings window
+torrentSettings_t readTorrentSettings() {
+    QSettings MIKSettings;
+    torrentSettings_t settings{MIKSettings.value("sDefaultTorrentAnnounce", "").toString(),
+                               MIKSettings.value("sDefaultTorrentSource", "").toString(),
+                               MIKSettings.value("bDefaultTorrentPrivate", true).toBool(),
+                               0,
+                               TORRENT_V1};
+
+    // e.g. "512 KiB" or "4 MiB"; anything else is automatic
+    QString pieceSizeText = MIKSettings.value("sDefaultTorrentPieceSize", "Auto").toString();
+    if(pieceSizeText.endsWith(" KiB")) {
+        settings.pieceSize = pieceSizeText.section(' ', 0, 0).toLongLong() * 1024;
+    }
+    else if(pieceSizeText.endsWith(" MiB")) {
+        settings.pieceSize = pieceSizeText.section(' ', 0, 0).toLongLong() * 1024 * 1024;
+    }
+
+    QString versionText = MIKSettings.value("sDefaultTorrentVersion", "v1").toString();
+    if(versionText == "v2") {
+        settings.version = TORRENT_V2;
+    }
+    else if(versionText == "Hybrid") {
+        settings.version = TORRENT_HYBRID;
+    }
+    return settings;
+}
+
+// Creates torrentPath, a torrent of everything in contentDir (named after the folder)
+// Pieces are hashed by a pool of threads, files that are still in the page cache (e.g. just written by the conversion) first
+bool createTorrent(QDir contentDir, QString torrentPath, torrentSettings_t settings) {
+    QVector<torrentFile_t> files;
+    foreach(QString filePath, findFiles(contentDir, {"*"})) {
+        // Neither the torrent itself nor folders still being cleaned up by the conversion (e.g. the extras folder) are part of the album
+        QString relativePath = contentDir.relativeFilePath(filePath);
+        if(QFileInfo(filePath) == QFileInfo(torrentPath) || relativePath.startsWith(".qMusicImportKit ") || relativePath.contains("/.qMusicImportKit ")) {
+            continue;
+        }
+        qint64 fileSize = QFileInfo(filePath).size();
+        double cachedFraction = fileSize > 0 ? static_cast<double>(cachedFileBytes(filePath)) / fileSize : 0.0;
+        files.append(torrentFile_t{filePath, relativePath.split('/'), fileSize, 0, 0, 0, cachedFraction, {}, {}});
+    }
+    if(files.isEmpty()) {
+        return false;
+    }
+
+    // Files are listed in path order, compared component by component, which is the order of a v2 file tree
+    std::sort(files.begin(), files.end(), [](const torrentFile_t &a, const torrentFile_t &b) {
+        for(int i = 0; i < qMin(a.pathComponents.count(), b.pathComponents.count()); i++) {
+            QByteArray componentA = a.pathComponents[i].toUtf8();
+            QByteArray componentB = b.pathComponents[i].toUtf8();
+            if(componentA != componentB) {
+                return componentA < componentB;
+            }
+        }
+        return a.pathComponents.count() < b.pathComponents.count();
+    });
+
+    qint64 contentSize = 0;
+    foreach(const torrentFile_t &file, files) {
+        contentSize += file.size;
+    }
+
+    qint64 pieceSize = settings.pieceSize;
+    if(pieceSize <= 0) {
+        pieceSize = TORRENT_MIN_PIECE_SIZE;
+        while(pieceSize < TORRENT_MAX_PIECE_SIZE && contentSize / pieceSize > TORRENT_TARGET_PIECES) {
+            pieceSize *= 2;
+        }
+    }
+
+    // Lay the files out in the v1 piece stream. Hybrid torrents pad every file but the last up to the next piece
+    qint64 streamSize = 0;
+    for(int i = 0; i < files.count(); i++) {
+        files[i].offset = streamSize;
+        files[i].firstPiece = streamSize / pieceSize;
+        if(settings.version == TORRENT_HYBRID && i < files.count() - 1 && files[i].size % pieceSize != 0) {
+            files[i].padding = pieceSize - files[i].size % pieceSize;
+        }
+        streamSize += files[i].size + files[i].padding;
+        if(settings.version != TORRENT_V1) {
+            files[i].pieceLayer = QByteArray(static_cast<int>((files[i].size + pieceSize - 1) / pieceSize * SHA256_DIGEST_SIZE), '\0');
+        }
+    }
+    qint64 pieceCount = (streamSize + pieceSize - 1) / pieceSize;
+    QByteArray pieces(settings.version != TORRENT_V2 ? static_cast<int>(pieceCount * SHA1_DIGEST_SIZE) : 0, '\0');
+
+    // Split the work into tasks of about TORRENT_TASK_BYTES: runs of pieces of the v1 stream, or of each file for v2/hybrid
+    qint64 piecesPerTask = qMax(1LL, TORRENT_TASK_BYTES / pieceSize);
+    QList<torrentTask_t> tasks;
+    if(settings.version == TORRENT_V1) {
+        for(qint64 piece = 0; piece < pieceCount; piece += piecesPerTask) {
+            torrentTask_t task{-1, piece, qMin(piecesPerTask, pieceCount - piece), 0.0};
+            // How much of the task's data is cached, from the files it covers
+            qint64 taskStart = piece * pieceSize;
+            qint64 taskEnd = qMin(streamSize, (piece + task.pieceCount) * pieceSize);
+            foreach(const torrentFile_t &file, files) {
+                qint64 overlap = qMin(taskEnd, file.offset + file.size) - qMax(taskStart, file.offset);
+                if(overlap > 0) {
+                    task.cachedFraction += file.cachedFraction * overlap / (taskEnd - taskStart);
+                }
+            }
+            tasks.append(task);
+        }
+    }
+    else {
+        for(int i = 0; i < files.count(); i++) {
+            qint64 filePieces = (files[i].size + pieceSize - 1) / pieceSize;
+            for(qint64 piece = 0; piece < filePieces; piece += piecesPerTask) {
+                tasks.append(torrentTask_t{i, piece, qMin(piecesPerTask, filePieces - piece), files[i].cachedFraction});
+            }
+        }
+    }
+
+    // Hot data first: it hashes at full speed while the threads behind it wait on the disk for the rest
+    std::stable_sort(tasks.begin(), tasks.end(), [](const torrentTask_t &a, const torrentTask_t &b) {
+        return a.cachedFraction > b.cachedFraction;
+    });
+
+    // Tasks only ever write their own pieces, through pointers taken here so nothing is detached while they run
+    char *piecesData = pieces.data();
+    QVector<char *> pieceLayerData;
+    for(int i = 0; i < files.count(); i++) {
+        pieceLayerData.append(files[i].pieceLayer.data());
+    }
+
+    QThreadPool hashPool;
+    std::atomic<bool> readFailed(false);
+    const QVector<torrentFile_t> &layout = files;
+    foreach(torrentTask_t task, tasks) {
+        QtConcurrent::run(&hashPool, [&, task]() {
+            if(readFailed) {
+                return;
+            }
+            bool hashed = task.fileIndex < 0 ? hashStreamPieces(layout, streamSize, pieceSize, task, piecesData) : hashFilePieces(layout[task.fileIndex], pieceSize, settings.version, task, pieceLayerData[task.fileIndex], piecesData);
+            if(!hashed) {
+                readFailed = true;
+            }
+        });
+    }
+    hashPool.waitForDone();
+    if(readFailed) {
+        return false;
+    }
+
+    QMap<QByteArray, QByteArray> info;
+    info.insert("name", bencodeString(contentDir.dirName().toUtf8()));
+    info.insert("piece length", bencodeInteger(pieceSize));
+    if(settings.isPrivate) {
+        info.insert("private", bencodeInteger(1));
+    }
+    if(settings.source != "") {
+        info.insert("source", bencodeString(settings.source.toUtf8()));
+    }
+
+    if(settings.version != TORRENT_V2) {
+        QList<QByteArray> fileList;
+        foreach(const torrentFile_t &file, files) {
+            QMap<QByteArray, QByteArray> fileEntry;
+            fileEntry.insert("length", bencodeInteger(file.size));
+            fileEntry.insert("path", bencodePath(file.pathComponents));
+            fileList += bencodeDictionary(fileEntry);
+
+            if(file.padding > 0) {
+                QMap<QByteArray, QByteArray> paddingEntry;
+                paddingEntry.insert("attr", bencodeString("p"));
+                paddingEntry.insert("length", bencodeInteger(file.padding));
+                paddingEntry.insert("path", bencodePath({".pad", QString::number(file.padding)}));
+                fileList += bencodeDictionary(paddingEntry);
+            }
+        }
+        info.insert("files", bencodeList(fileList));
+        info.insert("pieces", bencodeString(pieces));
+    }
+
+    QMap<QByteArray, QByteArray> pieceLayers;
+    if(settings.version != TORRENT_V1) {
+        // Hash of a whole piece of zeros, which pads the piece layers of longer files up to a power of two
+        QByteArray zeroPieceRoot = merkleRoot(QByteArray(), pieceSize / TORRENT_BLOCK_SIZE, QByteArray(SHA256_DIGEST_SIZE, '\0'));
+        QList<int> fileIndexes;
+        for(int i = 0; i < files.count(); i++) {
+            qint64 filePieces = files[i].pieceLayer.size() / SHA256_DIGEST_SIZE;
+            if(filePieces == 1) {
+                files[i].piecesRoot = files[i].pieceLayer;
+            }
+            else if(filePieces > 1) {
+                files[i].piecesRoot = merkleRoot(files[i].pieceLayer, nextPowerOfTwo(filePieces), zeroPieceRoot);
+                // Only files longer than a piece list their piece hashes
+                pieceLayers.insert(files[i].piecesRoot, bencodeString(files[i].pieceLayer));
+            }
+            fileIndexes += i;
+        }
+        info.insert("file tree", bencodeFileTree(files, fileIndexes, 0));
+        info.insert("meta version", bencodeInteger(2));
+    }
+
+    QMap<QByteArray, QByteArray> torrent;
+    if(settings.announce != "") {
+        torrent.insert("announce", bencodeString(settings.announce.toUtf8()));
+    }
+    torrent.insert("created by", bencodeString("qMusicImportKit"));
+    torrent.insert("creation date", bencodeInteger(QDateTime::currentSecsSinceEpoch()));
+    torrent.insert("info", bencodeDictionary(info));
+    if(!pieceLayers.isEmpty()) {
+        torrent.insert("piece layers", bencodeDictionary(pieceLayers));
+    }
+
+    QSaveFile torrentFile(torrentPath);
+    if(!torrentFile.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    torrentFile.write(bencodeDictionary(torrent));
+    return torrentFile.commit();
+}
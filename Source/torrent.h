@@ -0,0 +1,69 @@
+#ifndef TORRENT_H
+#define TORRENT_H
+
+#include <helper.h>
+#include <pagecache.h>
+#include <sha.h>
+
+#include <QMutex>
+#include <QThreadPool>
+
+#include <atomic>
+
+// v2 hashes every file in blocks of this size, the leaves of its merkle tree
+#define TORRENT_BLOCK_SIZE (16 * 1024)
+// Automatic piece sizes aim for about this many pieces, within the sizes below
+#define TORRENT_TARGET_PIECES 1500
+#define TORRENT_MIN_PIECE_SIZE (256 * 1024)
+#define TORRENT_MAX_PIECE_SIZE (16 * 1024 * 1024)
+// Roughly how much data each hashing task covers, so every thread gets several tasks and hot files can go first
+#define TORRENT_TASK_BYTES (16 * 1024 * 1024)
+
+enum torrentVersion_t {
+    // SHA-1 pieces over all files back to back, which every client understands
+    TORRENT_V1,
+    // Per-file SHA-256 merkle trees (BEP 52)
+    TORRENT_V2,
+    // Both, with v1 padding files so every file starts on a piece (BEP 47)
+    TORRENT_HYBRID
+};
+
+// What the torrents are made with, from the settings window
+struct torrentSettings_t {
+    QString announce;
+    QString source;
+    bool isPrivate;
+    // 0 to pick one from the content's size
+    qint64 pieceSize;
+    torrentVersion_t version;
+};
+
+// One file of the torrent, in torrent order
+struct torrentFile_t {
+    QString path;
+    QStringList pathComponents;
+    qint64 size;
+    // Where the file starts in the v1 piece stream, and its first v1 piece
+    qint64 offset;
+    qint64 firstPiece;
+    // Hybrid torrents: zeros added after the file to reach the next piece
+    qint64 padding;
+    // Part of the file that was in the page cache before hashing started
+    double cachedFraction;
+    // v2 hash of each of the file's pieces, and the root of its merkle tree
+    QByteArray pieceLayer;
+    QByteArray piecesRoot;
+};
+
+// Part of the hashing: pieceCount pieces from firstPiece on, of one file (v2/hybrid) or of the v1 stream (fileIndex -1)
+struct torrentTask_t {
+    int fileIndex;
+    qint64 firstPiece;
+    qint64 pieceCount;
+    double cachedFraction;
+};
+
+torrentSettings_t readTorrentSettings();
+bool createTorrent(QDir contentDir, QString torrentPath, torrentSettings_t settings);
+
+#endif // TORRENT_H